@@ -3,8 +3,12 @@
 //==============================================================================
 
 #include <inttypes.h>
+#include <string.h>
+#include <esp_timer.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "hdw-dac.h"
 
 //==============================================================================
@@ -14,6 +18,21 @@
 /** The number of buffers to use. The more buffers, the longer latency */
 #define DMA_DESCRIPTORS 4
 
+/** The priority of the task which copies rendered samples to the DMA. It must preempt the render task */
+#define DAC_FEED_TASK_PRIORITY 10
+
+/** The priority of the task which renders samples. It must preempt the main loop, which has priority 1 */
+#define DAC_RENDER_TASK_PRIORITY 3
+
+/** The stack size of the task which copies rendered samples to the DMA, in bytes */
+#define DAC_FEED_TASK_STACK 2048
+
+/** The stack size of the task which renders samples, in bytes. The application's callback runs on this stack */
+#define DAC_RENDER_TASK_STACK 4096
+
+/** How often the tasks wake up to check if they should exit, in milliseconds */
+#define DAC_TASK_POLL_MS 50
+
 //==============================================================================
 // Variables
 //==============================================================================
@@ -24,18 +43,60 @@ static dac_continuous_handle_t dac_handle = NULL;
 /** Keep track of if the DAC is writing or not */
 static bool dacWriting = false;
 
-/** A queue to move dac_event_data_t from the interrupt to the main loop*/
+/** A queue to move dac_event_data_t from the interrupt to the feed task */
 static QueueHandle_t dacIsrQueue = NULL;
 
 /** A callback which will request DAC samples from the application */
 static fnDacCallback_t dacCb = NULL;
 
-/** A temporary buffer for the application to fill with audio samples before */
-static uint8_t tmpDacBuf[DAC_BUF_SIZE] = {0};
+/** Rendered buffers waiting to be copied to the DMA */
+static uint8_t dacRing[DAC_MAX_LATENCY][DAC_BUF_SIZE];
+
+/** Silence, written to the DMA when the ring is empty */
+static uint8_t dacSilence[DAC_BUF_SIZE];
+
+/** The total number of buffers ever rendered into the ring. Only written by the render task */
+static uint32_t ringHead = 0;
+
+/** The total number of buffers ever copied out of the ring. Only written by the feed task */
+static uint32_t ringTail = 0;
+
+/** The number of buffers to render ahead of the DMA */
+static uint8_t dacLatency = DAC_DEFAULT_LATENCY;
+
+/** The task which renders samples into the ring */
+static TaskHandle_t dacRenderTaskHandle = NULL;
+
+/** The task which copies samples from the ring to the DMA */
+static TaskHandle_t dacFeedTaskHandle = NULL;
+
+/** Held by the render task while calling the application, so the DAC can be stopped between buffers. It is recursive,
+ * so the callback can call functions which take dacLock() */
+static SemaphoreHandle_t dacCbMutex = NULL;
+
+/** Given by each task when it exits */
+static SemaphoreHandle_t dacTaskExitSem = NULL;
+
+/** Cleared to make the tasks exit */
+static volatile bool dacTasksRunning = false;
 
 /** The GPIO which controls amplifier shutdown */
 static gpio_num_t shdnGpio;
 
+/** Statistics about how well the callback is keeping up */
+static dacStats_t dacStats;
+
+/** The number of events dropped by the interrupt because every buffer was waiting to be refilled */
+static volatile uint32_t dacIsrUnderruns = 0;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static void dacFeedTask(void* arg);
+static void dacRenderTask(void* arg);
+static void dacRecordRender(int64_t renderUs, size_t len);
+
 //==============================================================================
 // Functions
 //==============================================================================
@@ -53,9 +114,10 @@ static bool IRAM_ATTR dac_on_convert_done_callback(dac_continuous_handle_t handl
 {
     QueueHandle_t queue = (QueueHandle_t)user_data;
     BaseType_t need_awoke;
-    /* When the queue is full, drop the oldest item */
+    /* When the queue is full, drop the oldest item. The feed task is stalled, so this is an underrun */
     if (xQueueIsQueueFullFromISR(queue))
     {
+        dacIsrUnderruns++;
         dac_event_data_t dummy;
         xQueueReceiveFromISR(queue, &dummy, &need_awoke);
     }
@@ -112,6 +174,22 @@ void initDac(dac_channel_mask_t channel, gpio_num_t shdn_gpio, fnDacCallback_t c
         };
         ESP_ERROR_CHECK(gpio_config(&shdn_gpio_config));
         ESP_ERROR_CHECK(gpio_set_level(shdn_gpio, 0));
+
+        dacResetStats();
+
+        /* Start with an empty ring */
+        memset(dacSilence, 128, sizeof(dacSilence));
+        ringHead = 0;
+        ringTail = 0;
+
+        /* Start the tasks. The ESP32-S2 has a single core, so they're pinned to it */
+        dacCbMutex      = xSemaphoreCreateRecursiveMutex();
+        dacTaskExitSem  = xSemaphoreCreateCounting(2, 0);
+        dacTasksRunning = true;
+        xTaskCreatePinnedToCore(dacRenderTask, "dacRender", DAC_RENDER_TASK_STACK, NULL, DAC_RENDER_TASK_PRIORITY,
+                                &dacRenderTaskHandle, 0);
+        xTaskCreatePinnedToCore(dacFeedTask, "dacFeed", DAC_FEED_TASK_STACK, NULL, DAC_FEED_TASK_PRIORITY,
+                                &dacFeedTaskHandle, 0);
     }
 }
 
@@ -125,6 +203,18 @@ void deinitDac(void)
         /* Stop the DAC */
         dacStop();
 
+        /* Stop the tasks and wait for both to exit */
+        dacTasksRunning = false;
+        xTaskNotifyGive(dacRenderTaskHandle);
+        xSemaphoreTake(dacTaskExitSem, portMAX_DELAY);
+        xSemaphoreTake(dacTaskExitSem, portMAX_DELAY);
+        dacRenderTaskHandle = NULL;
+        dacFeedTaskHandle   = NULL;
+        vSemaphoreDelete(dacTaskExitSem);
+        dacTaskExitSem = NULL;
+        vSemaphoreDelete(dacCbMutex);
+        dacCbMutex = NULL;
+
         /* Free resources */
         ESP_ERROR_CHECK(dac_continuous_del_channels(dac_handle));
         dac_handle = NULL;
@@ -163,44 +253,207 @@ void dacStart(void)
         ESP_ERROR_CHECK(dac_continuous_enable(dac_handle));
         ESP_ERROR_CHECK(dac_continuous_start_async_writing(dac_handle));
         dacWriting = true;
+
+        /* Start filling the ring */
+        xTaskNotifyGive(dacRenderTaskHandle);
     }
 }
 
 /**
- * @brief Stop the DAC.
+ * @brief Stop the DAC. This waits for the application to finish filling the current buffer, so samples will not be
+ * requested after this returns.
  */
 void dacStop(void)
 {
     if (dac_handle && dacWriting)
     {
+        xSemaphoreTakeRecursive(dacCbMutex, portMAX_DELAY);
+
         /* Stop and disable the continuous channels */
         ESP_ERROR_CHECK(dac_continuous_stop_async_writing(dac_handle));
         ESP_ERROR_CHECK(dac_continuous_disable(dac_handle));
         dacWriting = false;
+
+        xSemaphoreGiveRecursive(dacCbMutex);
     }
 }
 
 /**
- * @brief Poll the queue to see if any buffers need to be filled with audio samples
+ * @brief Wait for the callback to return, and keep it from being called again until dacUnlock() is called. This lets
+ * the main loop change state which the callback uses. Samples aren't rendered while the lock is held, so hold it
+ * briefly. It may be taken more than once, i.e. by the callback itself
  */
-void dacPoll(void)
+void dacLock(void)
 {
-    if (dac_handle && dacIsrQueue && dacWriting)
+    if (dacCbMutex)
     {
-        /* If there is an event to receive, receive it */
+        xSemaphoreTakeRecursive(dacCbMutex, portMAX_DELAY);
+    }
+}
+
+/**
+ * @brief Let the callback be called again after dacLock()
+ */
+void dacUnlock(void)
+{
+    if (dacCbMutex)
+    {
+        xSemaphoreGiveRecursive(dacCbMutex);
+    }
+}
+
+/**
+ * @brief Set how far ahead of the DMA samples are rendered. More buffers make underruns less likely when the render
+ * time varies, at the cost of latency between an event and hearing it
+ *
+ * @param blocks The number of ::DAC_BUF_SIZE buffers to render ahead, from 1 to ::DAC_MAX_LATENCY
+ */
+void dacSetLatency(uint8_t blocks)
+{
+    if (blocks < 1)
+    {
+        blocks = 1;
+    }
+    else if (blocks > DAC_MAX_LATENCY)
+    {
+        blocks = DAC_MAX_LATENCY;
+    }
+    dacLatency = blocks;
+}
+
+/**
+ * @brief Get how far ahead of the DMA samples are rendered
+ *
+ * @return The number of ::DAC_BUF_SIZE buffers rendered ahead
+ */
+uint8_t dacGetLatency(void)
+{
+    return dacLatency;
+}
+
+/**
+ * @brief Record how long the callback took to fill a buffer
+ *
+ * @param renderUs The time the callback took, in microseconds
+ * @param len The number of samples the callback generated
+ */
+static void dacRecordRender(int64_t renderUs, size_t len)
+{
+    int64_t load = renderUs * DAC_SAMPLE_RATE_HZ * DAC_LOAD_FULL / ((int64_t)len * 1000000);
+    if (load > UINT16_MAX)
+    {
+        load = UINT16_MAX;
+    }
+
+    dacStats.blocks++;
+    dacStats.renderUs = renderUs;
+    if (dacStats.renderUs > dacStats.maxRenderUs)
+    {
+        dacStats.maxRenderUs = dacStats.renderUs;
+    }
+    if (load > dacStats.peakLoad)
+    {
+        dacStats.peakLoad = load;
+    }
+    /* Exponential moving average, so one slow block doesn't swing the value */
+    dacStats.load = (dacStats.load * 7 + load) / 8;
+}
+
+/**
+ * @brief A task which copies rendered samples from the ring to the DMA whenever the DMA finishes a buffer. This only
+ * copies memory, so it runs at a high priority without starving anything
+ *
+ * @param arg Unused
+ */
+static void dacFeedTask(void* arg)
+{
+    while (dacTasksRunning)
+    {
+        /* Wake up periodically to check if the task should exit */
         dac_event_data_t evt_data;
-        while (xQueueReceive(dacIsrQueue, &evt_data, 0))
+        if (xQueueReceive(dacIsrQueue, &evt_data, pdMS_TO_TICKS(DAC_TASK_POLL_MS)))
         {
-            /* Ask the application to fill a buffer */
-            dacCb(tmpDacBuf, evt_data.buf_size);
+            /* The acquire pairs with the release in the render task, so the buffer is fully written */
+            uint32_t head       = __atomic_load_n(&ringHead, __ATOMIC_ACQUIRE);
+            uint32_t tail       = ringTail;
+            const uint8_t* src  = dacSilence;
+            dacStats.numBuffers = dacLatency;
+            dacStats.fillLevel  = head - tail;
+            if (dacStats.fillLevel < dacStats.minFillLevel)
+            {
+                dacStats.minFillLevel = dacStats.fillLevel;
+            }
+
+            if (head != tail)
+            {
+                src = dacRing[tail % DAC_MAX_LATENCY];
+            }
+            else
+            {
+                /* The renderer fell behind, so play silence rather than stale samples */
+                dacStats.underruns++;
+            }
 
             /* Write the data DMA so that it is sent out the DAC */
             size_t loaded_bytes = 0;
             dac_continuous_write_asynchronously(dac_handle, evt_data.buf, evt_data.buf_size, //
-                                                tmpDacBuf, evt_data.buf_size, &loaded_bytes);
+                                                src, evt_data.buf_size, &loaded_bytes);
             /* assume loaded_bytes == DAC_BUF_SIZE */
+
+            if (head != tail)
+            {
+                /* Return the buffer to the render task */
+                __atomic_store_n(&ringTail, tail + 1, __ATOMIC_RELEASE);
+            }
+            xTaskNotifyGive(dacRenderTaskHandle);
         }
     }
+
+    xSemaphoreGive(dacTaskExitSem);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief A task which asks the application for samples until the ring holds the requested latency. It runs at a
+ * higher priority than the main loop, so a slow frame doesn't starve the DAC
+ *
+ * @param arg Unused
+ */
+static void dacRenderTask(void* arg)
+{
+    while (dacTasksRunning)
+    {
+        xSemaphoreTakeRecursive(dacCbMutex, portMAX_DELAY);
+        while (dacWriting && dacTasksRunning)
+        {
+            /* The acquire pairs with the release in the feed task, so the buffer isn't being read anymore */
+            uint32_t filled = ringHead - __atomic_load_n(&ringTail, __ATOMIC_ACQUIRE);
+            if (filled >= dacLatency)
+            {
+                break;
+            }
+            else if (0 == filled)
+            {
+                /* The ring drained before it was refilled */
+                dacStats.lateRefills++;
+            }
+
+            /* Ask the application to fill a buffer, and time it */
+            int64_t start = esp_timer_get_time();
+            dacCb(dacRing[ringHead % DAC_MAX_LATENCY], DAC_BUF_SIZE);
+            dacRecordRender(esp_timer_get_time() - start, DAC_BUF_SIZE);
+
+            /* Hand the buffer to the feed task */
+            __atomic_store_n(&ringHead, ringHead + 1, __ATOMIC_RELEASE);
+        }
+        xSemaphoreGiveRecursive(dacCbMutex);
+
+        /* Wait for the feed task to take a buffer */
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DAC_TASK_POLL_MS));
+    }
+
+    xSemaphoreGive(dacTaskExitSem);
+    vTaskDelete(NULL);
 }
 
 /**
@@ -221,3 +474,26 @@ void setDacShutdown(bool shutdown)
         dacStart();
     }
 }
+
+/**
+ * @brief Get statistics about how well the DAC callback is keeping up
+ *
+ * @param stats [out] Written with the current statistics
+ */
+void dacGetStats(dacStats_t* stats)
+{
+    *stats = dacStats;
+    stats->underruns += dacIsrUnderruns;
+}
+
+/**
+ * @brief Reset the DAC statistics
+ */
+void dacResetStats(void)
+{
+    memset(&dacStats, 0, sizeof(dacStats));
+    dacStats.numBuffers   = dacLatency;
+    dacStats.fillLevel    = dacLatency;
+    dacStats.minFillLevel = dacLatency;
+    dacIsrUnderruns       = 0;
+}
@@ -8,9 +8,17 @@
  * continuous, arbitrary signal.
  *
  * This component is initialized by initDac() with a ::fnDacCallback_t callback which will request DAC samples from the
- * application when required. Sample requests come from the DAC peripheral in an interrupt and are queued to be serviced
- * out of the interrupt. This queue is checked in dacPoll(). Spending time to generate samples in an interrupt isn't a
- * good idea.
+ * application when required. Samples are generated by a dedicated render task, which runs at a higher priority than
+ * the main loop, and are stored in a ring buffer ahead of the DMA. When the DAC peripheral finishes playing a buffer, it
+ * signals a feed task from an interrupt, and the feed task copies the next rendered buffer to the DMA. Spending time to
+ * generate samples in an interrupt isn't a good idea, and generating them from the main loop means a slow frame
+ * starves the DAC.
+ *
+ * Because the callback runs on another task, it may be called at the same time as the main loop. The main loop should
+ * either post events for the callback to act on, i.e. with midiQueueNoteOn(), or hold dacLock() while it modifies the
+ * callback's state directly, i.e. with midiPlayerLock(). The system holds it while switching Swadge modes, so a mode's
+ * ::swadgeMode_t.fnDacCb is never called before its ::swadgeMode_t.fnEnterMode returns or after its
+ * ::swadgeMode_t.fnExitMode is called.
  *
  * \warning
  * Note that the DAC peripheral and the ADC peripheral (hdw-mic.h) use the same DMA controller, so they cannot both be
@@ -22,11 +30,21 @@
  *
  * The system will also automatically call dacStart(), though the Swadge mode can later call dacStop() or dacStart()
  * when the DAC needs to be used. Stopping the DAC when not in use can save some processing cycles, but stopping it
- * abruptly may cause unwanted clicks or pops on the speaker.
+ * abruptly may cause unwanted clicks or pops on the speaker. dacStop() waits for the callback to return, so it won't be
+ * called again until dacStart() is called.
+ *
+ * By default, samples are requested from globalMidiPlayerFillBuffer(). Swadge modes may override this by providing a
+ * non-NULL function pointer for ::swadgeMode_t.fnDacCb.
+ *
+ * dacSetLatency() sets how many buffers are rendered ahead of the DMA, from 1 to ::DAC_MAX_LATENCY. Each buffer is
+ * ::DAC_BUF_SIZE samples. More buffers tolerate more variation in render time, at the cost of a longer delay between
+ * an event and hearing it.
  *
- * dacPoll() is called automatically by the system while the DAC is running. By default, samples are requested from
- * sngPlayerFillBuffer(). Swadge modes may override this by providing a non-NULL function pointer for
- * ::swadgeMode_t.fnDacCb.
+ * dacGetStats() reports how well the callback is keeping up. An underrun is counted when the DAC runs out of rendered
+ * samples and plays silence, which is heard as a glitch. A late refill is counted when the ring was empty by the time
+ * the render task got to refill it, which means an underrun is close. The DSP load is the time spent in the callback
+ * as a fraction of the time it takes to play the samples it generated, in units of ::DAC_LOAD_FULL. A load at or
+ * above ::DAC_LOAD_FULL can't be sustained.
  *
  * \section dac_example Example
  *
@@ -42,20 +60,23 @@
  *
  * int main()
  * {
- *     // Initialize and start the DAC
- *     initDac(dacCallback);
+ *     // Initialize and start the DAC. This will end up calling dacCallback as appropriate
+ *     initDac(DAC_CHANNEL_MASK_CH0, GPIO_NUM_18, dacCallback);
  *     dacStart();
  *
- *     // Loop forever and poll the DAC.
+ *     // Render three buffers ahead of the DMA
+ *     dacSetLatency(3);
+ *
+ *     // Do other things while samples are generated
  *     bool running = true;
  *     while(running)
  *     {
- *         // This will end up calling dacCallback as appropriate
- *         dacPoll();
+ *         ...
  *     }
  *
  *     // Cleanup
  *     dacStop();
+ *     deinitDac();
  * }
  * \endcode
  */
@@ -81,6 +102,15 @@
 /** The size of each buffer to fill with DAC samples */
 #define DAC_BUF_SIZE 512
 
+/** The default number of buffers rendered ahead of the DMA */
+#define DAC_DEFAULT_LATENCY 2
+
+/** The most buffers which may be rendered ahead of the DMA */
+#define DAC_MAX_LATENCY 8
+
+/** The DSP load value which means the callback took exactly as long as its samples take to play */
+#define DAC_LOAD_FULL 1000
+
 //==============================================================================
 // Typedefs
 //==============================================================================
@@ -93,6 +123,23 @@
  */
 typedef void (*fnDacCallback_t)(uint8_t* samples, int16_t len);
 
+/**
+ * @brief Statistics about how well the application is keeping up with the DAC
+ */
+typedef struct
+{
+    uint32_t blocks;      ///< The number of buffers filled since the statistics were reset
+    uint32_t underruns;   ///< The number of times the DAC ran out of fresh samples and replayed old ones
+    uint32_t lateRefills; ///< The number of times the ring was empty when the render task went to refill it
+    uint8_t numBuffers;   ///< The number of buffers rendered ahead, as set by dacSetLatency()
+    uint8_t fillLevel;    ///< The number of rendered buffers in the ring when the DAC last took one
+    uint8_t minFillLevel; ///< The lowest value of fillLevel since the statistics were reset
+    uint32_t renderUs;    ///< The time the last callback took, in microseconds
+    uint32_t maxRenderUs; ///< The longest time a callback took since the statistics were reset, in microseconds
+    uint16_t load;        ///< The smoothed DSP load, where ::DAC_LOAD_FULL means fully loaded
+    uint16_t peakLoad;    ///< The highest unsmoothed DSP load since the statistics were reset
+} dacStats_t;
+
 //==============================================================================
 // Function Declarations
 //==============================================================================
@@ -101,7 +148,12 @@ void initDac(dac_channel_mask_t channel, gpio_num_t shdn_gpio, fnDacCallback_t c
 void deinitDac(void);
 void powerDownDac(void);
 void powerUpDac(void);
-void dacPoll(void);
 void dacStart(void);
 void dacStop(void);
+void dacLock(void);
+void dacUnlock(void);
 void setDacShutdown(bool shutdown);
+void dacSetLatency(uint8_t blocks);
+uint8_t dacGetLatency(void);
+void dacGetStats(dacStats_t* stats);
+void dacResetStats(void);
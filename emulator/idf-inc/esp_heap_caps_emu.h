@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+void heapProfileSetEnabled(bool enabled);
+void heapProfileStartScope(const char* name);
+void heapProfileNameScope(const char* name);
+void heapProfileFrame(void);
+void heapProfileReport(bool prior, FILE* out, bool json);
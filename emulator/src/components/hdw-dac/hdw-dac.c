@@ -5,14 +5,24 @@
 #include <stddef.h>
 #include <string.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include "os_generic.h"
 #include "hdw-dac.h"
 #include "hdw-dac_emu.h"
 #include "emu_main.h"
+#include "macros.h"
 
 //==============================================================================
 // Defines
 //==============================================================================
 
+/// The most samples the audio output is expected to ask for at once. The ring is sized to hold this many on top of
+/// the latency, and larger requests are clamped to it
+#define DAC_MAX_REQUEST (16 * DAC_BUF_SIZE)
+
+/// The size of the ring of rendered samples. This is a power of two, so the sample counts wrap around it cleanly
+#define DAC_RING_SIZE (2 * DAC_MAX_REQUEST)
+
 //==============================================================================
 // Variables
 //==============================================================================
@@ -23,6 +33,47 @@ static fnDacCallback_t dacCb = NULL;
 static bool shutdownState    = false;
 static bool dacWriting       = false;
 
+/// Statistics about how well the callback is keeping up
+static dacStats_t dacStats;
+
+/// Held while reading or writing dacStats, which is written by both the render and audio threads
+static og_mutex_t dacStatsMutex = NULL;
+
+/// Rendered samples waiting to be played
+static uint8_t dacRing[DAC_RING_SIZE];
+
+/// The total number of samples ever rendered into the ring. Only written by the render thread
+static uint32_t ringHead = 0;
+
+/// The total number of samples ever played from the ring. Only written by the audio thread
+static uint32_t ringTail = 0;
+
+/// The number of buffers to render ahead of the audio output
+static uint8_t dacLatency = DAC_DEFAULT_LATENCY;
+
+/// The most samples the audio output has asked for at once, rounded up to whole buffers. CNFA is only given
+/// ::DAC_BUF_SIZE as a suggestion, so some drivers ask for more. Only written by the audio thread
+static uint32_t dacRequestSize = DAC_BUF_SIZE;
+
+/// The thread which renders samples into the ring
+static og_thread_t dacRenderThread = NULL;
+
+/// Held by the render thread while calling the application, so the DAC can be stopped between buffers
+static og_mutex_t dacCbMutex = NULL;
+
+/// Unlocked by the audio thread to wake the render thread after taking samples
+static og_sema_t dacRefillSema = NULL;
+
+/// Cleared to make the render thread exit
+static volatile bool dacThreadRunning = false;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static void* dacRenderThreadFn(void* arg);
+static void dacRecordRender(int64_t renderUs, int len, bool late);
+
 //==============================================================================
 // Functions
 //==============================================================================
@@ -37,9 +88,28 @@ static bool dacWriting       = false;
 void initDac(dac_channel_mask_t channel, gpio_num_t shdn_gpio, fnDacCallback_t cb)
 {
     ESP_LOGI(DAC_TAG, " ");
+
+    if (!dacThreadRunning)
+    {
+        // Start with an empty ring and a render thread to fill it, like the firmware's render task
+        ringHead         = 0;
+        ringTail         = 0;
+        dacRequestSize   = DAC_BUF_SIZE;
+        dacCbMutex       = OGCreateMutex();
+        dacStatsMutex    = OGCreateMutex();
+        dacRefillSema    = OGCreateSema();
+        dacThreadRunning = true;
+        dacRenderThread  = OGCreateThread(dacRenderThreadFn, NULL);
+    }
+
+    OGLockMutex(dacCbMutex);
     dacCb         = cb;
     shutdownState = false;
     dacWriting    = true;
+    OGUnlockMutex(dacCbMutex);
+
+    dacResetStats();
+    OGUnlockSema(dacRefillSema);
 }
 
 /**
@@ -49,8 +119,23 @@ void initDac(dac_channel_mask_t channel, gpio_num_t shdn_gpio, fnDacCallback_t c
 void deinitDac(void)
 {
     ESP_LOGI(DAC_TAG, " ");
+    dacStop();
     shutdownState = true;
-    dacWriting    = false;
+
+    if (dacThreadRunning)
+    {
+        // Wake the render thread so it notices it should exit
+        dacThreadRunning = false;
+        OGUnlockSema(dacRefillSema);
+        OGJoinThread(dacRenderThread);
+        dacRenderThread = NULL;
+        OGDeleteSema(dacRefillSema);
+        dacRefillSema = NULL;
+        OGDeleteMutex(dacCbMutex);
+        dacCbMutex = NULL;
+        OGDeleteMutex(dacStatsMutex);
+        dacStatsMutex = NULL;
+    }
 }
 
 /**
@@ -79,25 +164,155 @@ void dacStart(void)
 {
     ESP_LOGI(DAC_TAG, " ");
     dacWriting = true;
+    if (dacThreadRunning)
+    {
+        OGUnlockSema(dacRefillSema);
+    }
 }
 
 /**
- * @brief TODO
+ * @brief Stop the DAC. This waits for the application to finish filling the current buffer
  *
  */
 void dacStop(void)
 {
     ESP_LOGI(DAC_TAG, " ");
-    dacWriting = false;
+    if (dacThreadRunning)
+    {
+        OGLockMutex(dacCbMutex);
+        dacWriting = false;
+        OGUnlockMutex(dacCbMutex);
+    }
+    else
+    {
+        dacWriting = false;
+    }
+}
+
+/**
+ * @brief Wait for the callback to return, and keep it from being called again until dacUnlock() is called. The mutex is
+ * recursive, like the firmware's, so the callback may take it too
+ */
+void dacLock(void)
+{
+    if (dacCbMutex)
+    {
+        OGLockMutex(dacCbMutex);
+    }
+}
+
+/**
+ * @brief Let the callback be called again after dacLock()
+ */
+void dacUnlock(void)
+{
+    if (dacCbMutex)
+    {
+        OGUnlockMutex(dacCbMutex);
+    }
+}
+
+/**
+ * @brief Set how far ahead of the audio output samples are rendered
+ *
+ * @param blocks The number of ::DAC_BUF_SIZE buffers to render ahead, from 1 to ::DAC_MAX_LATENCY
+ */
+void dacSetLatency(uint8_t blocks)
+{
+    if (blocks < 1)
+    {
+        blocks = 1;
+    }
+    else if (blocks > DAC_MAX_LATENCY)
+    {
+        blocks = DAC_MAX_LATENCY;
+    }
+    dacLatency = blocks;
+}
+
+/**
+ * @brief Get how far ahead of the audio output samples are rendered
+ *
+ * @return The number of ::DAC_BUF_SIZE buffers rendered ahead
+ */
+uint8_t dacGetLatency(void)
+{
+    return dacLatency;
+}
+
+/**
+ * @brief A thread which asks the application for samples until the ring holds the requested latency. This stands in
+ * for the firmware's render task, so the audio thread only copies samples and never waits on the application
+ *
+ * @param arg Unused
+ * @return NULL
+ */
+static void* dacRenderThreadFn(void* arg)
+{
+    while (dacThreadRunning)
+    {
+        OGLockMutex(dacCbMutex);
+        while (dacWriting && dacThreadRunning && NULL != dacCb)
+        {
+            // The acquire pairs with the release in dacHandleSoundOutput(), so the samples aren't being read anymore
+            uint32_t filled = ringHead - __atomic_load_n(&ringTail, __ATOMIC_ACQUIRE);
+
+            // Hold a whole request from the audio output, plus the rest of the latency
+            uint32_t target = __atomic_load_n(&dacRequestSize, __ATOMIC_RELAXED) + (dacLatency - 1) * DAC_BUF_SIZE;
+            if (filled + DAC_BUF_SIZE > target)
+            {
+                break;
+            }
+
+            // The head always moves a whole buffer at a time, so the buffer never wraps around the ring
+            int64_t start = esp_timer_get_time();
+            dacCb(&dacRing[ringHead % DAC_RING_SIZE], DAC_BUF_SIZE);
+            dacRecordRender(esp_timer_get_time() - start, DAC_BUF_SIZE, 0 == filled);
+
+            // Hand the samples to the audio thread
+            __atomic_store_n(&ringHead, ringHead + DAC_BUF_SIZE, __ATOMIC_RELEASE);
+        }
+        OGUnlockMutex(dacCbMutex);
+
+        // Wait for the audio thread to take some samples
+        OGLockSema(dacRefillSema);
+    }
+    return NULL;
 }
 
 /**
- * @brief Poll the queue to see if it needs to be filled with audio samples
+ * @brief Record how long the callback took to fill a buffer
+ *
+ * @param renderUs The time the callback took, in microseconds
+ * @param len The number of samples the callback generated
+ * @param late true if the ring had drained before this buffer was rendered
  */
-void dacPoll(void)
+static void dacRecordRender(int64_t renderUs, int len, bool late)
 {
-    // In actual firmware, this function will fill sample buffers received in interrupts.
-    // In the emulator, that's handled in dacHandleSoundOutput() instead
+    int64_t load = renderUs * DAC_SAMPLE_RATE_HZ * DAC_LOAD_FULL / ((int64_t)len * 1000000);
+    if (load > UINT16_MAX)
+    {
+        load = UINT16_MAX;
+    }
+
+    OGLockMutex(dacStatsMutex);
+    if (late && 0 != dacStats.blocks)
+    {
+        dacStats.lateRefills++;
+    }
+    dacStats.blocks++;
+    dacStats.renderUs = renderUs;
+    if (dacStats.renderUs > dacStats.maxRenderUs)
+    {
+        dacStats.maxRenderUs = dacStats.renderUs;
+    }
+    if (load > dacStats.peakLoad)
+    {
+        dacStats.peakLoad = load;
+    }
+    // Exponential moving average, so one slow block doesn't swing the value
+    dacStats.load = (dacStats.load * 7 + load) / 8;
+    OGUnlockMutex(dacStatsMutex);
 }
 
 /**
@@ -113,16 +328,42 @@ void dacHandleSoundOutput(short* out, int framesp, short numChannels)
     if (NULL != out)
     {
         // Make sure there is a callback function to call
-        if (NULL != dacCb && dacWriting)
+        if (NULL != dacCb && dacWriting && dacThreadRunning)
         {
-            // Get samples from the Swadge mode
-            uint8_t tempSamps[framesp];
-            dacCb(tempSamps, framesp);
+            // Let the render thread keep enough samples for requests this large
+            uint32_t request = MIN((uint32_t)framesp, DAC_MAX_REQUEST);
+            request          = ((request + DAC_BUF_SIZE - 1) / DAC_BUF_SIZE) * DAC_BUF_SIZE;
+            if (request > dacRequestSize)
+            {
+                __atomic_store_n(&dacRequestSize, request, __ATOMIC_RELAXED);
+            }
+
+            // The acquire pairs with the release in the render thread, so the samples are fully written
+            uint32_t tail  = ringTail;
+            uint32_t avail = __atomic_load_n(&ringHead, __ATOMIC_ACQUIRE) - tail;
+
+            OGLockMutex(dacStatsMutex);
+            dacStats.numBuffers = dacLatency;
+            dacStats.fillLevel  = avail / DAC_BUF_SIZE;
+            if (dacStats.fillLevel < dacStats.minFillLevel)
+            {
+                dacStats.minFillLevel = dacStats.fillLevel;
+            }
+            if (avail < (uint32_t)framesp)
+            {
+                // The renderer fell behind, so the rest of this buffer is silence
+                dacStats.underruns++;
+            }
+            OGUnlockMutex(dacStatsMutex);
 
             // Write the samples to the emulator output, in signed short format
             for (int i = 0; i < framesp; i++)
             {
-                short samp = (tempSamps[i] - 127) * 256;
+                short samp = 0;
+                if ((uint32_t)i < avail)
+                {
+                    samp = (dacRing[(tail + i) % DAC_RING_SIZE] - 127) * 256;
+                }
                 // Copy the same sample to each channel
                 for (int j = 0; j < numChannels; j++)
                 {
@@ -136,11 +377,15 @@ void dacHandleSoundOutput(short* out, int framesp, short numChannels)
                     }
                 }
             }
+
+            // Return the samples to the render thread and wake it up
+            __atomic_store_n(&ringTail, tail + MIN((uint32_t)framesp, avail), __ATOMIC_RELEASE);
+            OGUnlockSema(dacRefillSema);
         }
         else
         {
             // No callback function, write zeros
-            memset(out, 0, sizeof(short) * 2 * framesp);
+            memset(out, 0, sizeof(short) * numChannels * framesp);
         }
     }
 }
@@ -163,3 +408,41 @@ void setDacShutdown(bool shutdown)
         dacStart();
     }
 }
+
+/**
+ * @brief Get statistics about how well the DAC callback is keeping up
+ *
+ * @param stats [out] Written with the current statistics
+ */
+void dacGetStats(dacStats_t* stats)
+{
+    if (NULL != dacStatsMutex)
+    {
+        OGLockMutex(dacStatsMutex);
+        *stats = dacStats;
+        OGUnlockMutex(dacStatsMutex);
+    }
+    else
+    {
+        *stats = dacStats;
+    }
+}
+
+/**
+ * @brief Reset the DAC statistics
+ */
+void dacResetStats(void)
+{
+    if (NULL != dacStatsMutex)
+    {
+        OGLockMutex(dacStatsMutex);
+    }
+    memset(&dacStats, 0, sizeof(dacStats));
+    dacStats.numBuffers   = dacLatency;
+    dacStats.fillLevel    = dacLatency;
+    dacStats.minFillLevel = dacLatency;
+    if (NULL != dacStatsMutex)
+    {
+        OGUnlockMutex(dacStatsMutex);
+    }
+}
@@ -5,11 +5,60 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
 
 #include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "cnfs.h"
 #include "cnfs_image.h"
+#include "emu_args.h"
+#include "hdw-dac.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The magic number at the start of a binary CNFS image, "CNFS" when read as bytes
+#define CNFS_BIN_MAGIC 0x53464E43
+
+/// The version of the binary CNFS image format which can be loaded
+#define CNFS_BIN_VERSION 1
+
+/// The size of a binary CNFS image's header, before the file table
+#define CNFS_BIN_HDR_SIZE 24
+
+/// How often to check whether the binary CNFS image file changed, in microseconds
+#define CNFS_CHECK_PERIOD_US 500000
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief A binary CNFS image which was loaded from a file
+ */
+typedef struct
+{
+    void* base;  ///< The start of the image
+    size_t size; ///< The size of the image, in bytes
+} emuCnfsMapping_t;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static uint32_t readLe32(const uint8_t* bytes);
+static void* mapImageFile(const char* path, size_t* size);
+static void unmapImageFile(void* base, size_t size);
+static bool statImageFile(const char* path, struct stat* st);
 
 //==============================================================================
 // Variables
@@ -27,6 +76,21 @@ static char* cnfsInjectedFilename   = NULL;
 static int32_t cnfsInjectedFileSize = 0;
 static void* cnfsInjectedFileData   = NULL;
 
+// Binary CNFS Image Variables
+
+/// The binary CNFS image file being used instead of the built-in image, or NULL
+static const char* cnfsImagePath = NULL;
+
+/// Every image loaded so far. Old ones aren't unloaded until deinitCnfs(), so pointers into them stay valid
+static emuCnfsMapping_t* cnfsMappings = NULL;
+static int cnfsMappingCount           = 0;
+
+/// The image file's modification time, size, and inode, when it was last loaded
+static struct stat cnfsImageStat;
+
+/// The last time the image file was checked for changes
+static int64_t cnfsLastCheckUs = 0;
+
 //==============================================================================
 // Functions
 //==============================================================================
@@ -38,11 +102,260 @@ bool initCnfs(void)
     cnfsDataSz = getCnfsSize();
     cnfsFiles  = getCnfsFiles();
 
+    /* Use a binary image instead, if one was given */
+    if (NULL != emulatorArgs.cnfsImage && !emuCnfsLoadImage(emulatorArgs.cnfsImage))
+    {
+        ESP_LOGW("CNFS", "Using the built-in image instead of %s", emulatorArgs.cnfsImage);
+    }
+
     /* Debug print */
     ESP_LOGI("CNFS", "Size: %" PRIu32 ", Files: %" PRIu32, cnfsDataSz, CNFS_NUM_FILES);
     return (0 != cnfsDataSz) && (0 != CNFS_NUM_FILES);
 }
 
+/**
+ * @brief Read a little-endian 32-bit value
+ *
+ * @param bytes The bytes to read
+ * @return The value
+ */
+static uint32_t readLe32(const uint8_t* bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/**
+ * @brief Map a file read-only. On Windows the file is read into memory instead, since a mapped file can't be replaced
+ * by a rebuilt one there
+ *
+ * @param path The file to map
+ * @param size [out] The size of the file
+ * @return The file's contents, or NULL if it could not be mapped
+ */
+static void* mapImageFile(const char* path, size_t* size)
+{
+#ifdef _WIN32
+    FILE* file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0L, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0L, SEEK_SET);
+
+    void* data = (fileSize > 0) ? malloc(fileSize) : NULL;
+    if (NULL != data && (size_t)fileSize != fread(data, 1, fileSize, file))
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    *size = fileSize;
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat st = {0};
+    void* data     = NULL;
+    if (0 == fstat(fd, &st) && st.st_size > 0)
+    {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == data)
+        {
+            data = NULL;
+        }
+    }
+
+    // The mapping keeps the file open
+    close(fd);
+
+    *size = st.st_size;
+    return data;
+#endif
+}
+
+/**
+ * @brief Unmap a file mapped by mapImageFile()
+ *
+ * @param base The file's contents
+ * @param size The size of the file
+ */
+static void unmapImageFile(void* base, size_t size)
+{
+#ifdef _WIN32
+    free(base);
+#else
+    munmap(base, size);
+#endif
+}
+
+/**
+ * @brief Get the modification time, size, and inode of a file
+ *
+ * @param path The file
+ * @param st [out] The file's status
+ * @return true if the file exists
+ */
+static bool statImageFile(const char* path, struct stat* st)
+{
+    memset(st, 0, sizeof(struct stat));
+    return 0 == stat(path, st);
+}
+
+/**
+ * @brief Load a binary CNFS image written by \c cnfs_gen, and use it instead of the image built into the emulator.
+ * The image is mapped read-only, so like flash on a Swadge, cnfsGetFile() returns pointers straight into it and
+ * nothing is read until it's used. The image must have exactly the same files as the built-in one, since modes were
+ * compiled with their ::cnfsFileIdx_t
+ *
+ * @param path The binary CNFS image file
+ * @return true if the image was loaded, false if it could not be read or doesn't match the built-in image
+ */
+bool emuCnfsLoadImage(const char* path)
+{
+    struct stat st;
+    if (!statImageFile(path, &st))
+    {
+        ESP_LOGE("CNFS", "Could not open %s", path);
+        return false;
+    }
+
+    size_t size;
+    uint8_t* base = mapImageFile(path, &size);
+    if (NULL == base)
+    {
+        ESP_LOGE("CNFS", "Could not map %s", path);
+        return false;
+    }
+
+    // Make sure the image is complete and matches the files the emulator was built with
+    const char* err = NULL;
+    if (size < CNFS_BIN_HDR_SIZE || CNFS_BIN_MAGIC != readLe32(&base[0]))
+    {
+        err = "is not a CNFS image";
+    }
+    else if (CNFS_BIN_VERSION != readLe32(&base[4]))
+    {
+        err = "is a different version";
+    }
+    else if (CNFS_NUM_FILES != readLe32(&base[8]) || CNFS_NAMES_HASH != readLe32(&base[12]))
+    {
+        err = "has different files than the emulator was built with, so rebuild the emulator";
+    }
+
+    uint32_t dataOffset = 0;
+    uint32_t dataSize   = 0;
+    if (NULL == err)
+    {
+        dataOffset = readLe32(&base[16]);
+        dataSize   = readLe32(&base[20]);
+        if (dataOffset < CNFS_BIN_HDR_SIZE + CNFS_NUM_FILES * sizeof(cnfsFileEntry) || dataOffset > size
+            || dataSize > size - dataOffset)
+        {
+            err = "is truncated";
+        }
+    }
+
+    // Don't hand out pointers past the end of the image
+    const cnfsFileEntry* files = (const cnfsFileEntry*)&base[CNFS_BIN_HDR_SIZE];
+    for (int32_t i = 0; NULL == err && i < CNFS_NUM_FILES; i++)
+    {
+        if (files[i].offset > dataSize || files[i].len > dataSize - files[i].offset)
+        {
+            err = "has a file outside of it";
+        }
+    }
+
+    if (NULL != err)
+    {
+        ESP_LOGE("CNFS", "%s %s", path, err);
+        unmapImageFile(base, size);
+        return false;
+    }
+
+    // Keep every image, since assets may still point into old ones
+    emuCnfsMapping_t* mappings = realloc(cnfsMappings, (cnfsMappingCount + 1) * sizeof(emuCnfsMapping_t));
+    if (NULL == mappings)
+    {
+        unmapImageFile(base, size);
+        return false;
+    }
+    cnfsMappings                     = mappings;
+    cnfsMappings[cnfsMappingCount++] = (emuCnfsMapping_t){.base = base, .size = size};
+
+    // The audio thread reads files too, for drum samples and songs, so swap the image while it's not running
+    dacLock();
+    cnfsData   = &base[dataOffset];
+    cnfsDataSz = dataSize;
+    cnfsFiles  = files;
+    dacUnlock();
+
+    cnfsImagePath = path;
+    cnfsImageStat = st;
+    return true;
+}
+
+/**
+ * @brief Reload the binary CNFS image if its file changed since it was loaded. This is checked at most every
+ * ::CNFS_CHECK_PERIOD_US, so it may be called every frame. Assets loaded after this returns true will come from the
+ * new image, so re-enter a mode to see its new assets
+ *
+ * @return true if the image was reloaded
+ */
+bool emuCnfsCheckImage(void)
+{
+    if (NULL == cnfsImagePath)
+    {
+        return false;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (now - cnfsLastCheckUs < CNFS_CHECK_PERIOD_US)
+    {
+        return false;
+    }
+    cnfsLastCheckUs = now;
+
+    struct stat st;
+    if (!statImageFile(cnfsImagePath, &st)
+        || (st.st_mtime == cnfsImageStat.st_mtime && st.st_size == cnfsImageStat.st_size
+            && st.st_ino == cnfsImageStat.st_ino))
+    {
+        return false;
+    }
+
+    if (emuCnfsLoadImage(cnfsImagePath))
+    {
+        ESP_LOGI("CNFS", "Reloaded %s", cnfsImagePath);
+        return true;
+    }
+
+    // Don't try the same broken file again
+    cnfsImageStat = st;
+    return false;
+}
+
+/**
+ * @brief Get where assets are being loaded from
+ *
+ * @param size [out] The size of the file data in the image
+ * @param loads [out] The number of binary images loaded so far, including reloads
+ * @return The binary CNFS image file, or NULL if the built-in image is being used
+ */
+const char* emuCnfsGetImage(int32_t* size, int* loads)
+{
+    *size  = cnfsDataSz;
+    *loads = cnfsMappingCount;
+    return cnfsImagePath;
+}
+
 bool emuCnfsInjectFile(const char* name, const char* filePath)
 {
     FILE* dataFile = fopen(filePath, "rb");
@@ -92,6 +405,22 @@ bool deinitCnfs(void)
     cnfsInjectedFilename = NULL;
     cnfsInjectedFileData = NULL;
 
+    // Go back to the built-in image before unmapping the others
+    dacLock();
+    cnfsData   = getCnfsImage();
+    cnfsDataSz = getCnfsSize();
+    cnfsFiles  = getCnfsFiles();
+    dacUnlock();
+    cnfsImagePath = NULL;
+
+    for (int i = 0; i < cnfsMappingCount; i++)
+    {
+        unmapImageFile(cnfsMappings[i].base, cnfsMappings[i].size);
+    }
+    free(cnfsMappings);
+    cnfsMappings     = NULL;
+    cnfsMappingCount = 0;
+
     return true;
 }
 
@@ -2,6 +2,10 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
+bool emuCnfsLoadImage(const char* path);
+bool emuCnfsCheckImage(void);
+const char* emuCnfsGetImage(int32_t* size, int* loads);
 bool emuCnfsInjectFile(const char* name, const char* filePath);
 void emuCnfsInjectFileData(const char* name, size_t length, void* data);
@@ -88,6 +88,7 @@
 // #define DEBUG_INPUTS
 
 #include "emu_args.h"
+#include "emu_cnfs.h"
 #include "emu_ext.h"
 #include "emu_main.h"
 #include "ext_tools.h"
@@ -321,6 +322,9 @@ void taskYIELD(void)
         // Check things here which are called by interrupts or timers on the Swadge
         check_esp_timer(tElapsedUs);
 
+        // Pick up a rebuilt CNFS image, if one is being used
+        emuCnfsCheckImage();
+
         // Grey Background
         CNFGBGColor = BG_COLOR;
         CNFGClearFrame();
@@ -409,13 +413,16 @@ void taskYIELD(void)
         // Display the image and wait for time to display next frame.
         CNFGSwapBuffers();
 
-        // Sleep for one ms
-        static struct timespec tRemaining = {0};
-        const struct timespec tSleep      = {
-                 .tv_sec  = 0 + tRemaining.tv_sec,
-                 .tv_nsec = 1000000 + tRemaining.tv_nsec,
-        };
-        nanosleep(&tSleep, &tRemaining);
+        // Sleep for one ms, unless running as fast as possible. The clock is fake then, so frames don't depend on it
+        if (!emulatorArgs.maxSpeed)
+        {
+            static struct timespec tRemaining = {0};
+            const struct timespec tSleep      = {
+                     .tv_sec  = 0 + tRemaining.tv_sec,
+                     .tv_nsec = 1000000 + tRemaining.tv_nsec,
+            };
+            nanosleep(&tSleep, &tRemaining);
+        }
 
         // This means that the pre-frame callback gets called once (assuming the post-frame
         // callback didn't already pause) and then, if one of them pauses, they don't get called
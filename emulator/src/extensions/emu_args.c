@@ -82,6 +82,8 @@ static bool parseBoolArg(const char* val, bool defaultValue);
 //==============================================================================
 
 emuArgs_t emulatorArgs = {
+    .cnfsImage = NULL,
+
     .fakeFps    = 0.0,
     .fakeTime   = false,
     .fullscreen = false,
@@ -101,6 +103,9 @@ emuArgs_t emulatorArgs = {
     .startMode      = NULL,
     .modeSwitchTime = 0,
 
+    .memProfile     = false,
+    .memProfileFile = NULL,
+
     .emulateMotion      = false,
     .motionJitter       = false,
     .motionJitterAmount = 5,
@@ -111,8 +116,11 @@ emuArgs_t emulatorArgs = {
     .record   = false,
     .playback = false,
 
-    .recordFile = NULL,
-    .replayFile = NULL,
+    .recordFile        = NULL,
+    .replayFile        = NULL,
+    .convertReplayFile = NULL,
+    .maxSpeed          = false,
+    .quitAfter         = 0.0,
 
     .seed = UINT32_MAX,
 
@@ -128,6 +136,8 @@ static const char mainDoc[] = "Emulates a swadge";
 // Long argument name definitions
 // These MUST be defined here, so that they are
 // the same in both options and argDocs
+static const char argCnfsImage[]   = "cnfs-image";
+static const char argConvert[]     = "convert-replay";
 static const char argFakeFps[]     = "fake-fps";
 static const char argFakeTime[]    = "fake-time";
 static const char argFullscreen[]  = "fullscreen";
@@ -142,11 +152,14 @@ static const char argJoystick[]    = "joystick";
 static const char argJsPreset[]    = "preset";
 static const char argKeymap[]      = "keymap";
 static const char argLock[]        = "lock";
+static const char argMaxSpeed[]    = "max-speed";
+static const char argMemProfile[]  = "mem-profile";
 static const char argMidiFile[]    = "midi-file";
 static const char argMode[]        = "mode";
 static const char argModeSwitch[]  = "mode-switch";
 static const char argModeList[]    = "modes-list";
 static const char argPlayback[]    = "playback";
+static const char argQuitAfter[]   = "quit-after";
 static const char argRecord[]      = "record";
 static const char argSeed[]        = "seed";
 static const char argShowFps[]     = "show-fps";
@@ -161,6 +174,8 @@ static const char argUsage[]       = "usage";
  */
 static const struct option options[] =
 {
+    { argCnfsImage,   required_argument, NULL,                             0    },
+    { argConvert,     required_argument, NULL,                             0    },
     { argFakeFps,     required_argument, NULL,                             0    },
     { argFakeTime,    no_argument,       (int*)&emulatorArgs.fakeTime,     true },
     { argFullscreen,  no_argument,       (int*)&emulatorArgs.fullscreen,   true },
@@ -175,9 +190,12 @@ static const struct option options[] =
     { argJsPreset,    required_argument, (int*)&emulatorArgs.jsPreset,     0    },
     { argKeymap,      required_argument, NULL,                             'k'  },
     { argLock,        no_argument,       (int*)&emulatorArgs.lock,         true },
+    { argMaxSpeed,    no_argument,       NULL,                             0    },
+    { argMemProfile,  optional_argument, (int*)&emulatorArgs.memProfile,   true },
     { argMidiFile,    required_argument, NULL,                             0    },
     { argMode,        required_argument, NULL,                             'm'  },
     { argPlayback,    required_argument, (int*)&emulatorArgs.playback,     'p'  },
+    { argQuitAfter,   required_argument, NULL,                             0    },
     { argRecord,      optional_argument, (int*)&emulatorArgs.record,       'r'  },
     { argSeed,        required_argument, (int*)&emulatorArgs.seed,         0    },
     { argShowFps,     optional_argument, (int*)&emulatorArgs.showFps,      'c'  },
@@ -195,6 +213,8 @@ static const struct option options[] =
  */
 static const optDoc_t argDocs[] =
 {
+    { 0,  argCnfsImage,   "FILE",  "Load assets from a CNFS image, and reload it whenever it changes" },
+    { 0,  argConvert,     "FILE",  "Convert the --playback recording to FILE and exit. Ends in .csv for text" },
     { 0,  argFakeFps,     "RATE",  "Set a fake framerate. RATE can be a decimal number"},
     { 0,  argFakeTime,    NULL,    "Use a fake timer that ticks at a constant "},
     {'f', argFullscreen,  NULL,    "Open in fullscreen mode" },
@@ -209,11 +229,14 @@ static const optDoc_t argDocs[] =
     { 0,  argHideLeds,    NULL,    "Don't draw simulated LEDs next to the display" },
     {'k', argKeymap,     "LAYOUT", "Use an alternative keymap. LAYOUT can be azerty, colemak, or dvorak"},
     {'l', argLock,        NULL,    "Lock the emulator in the start mode" },
+    { 0,  argMaxSpeed,    NULL,    "Run frames as fast as possible, i.e. to play back quickly. Implies --fake-time" },
+    { 0,  argMemProfile,  "FILE",  "Print heap usage and leaks when each mode exits, and write them as JSON to FILE" },
     { 0,  argMidiFile,    "FILE",  "Open and immediately play a MIDI file" },
     {'m', argMode,        "MODE",  "Start the emulator in the swadge mode MODE instead of the main menu"},
     { 0,  argModeSwitch,  "TIME",  "Enable or set the timer to switch modes automatically" },
     { 0,  argModeList,    NULL,    "Print out a list of all possible values for MODE" },
     {'p', argPlayback,    "FILE",  "Play back recorded emulator inputs from a file" },
+    { 0,  argQuitAfter,   "SECS",  "Quit cleanly after SECS seconds of emulated time, i.e. to end a fuzzing run" },
     {'r', argRecord,      "FILE",  "Record emulator inputs to a file" },
     {'s', argSeed,        "SEED",  "Seed the random number generator with a specific value" },
     {'c', argShowFps,     NULL,    "Display an FPS counter" },
@@ -240,7 +263,25 @@ static const optDoc_t argDocs[] =
 static bool handleArgument(const char* optName, const char* arg, int optVal)
 {
     // Handle all arguments by their long-option, as it will always be set.
-    if (argFakeFps == optName)
+    if (argCnfsImage == optName)
+    {
+        emulatorArgs.cnfsImage = arg;
+    }
+    else if (argConvert == optName)
+    {
+        emulatorArgs.convertReplayFile = arg;
+    }
+    else if (argMaxSpeed == optName)
+    {
+        // Frames can only be run faster than real time with a fake clock
+        emulatorArgs.maxSpeed = true;
+        emulatorArgs.fakeTime = true;
+        if (emulatorArgs.fakeFps == 0.0)
+        {
+            emulatorArgs.fakeFps = 24.0;
+        }
+    }
+    else if (argFakeFps == optName)
     {
         // Set fake FPS
         if (arg)
@@ -325,6 +366,13 @@ static bool handleArgument(const char* optName, const char* arg, int optVal)
         }
         return true;
     }
+    else if (argMemProfile == optName)
+    {
+        if (arg)
+        {
+            emulatorArgs.memProfileFile = arg;
+        }
+    }
     else if (argMidiFile == optName)
     {
         emulatorArgs.midiFile = arg;
@@ -390,6 +438,16 @@ static bool handleArgument(const char* optName, const char* arg, int optVal)
             emulatorArgs.replayFile = arg;
         }
     }
+    else if (argQuitAfter == optName)
+    {
+        char* end              = NULL;
+        emulatorArgs.quitAfter = strtof(arg, &end);
+        if (end == arg || emulatorArgs.quitAfter < 0.0)
+        {
+            printf("ERR: Invalid number of seconds '%s'\n", arg);
+            return false;
+        }
+    }
     else if (argSeed == optName)
     {
         if (arg)
@@ -21,6 +21,9 @@
 
 typedef struct
 {
+    /// @brief Name of a binary CNFS image file to load assets from instead of the built-in ones, or NULL
+    const char* cnfsImage;
+
     float fakeFps;
     bool fakeTime;
 
@@ -43,6 +46,14 @@ typedef struct
     const char* startMode;
     uint32_t modeSwitchTime;
 
+    // Memory Extension
+
+    /// @brief Whether or not to profile heap usage per mode
+    bool memProfile;
+
+    /// @brief Name of the file to write JSON heap profiles to, or NULL to only print them
+    const char* memProfileFile;
+
     bool emulateMotion;
     bool motionJitter;
     uint16_t motionJitterAmount;
@@ -66,6 +77,15 @@ typedef struct
     /// @brief Name of the file to replay inputs from
     const char* replayFile;
 
+    /// @brief Name of the file to convert the replayFile to, without starting the emulator, or NULL
+    const char* convertReplayFile;
+
+    /// @brief Whether to run frames as fast as possible instead of sleeping between them. Implies fakeTime
+    bool maxSpeed;
+
+    /// @brief How many seconds of emulated time to run before quitting, or 0 to run until closed
+    float quitAfter;
+
     /// @brief A value to use to manually seed the random number generator
     uint32_t seed;
 
@@ -15,6 +15,7 @@
 // Extension Includes
 #include "ext_touch.h"
 #include "ext_leds.h"
+#include "ext_memory.h"
 #include "ext_fuzzer.h"
 #include "ext_gamepad.h"
 #include "ext_keymap.h"
@@ -33,7 +34,7 @@
 
 static const emuExtension_t* registeredExtensions[] = {
     &touchEmuCallback,  &ledEmuExtension,     &fuzzerEmuExtension, &toolsEmuExtension, &keymapEmuCallback,
-    &modesEmuExtension, &gamepadEmuExtension, &replayEmuExtension, &midiEmuExtension,
+    &modesEmuExtension, &gamepadEmuExtension, &replayEmuExtension, &midiEmuExtension,  &memoryEmuExtension,
 };
 
 //==============================================================================
@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "ext_fuzzer.h"
 #include "emu_args.h"
@@ -18,6 +20,7 @@
 
 static bool fuzzerInitCb(emuArgs_t* emuArgs);
 static void fuzzerPreFrameCb(uint64_t frame);
+static uint32_t fuzzRand(void);
 
 //==============================================================================
 // Structs
@@ -31,6 +34,10 @@ typedef struct
     bool time;
 
     buttonBit_t buttonMask;
+
+    /// @brief The state of the fuzzer's own random number generator, so fuzzing doesn't change what rand() gives the
+    /// modes. That keeps a recording of a fuzzed run deterministic when it's played back with the same seed
+    uint32_t randState;
 } fuzzer_t;
 
 //==============================================================================
@@ -64,6 +71,10 @@ static bool fuzzerInitCb(emuArgs_t* emuArgs)
 
     fuzzer.buttonMask = (PB_A | PB_B | PB_UP | PB_DOWN | PB_LEFT | PB_RIGHT | PB_START);
 
+    // Derive the fuzzer's seed from --seed, so each seed fuzzes differently but repeatably
+    uint32_t seed    = (emuArgs->seed != UINT32_MAX) ? emuArgs->seed : (uint32_t)(time(NULL) ^ getpid());
+    fuzzer.randState = (seed * 2654435761U) ^ 0x5EED5EED;
+
     if (emuArgs->fuzz)
     {
         printf("\nFuzzing:\n - [%c] Buttons\n - [%c] Touch\n - [%c] Motion\n - [%c] Time\n", fuzzer.buttons ? 'X' : ' ',
@@ -85,7 +96,7 @@ static void fuzzerPreFrameCb(uint64_t frame)
         buttonBit_t buttonState = emulatorGetButtonState();
 
         // Pick a random button
-        uint8_t i              = rand() % 8;
+        uint8_t i              = fuzzRand() % 8;
         buttonBit_t fuzzButton = (1 << i);
 
         if (fuzzButton & fuzzer.buttonMask)
@@ -97,10 +108,10 @@ static void fuzzerPreFrameCb(uint64_t frame)
 
     if (fuzzer.touch)
     {
-        if (0 == (rand() % 2))
+        if (0 == (fuzzRand() % 2))
         {
             // Set a random angle, radius (up to 1024, not 1023), and intensity value 50% of the time
-            emulatorSetTouchJoystick(rand() % 360, rand() % 1025, rand() % (1 << 18));
+            emulatorSetTouchJoystick(fuzzRand() % 360, fuzzRand() % 1025, fuzzRand() % (1 << 18));
         }
         else
         {
@@ -119,9 +130,9 @@ static void fuzzerPreFrameCb(uint64_t frame)
         }
 
         // Set the accelerometer to 3 random readings
-        emulatorSetAccelerometer((rand() % (1 + accelMax - accelMin)) + accelMin,
-                                 (rand() % (1 + accelMax - accelMin)) + accelMin,
-                                 (rand() % (1 + accelMax - accelMin)) + accelMin);
+        emulatorSetAccelerometer((fuzzRand() % (1 + accelMax - accelMin)) + accelMin,
+                                 (fuzzRand() % (1 + accelMax - accelMin)) + accelMin,
+                                 (fuzzRand() % (1 + accelMax - accelMin)) + accelMin);
     }
 
     if (fuzzer.time)
@@ -132,11 +143,32 @@ static void fuzzerPreFrameCb(uint64_t frame)
         //  60FPS is  16666us per frame
         //  25FPS is  40000us per frame
         //   1FPS = 1000000us per frame
-        fakeTime += (rand() % 128) * 1000 << (rand() % (4));
+        fakeTime += (fuzzRand() % 128) * 1000 << (fuzzRand() % (4));
         emuSetEspTimerTime(fakeTime);
     }
 }
 
+/**
+ * @brief Get a random number from the fuzzer's own xorshift generator
+ *
+ * @return uint32_t A random number
+ */
+static uint32_t fuzzRand(void)
+{
+    // The generator gets stuck at zero, and may not have been seeded if the fuzzer was enabled from the console
+    if (0 == fuzzer.randState)
+    {
+        fuzzer.randState = 0x5EED5EED;
+    }
+
+    uint32_t x = fuzzer.randState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    fuzzer.randState = x;
+    return x;
+}
+
 void emuSetFuzzButtonsEnabled(bool enabled)
 {
     fuzzer.buttons = enabled;
@@ -0,0 +1,135 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "ext_memory.h"
+#include "emu_args.h"
+#include "esp_heap_caps_emu.h"
+#include "swadge2024.h"
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static bool memoryInitCb(emuArgs_t* emuArgs);
+static void memoryDeinitCb(void);
+static void memoryPreFrameCb(uint64_t frame);
+static void memoryReport(bool prior);
+
+//==============================================================================
+// Variables
+//==============================================================================
+
+emuExtension_t memoryEmuExtension = {
+    .name            = "memory",
+    .fnInitCb        = memoryInitCb,
+    .fnDeinitCb      = memoryDeinitCb,
+    .fnPreFrameCb    = memoryPreFrameCb,
+    .fnPostFrameCb   = NULL,
+    .fnKeyCb         = NULL,
+    .fnMouseMoveCb   = NULL,
+    .fnMouseButtonCb = NULL,
+    .fnRenderCb      = NULL,
+};
+
+/// @brief true if heap profiling is enabled
+static bool memProfileEnabled = false;
+
+/// @brief The file JSON reports are written to, or NULL to not write JSON
+static FILE* jsonFile = NULL;
+
+/// @brief The number of reports written to jsonFile
+static uint32_t numJsonReports = 0;
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+static bool memoryInitCb(emuArgs_t* emuArgs)
+{
+    memProfileEnabled = emuArgs->memProfile;
+    heapProfileSetEnabled(memProfileEnabled);
+
+    if (memProfileEnabled && NULL != emuArgs->memProfileFile)
+    {
+        jsonFile = fopen(emuArgs->memProfileFile, "w");
+        if (NULL == jsonFile)
+        {
+            printf("ERR: Could not open heap profile file '%s'\n", emuArgs->memProfileFile);
+        }
+        else
+        {
+            fprintf(jsonFile, "[");
+        }
+    }
+
+    return memProfileEnabled;
+}
+
+static void memoryDeinitCb(void)
+{
+    // deinitSystem() has already exited the mode, so anything left in the scope is a leak
+    memoryReport(false);
+
+    if (NULL != jsonFile)
+    {
+        fprintf(jsonFile, "]\n");
+        fclose(jsonFile);
+        jsonFile = NULL;
+    }
+}
+
+static void memoryPreFrameCb(uint64_t frame)
+{
+    if (1 == frame)
+    {
+        // The boot scope includes the first mode's allocations
+        heapProfileNameScope(getCurrentSwadgeMode()->modeName);
+    }
+    heapProfileFrame();
+}
+
+/**
+ * @brief Write a heap profile report to stdout and, if enabled, to the JSON file
+ *
+ * @param prior true to report the prior mode's scope, false to report the current mode's scope
+ */
+static void memoryReport(bool prior)
+{
+    heapProfileReport(prior, stdout, false);
+
+    if (NULL != jsonFile)
+    {
+        if (numJsonReports++)
+        {
+            fprintf(jsonFile, ",\n");
+        }
+        heapProfileReport(prior, jsonFile, true);
+        fflush(jsonFile);
+    }
+}
+
+/**
+ * @brief Start a new heap profiling scope for the mode which is about to be entered. This must be called before the
+ * current mode is exited so that allocations made by the next mode's fnEnterMode are attributed to it.
+ */
+void emuMemProfilePreModeSwitch(void)
+{
+    heapProfileStartScope(NULL);
+}
+
+/**
+ * @brief Report heap usage and leaks for the mode which was just exited, and name the new mode's scope
+ */
+void emuMemProfilePostModeSwitch(void)
+{
+    heapProfileNameScope(getCurrentSwadgeMode()->modeName);
+
+    if (memProfileEnabled)
+    {
+        memoryReport(true);
+    }
+}
@@ -0,0 +1,13 @@
+/**
+ * @file ext_memory.h
+ * @brief Extension to profile heap usage per Swadge mode, report leaks, and count allocations per frame
+ * @date 2026-10-18
+ */
+#pragma once
+
+#include "emu_ext.h"
+
+extern emuExtension_t memoryEmuExtension;
+
+void emuMemProfilePreModeSwitch(void);
+void emuMemProfilePostModeSwitch(void);
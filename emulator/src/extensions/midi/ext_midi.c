@@ -7,20 +7,55 @@
 #include "emu_cnfs.h"
 #include "ext_modes.h"
 #include "mode_synth.h"
+#include "midiPlayer.h"
+#include "hdw-dac.h"
+#include "os_generic.h"
 
+#include <esp_heap_caps.h>
+#include <esp_random.h>
+#include <esp_timer.h>
+
+#include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef EMU_MACOS
     // Used to handle DocumentOpen event that OSX uses instead of Just Putting It In Argv
     #include <Carbon/Carbon.h>
 #endif
 
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The channel played by the timing measurement, which is percussion so every note is short
+#define TIMING_CHANNEL 9
+
+/// The note played by the timing measurement
+#define TIMING_NOTE 37
+
+/// A sample further than this from the midpoint is the start of a note
+#define TIMING_THRESHOLD 2
+
+/// The number of quiet samples which must come before the start of a note
+#define TIMING_MIN_GAP 64
+
 //==============================================================================
 // Types
 //==============================================================================
 
+/// @brief Shared state for the streaming MIDI timing measurement
+typedef struct
+{
+    midiPlayer_t* player; ///< The player being measured
+    uint8_t* samples;     ///< Every sample rendered during the measurement
+    uint32_t numBlocks;   ///< The number of ::DAC_BUF_SIZE blocks to render
+    int64_t startUs;      ///< The time the first block is rendered. It is played one block later
+} midiTiming_t;
+
 #ifdef EMU_MACOS
 typedef void (*MacOpenFileCb)(const char* path);
 
@@ -40,6 +75,7 @@ typedef struct
 static bool midiInitCb(emuArgs_t* emuArgs);
 static void midiPreFrameCb(uint64_t frame);
 static bool midiInjectFile(const char* path);
+static void* midiTimingRenderThread(void* arg);
 
 #ifdef EMU_MACOS
 // Exists but isn't declared in the headers
@@ -143,6 +179,149 @@ static bool midiInjectFile(const char* path)
     }
 }
 
+/**
+ * @brief Render blocks when the DAC would ask for them, a random fraction of a block late like a busy render task
+ *
+ * @param arg The ::midiTiming_t
+ * @return NULL
+ */
+static void* midiTimingRenderThread(void* arg)
+{
+    midiTiming_t* timing = arg;
+    int64_t blockUs      = SAMPLES_TO_US(DAC_BUF_SIZE);
+
+    for (uint32_t block = 0; block < timing->numBlocks; block++)
+    {
+        int64_t due  = timing->startUs + block * blockUs + esp_random() % (blockUs / 4);
+        int64_t wait = due - esp_timer_get_time();
+        if (wait > 0)
+        {
+            OGUSleep(wait);
+        }
+        midiPlayerFillBuffer(timing->player, &timing->samples[block * DAC_BUF_SIZE], DAC_BUF_SIZE);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Measure how long streamed MIDI notes take to be heard, and how much that varies.
+ *
+ * A private player is rendered a block at a time on its own thread, one block ahead of a simulated DAC, while notes
+ * are sent to it with midiQueueTimedEvent() at a steady rate. Afterwards, the start of each note is found in the
+ * rendered samples and compared to when it was sent.
+ *
+ * @param count The number of notes to send
+ * @param periodMs The time between notes, in milliseconds
+ * @param latency The stream latency to measure, in samples. See midiSetStreamLatency()
+ * @param[out] result Written with the measurement
+ * @return true if the measurement ran, false if memory couldn't be allocated
+ */
+bool midiMeasureTiming(uint32_t count, uint32_t periodMs, uint32_t latency, midiTimingResult_t* result)
+{
+    memset(result, 0, sizeof(midiTimingResult_t));
+
+    int64_t blockUs  = SAMPLES_TO_US(DAC_BUF_SIZE);
+    int64_t periodUs = (int64_t)periodMs * 1000;
+
+    // Leave a block of silence before the first note, and let the latency and the last note play out afterwards
+    midiTiming_t timing = {
+        .numBlocks = (count * periodUs + SAMPLES_TO_US((int64_t)latency)) / blockUs + 4,
+    };
+    timing.player  = heap_caps_calloc(1, sizeof(midiPlayer_t), MALLOC_CAP_SPIRAM);
+    timing.samples = heap_caps_malloc(timing.numBlocks * DAC_BUF_SIZE, MALLOC_CAP_SPIRAM);
+    int64_t* sent  = heap_caps_calloc(count, sizeof(int64_t), MALLOC_CAP_SPIRAM);
+    if (NULL == timing.player || NULL == timing.samples || NULL == sent)
+    {
+        heap_caps_free(timing.player);
+        heap_caps_free(timing.samples);
+        heap_caps_free(sent);
+        return false;
+    }
+
+    midiPlayerInit(timing.player);
+    midiGmOn(timing.player);
+    timing.player->mode = MIDI_STREAMING;
+    midiSetVoiceBudget(timing.player, POOL_VOICE_COUNT, false);
+    midiSetStreamLatency(timing.player, latency);
+    midiPause(timing.player, false);
+
+    timing.startUs       = esp_timer_get_time() + blockUs;
+    og_thread_t renderer = OGCreateThread(midiTimingRenderThread, &timing);
+
+    midiEvent_t event = {
+        .type = MIDI_EVENT,
+        .midi = {.data = {TIMING_NOTE, 0x7F}},
+    };
+    for (uint32_t i = 0; i < count; i++)
+    {
+        // Notes are evenly spaced, but not on block boundaries, so each one lands somewhere different in a block
+        int64_t noteOn = timing.startUs + blockUs + i * periodUs;
+        int64_t wait   = noteOn - esp_timer_get_time();
+        if (wait > 0)
+        {
+            OGUSleep(wait);
+        }
+        event.midi.status = 0x90 | TIMING_CHANNEL;
+        sent[i]           = esp_timer_get_time();
+        midiQueueTimedEvent(timing.player, &event, sent[i]);
+
+        wait = noteOn + periodUs / 2 - esp_timer_get_time();
+        if (wait > 0)
+        {
+            OGUSleep(wait);
+        }
+        event.midi.status = 0x80 | TIMING_CHANNEL;
+        midiQueueTimedEvent(timing.player, &event, esp_timer_get_time());
+    }
+    OGJoinThread(renderer);
+
+    // Find where each note starts, which is the first loud sample after a stretch of quiet ones
+    double sum       = 0;
+    double sumSq     = 0;
+    uint32_t quiet   = TIMING_MIN_GAP;
+    uint32_t samples = timing.numBlocks * DAC_BUF_SIZE;
+    for (uint32_t s = 0; s < samples && result->detected < count; s++)
+    {
+        if (abs(timing.samples[s] - 128) <= TIMING_THRESHOLD)
+        {
+            quiet++;
+            continue;
+        }
+        if (quiet >= TIMING_MIN_GAP)
+        {
+            // Block k is rendered at startUs + k * blockUs and played one block later
+            int64_t heard = timing.startUs + blockUs + SAMPLES_TO_US((int64_t)s);
+            int64_t delay = heard - sent[result->detected];
+            if (0 == result->detected || delay < result->minLatencyUs)
+            {
+                result->minLatencyUs = delay;
+            }
+            if (0 == result->detected || delay > result->maxLatencyUs)
+            {
+                result->maxLatencyUs = delay;
+            }
+            sum += delay;
+            sumSq += (double)delay * delay;
+            result->detected++;
+        }
+        quiet = 0;
+    }
+
+    result->events     = count;
+    result->lateEvents = timing.player->lateEvents;
+    if (result->detected)
+    {
+        double mean           = sum / result->detected;
+        result->meanLatencyUs = mean;
+        result->jitterUs      = sqrt(fmax(0, sumSq / result->detected - mean * mean));
+    }
+
+    heap_caps_free(timing.player);
+    heap_caps_free(timing.samples);
+    heap_caps_free(sent);
+    return true;
+}
+
 #ifdef EMU_MACOS
 static void doFileOpenCb(const char* path)
 {
@@ -1,10 +1,32 @@
 /*! \file ext_midi.h
  *
  * \section ext_midi Extended Emulator MIDI Support
+ *
+ * Opens MIDI files passed on the command line or by the OS in the synth mode, and measures the timing of streamed MIDI
+ * events with midiMeasureTiming(), which the \c midijitter console command runs.
  */
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "emu_ext.h"
 
+/**
+ * @brief The result of a streaming MIDI timing measurement
+ */
+typedef struct
+{
+    uint32_t events;       ///< The number of notes sent to the player
+    uint32_t detected;     ///< The number of notes found in the rendered audio
+    uint32_t lateEvents;   ///< The number of notes which arrived too late to be played at their scheduled sample
+    int64_t meanLatencyUs; ///< The average time from a note being received to it being heard, in microseconds
+    int64_t jitterUs;      ///< The standard deviation of the latency, in microseconds
+    int64_t minLatencyUs;  ///< The shortest latency, in microseconds
+    int64_t maxLatencyUs;  ///< The longest latency, in microseconds
+} midiTimingResult_t;
+
 extern emuExtension_t midiEmuExtension;
+
+bool midiMeasureTiming(uint32_t count, uint32_t periodMs, uint32_t latency, midiTimingResult_t* result);
@@ -11,10 +11,13 @@
 #include "ext_tools.h"
 #include "emu_utils.h"
 #include "esp_random_emu.h"
+#include "esp_timer_emu.h"
+#include "emu_args.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <inttypes.h>
 #include <unistd.h>
 
@@ -26,6 +29,30 @@
 
 #define HEADER "Time,Type,Value\n"
 
+/// @brief The magic bytes at the start of a binary recording
+#define BINARY_MAGIC "SWRP"
+
+/// @brief The version of the binary format, which follows the magic bytes
+#define BINARY_VERSION 2
+
+/// @brief The number of bytes before the first entry of a binary recording
+#define BINARY_HEADER_SIZE 5
+
+/// @brief The magic bytes at the very end of a binary recording which has an index
+#define INDEX_MAGIC "SWRI"
+
+/// @brief The number of bytes in the footer of a binary recording, the index offset and ::INDEX_MAGIC
+#define INDEX_FOOTER_SIZE 8
+
+/// @brief The type byte which ends the entries and starts the index of a binary recording
+#define INDEX_TAG 0xFF
+
+/// @brief How much recorded time there is between the checkpoints of a binary recording
+#define CHECKPOINT_INTERVAL_US 1000000
+
+/// @brief The longest string that can be read from a recording, not including the NUL
+#define MAX_STRING_LEN 1023
+
 #ifdef DEBUG
     #define REPLAY_DEBUG(str, ...) printf(str "\n", __VA_ARGS__);
 #else
@@ -84,13 +111,56 @@ typedef struct
     };
 } replayEntry_t;
 
+/**
+ * @brief The inputs which are held at one point in a recording, and where the mode and seed in effect were set
+ */
+typedef struct
+{
+    buttonBit_t buttons;    ///< The buttons which are held
+    int32_t touchPhi;       ///< The touchpad angle
+    int32_t touchR;         ///< The touchpad radius
+    int32_t touchIntensity; ///< The touchpad intensity
+    int16_t accelX;         ///< The accelerometer X reading
+    int16_t accelY;         ///< The accelerometer Y reading
+    int16_t accelZ;         ///< The accelerometer Z reading
+    uint64_t modeOffset;    ///< Where the last SetMode entry starts in the file, or 0 if there wasn't one
+    uint64_t seedOffset;    ///< Where the last RandomSeed entry starts in the file, or 0 if there wasn't one
+} replayInputState_t;
+
+/**
+ * @brief A point in a binary recording which can be read from without reading everything before it
+ */
+typedef struct
+{
+    int64_t time;             ///< The time of the last entry before the checkpoint, which the next one is relative to
+    uint64_t offset;          ///< Where the next entry starts in the file
+    replayInputState_t state; ///< The inputs which are held at the checkpoint
+} replayCheckpoint_t;
+
+/**
+ * @brief A recording file which is being read or written, in either the text or the binary format
+ */
+typedef struct
+{
+    FILE* fp;     ///< The open file, or NULL
+    bool binary;  ///< true if the file is in the binary format, false if it is CSV text
+    bool writing; ///< true if the file is being written, false if it is being read
+
+    int64_t lastTime;         ///< The time of the last entry read or written, which binary times are relative to
+    replayInputState_t state; ///< The inputs held after the last entry read or written
+
+    replayCheckpoint_t* checkpoints; ///< The checkpoints written so far, or read from the index
+    uint32_t numCheckpoints;         ///< The number of checkpoints
+    uint32_t checkpointCap;          ///< The number of checkpoints there is space for
+    int64_t nextCheckpointTime;      ///< The earliest time the next checkpoint may be written at
+} replayFile_t;
+
 typedef struct
 {
-    FILE* file;
+    replayFile_t file;
     bool readCompleted;
 
     replayMode_t mode;
-    bool headerHandled;
 
     buttonBit_t lastButtons;
 
@@ -105,6 +175,12 @@ typedef struct
     uint32_t newSeed;
 
     replayEntry_t nextEntry;
+
+    /// @brief The time to fast-forward playback to, or 0 if not seeking
+    int64_t seekTime;
+
+    /// @brief Whether the emulator ran at max speed before seeking
+    bool maxSpeedBeforeSeek;
 } replay_t;
 
 //==============================================================================
@@ -112,12 +188,33 @@ typedef struct
 //==============================================================================
 
 static bool replayInit(emuArgs_t* emuArgs);
+static void replayDeinit(void);
 static void replayRecordFrame(uint64_t frame);
 static void replayPlaybackFrame(uint64_t frame);
 static void replayPreFrame(uint64_t frame);
 
-static bool readEntry(replayEntry_t* out);
-static void writeEntry(const replayEntry_t* entry);
+static bool isBinaryFilename(const char* filename);
+static bool openReplayFile(replayFile_t* rf, const char* filename, bool writing);
+static void closeReplayFile(replayFile_t* rf);
+static void loadIndex(replayFile_t* rf);
+static bool seekReplayFile(replayFile_t* rf, int64_t time, replayEntry_t* next);
+static void updateInputState(replayInputState_t* state, const replayEntry_t* entry, uint64_t offset);
+static void freeEntry(replayEntry_t* entry);
+
+static void writeVarint(FILE* fp, uint64_t val);
+static bool readVarint(FILE* fp, uint64_t* val);
+static void writeSigned(FILE* fp, int64_t val);
+static bool readSigned(FILE* fp, int64_t* val);
+static void writeString(FILE* fp, const char* str);
+static bool readString(FILE* fp, char** str);
+
+static bool readEntry(replayFile_t* rf, replayEntry_t* out);
+static bool readEntryAt(replayFile_t* rf, uint64_t offset, replayEntry_t* entry);
+static bool readTextEntry(replayFile_t* rf, replayEntry_t* out);
+static bool readBinaryEntry(replayFile_t* rf, replayEntry_t* out);
+static void writeEntry(replayFile_t* rf, const replayEntry_t* entry);
+static void writeTextEntry(replayFile_t* rf, const replayEntry_t* entry);
+static void writeBinaryEntry(replayFile_t* rf, const replayEntry_t* entry);
 
 //==============================================================================
 // Variables
@@ -131,6 +228,7 @@ static const char* replayLogTypeStrs[] = {
 emuExtension_t replayEmuExtension = {
     .name            = "replay",
     .fnInitCb        = replayInit,
+    .fnDeinitCb      = replayDeinit,
     .fnPreFrameCb    = replayPreFrame,
     .fnPostFrameCb   = NULL,
     .fnKeyCb         = NULL,
@@ -157,11 +255,25 @@ static bool replayInit(emuArgs_t* emuArgs)
 {
     replay.lastAccelZ = 256;
 
-    if (emuArgs->record)
+    if (emuArgs->convertReplayFile)
+    {
+        // Convert the recording and exit without starting the emulator
+        if (!emuArgs->replayFile)
+        {
+            printf("ERR: Replay: --convert-replay needs a recording given with --playback\n");
+        }
+        else
+        {
+            convertReplay(emuArgs->replayFile, emuArgs->convertReplayFile, 0);
+        }
+        emulatorQuit();
+        return false;
+    }
+    else if (emuArgs->record)
     {
         startRecording(emuArgs->recordFile);
 
-        return (replayInitialized = (replay.file != NULL));
+        return (replayInitialized = (replay.file.fp != NULL));
     }
     else if (emuArgs->playback)
     {
@@ -172,16 +284,19 @@ static bool replayInit(emuArgs_t* emuArgs)
     return false;
 }
 
+/**
+ * @brief Close the recording file, which writes the index of a binary recording
+ */
+static void replayDeinit(void)
+{
+    closeReplayFile(&replay.file);
+    freeEntry(&replay.nextEntry);
+}
+
 static void replayRecordFrame(uint64_t frame)
 {
     replayEntry_t logEntry = {0};
 
-    if (!replay.headerHandled)
-    {
-        replay.headerHandled = true;
-        fwrite(HEADER, 1, strlen(HEADER), replay.file);
-    }
-
     logEntry.time = esp_timer_get_time();
 
     int32_t touchPhi, touchR, touchIntensity;
@@ -213,7 +328,7 @@ static void replayRecordFrame(uint64_t frame)
                         bool press         = (curButtons & btn) == btn;
                         logEntry.type      = press ? BUTTON_PRESS : BUTTON_RELEASE;
                         logEntry.buttonVal = btn;
-                        writeEntry(&logEntry);
+                        writeEntry(&replay.file, &logEntry);
 
                         if (press)
                         {
@@ -236,8 +351,8 @@ static void replayRecordFrame(uint64_t frame)
             {
                 if (touchPhi != replay.lastTouchPhi)
                 {
-                    logEntry.accelVal = touchPhi;
-                    writeEntry(&logEntry);
+                    logEntry.touchVal = touchPhi;
+                    writeEntry(&replay.file, &logEntry);
                 }
                 break;
             }
@@ -247,7 +362,7 @@ static void replayRecordFrame(uint64_t frame)
                 if (touchR != replay.lastTouchR)
                 {
                     logEntry.touchVal = touchR;
-                    writeEntry(&logEntry);
+                    writeEntry(&replay.file, &logEntry);
                 }
                 break;
             }
@@ -257,7 +372,7 @@ static void replayRecordFrame(uint64_t frame)
                 if (touchIntensity != replay.lastTouchIntensity)
                 {
                     logEntry.touchVal = touchIntensity;
-                    writeEntry(&logEntry);
+                    writeEntry(&replay.file, &logEntry);
                 }
                 break;
             }
@@ -267,7 +382,7 @@ static void replayRecordFrame(uint64_t frame)
                 if (accelX != replay.lastAccelX)
                 {
                     logEntry.accelVal = accelX;
-                    writeEntry(&logEntry);
+                    writeEntry(&replay.file, &logEntry);
                 }
                 break;
             }
@@ -277,7 +392,7 @@ static void replayRecordFrame(uint64_t frame)
                 if (accelY != replay.lastAccelY)
                 {
                     logEntry.accelVal = accelY;
-                    writeEntry(&logEntry);
+                    writeEntry(&replay.file, &logEntry);
                 }
                 break;
             }
@@ -287,7 +402,7 @@ static void replayRecordFrame(uint64_t frame)
                 if (accelZ != replay.lastAccelZ)
                 {
                     logEntry.accelVal = accelZ;
-                    writeEntry(&logEntry);
+                    writeEntry(&replay.file, &logEntry);
                 }
                 break;
             }
@@ -312,7 +427,7 @@ static void replayRecordFrame(uint64_t frame)
 
     // Flush all the entries to the file so that we can close the file the proper way
     // which is obviously to let the OS deal with it when the process exits
-    fflush(replay.file);
+    fflush(replay.file.fp);
 }
 
 /**
@@ -322,6 +437,15 @@ static void replayRecordFrame(uint64_t frame)
  */
 static void replayPlaybackFrame(uint64_t frame)
 {
+    // Stop fast-forwarding once the seek time is reached, or there's nothing more to play
+    if (replay.seekTime && (esp_timer_get_time() >= replay.seekTime || replay.readCompleted))
+    {
+        printf("Replay: Seeked to %" PRId64 "us, paused\n", esp_timer_get_time());
+        replay.seekTime       = 0;
+        emulatorArgs.maxSpeed = replay.maxSpeedBeforeSeek;
+        emuTimerPause();
+    }
+
     // Unless we've finished reading the file completely
     if (!replay.readCompleted)
     {
@@ -462,7 +586,7 @@ static void replayPlaybackFrame(uint64_t frame)
             }
 
             // Get the next entry
-            if (!readEntry(&replay.nextEntry))
+            if (!readEntry(&replay.file, &replay.nextEntry))
             {
                 printf("Replay: Reached end of recording\n");
                 replay.readCompleted = true;
@@ -509,24 +633,438 @@ static void replayPreFrame(uint64_t frame)
     }
 }
 
-static bool readEntry(replayEntry_t* entry)
+/**
+ * @brief Check whether a recording with the given filename should be written in the binary format. Only files ending
+ * in `.csv` are written as text
+ *
+ * @param filename The name of the recording file
+ * @return true if the file should be binary, false if it should be CSV text
+ */
+static bool isBinaryFilename(const char* filename)
 {
-    char buffer[1024];
-    if (!replay.headerHandled)
+    size_t len = strlen(filename);
+    return !(len >= 4 && !strcasecmp(&filename[len - 4], ".csv"));
+}
+
+/**
+ * @brief Open a recording file to read or write. When reading, the format is detected from the file's contents, and
+ * the index of a binary recording is loaded if it has one. When writing, the format is chosen with
+ * isBinaryFilename() and the header is written immediately
+ *
+ * @param rf The recording to open, which is cleared first
+ * @param filename The name of the file to open
+ * @param writing true to write the file, false to read it
+ * @return true if the file was opened and has a valid header
+ * @return false if the file could not be opened or is not a recording
+ */
+static bool openReplayFile(replayFile_t* rf, const char* filename, bool writing)
+{
+    memset(rf, 0, sizeof(replayFile_t));
+    rf->writing      = writing;
+    rf->state.accelZ = 256;
+
+    rf->fp = fopen(filename, writing ? "wb" : "rb");
+    if (NULL == rf->fp)
     {
-        if (1 != fscanf(replay.file, "%63[^\n]\n", buffer) || strncmp(buffer, HEADER, strlen(buffer)))
+        printf("ERR: Replay: Couldn't open %s\n", filename);
+        return false;
+    }
+
+    if (writing)
+    {
+        rf->binary = isBinaryFilename(filename);
+        if (rf->binary)
         {
-            // Couldn't read, anything.
-            printf("ERR: Invalid playback file, could not parse header\n");
+            fwrite(BINARY_MAGIC, 1, strlen(BINARY_MAGIC), rf->fp);
+            putc(BINARY_VERSION, rf->fp);
+        }
+        else
+        {
+            fwrite(HEADER, 1, strlen(HEADER), rf->fp);
+        }
+        return true;
+    }
+
+    // Check for the binary magic bytes, then for the text header
+    char magic[BINARY_HEADER_SIZE];
+    if (BINARY_HEADER_SIZE == fread(magic, 1, BINARY_HEADER_SIZE, rf->fp)
+        && !memcmp(magic, BINARY_MAGIC, strlen(BINARY_MAGIC)))
+    {
+        if (BINARY_VERSION != magic[strlen(BINARY_MAGIC)])
+        {
+            printf("ERR: Replay: %s is binary recording version %d, not %d\n", filename,
+                   magic[strlen(BINARY_MAGIC)], BINARY_VERSION);
+            closeReplayFile(rf);
             return false;
         }
 
-        replay.headerHandled = true;
+        rf->binary = true;
+        loadIndex(rf);
+        return true;
+    }
+
+    char buffer[64];
+    rewind(rf->fp);
+    if (1 != fscanf(rf->fp, "%63[^\n]\n", buffer) || strncmp(buffer, HEADER, strlen(buffer)))
+    {
+        printf("ERR: Invalid playback file, could not parse header\n");
+        closeReplayFile(rf);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Close a recording file. The index of a binary recording is written when it is closed, so a recording which
+ * was never closed can still be played back, but not seeked quickly
+ *
+ * @param rf The recording to close
+ */
+static void closeReplayFile(replayFile_t* rf)
+{
+    if (NULL != rf->fp)
+    {
+        if (rf->writing && rf->binary)
+        {
+            // The index is a tag byte, the number of checkpoints, and then each checkpoint
+            uint32_t indexOffset = (uint32_t)ftell(rf->fp);
+            putc(INDEX_TAG, rf->fp);
+            writeVarint(rf->fp, rf->numCheckpoints);
+
+            int64_t lastTime = 0;
+            for (uint32_t i = 0; i < rf->numCheckpoints; i++)
+            {
+                const replayCheckpoint_t* cp = &rf->checkpoints[i];
+                writeSigned(rf->fp, cp->time - lastTime);
+                writeVarint(rf->fp, cp->offset);
+                writeVarint(rf->fp, cp->state.buttons);
+                writeSigned(rf->fp, cp->state.touchPhi);
+                writeSigned(rf->fp, cp->state.touchR);
+                writeSigned(rf->fp, cp->state.touchIntensity);
+                writeSigned(rf->fp, cp->state.accelX);
+                writeSigned(rf->fp, cp->state.accelY);
+                writeSigned(rf->fp, cp->state.accelZ);
+                writeVarint(rf->fp, cp->state.modeOffset);
+                writeVarint(rf->fp, cp->state.seedOffset);
+                lastTime = cp->time;
+            }
+
+            // The footer points back to the index, so it can be found without reading the entries
+            for (int i = 0; i < 4; i++)
+            {
+                putc((indexOffset >> (8 * i)) & 0xFF, rf->fp);
+            }
+            fwrite(INDEX_MAGIC, 1, strlen(INDEX_MAGIC), rf->fp);
+        }
+
+        fclose(rf->fp);
+        rf->fp = NULL;
+    }
+
+    free(rf->checkpoints);
+    rf->checkpoints    = NULL;
+    rf->numCheckpoints = 0;
+    rf->checkpointCap  = 0;
+}
+
+/**
+ * @brief Load the checkpoints from the index at the end of a binary recording, then go back to the first entry. If
+ * the recording has no index, it just won't have any checkpoints
+ *
+ * @param rf The binary recording to load the index of
+ */
+static void loadIndex(replayFile_t* rf)
+{
+    uint8_t footer[INDEX_FOOTER_SIZE];
+    if (0 == fseek(rf->fp, -INDEX_FOOTER_SIZE, SEEK_END)
+        && INDEX_FOOTER_SIZE == fread(footer, 1, sizeof(footer), rf->fp)
+        && !memcmp(&footer[4], INDEX_MAGIC, strlen(INDEX_MAGIC)))
+    {
+        uint32_t indexOffset = footer[0] | (footer[1] << 8) | (footer[2] << 16) | ((uint32_t)footer[3] << 24);
+        uint64_t count;
+        if (0 == fseek(rf->fp, indexOffset, SEEK_SET) && INDEX_TAG == getc(rf->fp) && readVarint(rf->fp, &count)
+            && count > 0 && count <= UINT32_MAX)
+        {
+            rf->checkpoints = calloc(count, sizeof(replayCheckpoint_t));
+            if (NULL != rf->checkpoints)
+            {
+                rf->checkpointCap = count;
+
+                int64_t lastTime = 0;
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    replayCheckpoint_t* cp = &rf->checkpoints[i];
+                    int64_t delta, phi, r, intensity, x, y, z;
+                    uint64_t buttons;
+                    if (!readSigned(rf->fp, &delta) || !readVarint(rf->fp, &cp->offset) || !readVarint(rf->fp, &buttons)
+                        || !readSigned(rf->fp, &phi) || !readSigned(rf->fp, &r) || !readSigned(rf->fp, &intensity)
+                        || !readSigned(rf->fp, &x) || !readSigned(rf->fp, &y) || !readSigned(rf->fp, &z)
+                        || !readVarint(rf->fp, &cp->state.modeOffset) || !readVarint(rf->fp, &cp->state.seedOffset))
+                    {
+                        printf("ERR: Replay: Index is damaged, ignoring it\n");
+                        rf->numCheckpoints = 0;
+                        break;
+                    }
+
+                    cp->time                 = lastTime + delta;
+                    cp->state.buttons        = buttons;
+                    cp->state.touchPhi       = phi;
+                    cp->state.touchR         = r;
+                    cp->state.touchIntensity = intensity;
+                    cp->state.accelX         = x;
+                    cp->state.accelY         = y;
+                    cp->state.accelZ         = z;
+                    lastTime                 = cp->time;
+                    rf->numCheckpoints++;
+                }
+            }
+        }
+    }
+
+    fseek(rf->fp, BINARY_HEADER_SIZE, SEEK_SET);
+}
+
+/**
+ * @brief Move a recording which is being read to the given time. This jumps to the last checkpoint before the time,
+ * if there is one, and reads from there. The inputs which are held at the time are in the recording's state.
+ * Anything which isn't an input, like SetMode, is skipped
+ *
+ * @param rf The recording to seek
+ * @param time The time to seek to, in microseconds
+ * @param next [out] The first entry after the time
+ * @return true if there is an entry after the time, false if the recording ends before it
+ */
+static bool seekReplayFile(replayFile_t* rf, int64_t time, replayEntry_t* next)
+{
+    const replayCheckpoint_t* start = NULL;
+    for (uint32_t i = 0; i < rf->numCheckpoints && rf->checkpoints[i].time <= time; i++)
+    {
+        start = &rf->checkpoints[i];
+    }
+
+    if (NULL != start)
+    {
+        fseek(rf->fp, start->offset, SEEK_SET);
+        rf->lastTime = start->time;
+        rf->state    = start->state;
+    }
+    else
+    {
+        // Start from the first entry
+        memset(&rf->state, 0, sizeof(replayInputState_t));
+        rf->state.accelZ = 256;
+        rf->lastTime     = 0;
+        if (rf->binary)
+        {
+            fseek(rf->fp, BINARY_HEADER_SIZE, SEEK_SET);
+        }
+        else
+        {
+            // Skip the header, which was checked when the file was opened
+            rewind(rf->fp);
+            if (EOF == fscanf(rf->fp, "%*[^\n]\n"))
+            {
+                return false;
+            }
+        }
+    }
+
+    // Reading an entry applies it to the state, so keep the state from before the first entry after the time
+    replayInputState_t state = rf->state;
+    while (readEntry(rf, next))
+    {
+        if (next->time > time)
+        {
+            rf->state = state;
+            return true;
+        }
+        freeEntry(next);
+        state = rf->state;
     }
+    return false;
+}
 
+/**
+ * @brief Track the inputs which are held after an entry, and where the last SetMode and RandomSeed entries are
+ *
+ * @param state The inputs to update
+ * @param entry The entry to apply to them
+ * @param offset Where the entry starts in the file
+ */
+static void updateInputState(replayInputState_t* state, const replayEntry_t* entry, uint64_t offset)
+{
+    switch (entry->type)
+    {
+        case BUTTON_PRESS:
+            state->buttons |= entry->buttonVal;
+            break;
+        case BUTTON_RELEASE:
+            state->buttons &= ~entry->buttonVal;
+            break;
+        case TOUCH_PHI:
+            state->touchPhi = entry->touchVal;
+            break;
+        case TOUCH_R:
+            state->touchR = entry->touchVal;
+            break;
+        case TOUCH_INTENSITY:
+            state->touchIntensity = entry->touchVal;
+            break;
+        case ACCEL_X:
+            state->accelX = entry->accelVal;
+            break;
+        case ACCEL_Y:
+            state->accelY = entry->accelVal;
+            break;
+        case ACCEL_Z:
+            state->accelZ = entry->accelVal;
+            break;
+        case SET_MODE:
+            state->modeOffset = offset;
+            break;
+        case RANDOM_SEED:
+            state->seedOffset = offset;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Free the string of an entry which has one
+ *
+ * @param entry The entry to free the string of
+ */
+static void freeEntry(replayEntry_t* entry)
+{
+    switch (entry->type)
+    {
+        case SCREENSHOT:
+        case SET_MODE:
+        case COMMAND:
+        {
+            // These all share the same union member
+            free(entry->filename);
+            entry->filename = NULL;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Read the next entry from a recording, in whichever format it is
+ *
+ * @param rf The recording to read from
+ * @param entry [out] The entry which was read. Its string, if it has one, must be freed
+ * @return true if an entry was read, false at the end of the recording or if there was an error
+ */
+static bool readEntry(replayFile_t* rf, replayEntry_t* entry)
+{
+    // Start from nothing, so an entry which couldn't be read never has a string to free
+    memset(entry, 0, sizeof(replayEntry_t));
+    long offset = (NULL == rf->fp) ? 0 : ftell(rf->fp);
+    if (NULL == rf->fp || !(rf->binary ? readBinaryEntry(rf, entry) : readTextEntry(rf, entry)))
+    {
+        freeEntry(entry);
+        memset(entry, 0, sizeof(replayEntry_t));
+        return false;
+    }
+
+    rf->lastTime = entry->time;
+    updateInputState(&rf->state, entry, offset);
+    return true;
+}
+
+/**
+ * @brief Read the entry which starts at the given offset, then go back to where the recording was. The entry's time
+ * is not valid, because binary times are relative to the entry before
+ *
+ * @param rf The recording to read from
+ * @param offset Where the entry starts in the file
+ * @param entry [out] The entry which was read. Its string, if it has one, must be freed
+ * @return true if an entry was read, false if there was an error
+ */
+static bool readEntryAt(replayFile_t* rf, uint64_t offset, replayEntry_t* entry)
+{
+    long pos                 = ftell(rf->fp);
+    int64_t lastTime         = rf->lastTime;
+    replayInputState_t state = rf->state;
+
+    bool read = (0 == fseek(rf->fp, offset, SEEK_SET)) && readEntry(rf, entry);
+
+    fseek(rf->fp, pos, SEEK_SET);
+    rf->lastTime = lastTime;
+    rf->state    = state;
+    return read;
+}
+
+/**
+ * @brief Write an entry to a recording, in whichever format it is. A binary recording gets a checkpoint before the
+ * first entry of each frame once ::CHECKPOINT_INTERVAL_US has passed since the last one
+ *
+ * @param rf The recording to write to
+ * @param entry The entry to write
+ */
+static void writeEntry(replayFile_t* rf, const replayEntry_t* entry)
+{
+    if (NULL == rf->fp)
+    {
+        return;
+    }
+
+    // Checkpoints don't write anything, so this is where the entry starts
+    long offset = ftell(rf->fp);
+    if (rf->binary)
+    {
+        if (entry->time != rf->lastTime && entry->time >= rf->nextCheckpointTime)
+        {
+            if (rf->numCheckpoints == rf->checkpointCap)
+            {
+                uint32_t newCap           = rf->checkpointCap ? rf->checkpointCap * 2 : 64;
+                replayCheckpoint_t* grown = realloc(rf->checkpoints, newCap * sizeof(replayCheckpoint_t));
+                if (NULL != grown)
+                {
+                    rf->checkpoints   = grown;
+                    rf->checkpointCap = newCap;
+                }
+            }
+
+            if (rf->numCheckpoints < rf->checkpointCap)
+            {
+                replayCheckpoint_t* cp = &rf->checkpoints[rf->numCheckpoints++];
+                cp->time               = rf->lastTime;
+                cp->offset             = ftell(rf->fp);
+                cp->state              = rf->state;
+            }
+            rf->nextCheckpointTime = entry->time + CHECKPOINT_INTERVAL_US;
+        }
+
+        writeBinaryEntry(rf, entry);
+    }
+    else
+    {
+        writeTextEntry(rf, entry);
+    }
+
+    rf->lastTime = entry->time;
+    updateInputState(&rf->state, entry, offset);
+}
+
+/**
+ * @brief Read the next entry from a CSV text recording
+ *
+ * @param rf The recording to read from
+ * @param entry [out] The entry which was read
+ * @return true if an entry was read, false at the end of the file or if there was an error
+ */
+static bool readTextEntry(replayFile_t* rf, replayEntry_t* entry)
+{
+    char buffer[1024];
     int result;
     // Read timestamp index
-    result = fscanf(replay.file, "%" PRId64 ",", &entry->time);
+    result = fscanf(rf->fp, "%" PRId64 ",", &entry->time);
 
     // Check if the index key was readable
     if (result != 1)
@@ -543,7 +1081,7 @@ static bool readEntry(replayEntry_t* entry)
         return false;
     }
 
-    if (1 != fscanf(replay.file, "%63[^,],", buffer))
+    if (1 != fscanf(rf->fp, "%63[^,],", buffer))
     {
         printf("ERR: Can't read action type\n");
         return false;
@@ -571,7 +1109,7 @@ static bool readEntry(replayEntry_t* entry)
         case BUTTON_PRESS:
         case BUTTON_RELEASE:
         {
-            if (1 != fscanf(replay.file, "%63s\n", buffer))
+            if (1 != fscanf(rf->fp, "%63s\n", buffer))
             {
                 printf("ERR: Can't read button name\n");
                 return false;
@@ -593,7 +1131,7 @@ static bool readEntry(replayEntry_t* entry)
         case TOUCH_R:
         case TOUCH_INTENSITY:
         {
-            if (1 != fscanf(replay.file, "%" PRId32 "\n", &entry->touchVal))
+            if (1 != fscanf(rf->fp, "%" PRId32 "\n", &entry->touchVal))
             {
                 return false;
             }
@@ -604,7 +1142,7 @@ static bool readEntry(replayEntry_t* entry)
         case ACCEL_Y:
         case ACCEL_Z:
         {
-            if (1 != fscanf(replay.file, "%hd\n", &entry->accelVal))
+            if (1 != fscanf(rf->fp, "%hd\n", &entry->accelVal))
             {
                 return false;
             }
@@ -613,10 +1151,10 @@ static bool readEntry(replayEntry_t* entry)
 
         case FUZZ:
         {
-            // Just advance to the next line, with warning suppression
-            if (fscanf(replay.file, "%*[^\n]\n"))
+            // Just advance to the next line. There may be no value, or no newline at the end of the file
+            if (EOF == fscanf(rf->fp, "%*[^\n]\n") && ferror(rf->fp))
             {
-                ;
+                return false;
             }
 
             break;
@@ -625,7 +1163,7 @@ static bool readEntry(replayEntry_t* entry)
         case QUIT:
         {
             // Just advance to the next line
-            while (fgetc(replay.file) != '\n')
+            while (fgetc(rf->fp) != '\n')
                 ;
             break;
         }
@@ -633,10 +1171,10 @@ static bool readEntry(replayEntry_t* entry)
         case SCREENSHOT:
         {
             // Read the filename from the screenshot
-            if (1 != fscanf(replay.file, "%63[^\n]\n", buffer))
+            if (1 != fscanf(rf->fp, "%63[^\n]\n", buffer))
             {
                 // Skip to the end
-                while (fgetc(replay.file) != '\n')
+                while (fgetc(rf->fp) != '\n')
                     ;
                 entry->filename = NULL;
             }
@@ -653,7 +1191,7 @@ static bool readEntry(replayEntry_t* entry)
         case SET_MODE:
         {
             // Read the mode name from the file
-            if (1 != fscanf(replay.file, "%63[^\n]\n", buffer))
+            if (1 != fscanf(rf->fp, "%63[^\n]\n", buffer))
             {
                 return false;
             }
@@ -668,7 +1206,7 @@ static bool readEntry(replayEntry_t* entry)
         case RANDOM_SEED:
         {
             // Read the seed value from the file
-            if (1 != fscanf(replay.file, "%" PRIu32 "\n", &entry->seedVal))
+            if (1 != fscanf(rf->fp, "%" PRIu32 "\n", &entry->seedVal))
             {
                 return false;
             }
@@ -677,7 +1215,7 @@ static bool readEntry(replayEntry_t* entry)
 
         case COMMAND:
         {
-            if (1 != fscanf(replay.file, "%1023[^\n]\n", buffer))
+            if (1 != fscanf(rf->fp, "%1023[^\n]\n", buffer))
             {
                 return false;
             }
@@ -697,7 +1235,13 @@ static bool readEntry(replayEntry_t* entry)
     return true;
 }
 
-static void writeEntry(const replayEntry_t* entry)
+/**
+ * @brief Write an entry to a CSV text recording
+ *
+ * @param rf The recording to write to
+ * @param entry The entry to write
+ */
+static void writeTextEntry(replayFile_t* rf, const replayEntry_t* entry)
 {
     char buffer[1024];
     char* ptr = buffer;
@@ -737,6 +1281,8 @@ static void writeEntry(const replayEntry_t* entry)
         case FUZZ:
         case QUIT:
         {
+            // There's no value, but the line still has to end
+            snprintf(ptr, BUFSIZE, "\n");
             break;
         }
 
@@ -765,42 +1311,323 @@ static void writeEntry(const replayEntry_t* entry)
         }
     }
 
-    fwrite(buffer, 1, strlen(buffer), replay.file);
+    fwrite(buffer, 1, strlen(buffer), rf->fp);
 }
 
 /**
- * @brief Begins recording emulator inputs to the given filename
+ * @brief Write an unsigned integer in as few bytes as it needs, seven bits per byte, low bits first. The top bit of
+ * each byte is set if more bytes follow
  *
- * @param filename The name of the recording file to write
+ * @param fp The file to write to
+ * @param val The value to write
  */
-void startRecording(const char* filename)
+static void writeVarint(FILE* fp, uint64_t val)
+{
+    do
+    {
+        uint8_t b = val & 0x7F;
+        val >>= 7;
+        putc(val ? (b | 0x80) : b, fp);
+    } while (val);
+}
+
+/**
+ * @brief Read an unsigned integer written with writeVarint()
+ *
+ * @param fp The file to read from
+ * @param val [out] The value which was read
+ * @return true if the value was read, false at the end of the file or if it was too long
+ */
+static bool readVarint(FILE* fp, uint64_t* val)
+{
+    *val = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int c = getc(fp);
+        if (EOF == c)
+        {
+            return false;
+        }
+        *val |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Write a signed integer with writeVarint(), zig-zag encoded so small negative values are small too
+ *
+ * @param fp The file to write to
+ * @param val The value to write
+ */
+static void writeSigned(FILE* fp, int64_t val)
+{
+    writeVarint(fp, ((uint64_t)val << 1) ^ (uint64_t)(val >> 63));
+}
+
+/**
+ * @brief Read a signed integer written with writeSigned()
+ *
+ * @param fp The file to read from
+ * @param val [out] The value which was read
+ * @return true if the value was read, false at the end of the file or if it was too long
+ */
+static bool readSigned(FILE* fp, int64_t* val)
+{
+    uint64_t zigzag;
+    if (!readVarint(fp, &zigzag))
+    {
+        return false;
+    }
+    *val = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+    return true;
+}
+
+/**
+ * @brief Write a string as its length and then its characters, without a NUL
+ *
+ * @param fp The file to write to
+ * @param str The string to write, or NULL to write an empty string
+ */
+static void writeString(FILE* fp, const char* str)
+{
+    size_t len = str ? strlen(str) : 0;
+    writeVarint(fp, len);
+    fwrite(str, 1, len, fp);
+}
+
+/**
+ * @brief Read a string written with writeString()
+ *
+ * @param fp The file to read from
+ * @param str [out] A newly allocated copy of the string, or NULL if it was empty
+ * @return true if the string was read, false at the end of the file or if it was too long
+ */
+static bool readString(FILE* fp, char** str)
+{
+    uint64_t len;
+    *str = NULL;
+    if (!readVarint(fp, &len) || len > MAX_STRING_LEN)
+    {
+        return false;
+    }
+    if (0 == len)
+    {
+        return true;
+    }
+
+    *str = malloc(len + 1);
+    if (len != fread(*str, 1, len, fp))
+    {
+        free(*str);
+        *str = NULL;
+        return false;
+    }
+    (*str)[len] = '\0';
+    return true;
+}
+
+/**
+ * @brief Read the next entry from a binary recording. Each entry is a type byte, then the time since the previous
+ * entry with writeSigned(), then a value which depends on the type
+ *
+ * @param rf The recording to read from
+ * @param entry [out] The entry which was read
+ * @return true if an entry was read, false at the end of the entries or if there was an error
+ */
+static bool readBinaryEntry(replayFile_t* rf, replayEntry_t* entry)
+{
+    int type = getc(rf->fp);
+    if (EOF == type || INDEX_TAG == type)
+    {
+        // The index follows the last entry
+        return false;
+    }
+    else if (type > LAST_TYPE)
+    {
+        printf("ERR: Replay: Unknown entry type %d\n", type);
+        return false;
+    }
+
+    int64_t delta;
+    if (!readSigned(rf->fp, &delta))
+    {
+        printf("ERR: Can't read Time from recording\n");
+        return false;
+    }
+    entry->time = rf->lastTime + delta;
+    entry->type = type;
+
+    uint64_t uval;
+    int64_t sval;
+    switch (entry->type)
+    {
+        case BUTTON_PRESS:
+        case BUTTON_RELEASE:
+        {
+            if (!readVarint(rf->fp, &uval) || 0 == uval)
+            {
+                printf("ERR: Can't read button\n");
+                return false;
+            }
+            entry->buttonVal = uval;
+            break;
+        }
+
+        case TOUCH_PHI:
+        case TOUCH_R:
+        case TOUCH_INTENSITY:
+        {
+            if (!readSigned(rf->fp, &sval))
+            {
+                return false;
+            }
+            entry->touchVal = sval;
+            break;
+        }
+
+        case ACCEL_X:
+        case ACCEL_Y:
+        case ACCEL_Z:
+        {
+            if (!readSigned(rf->fp, &sval))
+            {
+                return false;
+            }
+            entry->accelVal = sval;
+            break;
+        }
+
+        case FUZZ:
+        case QUIT:
+        {
+            break;
+        }
+
+        case SCREENSHOT:
+        {
+            return readString(rf->fp, &entry->filename);
+        }
+
+        case SET_MODE:
+        {
+            return readString(rf->fp, &entry->modeName) && NULL != entry->modeName;
+        }
+
+        case RANDOM_SEED:
+        {
+            if (!readVarint(rf->fp, &uval))
+            {
+                return false;
+            }
+            entry->seedVal = uval;
+            break;
+        }
+
+        case COMMAND:
+        {
+            return readString(rf->fp, &entry->commandStr) && NULL != entry->commandStr;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Write an entry to a binary recording, see readBinaryEntry()
+ *
+ * @param rf The recording to write to
+ * @param entry The entry to write
+ */
+static void writeBinaryEntry(replayFile_t* rf, const replayEntry_t* entry)
 {
-    if (replay.file != NULL)
+    putc(entry->type, rf->fp);
+    writeSigned(rf->fp, entry->time - rf->lastTime);
+
+    switch (entry->type)
     {
-        fclose(replay.file);
-        replay.file = NULL;
+        case BUTTON_PRESS:
+        case BUTTON_RELEASE:
+        {
+            writeVarint(rf->fp, entry->buttonVal);
+            break;
+        }
+
+        case TOUCH_PHI:
+        case TOUCH_R:
+        case TOUCH_INTENSITY:
+        {
+            writeSigned(rf->fp, entry->touchVal);
+            break;
+        }
+
+        case ACCEL_X:
+        case ACCEL_Y:
+        case ACCEL_Z:
+        {
+            writeSigned(rf->fp, entry->accelVal);
+            break;
+        }
+
+        case FUZZ:
+        case QUIT:
+        {
+            break;
+        }
+
+        case SCREENSHOT:
+        {
+            writeString(rf->fp, entry->filename);
+            break;
+        }
+
+        case SET_MODE:
+        {
+            writeString(rf->fp, entry->modeName);
+            break;
+        }
+
+        case RANDOM_SEED:
+        {
+            writeVarint(rf->fp, entry->seedVal);
+            break;
+        }
+
+        case COMMAND:
+        {
+            writeString(rf->fp, entry->commandStr);
+            break;
+        }
     }
+}
+
+/**
+ * @brief Begins recording emulator inputs to the given filename. Files ending in `.csv` are written as text, and
+ * anything else is written in the smaller binary format
+ *
+ * @param filename The name of the recording file to write, or NULL for an automatically generated binary one
+ */
+void startRecording(const char* filename)
+{
+    closeReplayFile(&replay.file);
 
     char buf[128];
     if (!filename || !*filename)
     {
-        filename = getTimestampFilename(buf, sizeof(buf) - 1, "rec-", "csv");
+        filename = getTimestampFilename(buf, sizeof(buf) - 1, "rec-", "rpl");
     }
 
     // If specified, use custom filename, otherwise use timestamp one
     printf("\nReplay: Recording inputs to file %s\n", filename);
-    replay.file = fopen(filename, "w");
+    openReplayFile(&replay.file, filename, true);
     replay.mode = RECORD;
-    if (replay.file != NULL)
+    if (replay.file.fp != NULL)
     {
         if (emulatorArgs.startMode)
         {
-            if (!replay.headerHandled)
-            {
-                replay.headerHandled = true;
-                fwrite(HEADER, 1, strlen(HEADER), replay.file);
-            }
-
             // Immediately record the start mode
             replayEntry_t modeEntry = {
                 .type     = SET_MODE,
@@ -812,63 +1639,197 @@ void startRecording(const char* filename)
             strncpy(tmpStr, emulatorArgs.startMode, strlen(emulatorArgs.startMode) + 1);
             modeEntry.modeName = tmpStr;
 
-            writeEntry(&modeEntry);
+            writeEntry(&replay.file, &modeEntry);
             free(tmpStr);
         }
 
         if (emulatorArgs.seed)
         {
-            if (!replay.headerHandled)
-            {
-                replay.headerHandled = true;
-                fwrite(HEADER, 1, strlen(HEADER), replay.file);
-            }
-
             // Immediately record the start mode
             replayEntry_t seedEntry = {
                 .type    = RANDOM_SEED,
                 .time    = 0,
                 .seedVal = emulatorArgs.seed,
             };
-            writeEntry(&seedEntry);
+            writeEntry(&replay.file, &seedEntry);
         }
     }
 }
 
 void stopRecording(void)
 {
-    if (replay.file != NULL && replay.mode == RECORD)
+    if (replay.file.fp != NULL && replay.mode == RECORD)
     {
-        fclose(replay.file);
-        replay.file = NULL;
+        closeReplayFile(&replay.file);
         printf("\nStopped recording inputs\n");
     }
 }
 
 bool isRecordingInput(void)
 {
-    return replay.file != NULL && replay.mode == RECORD;
+    return replay.file.fp != NULL && replay.mode == RECORD;
 }
 
 /**
- * @brief Begins playing back emulator inputs from the given file
+ * @brief Begins playing back emulator inputs from the given file, which may be in either format
  *
  * @param recordingName The name of the recording file to play back
  */
 void startPlayback(const char* recordingName)
 {
-    if (replay.file != NULL)
-    {
-        fclose(replay.file);
-        replay.file = NULL;
-    }
+    closeReplayFile(&replay.file);
+    freeEntry(&replay.nextEntry);
 
     printf("\nReplay: Replaying inputs from file %s\n", recordingName);
-    replay.file = fopen(recordingName, "r");
+    openReplayFile(&replay.file, recordingName, false);
     replay.mode = REPLAY;
 
-    // Return true if the file was opened OK and has a valid header and first entry
-    readEntry(&replay.nextEntry);
+    // Playback is finished right away if the file couldn't be opened or has no entries
+    replay.readCompleted = !readEntry(&replay.file, &replay.nextEntry);
+}
+
+/**
+ * @brief Fast-forwards playback to the given time, then pauses. Frames are run as fast as possible until then, like
+ * with `--max-speed`, so this only works with `--fake-time`, which makes playback deterministic
+ *
+ * @param time The time to seek to, in microseconds. It must be later than the current time
+ * @return true if playback will seek to the time
+ * @return false if playback can't seek to the time
+ */
+bool seekPlayback(int64_t time)
+{
+    if (replay.mode != REPLAY || NULL == replay.file.fp || replay.readCompleted)
+    {
+        printf("ERR: Replay: Nothing is being played back\n");
+        return false;
+    }
+    else if (!emulatorArgs.fakeTime)
+    {
+        printf("ERR: Replay: Seeking needs --fake-time\n");
+        return false;
+    }
+    else if (time <= esp_timer_get_time())
+    {
+        printf("ERR: Replay: Can only seek forward, it's already %" PRId64 "us\n", esp_timer_get_time());
+        return false;
+    }
+
+    if (!replay.seekTime)
+    {
+        replay.maxSpeedBeforeSeek = emulatorArgs.maxSpeed;
+    }
+    replay.seekTime       = time;
+    emulatorArgs.maxSpeed = true;
+    return true;
+}
+
+/**
+ * @brief Converts a recording to the format given by the output's filename, see startRecording(). The input may be in
+ * either format. Only the part of the recording from the given time is kept, starting with the inputs which are held
+ * at that time, so a section of a long recording can be looked at quickly. A binary input with an index is seeked
+ * without reading the whole recording
+ *
+ * @param inName The name of the recording to convert
+ * @param outName The name of the file to write the converted recording to
+ * @param start The time to start the converted recording at, in microseconds, or 0 for the whole recording
+ * @return true if the recording was converted
+ * @return false if there was an error
+ */
+bool convertReplay(const char* inName, const char* outName, int64_t start)
+{
+    replayFile_t in  = {0};
+    replayFile_t out = {0};
+    if (!openReplayFile(&in, inName, false))
+    {
+        return false;
+    }
+    if (!openReplayFile(&out, outName, true))
+    {
+        closeReplayFile(&in);
+        return false;
+    }
+
+    replayEntry_t entry = {0};
+    bool haveEntry;
+    if (start > 0)
+    {
+        haveEntry = seekReplayFile(&in, start, &entry);
+
+        // Write the mode and seed which were set before the start, in the order they were set
+        uint64_t setOffsets[] = {in.state.modeOffset, in.state.seedOffset};
+        if (setOffsets[0] > setOffsets[1])
+        {
+            setOffsets[0] = in.state.seedOffset;
+            setOffsets[1] = in.state.modeOffset;
+        }
+        for (uint8_t i = 0; i < ARRAY_SIZE(setOffsets); i++)
+        {
+            replayEntry_t set;
+            if (0 != setOffsets[i] && readEntryAt(&in, setOffsets[i], &set))
+            {
+                set.time = start;
+                writeEntry(&out, &set);
+                freeEntry(&set);
+            }
+        }
+
+        // Write the inputs which are held at the start
+        replayEntry_t held = {.time = start};
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            if (in.state.buttons & (1 << i))
+            {
+                held.type      = BUTTON_PRESS;
+                held.buttonVal = (1 << i);
+                writeEntry(&out, &held);
+            }
+        }
+
+        const int32_t touchVals[] = {in.state.touchPhi, in.state.touchR, in.state.touchIntensity};
+        for (uint8_t i = 0; i < ARRAY_SIZE(touchVals); i++)
+        {
+            held.type     = TOUCH_PHI + i;
+            held.touchVal = touchVals[i];
+            writeEntry(&out, &held);
+        }
+
+        const int16_t accelVals[] = {in.state.accelX, in.state.accelY, in.state.accelZ};
+        for (uint8_t i = 0; i < ARRAY_SIZE(accelVals); i++)
+        {
+            held.type     = ACCEL_X + i;
+            held.accelVal = accelVals[i];
+            writeEntry(&out, &held);
+        }
+    }
+    else
+    {
+        haveEntry = readEntry(&in, &entry);
+    }
+
+    uint32_t count = 0;
+    while (haveEntry)
+    {
+        writeEntry(&out, &entry);
+        freeEntry(&entry);
+        count++;
+        haveEntry = readEntry(&in, &entry);
+    }
+
+    long inSize = ftell(in.fp);
+    closeReplayFile(&in);
+    closeReplayFile(&out);
+
+    FILE* outFile = fopen(outName, "rb");
+    long outSize  = 0;
+    if (NULL != outFile)
+    {
+        fseek(outFile, 0, SEEK_END);
+        outSize = ftell(outFile);
+        fclose(outFile);
+    }
+    printf("Replay: Converted %" PRIu32 " entries from %s (%ld bytes) to %s (%ld bytes)\n", count, inName, inSize,
+           outName, outSize);
+    return true;
 }
 
 /**
@@ -879,7 +1840,7 @@ void startPlayback(const char* recordingName)
 void recordScreenshotTaken(const char* name)
 {
     // Check that we're recording, otherwise we don't do anything
-    if (replay.mode == RECORD && replay.file)
+    if (replay.mode == RECORD && replay.file.fp)
     {
         replayEntry_t entry = {
             .time     = esp_timer_get_time(),
@@ -893,11 +1854,11 @@ void recordScreenshotTaken(const char* name)
             char tmp[strlen(name) + 1];
             strcpy(tmp, name);
             entry.filename = tmp;
-            writeEntry(&entry);
+            writeEntry(&replay.file, &entry);
         }
         else
         {
-            writeEntry(&entry);
+            writeEntry(&replay.file, &entry);
         }
     }
 }
@@ -909,7 +1870,7 @@ void recordScreenshotTaken(const char* name)
  */
 void emulatorRecordRandomSeed(uint32_t seed)
 {
-    if (replay.mode == RECORD && replay.file)
+    if (replay.mode == RECORD && replay.file.fp)
     {
         replayEntry_t entry = {
             // We want this to happen as early as possible so minor timing differences don't cause it to get missed
@@ -917,7 +1878,7 @@ void emulatorRecordRandomSeed(uint32_t seed)
             .type    = RANDOM_SEED,
             .seedVal = seed,
         };
-        writeEntry(&entry);
+        writeEntry(&replay.file, &entry);
     }
 }
 
@@ -928,7 +1889,7 @@ void emulatorRecordRandomSeed(uint32_t seed)
  */
 void emulatorRecordCommand(const char* command)
 {
-    if (replay.mode == RECORD && replay.file)
+    if (replay.mode == RECORD && replay.file.fp)
     {
         replayEntry_t entry = {
             .time       = esp_timer_get_time(),
@@ -947,11 +1908,11 @@ void emulatorRecordCommand(const char* command)
             char tmp[strlen(command) + 1];
             strcpy(tmp, command);
             entry.commandStr = tmp;
-            writeEntry(&entry);
+            writeEntry(&replay.file, &entry);
         }
         else
         {
-            writeEntry(&entry);
+            writeEntry(&replay.file, &entry);
         }
     }
 }
@@ -10,8 +10,14 @@
  * generate a screenshot of a specific screen.
  *
  * \section ext_format Recording File Format
- * If not given a custom name, recording files will be created in the current directory with the
- * name 'rec-TIMESTAMP.csv' As suggested by the name, this is simply a CSV file. The first line
+ * Recordings can be written in two formats. Files whose names end in `.csv` are written as text, which
+ * is easy to read and edit by hand, and anything else is written in a smaller binary format, which is
+ * described below. If not given a custom name, recording files will be created in the current
+ * directory with the name 'rec-TIMESTAMP.rpl' in the binary format. Playback detects the format from
+ * the file's contents, and a recording can be converted from one format to the other with
+ * `--playback IN --convert-replay OUT`, or the `replay convert` console command.
+ *
+ * The text format is simply a CSV file. The first line
  * contains the header, which specifies three columns: Time, Type, and Value. The rest of the lines
  * will be the individual input values or special actions.
  *
@@ -59,6 +65,30 @@
  * 10000000,Screenshot,afterFuzz.bmp
  * 10000000,Quit,
  * \endcode
+ *
+ * \section ext_binary_format Binary Recording File Format
+ * A binary recording starts with the four bytes `SWRP` and a version byte, which is currently 2. Then
+ * each entry is one byte of `Type`, counting from 0 for `BtnDown` in the order listed above, followed
+ * by the `Time` since the previous entry, and then the `Value`. Integers are written as varints, seven
+ * bits per byte with the low bits first and the top bit set when more bytes follow, and signed values
+ * like the time and the touchpad and accelerometer readings are zig-zag encoded first so that small
+ * negative values stay small. Buttons are written as their bit, and strings as their length followed
+ * by their characters.
+ *
+ * When a binary recording is closed, a byte of 0xFF ends the entries and an index of checkpoints
+ * follows. A checkpoint is written about once per second of recorded time and holds the offset of an
+ * entry along with all the inputs which are held at that point, and the offsets of the last `SetMode`
+ * and `Seed` entries before it, or 0 if there were none. So a recording can be read from any
+ * checkpoint without reading everything before it. The last eight bytes of the file are the offset of
+ * the 0xFF byte, as a little-endian 32-bit value, and `SWRI`. A recording which was never closed has no
+ * index, but can still be played back.
+ *
+ * \section ext_fast_playback Fast Playback
+ * Recordings normally play back at the pace they were recorded. With `--fake-time`, each frame advances
+ * the clock by the same amount, so a recording made with `--fake-time` plays back identically every
+ * time. Adding `--max-speed` runs those frames as fast as possible, so a long recording plays back in a
+ * fraction of its length, with the same results. The `replay seek TIME` console command does the same
+ * thing until playback reaches TIME, in seconds, and then pauses.
  */
 
 #pragma once
@@ -72,6 +102,8 @@ void startRecording(const char* recordingName);
 void stopRecording(void);
 bool isRecordingInput(void);
 void startPlayback(const char* recordingName);
+bool seekPlayback(int64_t time);
+bool convertReplay(const char* inName, const char* outName, int64_t start);
 void recordScreenshotTaken(const char* name);
 void emulatorRecordRandomSeed(uint32_t seed);
 void emulatorRecordCommand(const char* command);
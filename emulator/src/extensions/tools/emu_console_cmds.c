@@ -2,6 +2,12 @@
 #include "macros.h"
 
 #include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
 
 #include "ext_modes.h"
 #include "ext_tools.h"
@@ -9,8 +15,18 @@
 #include "ext_replay.h"
 #include "ext_fuzzer.h"
 #include "ext_gamepad.h"
+#include "ext_midi.h"
 #include "hdw-nvs_emu.h"
 #include "emu_cnfs.h"
+#include "midiPlayer.h"
+#include "hdw-dac.h"
+#include "pitchDetect.h"
+#include "linked_list.h"
+#include "hashMap.h"
+#include "swSynth.h"
+#include "DFT32.h"
+#include "drums.h"
+#include "os_generic.h"
 
 // Console command handlers
 static int screenshotCommandCb(const char** args, int argCount, char* out);
@@ -22,7 +38,13 @@ static int fuzzCommandCb(const char** args, int argCount, char* out);
 static int touchCommandCb(const char** args, int argCount, char* out);
 static int ledsCommandCb(const char** args, int argCount, char* out);
 static int injectCommandCb(const char** args, int argCount, char* out);
+static int cnfsCommandCb(const char** args, int argCount, char* out);
 static int joystickCommandCb(const char** args, int argCount, char* out);
+static int midiStressCommandCb(const char** args, int argCount, char* out);
+static int midiJitterCommandCb(const char** args, int argCount, char* out);
+static int audioCommandCb(const char** args, int argCount, char* out);
+static int pitchCommandCb(const char** args, int argCount, char* out);
+static int benchCommandCb(const char** args, int argCount, char* out);
 static int helpCommandCb(const char** args, int argCount, char* out);
 
 // command, usage, description
@@ -33,7 +55,12 @@ static const char* commandDocs[][3] = {
     {"gif", "gif [filename]",
      "starts or stops recording the screen to a GIF named [filename], or an auto-generated file name if not specified"},
     {"mode", "mode [name]", "immediately changes the mode to [name], or lists all mode names if not specified"},
-    {"replay", "replay [filename]", "open and replay recorded inputs from replay file [filename]"},
+    {"replay", "replay [filename]", "open and replay recorded inputs from replay file [filename], in either format"},
+    {"replay seek", "replay seek <seconds>",
+     "plays back as fast as possible until <seconds> into the recording, then pauses. Needs --fake-time"},
+    {"replay convert", "replay convert <in> <out> [seconds]",
+     "converts recording <in> to <out>, which is text if it ends in .csv or binary otherwise. If [seconds] is given, "
+     "only the inputs from then on are kept"},
     {"record", "record [name]",
      "begin recording inputs into replay file [filename], or an auto-generated file name if not specified"},
     {"fuzz", "fuzz [on|off]", "toggles the fuzzer"},
@@ -60,6 +87,28 @@ static const char* commandDocs[][3] = {
     {"inject nvs", "inject nvs [namespace] <key> <int|str|file> <value>",
      "injects data into an NVS key. Value can be either an integer, a string, or a file path"},
     {"inject asset", "inject asset <name> <filename>", "injects a file's entire contents as an asset"},
+    {"cnfs", "cnfs [reload]",
+     "prints where assets are loaded from, or reloads the CNFS image given with --cnfs-image. Re-enter a mode to see "
+     "its new assets"},
+    {"audio", "audio [reset]",
+     "prints DAC underruns, late refills, and DSP load, and the voice budget of the system MIDI players. 'reset' "
+     "clears the DAC statistics"},
+    {"audio latency", "audio latency [buffers]", "sets or prints how many buffers are rendered ahead of the output"},
+    {"audio stall", "audio stall <ms>",
+     "blocks the main loop for <ms> milliseconds, then prints how many underruns happened meanwhile"},
+    {"pitch", "pitch <filename>",
+     "runs a 16-bit PCM WAV file through the tuner's pitch detector and prints the most common note, how far off it "
+     "was, and how long each analysis took"},
+    {"midistress", "midistress [ms]",
+     "hammers a private MIDI player's command queue from one thread while another renders audio, for [ms] "
+     "milliseconds or 2000 if not specified. Build with ENABLE_TSAN=true to check for data races"},
+    {"midijitter", "midijitter [count] [period]",
+     "streams [count] notes, or 40 if not specified, [period] milliseconds apart, or 50 if not specified, to a private "
+     "MIDI player and prints how long they took to be heard and how much that varied, with and without the stream "
+     "latency"},
+    {"bench", "bench [name]",
+     "runs the benchmark called [name], or lists them if not specified, and prints the results to stdout. Build with "
+     "ENABLE_BENCHMARKS=true to include them"},
     {"help", "help [command]", "prints help text for all commands, or for commands matching [command]"},
 };
 
@@ -69,8 +118,27 @@ static const consoleCommand_t consoleCommands[] = {
     {.name = "record", .cb = recordCommandCb},         {.name = "fuzz", .cb = fuzzCommandCb},
     {.name = "touchpad", .cb = touchCommandCb},        {.name = "leds", .cb = ledsCommandCb},
     {.name = "inject", .cb = injectCommandCb},         {.name = "help", .cb = helpCommandCb},
-    {.name = "joystick", .cb = joystickCommandCb},
+    {.name = "joystick", .cb = joystickCommandCb},     {.name = "midistress", .cb = midiStressCommandCb},
+    {.name = "audio", .cb = audioCommandCb},           {.name = "pitch", .cb = pitchCommandCb},
+    {.name = "midijitter", .cb = midiJitterCommandCb}, {.name = "cnfs", .cb = cnfsCommandCb},
+    {.name = "bench", .cb = benchCommandCb},
+};
+
+#ifdef ENABLE_BENCHMARKS
+/// The benchmarks which the bench command can run, by name
+static const struct
+{
+    const char* name;
+    void (*fn)(void);
+} benchmarks[] = {
+    {.name = "list", .fn = listBenchmark},
+    {.name = "hash", .fn = hashBenchmark},
+    {.name = "synth", .fn = swSynthBenchmark},
+    {.name = "dft", .fn = dft32Benchmark},
+    {.name = "pitch", .fn = pitchDetectBenchmark},
+    {.name = "drums", .fn = drumsBenchmark},
 };
+#endif
 
 const consoleCommand_t* getConsoleCommands(void)
 {
@@ -153,7 +221,34 @@ static int screenRecordCommandCb(const char** args, int argCount, char* out)
 
 static int replayCommandCb(const char** args, int argCount, char* out)
 {
-    if (argCount > 0)
+    if (argCount > 0 && !strcmp(args[0], "seek"))
+    {
+        if (argCount < 2)
+        {
+            return sprintf(out, "Seek time is required!\n");
+        }
+
+        if (seekPlayback((int64_t)(atof(args[1]) * 1000000)))
+        {
+            return sprintf(out, "Seeking to %ss\n", args[1]);
+        }
+        return sprintf(out, "Can't seek, see the log for why\n");
+    }
+    else if (argCount > 0 && !strcmp(args[0], "convert"))
+    {
+        if (argCount < 3)
+        {
+            return sprintf(out, "Input and output filenames are required!\n");
+        }
+
+        int64_t start = (argCount > 3) ? (int64_t)(atof(args[3]) * 1000000) : 0;
+        if (convertReplay(args[1], args[2], start))
+        {
+            return sprintf(out, "Converted %s to %s\n", args[1], args[2]);
+        }
+        return sprintf(out, "Couldn't convert %s\n", args[1]);
+    }
+    else if (argCount > 0)
     {
         startPlayback(args[0]);
         return sprintf(out, "Playback started\n");
@@ -622,6 +717,37 @@ static int injectCommandCb(const char** args, int argCount, char* out)
     }
 }
 
+static int cnfsCommandCb(const char** args, int argCount, char* out)
+{
+    int32_t size;
+    int loads;
+    const char* image = emuCnfsGetImage(&size, &loads);
+
+    if (argCount > 0 && !strncmp("reload", args[0], strlen(args[0])))
+    {
+        if (NULL == image)
+        {
+            return snprintf(out, 1024, "No CNFS image to reload, start the emulator with --cnfs-image\n");
+        }
+        else if (emuCnfsLoadImage(image))
+        {
+            emuCnfsGetImage(&size, &loads);
+            return snprintf(out, 1024, "Reloaded %s, %" PRId32 " bytes\n", image, size);
+        }
+        else
+        {
+            return snprintf(out, 1024, "Could not reload %s, still using the previous image\n", image);
+        }
+    }
+
+    if (NULL == image)
+    {
+        return snprintf(out, 1024, "Assets are built in, %" PRId32 " bytes\n", size);
+    }
+    return snprintf(out, 1024, "Assets are from %s, %" PRId32 " bytes, loaded %d time%s\n", image, size, loads,
+                    (1 == loads) ? "" : "s");
+}
+
 static char joyDevName[128];
 static int joystickCommandCb(const char** args, int argCount, char* out)
 {
@@ -930,3 +1056,454 @@ static int helpCommandCb(const char** args, int argCount, char* out)
 
     return (cur - out);
 }
+
+static int audioCommandCb(const char** args, int argCount, char* out)
+{
+    if (argCount > 0)
+    {
+        if (!strncmp("reset", args[0], strlen(args[0])))
+        {
+            dacResetStats();
+            return snprintf(out, 1024, "DAC statistics reset\n");
+        }
+        else if (!strncmp("latency", args[0], strlen(args[0])))
+        {
+            if (argCount > 1)
+            {
+                dacSetLatency(strtol(args[1], NULL, 0));
+            }
+            return snprintf(out, 1024, "Rendering %" PRIu8 " buffers ahead (%dms)\n", dacGetLatency(),
+                            dacGetLatency() * DAC_BUF_SIZE * 1000 / DAC_SAMPLE_RATE_HZ);
+        }
+        else if (!strncmp("stall", args[0], strlen(args[0])))
+        {
+            if (argCount < 2)
+            {
+                return snprintf(out, 1024, "Stall duration is required\n");
+            }
+
+            // Block the main loop like a very slow frame would. Audio is rendered on its own thread, so it should
+            // keep playing
+            int stallMs = strtol(args[1], NULL, 0);
+            dacStats_t before, after;
+            dacGetStats(&before);
+            OGUSleep(stallMs * 1000);
+            dacGetStats(&after);
+
+            return snprintf(out, 1024, "Stalled %dms: %" PRIu32 " underruns, %" PRIu32 " late refills, %" PRIu32
+                            " blocks rendered\n",
+                            stallMs, after.underruns - before.underruns, after.lateRefills - before.lateRefills,
+                            after.blocks - before.blocks);
+        }
+        return snprintf(out, 1024, "Unrecognized command 'audio %s'\n", args[0]);
+    }
+
+    dacStats_t stats;
+    dacGetStats(&stats);
+
+    int written = snprintf(out, 1024,
+                           "DAC: %" PRIu32 " blocks, %" PRIu32 " underruns, %" PRIu32 " late refills\n"
+                           "DSP load: %" PRIu16 "%%, peak %" PRIu16 "%%, last render %" PRIu32 "us, max %" PRIu32
+                           "us\n",
+                           stats.blocks, stats.underruns, stats.lateRefills, stats.load / (DAC_LOAD_FULL / 100),
+                           stats.peakLoad / (DAC_LOAD_FULL / 100), stats.renderUs, stats.maxRenderUs);
+
+    const char* playerNames[NUM_GLOBAL_PLAYERS] = {[MIDI_SFX] = "SFX", [MIDI_BGM] = "BGM"};
+    for (uint8_t i = 0; i < NUM_GLOBAL_PLAYERS; i++)
+    {
+        midiPlayer_t* player = globalMidiPlayerGet(i);
+        if (NULL != player)
+        {
+            written += snprintf(out + written, 1024 - written,
+                                "MIDI %s: load %" PRIu16 "%%, peak %" PRIu16 "%%, %" PRIu8 "/%" PRIu8 " voices%s\n",
+                                playerNames[i], player->dspLoad / (DAC_LOAD_FULL / 100),
+                                player->peakDspLoad / (DAC_LOAD_FULL / 100), player->voiceBudget, player->voiceLimit,
+                                player->adaptiveVoices ? " (adaptive)" : "");
+        }
+    }
+
+    return written;
+}
+
+/**
+ * @brief Read a little-endian integer from a buffer
+ *
+ * @param data The buffer to read from
+ * @param len The number of bytes in the integer
+ * @return The integer
+ */
+static uint32_t readLittleEndian(const uint8_t* data, int len)
+{
+    uint32_t val = 0;
+    for (int i = len - 1; i >= 0; i--)
+    {
+        val = (val << 8) | data[i];
+    }
+    return val;
+}
+
+static int pitchCommandCb(const char** args, int argCount, char* out)
+{
+    if (argCount < 1)
+    {
+        return snprintf(out, 1024, "Filename is required\n");
+    }
+
+    char filenameBuf[1024];
+    expandPath(filenameBuf, sizeof(filenameBuf), args[0]);
+
+    FILE* file = fopen(filenameBuf, "rb");
+    if (NULL == file)
+    {
+        return snprintf(out, 1024, "ERR: Could not open %s\n", filenameBuf);
+    }
+
+    // Find the format and the start of the samples
+    uint8_t hdr[16];
+    uint16_t channels = 0;
+    uint32_t rate     = 0;
+    uint32_t dataLen  = 0;
+    if (12 != fread(hdr, 1, 12, file) || memcmp(hdr, "RIFF", 4) || memcmp(&hdr[8], "WAVE", 4))
+    {
+        fclose(file);
+        return snprintf(out, 1024, "ERR: %s is not a WAV file\n", filenameBuf);
+    }
+    while (8 == fread(hdr, 1, 8, file))
+    {
+        uint32_t chunkLen = readLittleEndian(&hdr[4], 4);
+        if (!memcmp(hdr, "fmt ", 4) && chunkLen >= 16 && 16 == fread(hdr, 1, 16, file))
+        {
+            // Only 16 bit PCM is supported
+            if (1 != readLittleEndian(&hdr[0], 2) || 16 != readLittleEndian(&hdr[14], 2))
+            {
+                fclose(file);
+                return snprintf(out, 1024, "ERR: %s is not 16-bit PCM\n", filenameBuf);
+            }
+            channels = readLittleEndian(&hdr[2], 2);
+            rate     = readLittleEndian(&hdr[4], 4);
+            chunkLen -= 16;
+        }
+        else if (!memcmp(hdr, "data", 4))
+        {
+            dataLen = chunkLen;
+            break;
+        }
+        // Chunks are padded to an even length
+        fseek(file, chunkLen + (chunkLen & 1), SEEK_CUR);
+    }
+    if (0 == channels || 0 == rate || 0 == dataLen)
+    {
+        fclose(file);
+        return snprintf(out, 1024, "ERR: %s has no samples\n", filenameBuf);
+    }
+
+    pitchDetect_t* pd = heap_caps_calloc(1, sizeof(pitchDetect_t), MALLOC_CAP_8BIT);
+    if (NULL == pd)
+    {
+        fclose(file);
+        return snprintf(out, 1024, "ERR: Could not allocate a pitch detector\n");
+    }
+    pitchDetectInit(pd, 70, 1000);
+
+    // Statistics for each MIDI note detected
+    uint32_t noteCounts[128] = {0};
+    double noteCents[128]    = {0};
+    double noteCentsSq[128]  = {0};
+    uint32_t voiced          = 0;
+    int64_t tTotal           = 0;
+
+    // Resample to the microphone's rate by picking the nearest sample, which is fine for measuring the pitch
+    int16_t block[128];
+    int blockLen      = 0;
+    uint64_t srcPos   = 0;
+    uint64_t srcStep  = ((uint64_t)rate << 16) / D_FREQ;
+    uint32_t frames   = dataLen / (2 * channels);
+    uint32_t frameIdx = 0;
+    uint8_t frame[2 * 16];
+    while (frameIdx < frames && channels <= 16)
+    {
+        if (2 * channels != fread(frame, 1, 2 * channels, file))
+        {
+            break;
+        }
+
+        // Mix all the channels together
+        int32_t mixed = 0;
+        for (uint16_t ch = 0; ch < channels; ch++)
+        {
+            mixed += (int16_t)readLittleEndian(&frame[2 * ch], 2);
+        }
+        mixed /= channels;
+
+        // Take this frame as many times as the output rate needs it
+        while ((srcPos >> 16) == frameIdx)
+        {
+            block[blockLen++] = mixed;
+            srcPos += srcStep;
+            if (ARRAY_SIZE(block) == blockLen)
+            {
+                int64_t tStart = esp_timer_get_time();
+                bool updated   = pitchDetectPush(pd, block, blockLen);
+                tTotal += esp_timer_get_time() - tStart;
+                blockLen = 0;
+
+                if (updated && pd->result.voiced)
+                {
+                    int32_t note = (pd->result.cents + 50) / 100;
+                    if (note >= 0 && note < 128)
+                    {
+                        double cents = pd->result.cents - note * 100;
+                        noteCounts[note]++;
+                        noteCents[note] += cents;
+                        noteCentsSq[note] += cents * cents;
+                    }
+                    voiced++;
+                }
+            }
+        }
+        frameIdx++;
+    }
+    fclose(file);
+
+    uint32_t analyses = pd->result.analyses;
+    heap_caps_free(pd);
+
+    int written = snprintf(out, 1024, "%" PRIu32 " analyses, %" PRIu32 " voiced, %" PRId64 "us each\n", analyses,
+                           voiced, analyses ? tTotal / analyses : 0);
+
+    int best = 0;
+    for (int note = 1; note < 128; note++)
+    {
+        if (noteCounts[note] > noteCounts[best])
+        {
+            best = note;
+        }
+    }
+    if (noteCounts[best])
+    {
+        static const char* const noteNames[] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+        double mean   = noteCents[best] / noteCounts[best];
+        double stdDev = sqrt(MAX(0, noteCentsSq[best] / noteCounts[best] - mean * mean));
+        written += snprintf(out + written, 1024 - written,
+                            "Most common note: %s%d in %" PRIu32 " analyses, %+.1f cents, std dev %.1f cents\n",
+                            noteNames[best % 12], best / 12 - 1, noteCounts[best], mean, stdDev);
+    }
+    return written;
+}
+
+/// @brief Shared state for the MIDI command queue stress test
+typedef struct
+{
+    midiPlayer_t* player;    ///< The player being stressed
+    int64_t durationUs;      ///< How long the producer should run for
+    bool producerDone;       ///< Set by the producer when it has stopped queueing commands
+    uint32_t queued;         ///< The number of commands accepted by the queue
+    uint32_t rejected;       ///< The number of commands rejected because the queue was full
+    uint32_t blocksRendered; ///< The number of audio blocks rendered by the consumer
+} midiStress_t;
+
+/**
+ * @brief Queue note, pitch wheel, and control change commands as fast as possible, like a mode's main loop would
+ *
+ * @param arg The ::midiStress_t
+ * @return NULL
+ */
+static void* midiStressProducer(void* arg)
+{
+    midiStress_t* stress = arg;
+    int64_t end          = esp_timer_get_time() + stress->durationUs;
+    uint32_t i           = 0;
+
+    while (esp_timer_get_time() < end)
+    {
+        uint8_t channel = i % 9;
+        uint8_t note    = 36 + (i * 7) % 48;
+        bool ok;
+
+        switch (i % 4)
+        {
+            case 0:
+            {
+                ok = midiQueueNoteOn(stress->player, channel, note, 0x7F);
+                break;
+            }
+            case 1:
+            {
+                ok = midiQueuePitchWheel(stress->player, channel, (i * 331) & 0x3FFF);
+                break;
+            }
+            case 2:
+            {
+                ok = midiQueueControlChange(stress->player, channel, MCC_SUSTENUTO_PEDAL, (i & 1) ? 0x7F : 0);
+                break;
+            }
+            case 3:
+            default:
+            {
+                ok = midiQueueNoteOff(stress->player, channel, 36 + ((i - 3) * 7) % 48, 0x40);
+                break;
+            }
+        }
+
+        if (ok)
+        {
+            stress->queued++;
+        }
+        else
+        {
+            stress->rejected++;
+        }
+        i++;
+    }
+
+    __atomic_store_n(&stress->producerDone, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * @brief Render audio blocks, applying queued commands at each block boundary, like the audio callback would
+ *
+ * @param arg The ::midiStress_t
+ * @return NULL
+ */
+static void* midiStressConsumer(void* arg)
+{
+    midiStress_t* stress = arg;
+    uint8_t samples[512];
+
+    while (!__atomic_load_n(&stress->producerDone, __ATOMIC_ACQUIRE)
+           || __atomic_load_n(&stress->player->cmdTail, __ATOMIC_ACQUIRE)
+                  != __atomic_load_n(&stress->player->cmdHead, __ATOMIC_ACQUIRE))
+    {
+        midiPlayerFillBuffer(stress->player, samples, sizeof(samples));
+        stress->blocksRendered++;
+    }
+    return NULL;
+}
+
+static int midiStressCommandCb(const char** args, int argCount, char* out)
+{
+    int64_t durationMs = 2000;
+    if (argCount > 0)
+    {
+        errno      = 0;
+        durationMs = strtol(args[0], NULL, 0);
+        if (errno || durationMs <= 0)
+        {
+            return snprintf(out, 1024, "ERR: Invalid duration '%s'\n", args[0]);
+        }
+    }
+
+    // Use a private player so the mode's own audio isn't disturbed
+    midiStress_t stress = {
+        .durationUs = durationMs * 1000,
+    };
+    stress.player = heap_caps_calloc(1, sizeof(midiPlayer_t), MALLOC_CAP_SPIRAM);
+    if (NULL == stress.player)
+    {
+        return snprintf(out, 1024, "ERR: Could not allocate a MIDI player\n");
+    }
+    midiPlayerInit(stress.player);
+    midiGmOn(stress.player);
+    midiPause(stress.player, false);
+
+    pthread_t producer, consumer;
+    if (pthread_create(&consumer, NULL, midiStressConsumer, &stress))
+    {
+        heap_caps_free(stress.player);
+        return snprintf(out, 1024, "ERR: Could not start the render thread\n");
+    }
+    if (pthread_create(&producer, NULL, midiStressProducer, &stress))
+    {
+        // Let the consumer exit on its own
+        __atomic_store_n(&stress.producerDone, true, __ATOMIC_RELEASE);
+        pthread_join(consumer, NULL);
+        heap_caps_free(stress.player);
+        return snprintf(out, 1024, "ERR: Could not start the producer thread\n");
+    }
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    int written = snprintf(out, 1024,
+                           "Queued %" PRIu32 " commands, %" PRIu32 " rejected while full, %" PRIu32
+                           " blocks rendered in %" PRId64 "ms\n",
+                           stress.queued, stress.rejected, stress.blocksRendered, durationMs);
+    heap_caps_free(stress.player);
+    return written;
+}
+
+static int midiJitterCommandCb(const char** args, int argCount, char* out)
+{
+    long count    = 40;
+    long periodMs = 50;
+    if (argCount > 0)
+    {
+        errno = 0;
+        count = strtol(args[0], NULL, 0);
+        if (errno || count <= 0)
+        {
+            return snprintf(out, 1024, "ERR: Invalid count '%s'\n", args[0]);
+        }
+    }
+    if (argCount > 1)
+    {
+        errno    = 0;
+        periodMs = strtol(args[1], NULL, 0);
+        if (errno || periodMs <= 0)
+        {
+            return snprintf(out, 1024, "ERR: Invalid period '%s'\n", args[1]);
+        }
+    }
+
+    // Without any latency, every event is played at the start of the block after it arrives, which is how streamed
+    // events used to be handled
+    static const uint32_t latencies[] = {MIDI_DEF_STREAM_LATENCY, 0};
+    int written                       = 0;
+    for (uint8_t i = 0; i < ARRAY_SIZE(latencies); i++)
+    {
+        midiTimingResult_t result;
+        if (!midiMeasureTiming(count, periodMs, latencies[i], &result))
+        {
+            return written + snprintf(out + written, 1024 - written, "ERR: Could not allocate memory\n");
+        }
+        written += snprintf(out + written, 1024 - written,
+                            "Latency %" PRIu32 " samples: %" PRIu32 "/%" PRIu32 " notes heard, %" PRIu32
+                            " late, latency %.2fms, jitter %.2fms, spread %.2fms\n",
+                            latencies[i], result.detected, result.events, result.lateEvents,
+                            result.meanLatencyUs / 1000.0, result.jitterUs / 1000.0,
+                            (result.maxLatencyUs - result.minLatencyUs) / 1000.0);
+    }
+    return written;
+}
+
+static int benchCommandCb(const char** args, int argCount, char* out)
+{
+#ifdef ENABLE_BENCHMARKS
+    if (argCount < 1)
+    {
+        char* cur = out;
+        cur += snprintf(cur, 1024 - (cur - out), "Benchmarks:");
+        for (int i = 0; i < ARRAY_SIZE(benchmarks); i++)
+        {
+            cur += snprintf(cur, 1024 - (cur - out), " %s", benchmarks[i].name);
+        }
+        cur += snprintf(cur, 1024 - (cur - out), "\n");
+        return cur - out;
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(benchmarks); i++)
+    {
+        if (!strcasecmp(args[0], benchmarks[i].name))
+        {
+            // The benchmarks print their own results, and block the main loop while they run
+            printf("Running the %s benchmark...\n", benchmarks[i].name);
+            benchmarks[i].fn();
+            return snprintf(out, 1024, "Ran the %s benchmark, see stdout for the results\n", benchmarks[i].name);
+        }
+    }
+    return snprintf(out, 1024, "ERR: No benchmark named '%s'\n", args[0]);
+#else
+    return snprintf(out, 1024,
+                    "ERR: Benchmarks were not built. Rebuild with 'make clean && make ENABLE_BENCHMARKS=true'\n");
+#endif
+}
@@ -81,6 +81,8 @@ static char recordingFilename[256] = {0};
 
 static bool pauseNextFrame = false;
 
+static int64_t quitAfterTime = 0;
+
 static bool showFps  = false;
 static int fpsPaneId = -1;
 static int64_t frameStartTime;
@@ -119,6 +121,11 @@ static bool toolsInit(emuArgs_t* emuArgs)
         printf("Using fake frame rate of %.1fFPS -- %" PRIu64 "us per frame\n", emuArgs->fakeFps, fakeFrameTime);
     }
 
+    if (emuArgs->quitAfter > 0.0)
+    {
+        quitAfterTime = (int64_t)(emuArgs->quitAfter * 1000000.0);
+    }
+
     if (emuArgs->showFps)
     {
         fpsPaneId      = requestPane(&toolsEmuExtension, PANE_BOTTOM, 30, 30);
@@ -333,6 +340,13 @@ static void toolsPreFrame(uint64_t frame)
         fakeTime += fakeFrameTime;
     }
 
+    // Quit through the main loop, so recordings are closed and coverage is written as usual
+    if (quitAfterTime && esp_timer_get_time() >= quitAfterTime)
+    {
+        emulatorQuit();
+        quitAfterTime = 0;
+    }
+
     if (pauseNextFrame)
     {
         emuTimerPause();
@@ -7,6 +7,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include "esp_heap_caps.h"
+#include "esp_heap_caps_emu.h"
 
 //==============================================================================
 // Defines
@@ -20,6 +21,12 @@
 
 #define A_TABLE_SIZE 16384
 
+/// The maximum number of distinct allocation tags tracked per profiling scope
+#define MAX_PROFILE_TAGS 512
+
+/// The number of slots in each profiling scope's tag hash table, a power of two larger than ::MAX_PROFILE_TAGS
+#define PROFILE_TAG_HASH_SIZE 1024
+
 //==============================================================================
 // Enums
 //==============================================================================
@@ -52,8 +59,38 @@ typedef struct
     const char* func;
     uint32_t line;
     char tag[32];
+    uint32_t scopeId; ///< The ID of the profiling scope this was allocated in
+    int16_t tagIdx;   ///< The index of this allocation's tag in the scope's tag table, or -1
 } allocation_t;
 
+/// @brief Memory statistics for a single allocation tag within a profiling scope
+typedef struct
+{
+    char tag[32];                 ///< The allocation tag, or function:line if untagged
+    size_t live[MAX_MEM_TYPES];   ///< The bytes currently allocated with this tag
+    size_t peak[MAX_MEM_TYPES];   ///< The most bytes ever allocated at once with this tag
+    uint32_t numAllocs;           ///< The number of allocations made with this tag
+    uint32_t numReallocs;         ///< The number of times an allocation with this tag was resized
+} tagStats_t;
+
+/// @brief Memory statistics for a profiling scope, usually a single Swadge mode's lifetime
+typedef struct
+{
+    uint32_t id;                            ///< A unique ID for this scope
+    char name[64];                          ///< The name of this scope, usually the Swadge mode name
+    size_t live[MAX_MEM_TYPES];             ///< The bytes currently allocated in this scope
+    size_t peak[MAX_MEM_TYPES];             ///< The most bytes ever allocated at once in this scope
+    uint32_t numAllocs;                     ///< The number of allocations made in this scope
+    uint32_t numReallocs;                   ///< The number of times an allocation was resized in this scope
+    uint32_t numFrees;                      ///< The number of allocations from this scope which were freed
+    uint32_t numFrames;                     ///< The number of frames which ran in this scope
+    uint32_t allocsThisFrame;               ///< The number of allocations made during the current frame
+    uint32_t maxAllocsPerFrame;             ///< The most allocations made during a single frame
+    tagStats_t tags[MAX_PROFILE_TAGS];      ///< Per-tag statistics
+    uint16_t numTags;                       ///< The number of tags in use
+    int16_t tagHash[PROFILE_TAG_HASH_SIZE]; ///< Indices into tags plus one, by tag hash, or 0 for an empty slot
+} memScope_t;
+
 //==============================================================================
 // Variables
 //==============================================================================
@@ -61,6 +98,16 @@ typedef struct
 allocation_t aTable[A_TABLE_SIZE] = {0};
 size_t usedMemory[MAX_MEM_TYPES]  = {0};
 
+/// The current profiling scope and the one before it, indexed by scope ID parity
+static memScope_t memScopes[2] = {
+    {.id = 0, .name = "boot"},
+    {.id = UINT32_MAX},
+};
+/// The ID of the current profiling scope
+static uint32_t curScopeId = 0;
+/// Whether allocations are profiled, which is only done with --mem-profile since it slows every allocation down
+static bool profileEnabled = false;
+
 //==============================================================================
 // Function declarations
 //==============================================================================
@@ -68,6 +115,11 @@ size_t usedMemory[MAX_MEM_TYPES]  = {0};
 static void printMemoryOperation(memOp_t op, allocation_t* al);
 static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32_t size, uint32_t caps,
                            const char* file, const char* func, uint32_t line, const char* tag);
+static memScope_t* getScope(uint32_t scopeId);
+static int16_t findTag(memScope_t* scope, const char* tag);
+static void profileAlloc(allocation_t* al, bool resized);
+static void profileFree(allocation_t* al, bool countFree);
+static void printJsonString(FILE* out, const char* str);
 
 //==============================================================================
 // Functions
@@ -202,6 +254,9 @@ static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32
             al->line = line;
             // Don't overwrite tag
 
+            // Remove it from the profile
+            profileFree(al, true);
+
             // Decrement space
             if (al->size > *usedMem)
             {
@@ -233,9 +288,17 @@ static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32
 
             // Save the old size for reallocs
             uint32_t oldSize = 0;
+            bool resized     = false;
             if (OP_REALLOC == op)
             {
                 oldSize = al->size;
+
+                // Remove the old size from the profile, the new size will be added below
+                if (NULL != al->ptr)
+                {
+                    profileFree(al, false);
+                    resized = true;
+                }
             }
 
             // Save entry
@@ -249,6 +312,10 @@ static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32
             {
                 snprintf(al->tag, sizeof(al->tag) - 1, "%s", tag);
             }
+            else if (OP_REALLOC == op && oldSize)
+            {
+                // Keep the tag from the original allocation
+            }
             else
             {
                 snprintf(al->tag, sizeof(al->tag) - 1, "%s:%u", al->func, al->line);
@@ -258,6 +325,9 @@ static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32
             *usedMem -= oldSize;
             *usedMem += al->size;
 
+            // Add it to the profile
+            profileAlloc(al, resized);
+
             // Print it
             printMemoryOperation(op, al);
         }
@@ -281,6 +351,326 @@ static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32
     }
 }
 
+/**
+ * @brief Get a profiling scope by ID, if it's still tracked
+ *
+ * @param scopeId The ID of the scope to get
+ * @return The scope, or NULL if it is too old to be tracked
+ */
+static memScope_t* getScope(uint32_t scopeId)
+{
+    memScope_t* scope = &memScopes[scopeId % 2];
+    return (scope->id == scopeId) ? scope : NULL;
+}
+
+/**
+ * @brief Find a tag in a profiling scope's tag table, or add it if there's space
+ *
+ * @param scope The scope to find the tag in
+ * @param tag The tag to find
+ * @return int16_t The index of the tag in the scope's tag table, or -1 if the table is full
+ */
+static int16_t findTag(memScope_t* scope, const char* tag)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char* c = tag; *c; c++)
+    {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+
+    // Probe linearly. The table is never more than half full, so there's always an empty slot
+    for (uint32_t slot = hash % PROFILE_TAG_HASH_SIZE;; slot = (slot + 1) % PROFILE_TAG_HASH_SIZE)
+    {
+        int16_t tIdx = scope->tagHash[slot] - 1;
+        if (0 > tIdx)
+        {
+            if (scope->numTags >= MAX_PROFILE_TAGS)
+            {
+                return -1;
+            }
+            tIdx = scope->numTags++;
+            memcpy(scope->tags[tIdx].tag, tag, sizeof(scope->tags[tIdx].tag));
+            scope->tagHash[slot] = tIdx + 1;
+            return tIdx;
+        }
+        else if (0 == strcmp(scope->tags[tIdx].tag, tag))
+        {
+            return tIdx;
+        }
+    }
+}
+
+/**
+ * @brief Add an allocation to the current profiling scope
+ *
+ * @param al The allocation which was just made
+ * @param resized true if this is an existing allocation which was reallocated, false if it's a new allocation
+ */
+static void profileAlloc(allocation_t* al, bool resized)
+{
+    al->scopeId = curScopeId;
+    al->tagIdx  = -1;
+
+    if (!profileEnabled)
+    {
+        return;
+    }
+
+    memScope_t* scope = getScope(curScopeId);
+    memType_t type    = (MALLOC_CAP_SPIRAM & al->caps) ? MEM_SPIRAM : MEM_INTERNAL;
+
+    // Track per-tag stats
+    int16_t tIdx = findTag(scope, al->tag);
+    if (0 <= tIdx)
+    {
+        tagStats_t* ts = &scope->tags[tIdx];
+        al->tagIdx     = tIdx;
+        if (resized)
+        {
+            ts->numReallocs++;
+        }
+        else
+        {
+            ts->numAllocs++;
+        }
+        ts->live[type] += al->size;
+        if (ts->live[type] > ts->peak[type])
+        {
+            ts->peak[type] = ts->live[type];
+        }
+    }
+
+    // Track per-scope stats
+    if (resized)
+    {
+        scope->numReallocs++;
+    }
+    else
+    {
+        scope->numAllocs++;
+        scope->allocsThisFrame++;
+    }
+    scope->live[type] += al->size;
+    if (scope->live[type] > scope->peak[type])
+    {
+        scope->peak[type] = scope->live[type];
+    }
+}
+
+/**
+ * @brief Remove an allocation from the profiling scope it was allocated in
+ *
+ * @param al The allocation which is being freed or reallocated
+ * @param countFree true to count this as a free, false if this is part of a realloc
+ */
+static void profileFree(allocation_t* al, bool countFree)
+{
+    memScope_t* scope = getScope(al->scopeId);
+    if (!profileEnabled || NULL == scope)
+    {
+        // Too old to be tracked
+        return;
+    }
+
+    memType_t type = (MALLOC_CAP_SPIRAM & al->caps) ? MEM_SPIRAM : MEM_INTERNAL;
+
+    if (0 <= al->tagIdx)
+    {
+        tagStats_t* ts = &scope->tags[al->tagIdx];
+        ts->live[type] = (ts->live[type] > al->size) ? (ts->live[type] - al->size) : 0;
+    }
+    scope->live[type] = (scope->live[type] > al->size) ? (scope->live[type] - al->size) : 0;
+
+    if (countFree)
+    {
+        scope->numFrees++;
+    }
+}
+
+/**
+ * @brief Enable or disable heap profiling. Allocations are only attributed to profiling scopes while it's enabled
+ *
+ * @param enabled true to profile allocations, false to only track them for leak and overflow checks
+ */
+void heapProfileSetEnabled(bool enabled)
+{
+    profileEnabled = enabled;
+}
+
+/**
+ * @brief Start a new profiling scope. Allocations made after this are attributed to the new scope. The prior scope's
+ * statistics are kept so they may be reported with heapProfileReport() after the prior mode is done freeing memory.
+ *
+ * @param name The name of the new scope, or NULL to set it later with heapProfileNameScope()
+ */
+void heapProfileStartScope(const char* name)
+{
+    curScopeId++;
+    memScope_t* scope = &memScopes[curScopeId % 2];
+    memset(scope, 0, sizeof(memScope_t));
+    scope->id = curScopeId;
+    heapProfileNameScope(name);
+}
+
+/**
+ * @brief Set the name of the current profiling scope
+ *
+ * @param name The name of the current scope, usually the Swadge mode's name. May be NULL
+ */
+void heapProfileNameScope(const char* name)
+{
+    snprintf(memScopes[curScopeId % 2].name, sizeof(memScopes[0].name), "%s", name ? name : "");
+}
+
+/**
+ * @brief Mark the end of a frame. This is used to track the allocation rate per frame for the current scope
+ */
+void heapProfileFrame(void)
+{
+    memScope_t* scope = getScope(curScopeId);
+    if (scope->allocsThisFrame > scope->maxAllocsPerFrame)
+    {
+        scope->maxAllocsPerFrame = scope->allocsThisFrame;
+    }
+    scope->allocsThisFrame = 0;
+    scope->numFrames++;
+}
+
+/**
+ * @brief Write a string to a file as a JSON string, with quotes and escapes
+ *
+ * @param out The file to write to
+ * @param str The string to write
+ */
+static void printJsonString(FILE* out, const char* str)
+{
+    fputc('"', out);
+    for (; str && *str; str++)
+    {
+        if ('"' == *str || '\\' == *str)
+        {
+            fputc('\\', out);
+            fputc(*str, out);
+        }
+        else if ((unsigned char)*str < ' ')
+        {
+            fprintf(out, "\\u%04x", *str);
+        }
+        else
+        {
+            fputc(*str, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/**
+ * @brief Report the memory statistics for a profiling scope. Allocations from the scope which are still alive are
+ * reported as well. If the scope's mode has already exited, these are leaks.
+ *
+ * @param prior true to report the prior scope, false to report the current scope
+ * @param out The file to write the report to
+ * @param json true to write the report as a JSON object, false to write it as a human readable table
+ */
+void heapProfileReport(bool prior, FILE* out, bool json)
+{
+    memScope_t* scope = getScope(prior ? curScopeId - 1 : curScopeId);
+    if (NULL == scope)
+    {
+        return;
+    }
+
+    // Count allocations which are still alive
+    uint32_t numAlive = 0;
+    size_t aliveBytes = 0;
+    for (int idx = 0; idx < A_TABLE_SIZE; idx++)
+    {
+        if (aTable[idx].ptr && aTable[idx].scopeId == scope->id)
+        {
+            numAlive++;
+            aliveBytes += aTable[idx].size;
+        }
+    }
+
+    if (json)
+    {
+        fprintf(out, "{\"mode\":");
+        printJsonString(out, scope->name);
+        fprintf(out,
+                ",\"frames\":%" PRIu32 ",\"allocs\":%" PRIu32 ",\"reallocs\":%" PRIu32 ",\"frees\":%" PRIu32
+                ",\"maxAllocsPerFrame\":%" PRIu32
+                ",\"internal\":{\"live\":%zu,\"peak\":%zu},\"spiram\":{\"live\":%zu,\"peak\":%zu},\"tags\":[",
+                scope->numFrames, scope->numAllocs, scope->numReallocs, scope->numFrees, scope->maxAllocsPerFrame,
+                scope->live[MEM_INTERNAL], scope->peak[MEM_INTERNAL], scope->live[MEM_SPIRAM], scope->peak[MEM_SPIRAM]);
+        for (uint16_t tIdx = 0; tIdx < scope->numTags; tIdx++)
+        {
+            const tagStats_t* ts = &scope->tags[tIdx];
+            fprintf(out, "%s{\"tag\":", tIdx ? "," : "");
+            printJsonString(out, ts->tag);
+            fprintf(out,
+                    ",\"allocs\":%" PRIu32 ",\"reallocs\":%" PRIu32
+                    ",\"internal\":{\"live\":%zu,\"peak\":%zu},\"spiram\":{\"live\":%zu,\"peak\":%zu}}",
+                    ts->numAllocs, ts->numReallocs, ts->live[MEM_INTERNAL], ts->peak[MEM_INTERNAL],
+                    ts->live[MEM_SPIRAM], ts->peak[MEM_SPIRAM]);
+        }
+        fprintf(out, "],\"alive\":[");
+        bool first = true;
+        for (int idx = 0; idx < A_TABLE_SIZE; idx++)
+        {
+            const allocation_t* al = &aTable[idx];
+            if (al->ptr && al->scopeId == scope->id)
+            {
+                fprintf(out, "%s{\"file\":", first ? "" : ",");
+                printJsonString(out, al->file);
+                fprintf(out, ",\"func\":");
+                printJsonString(out, al->func);
+                fprintf(out, ",\"line\":%" PRIu32 ",\"tag\":", al->line);
+                printJsonString(out, al->tag);
+                fprintf(out, ",\"size\":%zu,\"spiram\":%s}", al->size,
+                        (MALLOC_CAP_SPIRAM & al->caps) ? "true" : "false");
+                first = false;
+            }
+        }
+        fprintf(out, "]}");
+    }
+    else
+    {
+        fprintf(out,
+                "[heap] \"%s\": %" PRIu32 " allocs, %" PRIu32 " reallocs, %" PRIu32 " frees in %" PRIu32
+                " frames, %.2f allocs/frame, %" PRIu32 " max\n",
+                scope->name, scope->numAllocs, scope->numReallocs, scope->numFrees, scope->numFrames,
+                scope->numFrames ? (float)scope->numAllocs / (float)scope->numFrames : 0.0f, scope->maxAllocsPerFrame);
+        fprintf(out, "[heap] %10s %10s %10s %10s %7s %8s  %s\n", "INT live", "INT peak", "SPI live", "SPI peak",
+                "Allocs", "Reallocs", "Tag");
+        fprintf(out, "[heap] %10zu %10zu %10zu %10zu %7" PRIu32 " %8" PRIu32 "  %s\n", scope->live[MEM_INTERNAL],
+                scope->peak[MEM_INTERNAL], scope->live[MEM_SPIRAM], scope->peak[MEM_SPIRAM], scope->numAllocs,
+                scope->numReallocs, "(total)");
+        for (uint16_t tIdx = 0; tIdx < scope->numTags; tIdx++)
+        {
+            const tagStats_t* ts = &scope->tags[tIdx];
+            fprintf(out, "[heap] %10zu %10zu %10zu %10zu %7" PRIu32 " %8" PRIu32 "  %s\n", ts->live[MEM_INTERNAL],
+                    ts->peak[MEM_INTERNAL], ts->live[MEM_SPIRAM], ts->peak[MEM_SPIRAM], ts->numAllocs,
+                    ts->numReallocs, ts->tag);
+        }
+
+        if (numAlive)
+        {
+            fprintf(out, "[heap] %s%" PRIu32 " allocations (%zu bytes) still alive:\n", prior ? "!! Leaked " : "",
+                    numAlive, aliveBytes);
+            for (int idx = 0; idx < A_TABLE_SIZE; idx++)
+            {
+                const allocation_t* al = &aTable[idx];
+                if (al->ptr && al->scopeId == scope->id)
+                {
+                    fprintf(out, "[heap]   %8zu %s %s:%" PRIu32 " (%s) %s\n", al->size,
+                            (MALLOC_CAP_SPIRAM & al->caps) ? "SPI" : "INT", al->file, al->line, al->func, al->tag);
+                }
+            }
+        }
+    }
+}
+
 /**
  * @brief Allocate a chunk of memory which has the given capabilities
  *
@@ -39,12 +39,13 @@ uint32_t esp_random(void)
 
 void emulatorSetEspRandomSeed(uint32_t seed_)
 {
-    seed = seed_;
-
-    if (seedValueSet)
+    // Setting the seed which is already in use, i.e. from a recording played back with the same --seed, must not
+    // restart the sequence, or the playback would diverge from the recording
+    if (seedValueSet && seed != seed_)
     {
-        srand(seed);
+        srand(seed_);
     }
+    seed = seed_;
 
     seedValueSet = true;
 }
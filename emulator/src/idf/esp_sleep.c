@@ -2,6 +2,7 @@
 #include "esp_sleep.h"
 #include "esp_sleep_emu.h"
 #include "swadge2024.h"
+#include "ext_memory.h"
 
 static uint64_t timeToLightSleep = 0;
 static bool modeLocked           = false;
@@ -37,7 +38,9 @@ void esp_deep_sleep_start(void)
 
         // On the emulator, this will switch the Swadge mode without rebooting
         // On an actual Swadge, this function will reboot the system and the new Swadge mode will be used after reboot
+        emuMemProfilePreModeSwitch();
         softSwitchToPendingSwadge();
+        emuMemProfilePostModeSwitch();
         return;
     }
 }
@@ -22,15 +22,27 @@
 #include "midi_device_emu.h"
 
 #include "tinyusb.h"
+#include "os_generic.h"
 #include <stdbool.h>
 #include <stdint.h>
 
 // Un-comment to enable printing all received MIDI packets
 // #define DEBUG_MIDI_PACKETS
 
+/// How often midiRxThread checks for data, in microseconds. USB full speed polls every millisecond
+#define MIDI_RX_POLL_US 1000
+
 static uint8_t runningStatus                   = 0;
 static struct platform_midi_driver* midiDriver = NULL;
 
+/// The thread which stands in for the USB task, calling tud_midi_rx_cb() when data arrives
+static og_thread_t midiRxThread = NULL;
+
+/// Cleared to make midiRxThread exit
+static volatile bool midiRxRunning = false;
+
+static void* midiRxThreadFn(void* arg);
+
 // Check if midi interface is mounted
 bool tud_midi_n_mounted(uint8_t itf)
 {
@@ -170,7 +182,7 @@ bool tud_midi_packet_write(uint8_t const packet[4])
 //--------------------------------------------------------------------+
 // Application Callback API (weak is optional)
 //--------------------------------------------------------------------+
-void tud_midi_rx_cb(uint8_t itf)
+__attribute__((weak)) void tud_midi_rx_cb(uint8_t itf)
 {
 }
 
@@ -190,14 +202,47 @@ void midid_init(void)
     {
         midiDriver = platform_midi_init(clientName ? "Swadge Emulator MIDI" : clientName);
     }
+
+    if (!midiRxRunning)
+    {
+        midiRxRunning = true;
+        midiRxThread  = OGCreateThread(midiRxThreadFn, NULL);
+    }
 }
 
 void midid_reset(uint8_t rhport)
 {
+    if (midiRxRunning)
+    {
+        midiRxRunning = false;
+        OGJoinThread(midiRxThread);
+        midiRxThread = NULL;
+    }
+
     platform_midi_deinit(midiDriver);
     midiDriver = NULL;
 }
 
+/**
+ * @brief Call tud_midi_rx_cb() whenever MIDI data is waiting, like TinyUSB's task does on the Swadge, so received
+ * events can be timestamped close to when they arrived
+ *
+ * @param arg Unused
+ * @return NULL
+ */
+static void* midiRxThreadFn(void* arg)
+{
+    while (midiRxRunning)
+    {
+        if (midiDriver && platform_midi_avail(midiDriver))
+        {
+            tud_midi_rx_cb(0);
+        }
+        OGUSleep(MIDI_RX_POLL_US);
+    }
+    return NULL;
+}
+
 uint16_t midid_open(uint8_t rhport, tusb_desc_interface_t const* itf_desc, uint16_t max_len)
 {
     return 0;
@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "hashMap.h"
+#define N 3000
+static int present[N]; static intptr_t vals[N];
+int main(int argc,char**argv){
+  unsigned seed = argc>1?atoi(argv[1]):1; srand(seed);
+  for (int round=0; round<200; round++){
+    hashMap_t m; hashInitBin(&m, 1+rand()%20, hashInt, intsEq);
+    memset(present,0,sizeof present);
+    int cnt=0;
+    for (int op=0; op<20000; op++){
+      int k = rand()% (rand()%2 ? N : 64); int r = rand()%10;
+      void* key=(void*)(intptr_t)(k+1);
+      if (r<5){ intptr_t v=rand()+1; hashPutBin(&m,key,(void*)v); if(!present[k])cnt++; present[k]=1; vals[k]=v; }
+      else if (r<8){ void* v=hashRemoveBin(&m,key); if(present[k]){ if((intptr_t)v!=vals[k]){printf("remove mismatch\n");return 1;} present[k]=0;cnt--;} else if(v){printf("remove phantom\n");return 1;} }
+      else if (r<9){ void* v=hashGetBin(&m,key); if(present[k]?((intptr_t)v!=vals[k]):(v!=NULL)){printf("get mismatch seed %u round %d op %d k %d present %d\n",seed,round,op,k,present[k]);return 1;} }
+      else { // iterate, randomly removing
+        hashIterator_t it={0}; int seen=0; static int seenk[N]; memset(seenk,0,sizeof seenk);
+        bool more = hashIterate(&m,&it);
+        while(more){
+          int kk=(int)(intptr_t)it.key-1; if(!present[kk]||seenk[kk]||(intptr_t)it.value!=vals[kk]){printf("iter bad k %d present %d seen %d\n",kk,present[kk],seenk[kk]);return 1;}
+          seenk[kk]=1; seen++;
+          if(rand()%4==0){ present[kk]=0; cnt--; more=hashIterRemove(&m,&it); }
+          else more=hashIterate(&m,&it);
+        }
+        int exp=0; for(int i=0;i<N;i++) if(present[i]&&!seenk[i]){printf("iter missed %d\n",i);return 1;}
+        (void)exp;
+      }
+      if (m.count!=cnt){printf("count mismatch %d %d\n",m.count,cnt);return 1;}
+    }
+    hashDeinit(&m);
+  }
+  printf("ok seed %u\n",seed); return 0;
+}
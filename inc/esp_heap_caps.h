@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#define MALLOC_CAP_8BIT 4
+#define MALLOC_CAP_SPIRAM 1024
+#define MALLOC_CAP_DEFAULT 4096
+void* heap_caps_malloc_tag(size_t s, uint32_t c, const char* t);
+void* heap_caps_calloc_tag(size_t n, size_t s, uint32_t c, const char* t);
+void* heap_caps_realloc_tag(void* p, size_t s, uint32_t c, const char* t);
+void heap_caps_free(void* p);
+#define heap_caps_malloc(s,c) heap_caps_malloc_tag(s,c,0)
+#define heap_caps_calloc(n,s,c) heap_caps_calloc_tag(n,s,c,0)
+#define heap_caps_realloc(p,s,c) heap_caps_realloc_tag(p,s,c,0)
@@ -0,0 +1,7 @@
+#pragma once
+#include <stdio.h>
+#define ESP_LOGE(t, ...) (fprintf(stderr, __VA_ARGS__), fprintf(stderr,"\n"))
+#define ESP_LOGW(t, ...) (fprintf(stderr, __VA_ARGS__), fprintf(stderr,"\n"))
+#define ESP_LOGI(t, ...) (fprintf(stderr, __VA_ARGS__), fprintf(stderr,"\n"))
+#define ESP_LOGD(t, ...)
+#define ESP_LOGV(t, ...)
@@ -0,0 +1,20 @@
+#ifndef _FONT_COMMON_H_
+#define _FONT_COMMON_H_
+
+/*
+ * A font asset starts with its height, then each character's width and bitmap. A font family starts with this tag
+ * instead, since a font's height is never zero, then a byte of ::FONT_FAMILY_OUTLINE flags for which variants it has,
+ * then the font's height. Each character's width is followed by its bitmap and then each variant's bitmap, which are
+ * all the same size.
+ */
+
+/// @brief The first byte of a font family
+#define FONT_FAMILY_TAG 0x00
+
+/// @brief The flag for a font family which has an outline variant
+#define FONT_FAMILY_OUTLINE 0x01
+
+/// @brief The size of a font family's tag, flags, and height
+#define FONT_FAMILY_HDR_SIZE 3
+
+#endif
@@ -21,7 +21,9 @@
 /* Turn on logging for debugging. */
 #define HEATSHRINK_DEBUGGING_LOGS 0
 
-/* Use indexing for faster compression. (This requires additional space.) */
-#define HEATSHRINK_USE_INDEX 0
+/* Use indexing for faster compression. (This requires additional space.)
+ * The index is 2 bytes per byte of the encoder's buffer, so 1KB for an 8 bit window. It finds the same matches as the
+ * linear search, so the output is identical, but saving a detailed full screen WSG to NVS is about twice as fast. */
+#define HEATSHRINK_USE_INDEX 1
 
 #endif
@@ -0,0 +1,32 @@
+#ifndef _LZ4_COMMON_H_
+#define _LZ4_COMMON_H_
+
+/*
+ * Compressed assets start with their decompressed size as a four byte big-endian number. Heatshrink assets are never
+ * 16MB or larger, so their first byte is always zero. LZ4 assets put this tag there instead, and the decompressed
+ * size is in the other three bytes. The rest of an LZ4 asset is a single LZ4 block. Uncompressed assets have their
+ * own tag, see stored_common.h.
+ */
+
+/// @brief The first byte of an LZ4 compressed asset
+#define LZ4_ASSET_TAG 0x4C
+
+/// @brief The largest decompressed size an LZ4 compressed asset can have
+#define LZ4_ASSET_MAX_SIZE 0x00FFFFFF
+
+/// @brief The shortest match in an LZ4 block
+#define LZ4_MIN_MATCH 4
+
+/// @brief The farthest back a match can be in an LZ4 block
+#define LZ4_MAX_OFFSET 0xFFFF
+
+/// @brief The number of bytes at the end of an LZ4 block which must be literals
+#define LZ4_LAST_LITERALS 5
+
+/// @brief The last match in an LZ4 block must start at least this many bytes before the end
+#define LZ4_MF_LIMIT 12
+
+/// @brief The value in a token nibble which means more length bytes follow
+#define LZ4_RUN_MASK 0x0F
+
+#endif
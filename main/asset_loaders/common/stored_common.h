@@ -0,0 +1,19 @@
+#ifndef _STORED_COMMON_H_
+#define _STORED_COMMON_H_
+
+/*
+ * Assets may also be stored without compression, so they can be used straight from flash without being copied into
+ * RAM. Like an LZ4 asset, a stored asset starts with this tag and its size as a three byte big-endian number. The rest
+ * of the asset is the data itself, so it starts four bytes into the file, which is four byte aligned in CNFS.
+ */
+
+/// @brief The first byte of an uncompressed asset
+#define STORED_ASSET_TAG 0x53
+
+/// @brief The largest size an uncompressed asset can have
+#define STORED_ASSET_MAX_SIZE 0x00FFFFFF
+
+/// @brief The size of an uncompressed asset's tag and size
+#define STORED_ASSET_HDR_SIZE 4
+
+#endif
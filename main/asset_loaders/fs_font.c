@@ -11,6 +11,13 @@
 #include "macros.h"
 #include "cnfs.h"
 #include "fs_font.h"
+#include "font_common.h"
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static bool loadFontInternal(cnfsFileIdx_t fIdx, font_t* font, font_t* outline, bool spiRam, arena_t* arena);
 
 //==============================================================================
 // Functions
@@ -30,6 +37,58 @@
  *         false if the font failed to load and should not be used
  */
 bool loadFont(cnfsFileIdx_t fIdx, font_t* font, bool spiRam)
+{
+    return loadFontInternal(fIdx, font, NULL, spiRam, NULL);
+}
+
+/**
+ * @brief Load a font from ROM to an arena. The character bitmaps are released with the arena, so this font must not
+ * be freed with freeFont()
+ *
+ * @param fIdx The cnfsFileIdx_t of the font to load. The ::font_t is not allocated by this function
+ * @param font A handle to load the font to
+ * @param arena The arena to allocate the character bitmaps from, i.e. getModeArena()
+ * @return true if the font was loaded successfully
+ *         false if the font failed to load and should not be used
+ */
+bool loadFontArena(cnfsFileIdx_t fIdx, font_t* font, arena_t* arena)
+{
+    return loadFontInternal(fIdx, font, NULL, true, arena);
+}
+
+/**
+ * @brief Load a font from ROM to RAM, along with its outline. The outline is made when the font is processed, so this
+ * is much faster than loadFont() and makeOutlineFont(). The font must have the \c outline option set in its options
+ * file.
+ *
+ * The font must be freed with freeFont(). The outline's bitmaps are used straight from ROM, so the outline takes no
+ * RAM and must not be passed to freeFont()
+ *
+ * @param fIdx The cnfsFileIdx_t of the font to load. The ::font_t are not allocated by this function
+ * @param font A handle to load the font to
+ * @param outline A handle to load the font's outline to
+ * @param spiRam true to load the font to SPI RAM, false to load it to normal RAM
+ * @return true if the font and outline were loaded successfully
+ *         false if the font failed to load or has no outline, and neither should be used
+ */
+bool loadFontFamily(cnfsFileIdx_t fIdx, font_t* font, font_t* outline, bool spiRam)
+{
+    return loadFontInternal(fIdx, font, outline, spiRam, NULL);
+}
+
+/**
+ * @brief Load a font from ROM to either the heap or an arena, and optionally point an outline at the font's outline in
+ * ROM
+ *
+ * @param fIdx The cnfsFileIdx_t of the font to load
+ * @param font A handle to load the font to
+ * @param outline A handle to load the font's outline to, or NULL to skip the outline
+ * @param spiRam true to load to SPI RAM, false to load to normal RAM. Ignored if arena is not NULL
+ * @param arena The arena to allocate the character bitmaps from, or NULL to allocate them from the heap
+ * @return true if the font was loaded successfully
+ *         false if the font failed to load and should not be used
+ */
+static bool loadFontInternal(cnfsFileIdx_t fIdx, font_t* font, font_t* outline, bool spiRam, arena_t* arena)
 {
     // Read font from file
     size_t bufIdx = 0;
@@ -42,8 +101,27 @@ bool loadFont(cnfsFileIdx_t fIdx, font_t* font, bool spiRam)
         return false;
     }
 
+    // A font family starts with a tag and the variants it has. A plain font starts with its height, which isn't zero
+    uint8_t variants = 0;
+    if (sz >= FONT_FAMILY_HDR_SIZE && FONT_FAMILY_TAG == buf[0])
+    {
+        variants = buf[1];
+        bufIdx   = 2;
+    }
+    bool hasOutline = (variants & FONT_FAMILY_OUTLINE);
+
+    if (NULL != outline && !hasOutline)
+    {
+        ESP_LOGE("FONT", "%d has no outline, set the outline option in its options file", fIdx);
+        return false;
+    }
+
     // Read the data into a font struct
     font->height = buf[bufIdx++];
+    if (NULL != outline)
+    {
+        outline->height = font->height;
+    }
 
     // Read each char
     while (bufIdx < sz && chIdx < ARRAY_SIZE(font->chars))
@@ -59,15 +137,39 @@ bool loadFont(cnfsFileIdx_t fIdx, font_t* font, bool spiRam)
         int bytes  = (pixels / 8) + ((pixels % 8 == 0) ? 0 : 1);
 
         // Allocate space for this char and copy it over
-        this->bitmap = (uint8_t*)heap_caps_malloc_tag(sizeof(uint8_t) * bytes,
-                                                      spiRam ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT, "font");
+        if (NULL != arena)
+        {
+            this->bitmap = (uint8_t*)arenaAlloc(arena, sizeof(uint8_t) * bytes);
+        }
+        else
+        {
+            this->bitmap = (uint8_t*)heap_caps_malloc_tag(sizeof(uint8_t) * bytes,
+                                                          spiRam ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT, "font");
+        }
         memcpy(this->bitmap, &buf[bufIdx], bytes);
         bufIdx += bytes;
+
+        // The outline's bitmap follows, and is the same size
+        if (hasOutline)
+        {
+            if (NULL != outline)
+            {
+                // font_ch_t isn't const, but outlines are never written to
+                outline->chars[chIdx - 1].width  = this->width;
+                outline->chars[chIdx - 1].bitmap = (uint8_t*)(uintptr_t)&buf[bufIdx];
+            }
+            bufIdx += bytes;
+        }
     }
 
     // Zero out any unused chars
     while (chIdx <= '~' - ' ' + 1)
     {
+        if (NULL != outline)
+        {
+            outline->chars[chIdx].bitmap = NULL;
+            outline->chars[chIdx].width  = 0;
+        }
         font->chars[chIdx].bitmap  = NULL;
         font->chars[chIdx++].width = 0;
     }
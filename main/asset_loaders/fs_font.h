@@ -17,6 +17,14 @@
  *
  * Free when done using freeFont(). If a font is not freed, the memory will leak.
  *
+ * Fonts which live as long as a Swadge mode may be loaded with loadFontArena() and getModeArena() instead. Every
+ * character is allocated separately, so this saves almost a hundred heap allocations per font. These fonts are
+ * released with the arena and must not be passed to freeFont().
+ *
+ * Fonts which are drawn with an outline should set `outline = yes` in the `[font]` section of their options file, so
+ * the outline is made when the font is processed. Load both with loadFontFamily() instead of calling
+ * makeOutlineFont(). The outline is used straight from ROM, so it takes no RAM and must not be passed to freeFont().
+ *
  * \section fs_font_example Example
  *
  * \code{.c}
@@ -38,8 +46,11 @@
 
 #include "cnfs_image.h"
 #include "font.h"
+#include "arena.h"
 
 bool loadFont(cnfsFileIdx_t fIdx, font_t* font, bool spiRam);
+bool loadFontArena(cnfsFileIdx_t fIdx, font_t* font, arena_t* arena);
+bool loadFontFamily(cnfsFileIdx_t fIdx, font_t* font, font_t* outline, bool spiRam);
 void freeFont(font_t* font);
 
 #endif
\ No newline at end of file
@@ -41,6 +41,27 @@ char* loadTxt(cnfsFileIdx_t fIdx, bool spiRam)
     return (char*)buf;
 }
 
+/**
+ * @brief Use a TXT straight from ROM, without loading it to RAM. This takes no memory. The text processor stores the
+ * null terminator, so the string can be used where it is. It must not be written to or freed with freeTxt()
+ *
+ * @param fIdx The cnfsFileIdx_t the TXT to use
+ * @return A pointer to a null terminated TXT string in ROM. May be NULL if the TXT isn't null terminated
+ */
+const char* loadTxtMapped(cnfsFileIdx_t fIdx)
+{
+    // Get the file without reading it
+    size_t sz;
+    const uint8_t* buf = cnfsGetFile(fIdx, &sz);
+    if (NULL == buf || 0 == sz || '\0' != buf[sz - 1])
+    {
+        ESP_LOGE("TXT", "Can't map %d, it isn't null terminated", fIdx);
+        return NULL;
+    }
+
+    return (const char*)buf;
+}
+
 /**
  * @brief Free an allocated TXT string
  *
@@ -15,12 +15,18 @@
  *
  * Free when done using freeTxt(). If text is not freed, the memory will leak.
  *
+ * Text is stored uncompressed and null terminated, so it may also be used straight from ROM with loadTxtMapped(),
+ * which takes no RAM. That text must not be written to or passed to freeTxt().
+ *
  * \section fs_txt_example Example
  *
  * \code{.c}
  * char* txtStr = loadTxt(STORY_TXT, true);
  * // Free the txt
  * freeTxt(&txtStr);
+ *
+ * // Use text from ROM, which is never freed
+ * const char* romStr = loadTxtMapped(STORY_TXT);
  * \endcode
  */
 
@@ -30,6 +36,7 @@
 #include "cnfs_image.h"
 
 char* loadTxt(cnfsFileIdx_t fIdx, bool spiRam);
+const char* loadTxtMapped(cnfsFileIdx_t fIdx);
 void freeTxt(char* txtStr);
 
 #endif
\ No newline at end of file
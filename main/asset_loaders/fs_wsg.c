@@ -13,6 +13,7 @@
 #include "hdw-nvs.h"
 #include "fs_wsg.h"
 #include "macros.h"
+#include "stored_common.h"
 
 //==============================================================================
 // Functions
@@ -59,6 +60,81 @@ bool loadWsg(cnfsFileIdx_t fIdx, wsg_t* wsg, bool spiRam)
     return false;
 }
 
+/**
+ * @brief Load a WSG from ROM to an arena. The pixels are released with the arena, so this WSG must not be freed with
+ * freeWsg()
+ *
+ * @param fIdx The cnfsFileIdx_t the WSG to load
+ * @param wsg  A handle to load the WSG to
+ * @param arena The arena to allocate the pixels from, i.e. getModeArena()
+ * @return true if the WSG was loaded successfully,
+ *         false if the WSG load failed and should not be used
+ */
+bool loadWsgArena(cnfsFileIdx_t fIdx, wsg_t* wsg, arena_t* arena)
+{
+    // Read and decompress file
+    uint32_t decompressedSize = 0;
+    uint8_t* decompressedBuf  = readHeatshrinkFile(fIdx, &decompressedSize, true);
+
+    if (NULL == decompressedBuf)
+    {
+        return false;
+    }
+
+    // Save the decompressed info to the wsg. The first four bytes are dimension
+    wsg->w = (decompressedBuf[0] << 8) | decompressedBuf[1];
+    wsg->h = (decompressedBuf[2] << 8) | decompressedBuf[3];
+    // The rest of the bytes are pixels
+    wsg->px = (paletteColor_t*)arenaAlloc(arena, sizeof(paletteColor_t) * wsg->w * wsg->h);
+
+    if (NULL != wsg->px)
+    {
+        memcpy(wsg->px, &decompressedBuf[4], decompressedSize - 4);
+    }
+
+    // all done
+    heap_caps_free(decompressedBuf);
+    return NULL != wsg->px;
+}
+
+/**
+ * @brief Use a WSG straight from ROM, without loading it to RAM. This takes no memory, but the WSG must be stored
+ * uncompressed, by setting its codec to \c none in \c assets.conf or its options file. The pixels are in ROM, so they
+ * must not be written to, and this WSG must not be freed with freeWsg()
+ *
+ * @param fIdx The cnfsFileIdx_t the WSG to use
+ * @param wsg  A handle to point at the WSG
+ * @return true if the WSG can be used,
+ *         false if the WSG is compressed or damaged and should not be used
+ */
+bool loadWsgMapped(cnfsFileIdx_t fIdx, wsg_t* wsg)
+{
+    // Get the file without reading it
+    size_t sz;
+    const uint8_t* buf = cnfsGetFile(fIdx, &sz);
+    if (NULL == buf || sz < STORED_ASSET_HDR_SIZE + 4 || STORED_ASSET_TAG != buf[0])
+    {
+        ESP_LOGE("WSG", "Can't map %d, it isn't stored with codec = none", fIdx);
+        return false;
+    }
+
+    // The first four bytes after the header are dimension
+    const uint8_t* data = &buf[STORED_ASSET_HDR_SIZE];
+    uint16_t w          = (data[0] << 8) | data[1];
+    uint16_t h          = (data[2] << 8) | data[3];
+    if (sz - STORED_ASSET_HDR_SIZE - 4 < (size_t)w * h)
+    {
+        ESP_LOGE("WSG", "Can't map %d, it is truncated", fIdx);
+        return false;
+    }
+
+    // The rest of the bytes are pixels, which are used where they are. wsg_t isn't const, but they're never written to
+    wsg->w  = w;
+    wsg->h  = h;
+    wsg->px = (paletteColor_t*)(uintptr_t)&data[4];
+    return true;
+}
+
 /**
  * @brief Load a WSG from ROM to RAM. WSGs placed in the assets_image folder
  * before compilation will be automatically flashed to ROM.
@@ -145,47 +221,26 @@ bool saveWsgNvs(const char* namespace, const char* key, const wsg_t* wsg)
     // pixelSize is just the WSG pixels, no dimensions
     uint32_t pixelSize = sizeof(uint8_t) * wsg->w * wsg->h;
 
-    // wsgHeaderSize is the 4 bytes of WSG header, 2 for W and 2 for H
-    uint32_t wsgHeaderSize = 4;
-
-    // imageSize is the total image data size; header + pixels
-    uint32_t imageSize = wsgHeaderSize + pixelSize;
-
-    // Create an output buffer big enough to hold the uncompressed image
-    uint8_t* output = heap_caps_malloc_tag(imageSize, MALLOC_CAP_SPIRAM, key);
-
-    if (!output)
-    {
-        ESP_LOGE("WSG", "Failed to allocate output buffer for image");
-        return false;
-    }
-
-    // Write the WSG header to the buffer
-    output[0] = (wsg->w >> 8) & 0xFF;
-    output[1] = (wsg->w) & 0xFF;
-    output[2] = (wsg->h >> 8) & 0xFF;
-    output[3] = (wsg->h) & 0xFF;
-
-    // Copy the pixels into the input buffer after the
-    memcpy(output + 4, wsg->px, pixelSize);
-
-    // Compress the buffer in-place
-    uint32_t outputSize = heatshrinkCompress(output, output, imageSize);
-
-    bool result;
-    if (outputSize == 0)
+    // The WSG header is the 4 bytes of dimension, 2 for W and 2 for H
+    uint8_t header[4] = {
+        (wsg->w >> 8) & 0xFF,
+        (wsg->w) & 0xFF,
+        (wsg->h >> 8) & 0xFF,
+        (wsg->h) & 0xFF,
+    };
+
+    // Compress the header and pixels straight from the WSG, without copying the image first
+    heatshrinkNvsWriter_t writer;
+    heatshrinkNvsWriterBegin(&writer, sizeof(header) + pixelSize, NULL);
+    heatshrinkNvsWriterWrite(&writer, header, sizeof(header));
+    heatshrinkNvsWriterWrite(&writer, wsg->px, pixelSize);
+
+    if (!heatshrinkNvsWriterEnd(&writer, namespace, key))
     {
         ESP_LOGE("WSG", "Failed to save WSG to NVS");
-        result = false;
-    }
-    else
-    {
-        ESP_LOGD("WSG", "Compressed image from %" PRIu32 " bytes to %" PRIu32, imageSize, outputSize);
-        result = writeNamespaceNvsBlob(namespace, key, output, outputSize);
+        return false;
     }
-
-    heap_caps_free(output);
-    return result;
+    return true;
 }
 
 /**
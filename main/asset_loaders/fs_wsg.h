@@ -17,6 +17,13 @@
  *
  * Free when done using freeWsg(). If a wsg is not freed, the memory will leak.
  *
+ * WSGs which live as long as a Swadge mode may be loaded with loadWsgArena() and getModeArena() instead. These are
+ * released with the arena and must not be passed to freeWsg().
+ *
+ * WSGs which are stored uncompressed, with `codec = none` in \c assets.conf or an options file, may be used straight
+ * from ROM with loadWsgMapped(). These take no RAM at all, but are larger in ROM, so this is best for frequently used
+ * sprites. Their pixels must not be written to, and they must not be passed to freeWsg().
+ *
  * \section fs_wsg_example Example
  *
  * \code{.c}
@@ -42,8 +49,11 @@
 #include "wsg.h"
 #include "heatshrink_helper.h"
 #include "heatshrink_encoder.h"
+#include "arena.h"
 
 bool loadWsg(cnfsFileIdx_t fIdx, wsg_t* wsg, bool spiRam);
+bool loadWsgArena(cnfsFileIdx_t fIdx, wsg_t* wsg, arena_t* arena);
+bool loadWsgMapped(cnfsFileIdx_t fIdx, wsg_t* wsg);
 bool loadWsgInplace(cnfsFileIdx_t fIdx, wsg_t* wsg, bool spiRam, uint8_t* decompressedBuf, heatshrink_decoder* hsd);
 bool loadWsgNvs(const char* namespace, const char* key, wsg_t* wsg, bool spiRam);
 bool saveWsgNvs(const char* namespace, const char* key, const wsg_t* wsg);
@@ -1,4 +1,5 @@
 #include <stddef.h>
+#include <string.h>
 
 #include <esp_log.h>
 #include <esp_heap_caps.h>
@@ -10,18 +11,39 @@
 #include <nvs.h>
 
 #include "heatshrink_helper.h"
+#include "lz4_decoder.h"
+#include "stored_common.h"
+
+static uint32_t readDecompressedSize(const uint8_t* buf);
+
+/**
+ * @brief Read the decompressed size from the start of a compressed asset
+ *
+ * @param buf The compressed asset, which must be at least four bytes
+ * @return The decompressed size
+ */
+static uint32_t readDecompressedSize(const uint8_t* buf)
+{
+    if (LZ4_ASSET_TAG == buf[0] || STORED_ASSET_TAG == buf[0])
+    {
+        // The first byte of an LZ4 or uncompressed asset is its tag, so the size is only three bytes
+        return (buf[1] << 16) | (buf[2] << 8) | (buf[3]);
+    }
+    return (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | (buf[3]);
+}
 
 /**
  * @brief Read a heatshrink compressed file from the filesystem into an output array.
  * Files that are in the assets_image folder before compilation and flashing
  * will automatically be included in the firmware.
  *
- * You must provide a decoder and decode space for this function
+ * You must provide a decoder and decode space for this function. Assets compressed with LZ4 instead of heatshrink, or
+ * not compressed at all, are also read, and don't use the decoder
  *
  * @param fIdx    The CNFS index of the file to load
  * @param outsize A pointer to a size_t to return how much data was read
  * @param decompressedBuf Memory to store decoded data. This must be as large as the decoded data
- * @param hsd A heatshrink decoder
+ * @param hsd A heatshrink decoder. This may be NULL if the asset is compressed with LZ4 or not compressed
  * @return A pointer to the read data if successful, or NULL if there is a failure
  *         This data must be freed when done
  */
@@ -38,8 +60,31 @@ uint8_t* readHeatshrinkFileInplace(cnfsFileIdx_t fIdx, uint32_t* outsize, uint8_
         return NULL;
     }
 
-    // Pick out the decompressed size and create a space for it
-    (*outsize) = (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | (buf[3]);
+    // Pick out the decompressed size
+    (*outsize) = readDecompressedSize(buf);
+
+    // LZ4 assets are decompressed in one go, without the decoder
+    if (LZ4_ASSET_TAG == buf[0])
+    {
+        if (!lz4Decompress(decompressedBuf, (*outsize), &buf[4], sz - 4))
+        {
+            ESP_LOGE("WSG", "Failed to read %d fault on decode", fIdx);
+            return NULL;
+        }
+        return decompressedBuf;
+    }
+
+    // Uncompressed assets are just copied
+    if (STORED_ASSET_TAG == buf[0])
+    {
+        if (sz < STORED_ASSET_HDR_SIZE || sz - STORED_ASSET_HDR_SIZE < (*outsize))
+        {
+            ESP_LOGE("WSG", "Failed to read %d, it is truncated", fIdx);
+            return NULL;
+        }
+        memcpy(decompressedBuf, &buf[STORED_ASSET_HDR_SIZE], (*outsize));
+        return decompressedBuf;
+    }
 
     // Create the decoder
     size_t copied = 0;
@@ -87,7 +132,8 @@ uint8_t* readHeatshrinkFileInplace(cnfsFileIdx_t fIdx, uint32_t* outsize, uint8_
 /**
  * @brief Read a heatshrink compressed file from the filesystem into an output array.
  * Files that are in the assets_image folder before compilation and flashing
- * will automatically be included in the firmware.
+ * will automatically be included in the firmware. Files compressed with LZ4
+ * instead of heatshrink, or not compressed at all, are read too.
  *
  * @param fIdx    The CNFS index of the file to load
  * @param outsize A pointer to a size_t to return how much data was read
@@ -108,7 +154,7 @@ uint8_t* readHeatshrinkFile(cnfsFileIdx_t fIdx, uint32_t* outsize, bool readToSp
     }
 
     // Pick out the decompressed size and create a space for it
-    int32_t decompressedSize = (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | (buf[3]);
+    int32_t decompressedSize = readDecompressedSize(buf);
     uint8_t* decompressedBuf;
     if (readToSpiRam)
     {
@@ -119,14 +165,21 @@ uint8_t* readHeatshrinkFile(cnfsFileIdx_t fIdx, uint32_t* outsize, bool readToSp
         decompressedBuf = (uint8_t*)heap_caps_malloc(decompressedSize, MALLOC_CAP_8BIT);
     }
 
-    // Allocate the decoder
-    heatshrink_decoder* hsd = heatshrink_decoder_alloc(256, 8, 4);
+    // Allocate the decoder, which LZ4 and uncompressed assets don't need
+    heatshrink_decoder* hsd = NULL;
+    if (LZ4_ASSET_TAG != buf[0] && STORED_ASSET_TAG != buf[0])
+    {
+        hsd = heatshrink_decoder_alloc(256, 8, 4);
+    }
 
     // Decode the file
     uint8_t* data = readHeatshrinkFileInplace(fIdx, outsize, decompressedBuf, hsd);
 
     // Free the decoder
-    heatshrink_decoder_free(hsd);
+    if (NULL != hsd)
+    {
+        heatshrink_decoder_free(hsd);
+    }
 
     // If there was an error, free decompressedBuf
     if (NULL == data)
@@ -205,9 +258,42 @@ uint8_t* readHeatshrinkNvs(const char* namespace, const char* key, uint32_t* out
     return decompressedBuf;
 }
 
+/**
+ * @brief Compress data with heatshrink, allocating a new encoder for it
+ *
+ * @param dest Where to write the compressed data, which must be at least as large as the data. This may be the same as
+ * src
+ * @param src The data to compress
+ * @param size The size of the data to compress
+ * @return The size of the compressed data, including the four byte header, or 0 if it could not be compressed
+ */
 uint32_t heatshrinkCompress(uint8_t* dest, const uint8_t* src, uint32_t size)
 {
-    heatshrink_encoder* hse = heatshrink_encoder_alloc(8, 4);
+    heatshrink_encoder* hse = heatshrink_encoder_alloc(HEATSHRINK_WINDOW_BITS, HEATSHRINK_LOOKAHEAD_BITS);
+    if (NULL == hse)
+    {
+        return 0;
+    }
+
+    uint32_t outputSize = heatshrinkCompressInplace(dest, src, size, hse);
+    heatshrink_encoder_free(hse);
+    return outputSize;
+}
+
+/**
+ * @brief Compress data with heatshrink, using an encoder which was already allocated. It's useful to allocate one
+ * encoder with heatshrink_encoder_alloc(::HEATSHRINK_WINDOW_BITS, ::HEATSHRINK_LOOKAHEAD_BITS) and reuse it for
+ * everything that gets compressed, instead of allocating the encoder's buffer and search index every time
+ *
+ * @param dest Where to write the compressed data, which must be at least as large as the data. This may be the same as
+ * src
+ * @param src The data to compress
+ * @param size The size of the data to compress
+ * @param hse A heatshrink encoder, which is reset before it is used
+ * @return The size of the compressed data, including the four byte header, or 0 if it could not be compressed
+ */
+uint32_t heatshrinkCompressInplace(uint8_t* dest, const uint8_t* src, uint32_t size, heatshrink_encoder* hse)
+{
     heatshrink_encoder_reset(hse);
 
     size_t inputIdx = 0;
@@ -317,7 +403,6 @@ uint32_t heatshrinkCompress(uint8_t* dest, const uint8_t* src, uint32_t size)
 
     ESP_LOGD("WSG", "Compressed size is %" PRIu32, (uint32_t)outputIdx);
 
-    heatshrink_encoder_free(hse);
     dest[0] = (size >> 24) & 0xFF;
     dest[1] = (size >> 16) & 0xFF;
     dest[2] = (size >> 8) & 0xFF;
@@ -325,16 +410,180 @@ uint32_t heatshrinkCompress(uint8_t* dest, const uint8_t* src, uint32_t size)
     return (uint32_t)outputIdx;
 
 heatshrink_error:
-    if (NULL != hse)
+    return 0;
+}
+
+/**
+ * @brief Start writing a heatshrink compressed NVS blob a piece at a time. Each piece is compressed as it is written,
+ * so the data never has to be in one buffer, i.e. a WSG's dimensions and pixels can be written separately. Write the
+ * pieces with heatshrinkNvsWriterWrite() and save the blob with heatshrinkNvsWriterEnd(). The blob can be read with
+ * readHeatshrinkNvs()
+ *
+ * @param writer The writer to start
+ * @param size The total size of the pieces which will be written
+ * @param hse A heatshrink encoder to reuse, or NULL to allocate one just for this blob
+ * @return true if the writer was started, false if memory could not be allocated
+ */
+bool heatshrinkNvsWriterBegin(heatshrinkNvsWriter_t* writer, uint32_t size, heatshrink_encoder* hse)
+{
+    memset(writer, 0, sizeof(heatshrinkNvsWriter_t));
+    writer->size = size;
+
+    // Allocate the encoder if one wasn't given
+    writer->hse = hse;
+    if (NULL == writer->hse)
     {
-        heatshrink_encoder_free(hse);
+        writer->hse          = heatshrink_encoder_alloc(HEATSHRINK_WINDOW_BITS, HEATSHRINK_LOOKAHEAD_BITS);
+        writer->hseAllocated = true;
     }
 
-    return 0;
+    // The blob starts with the decompressed size, and grows one chunk at a time
+    writer->cap = HEATSHRINK_NVS_CHUNK_SIZE;
+    writer->buf = heap_caps_malloc_tag(writer->cap, MALLOC_CAP_SPIRAM, "hs_nvs");
+    if (NULL == writer->hse || NULL == writer->buf)
+    {
+        ESP_LOGE("Heatshrink", "Failed to allocate NVS writer");
+        writer->failed = true;
+        return false;
+    }
+
+    writer->buf[0] = (size >> 24) & 0xFF;
+    writer->buf[1] = (size >> 16) & 0xFF;
+    writer->buf[2] = (size >> 8) & 0xFF;
+    writer->buf[3] = (size >> 0) & 0xFF;
+    writer->len    = 4;
+
+    heatshrink_encoder_reset(writer->hse);
+    return true;
+}
+
+/**
+ * @brief Move everything the encoder has output into the writer's blob, growing the blob as needed
+ *
+ * @param writer The writer to poll the encoder of
+ * @return true if the output was moved, false if the blob could not grow
+ */
+static bool heatshrinkNvsWriterPoll(heatshrinkNvsWriter_t* writer)
+{
+    HSE_poll_res res;
+    do
+    {
+        // Grow the blob if it's full
+        if (writer->len == writer->cap)
+        {
+            uint8_t* grown = heap_caps_realloc_tag(writer->buf, writer->cap + HEATSHRINK_NVS_CHUNK_SIZE,
+                                                   MALLOC_CAP_SPIRAM, "hs_nvs");
+            if (NULL == grown)
+            {
+                ESP_LOGE("Heatshrink", "Failed to grow NVS blob past %" PRIu32 " bytes", writer->cap);
+                return false;
+            }
+            writer->buf = grown;
+            writer->cap += HEATSHRINK_NVS_CHUNK_SIZE;
+        }
+
+        size_t copied = 0;
+        res = heatshrink_encoder_poll(writer->hse, &writer->buf[writer->len], writer->cap - writer->len, &copied);
+        writer->len += copied;
+    } while (HSER_POLL_MORE == res);
+
+    return HSER_POLL_EMPTY == res;
+}
+
+/**
+ * @brief Compress and add a piece of data to a heatshrink compressed NVS blob
+ *
+ * @param writer The writer started with heatshrinkNvsWriterBegin()
+ * @param data The piece of data to add
+ * @param len The size of the piece of data
+ * @return true if the data was added, false if there was an error, in which case the blob will not be saved
+ */
+bool heatshrinkNvsWriterWrite(heatshrinkNvsWriter_t* writer, const void* data, uint32_t len)
+{
+    if (writer->failed || len > writer->size - writer->sunk)
+    {
+        writer->failed = true;
+        return false;
+    }
+
+    const uint8_t* bytes = data;
+    while (len)
+    {
+        size_t copied = 0;
+        if (HSER_SINK_OK != heatshrink_encoder_sink(writer->hse, bytes, len, &copied)
+            || !heatshrinkNvsWriterPoll(writer))
+        {
+            writer->failed = true;
+            return false;
+        }
+        bytes += copied;
+        len -= copied;
+        writer->sunk += copied;
+    }
+    return true;
+}
+
+/**
+ * @brief Finish compressing a heatshrink compressed NVS blob and write it to NVS. This frees everything the writer
+ * allocated, even if there was an error
+ *
+ * @param writer The writer started with heatshrinkNvsWriterBegin()
+ * @param namespace The NVS namespace to write the blob to
+ * @param key The NVS key to write the blob to
+ * @return true if the blob was written, false if there was an error or fewer bytes were written than the writer was
+ * started with
+ */
+bool heatshrinkNvsWriterEnd(heatshrinkNvsWriter_t* writer, const char* namespace, const char* key)
+{
+    bool ok = !writer->failed && writer->sunk == writer->size;
+
+    // Flush the last of the output
+    if (ok)
+    {
+        while (HSER_FINISH_MORE == heatshrink_encoder_finish(writer->hse))
+        {
+            if (!heatshrinkNvsWriterPoll(writer))
+            {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    if (ok)
+    {
+        ESP_LOGD("Heatshrink", "Compressed %" PRIu32 " bytes to %" PRIu32, writer->size, writer->len);
+        ok = writeNamespaceNvsBlob(namespace, key, writer->buf, writer->len);
+    }
+
+    if (writer->hseAllocated && NULL != writer->hse)
+    {
+        heatshrink_encoder_free(writer->hse);
+    }
+    heap_caps_free(writer->buf);
+    memset(writer, 0, sizeof(heatshrinkNvsWriter_t));
+    return ok;
 }
 
 /**
- * @brief Get the size of and decompress heatshrink data
+ * @brief Compress data with heatshrink and write it to NVS. The data can be read with readHeatshrinkNvs()
+ *
+ * @param namespace The NVS namespace to write the data to
+ * @param key The NVS key to write the data to
+ * @param data The data to compress and write
+ * @param size The size of the data
+ * @return true if the data was written, false if there was an error
+ */
+bool writeHeatshrinkNvs(const char* namespace, const char* key, const uint8_t* data, uint32_t size)
+{
+    heatshrinkNvsWriter_t writer;
+    heatshrinkNvsWriterBegin(&writer, size, NULL);
+    heatshrinkNvsWriterWrite(&writer, data, size);
+    return heatshrinkNvsWriterEnd(&writer, namespace, key);
+}
+
+/**
+ * @brief Get the size of and decompress heatshrink or LZ4 data, or copy uncompressed data
  *
  * @param dest
  * @param destSize
@@ -360,10 +609,33 @@ bool heatshrinkDecompress(uint8_t* dest, uint32_t* destSize, const uint8_t* sour
     // Write the destSize
     if (destSize)
     {
-        (*destSize) = (source[0] << 24) | (source[1] << 16) | (source[2] << 8) | (source[3]);
+        (*destSize) = readDecompressedSize(source);
         sizeRead    = true;
     }
 
+    // LZ4 data is decompressed in one go
+    if (dest && LZ4_ASSET_TAG == source[0])
+    {
+        if (!lz4Decompress(dest, (*destSize), &source[4], sourceSize - 4))
+        {
+            ESP_LOGE("WSG", "Failed to decompress LZ4 buffer -- fault on decode");
+            return false;
+        }
+        return true;
+    }
+
+    // Uncompressed data is copied
+    if (dest && STORED_ASSET_TAG == source[0])
+    {
+        if (sourceSize - STORED_ASSET_HDR_SIZE < (*destSize))
+        {
+            ESP_LOGE("WSG", "Failed to copy uncompressed buffer -- it is truncated");
+            return false;
+        }
+        memcpy(dest, &source[STORED_ASSET_HDR_SIZE], (*destSize));
+        return true;
+    }
+
     // Write the actual data
     if (dest)
     {
@@ -8,11 +8,39 @@
 #include "heatshrink_decoder.h"
 #include "heatshrink_encoder.h"
 
+/// @brief The window size, as a power of two, of everything compressed with heatshrink
+#define HEATSHRINK_WINDOW_BITS 8
+
+/// @brief The lookahead size, as a power of two, of everything compressed with heatshrink
+#define HEATSHRINK_LOOKAHEAD_BITS 4
+
+/// @brief How much a heatshrink compressed NVS blob grows by while it is written
+#define HEATSHRINK_NVS_CHUNK_SIZE 1024
+
+/**
+ * @brief A heatshrink compressed NVS blob which is being written a piece at a time, see heatshrinkNvsWriterBegin()
+ */
+typedef struct
+{
+    heatshrink_encoder* hse; ///< The encoder, which may be reused for many blobs
+    bool hseAllocated;       ///< true if the encoder was allocated by the writer, and is freed with it
+    uint8_t* buf;            ///< The compressed blob so far, starting with the four byte decompressed size
+    uint32_t len;            ///< The number of bytes in buf
+    uint32_t cap;            ///< The number of bytes buf has space for
+    uint32_t size;           ///< The decompressed size the blob will have
+    uint32_t sunk;           ///< The number of decompressed bytes written so far
+    bool failed;             ///< true if there was an error, so the blob will not be saved
+} heatshrinkNvsWriter_t;
+
 uint8_t* readHeatshrinkFileInplace(cnfsFileIdx_t fIdx, uint32_t* outsize, uint8_t* decompressedBuf,
                                    heatshrink_decoder* hsd);
 uint8_t* readHeatshrinkFile(cnfsFileIdx_t fIdx, uint32_t* outsize, bool readToSpiRam);
 uint8_t* readHeatshrinkNvs(const char* namespace, const char* key, uint32_t* outsize, bool spiRam);
 uint32_t heatshrinkCompress(uint8_t* dest, const uint8_t* src, uint32_t size);
+uint32_t heatshrinkCompressInplace(uint8_t* dest, const uint8_t* src, uint32_t size, heatshrink_encoder* hse);
+bool heatshrinkNvsWriterBegin(heatshrinkNvsWriter_t* writer, uint32_t size, heatshrink_encoder* hse);
+bool heatshrinkNvsWriterWrite(heatshrinkNvsWriter_t* writer, const void* data, uint32_t len);
+bool heatshrinkNvsWriterEnd(heatshrinkNvsWriter_t* writer, const char* namespace, const char* key);
 bool writeHeatshrinkNvs(const char* namespace, const char* key, const uint8_t* data, uint32_t size);
 bool heatshrinkDecompress(uint8_t* dest, uint32_t* destSize, const uint8_t* source, uint32_t sourceSize);
 
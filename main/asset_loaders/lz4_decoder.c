@@ -0,0 +1,132 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <string.h>
+
+#include "lz4_decoder.h"
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Decompress one LZ4 block. LZ4 is byte oriented, so this is several times faster than heatshrink, at the cost
+ * of a somewhat larger file. Damaged input is rejected rather than read or written out of bounds
+ *
+ * @param dest The buffer to decompress into
+ * @param destSize The exact decompressed size
+ * @param source The LZ4 block, without the compressed asset header
+ * @param sourceSize The size of the LZ4 block
+ * @return true if the block decompressed to exactly destSize bytes
+ * @return false if the block was damaged
+ */
+bool lz4Decompress(uint8_t* dest, uint32_t destSize, const uint8_t* source, uint32_t sourceSize)
+{
+    const uint8_t* ip   = source;
+    const uint8_t* iend = source + sourceSize;
+    uint8_t* op         = dest;
+    uint8_t* oend       = dest + destSize;
+
+    while (ip < iend)
+    {
+        // Each sequence starts with a token of the literal and match lengths
+        uint8_t token = *ip++;
+
+        // Read the literal length, which continues in extra bytes if the nibble is maxed out
+        size_t len = token >> 4;
+        if (LZ4_RUN_MASK == len)
+        {
+            uint8_t b;
+            do
+            {
+                if (ip >= iend)
+                {
+                    return false;
+                }
+                b = *ip++;
+                len += b;
+            } while (0xFF == b);
+        }
+
+        // Copy the literals
+        if (len > (size_t)(iend - ip) || len > (size_t)(oend - op))
+        {
+            return false;
+        }
+        memcpy(op, ip, len);
+        ip += len;
+        op += len;
+
+        // The last sequence is only literals
+        if (ip == iend)
+        {
+            break;
+        }
+
+        // Read the match offset, which is little-endian
+        if (iend - ip < 2)
+        {
+            return false;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (0 == offset || offset > (size_t)(op - dest))
+        {
+            return false;
+        }
+
+        // Read the match length
+        len = token & LZ4_RUN_MASK;
+        if (LZ4_RUN_MASK == len)
+        {
+            uint8_t b;
+            do
+            {
+                if (ip >= iend)
+                {
+                    return false;
+                }
+                b = *ip++;
+                len += b;
+            } while (0xFF == b);
+        }
+        len += LZ4_MIN_MATCH;
+        if (len > (size_t)(oend - op))
+        {
+            return false;
+        }
+
+        // Copy the match
+        const uint8_t* match = op - offset;
+        if (offset >= len)
+        {
+            memcpy(op, match, len);
+            op += len;
+        }
+        else if (1 == offset)
+        {
+            // Runs of one byte are common in images
+            memset(op, *match, len);
+            op += len;
+        }
+        else
+        {
+            // The match overlaps what it makes. Everything from the match to here repeats, so copy all of it at once,
+            // which doubles the amount copied each time
+            while (len)
+            {
+                size_t n = op - match;
+                if (n > len)
+                {
+                    n = len;
+                }
+                memcpy(op, match, n);
+                op += n;
+                len -= n;
+            }
+        }
+    }
+
+    return op == oend;
+}
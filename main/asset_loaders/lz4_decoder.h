@@ -0,0 +1,11 @@
+#ifndef _LZ4_DECODER_H_
+#define _LZ4_DECODER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lz4_common.h"
+
+bool lz4Decompress(uint8_t* dest, uint32_t destSize, const uint8_t* source, uint32_t sourceSize);
+
+#endif
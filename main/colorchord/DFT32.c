@@ -7,6 +7,13 @@
 #include "DFT32.h"
 #include <string.h>
 
+#ifdef ENABLE_BENCHMARKS
+    #include <stdio.h>
+    #include <inttypes.h>
+    #include <esp_timer.h>
+    #include <esp_heap_caps.h>
+#endif
+
 #ifndef CC_EMBEDDED
     #include <stdlib.h>
     #include <stdio.h>
@@ -14,6 +21,17 @@
 static float* gOutBins;
 #endif
 
+//==============================================================================
+// Defines
+//==============================================================================
+
+#ifdef ENABLE_BENCHMARKS
+    /// The number of seconds of audio dft32Benchmark() pushes through each method
+    #define BENCH_SECONDS 10
+    /// The number of samples dft32Benchmark() pushes at once, the same as a microphone block
+    #define BENCH_BLOCK (HPA_BUF_SIZE / 2)
+#endif
+
 //==============================================================================
 // Constant data
 //==============================================================================
@@ -176,66 +194,81 @@ void UpdateOutputBins32(dft32_data* dd)
 }
 
 /**
- * @brief TODO
+ * @brief Copy the running sin/cos state of every bin to the output and decay it. This is run once out of every
+ * ::BIN_CYCLE steps
  *
- * @param dd
- * @param sample
+ * @param dd The DFT data
  */
-static void HandleInt(dft32_data* dd, int16_t sample)
+static void SnapshotBins32(dft32_data* dd)
 {
-    int i;
-
-    uint8_t oct = dd->Sdo_this_octave[dd->sWhichOctavePlace];
-    dd->sWhichOctavePlace++;
-    dd->sWhichOctavePlace &= BIN_CYCLE - 1;
+    int32_t* bins    = &dd->sDatSpace32B[0];
+    int32_t* binsOut = &dd->sDatSpace32BOut[0];
 
-    for (i = 0; i < OCTAVES; i++)
+    for (int i = 0; i < FIX_BINS * 2; i++)
     {
-        dd->sAccum_octave_bins[i] += sample;
+        // SIN and COS are interleaved, but treated the same
+        int32_t val = bins[i];
+        binsOut[i]  = val;
+        bins[i]     = val - (val >> DFT_IIR);
     }
+}
 
-    if (oct > 128)
+/**
+ * @brief Advance the running sin/cos state of every bin in one octave by a run of decimated samples.
+ *
+ * This loops over bins on the outside and samples on the inside, so each bin's state stays in registers for the whole
+ * run instead of being loaded and stored for every sample.
+ *
+ * @param dd The DFT data
+ * @param oct The octave to update
+ * @param filtered The decimated samples for this octave, in order
+ * @param count The number of decimated samples
+ */
+static void UpdateOctave32(dft32_data* dd, uint8_t oct, const int16_t* filtered, int count)
+{
+    uint16_t* dsA = &dd->sDatSpace32A[oct * FIX_B_PER_O * 2];
+    int32_t* dsB  = &dd->sDatSpace32B[oct * FIX_B_PER_O * 2];
+
+    for (int i = 0; i < FIX_B_PER_O; i++)
     {
-        // Special: This is when we can update everything.
-        // This gets run once out of every (1<<OCTAVES) times.
-        //  which is half as many samples
-        // It handles updating part of the DFT.
-        // It should happen at the very first call to HandleInit
-        int32_t* bins    = &dd->sDatSpace32B[0];
-        int32_t* binsOut = &dd->sDatSpace32BOut[0];
+        uint16_t adv   = dsA[0];
+        uint16_t place = dsA[1];
+        int32_t sinAcc = dsB[0];
+        int32_t cosAcc = dsB[1];
 
-        for (i = 0; i < FIX_BINS; i++)
+        for (int k = 0; k < count; k++)
         {
-            // First for the SIN then the COS.
-            int32_t val  = *(bins);
-            *(binsOut++) = val;
-            *(bins++) -= val >> DFT_IIR;
+            uint8_t localipl = place >> 8;
+            place += adv;
 
-            val          = *(bins);
-            *(binsOut++) = val;
-            *(bins++) -= val >> DFT_IIR;
+            sinAcc += Ssinonlytable[localipl] * filtered[k];
+            // Get the cosine (1/4 wavelength out-of-phase with sin)
+            cosAcc += Ssinonlytable[(uint8_t)(localipl + 64)] * filtered[k];
         }
-        return;
+
+        dsA[1] = place;
+        dsB[0] = sinAcc;
+        dsB[1] = cosAcc;
+        dsA += 2;
+        dsB += 2;
     }
+}
 
-    if ((oct * FIX_B_PER_O * 2) < (FIX_BINS * 2) && (oct <= OCTAVES))
+/**
+ * @brief Run every octave's pending decimated samples through its bins
+ *
+ * @param dd The DFT data
+ * @param pending The decimated samples for each octave
+ * @param numPending The number of decimated samples for each octave. These are reset to zero
+ */
+static void FlushOctaves32(dft32_data* dd, int16_t pending[OCTAVES][BIN_CYCLE / 2], uint8_t numPending[OCTAVES])
+{
+    for (uint8_t oct = 0; oct < OCTAVES; oct++)
     {
-        // process a filtered sample for one of the octaves
-        uint16_t* dsA               = &dd->sDatSpace32A[oct * FIX_B_PER_O * 2];
-        int32_t* dsB                = &dd->sDatSpace32B[oct * FIX_B_PER_O * 2];
-        int16_t filteredsample      = dd->sAccum_octave_bins[oct] >> (OCTAVES - oct);
-        dd->sAccum_octave_bins[oct] = 0;
-
-        for (i = 0; i < FIX_B_PER_O; i++)
+        if (numPending[oct])
         {
-            uint16_t adv     = *(dsA++);
-            uint8_t localipl = *(dsA) >> 8;
-            *(dsA++) += adv;
-
-            *(dsB++) += (Ssinonlytable[localipl] * filteredsample);
-            // Get the cosine (1/4 wavelength out-of-phase with sin)
-            localipl += 64;
-            *(dsB++) += (Ssinonlytable[localipl] * filteredsample);
+            UpdateOctave32(dd, oct, pending[oct], numPending[oct]);
+            numPending[oct] = 0;
         }
     }
 }
@@ -303,15 +336,69 @@ void UpdateBins32(dft32_data* dd, const uint16_t* frequencies)
 }
 
 /**
- * @brief TODO
+ * @brief Push one sample into the DFT. When there is a block of samples, PushSamples32() is faster
  *
- * @param dd
- * @param dat
+ * @param dd The DFT data
+ * @param dat The sample, from -4095 to +4095
  */
 void PushSample32(dft32_data* dd, int16_t dat)
 {
-    HandleInt(dd, dat);
-    HandleInt(dd, dat);
+    PushSamples32(dd, &dat, 1);
+}
+
+/**
+ * @brief Push a block of samples into the DFT.
+ *
+ * Each sample is run through the DFT twice. Every step, the sample is added to the running total, and one octave gets
+ * a decimated sample, the average of the samples since that octave was last updated. The highest octave is updated
+ * every other step, the next one down every fourth step, and so on. Once every ::BIN_CYCLE steps, all bins are copied
+ * to the output instead. Decimated samples are collected until then, and each octave's bins are run over all of them
+ * at once.
+ *
+ * @param dd The DFT data
+ * @param samples The samples, each from -4095 to +4095
+ * @param n The number of samples
+ */
+void PushSamples32(dft32_data* dd, const int16_t* samples, uint32_t n)
+{
+    // Decimated samples for each octave which haven't been run through its bins yet. No octave is updated more than
+    // every other step, so this holds everything between two snapshots
+    int16_t pending[OCTAVES][BIN_CYCLE / 2];
+    uint8_t numPending[OCTAVES] = {0};
+
+    // Keep the schedule position and running total in registers for the whole block
+    uint8_t place  = dd->sWhichOctavePlace;
+    uint32_t total = dd->sAccumTotal;
+
+    while (n--)
+    {
+        int16_t sample = *(samples++);
+        for (int rep = 0; rep < 2; rep++)
+        {
+            // The total wraps, but differences between totals are still correct
+            total += sample;
+
+            uint8_t oct = dd->Sdo_this_octave[place];
+            place       = (place + 1) & (BIN_CYCLE - 1);
+
+            if (oct > 128)
+            {
+                // Special: This is when we can update everything. Bring every bin up to date first
+                FlushOctaves32(dd, pending, numPending);
+                SnapshotBins32(dd);
+            }
+            else if (oct < OCTAVES)
+            {
+                // Decimate to this octave's rate by averaging everything since it was last updated
+                pending[oct][numPending[oct]++] = (int32_t)(total - dd->sOctaveTotal[oct]) >> (OCTAVES - oct);
+                dd->sOctaveTotal[oct]           = total;
+            }
+        }
+    }
+    FlushOctaves32(dd, pending, numPending);
+
+    dd->sWhichOctavePlace = place;
+    dd->sAccumTotal       = total;
 }
 
 #ifndef CC_EMBEDDED
@@ -375,8 +462,7 @@ void DoDFTProgressive32(dft32_data* dd, float* outBins, float* frequencies, int
     for (i = last_place; i != place_in_data_buffer; i = (i + 1) % size_of_data_buffer)
     {
         int16_t ifr1 = (int16_t)(((dataBuffer[i])) * 4095);
-        HandleInt(ifr1);
-        HandleInt(ifr1);
+        PushSample32(dd, ifr1);
     }
 
     UpdateOutputBins32();
@@ -387,3 +473,147 @@ void DoDFTProgressive32(dft32_data* dd, float* outBins, float* frequencies, int
 }
 
 #endif
+
+#ifdef ENABLE_BENCHMARKS
+
+/**
+ * @brief The per-sample DFT step from before PushSamples32(), kept so dft32Benchmark() has an independent reference.
+ * Every step updates one octave's bins with the average of the samples since its last update.
+ *
+ * @param dd The DFT data
+ * @param accum The sum of the samples since each octave was last updated
+ * @param sample The sample, from -4095 to +4095
+ */
+static void benchHandleInt(dft32_data* dd, int32_t accum[OCTAVES], int16_t sample)
+{
+    int i;
+
+    uint8_t oct = dd->Sdo_this_octave[dd->sWhichOctavePlace];
+    dd->sWhichOctavePlace++;
+    dd->sWhichOctavePlace &= BIN_CYCLE - 1;
+
+    for (i = 0; i < OCTAVES; i++)
+    {
+        accum[i] += sample;
+    }
+
+    if (oct > 128)
+    {
+        // Copy every bin to the output and decay it
+        int32_t* bins    = &dd->sDatSpace32B[0];
+        int32_t* binsOut = &dd->sDatSpace32BOut[0];
+
+        for (i = 0; i < FIX_BINS; i++)
+        {
+            // First for the SIN then the COS.
+            int32_t val  = *(bins);
+            *(binsOut++) = val;
+            *(bins++) -= val >> DFT_IIR;
+
+            val          = *(bins);
+            *(binsOut++) = val;
+            *(bins++) -= val >> DFT_IIR;
+        }
+        return;
+    }
+
+    if ((oct * FIX_B_PER_O * 2) < (FIX_BINS * 2) && (oct <= OCTAVES))
+    {
+        // process a filtered sample for one of the octaves
+        uint16_t* dsA          = &dd->sDatSpace32A[oct * FIX_B_PER_O * 2];
+        int32_t* dsB           = &dd->sDatSpace32B[oct * FIX_B_PER_O * 2];
+        int16_t filteredsample = accum[oct] >> (OCTAVES - oct);
+        accum[oct]             = 0;
+
+        for (i = 0; i < FIX_B_PER_O; i++)
+        {
+            uint16_t adv     = *(dsA++);
+            uint8_t localipl = *(dsA) >> 8;
+            *(dsA++) += adv;
+
+            *(dsB++) += (Ssinonlytable[localipl] * filteredsample);
+            // Get the cosine (1/4 wavelength out-of-phase with sin)
+            localipl += 64;
+            *(dsB++) += (Ssinonlytable[localipl] * filteredsample);
+        }
+    }
+}
+
+/**
+ * @brief Push ten seconds of a test tone through the old per-sample DFT step and through PushSamples32(), check that
+ * both give the same bins after every block, and print the throughput and the CPU load at ::D_FREQ
+ */
+void dft32Benchmark(void)
+{
+    static const uint16_t freqs[FIX_B_PER_O] = {
+        1316, 1394, 1477, 1565, 1658, 1757, 1861, 1972, 2089, 2213, 2345, 2484,
+        2632, 2789, 2954, 3130, 3316, 3513, 3722, 3943, 4178, 4426, 4689, 4968,
+    };
+
+    dft32_data* dds[2];
+    int64_t tTotals[2]     = {0};
+    int32_t accum[OCTAVES] = {0};
+    int16_t block[BENCH_BLOCK];
+    uint32_t phase           = 0;
+    int32_t mismatchedBlocks = 0;
+
+    for (int method = 0; method < 2; method++)
+    {
+        dds[method] = heap_caps_calloc(1, sizeof(dft32_data), MALLOC_CAP_8BIT);
+        SetupDFTProgressive32(dds[method]);
+        UpdateBins32(dds[method], freqs);
+    }
+
+    for (int32_t n = 0; n < BENCH_SECONDS * D_FREQ; n += BENCH_BLOCK)
+    {
+        // A sweeping tone, so every octave sees some signal
+        for (int32_t i = 0; i < BENCH_BLOCK; i++)
+        {
+            phase += 0x10000 + ((n + i) >> 3);
+            block[i] = Ssinonlytable[(phase >> 16) & 0xFF] * 2;
+        }
+
+        // The reference runs each sample through the step twice, like PushSample32() used to
+        int64_t tStart = esp_timer_get_time();
+        for (int32_t i = 0; i < BENCH_BLOCK; i++)
+        {
+            benchHandleInt(dds[0], accum, block[i]);
+            benchHandleInt(dds[0], accum, block[i]);
+        }
+        tTotals[0] += esp_timer_get_time() - tStart;
+
+        tStart = esp_timer_get_time();
+        PushSamples32(dds[1], block, BENCH_BLOCK);
+        tTotals[1] += esp_timer_get_time() - tStart;
+
+        UpdateOutputBins32(dds[0]);
+        UpdateOutputBins32(dds[1]);
+        if (memcmp(dds[0]->embeddedBins32, dds[1]->embeddedBins32, sizeof(dds[0]->embeddedBins32)))
+        {
+            mismatchedBlocks++;
+        }
+    }
+
+    static const char* const names[] = {"Per-sample reference", "PushSamples32"};
+    for (int method = 0; method < 2; method++)
+    {
+        int64_t tTotal = tTotals[method];
+        printf("%s: %d samples in %" PRId64 "us, %" PRId64 " samples/s, %" PRId64 ".%02" PRId64 "%% CPU at %dHz\n",
+               names[method], BENCH_SECONDS * D_FREQ, tTotal,
+               (tTotal > 0) ? (BENCH_SECONDS * D_FREQ * (int64_t)1000000) / tTotal : 0,
+               tTotal / (BENCH_SECONDS * 10000), (tTotal / (BENCH_SECONDS * 100)) % 100, D_FREQ);
+        heap_caps_free(dds[method]);
+    }
+
+    if (mismatchedBlocks)
+    {
+        printf("Bins DIFFER from the reference after %" PRId32 " of %d blocks\n", mismatchedBlocks,
+               (BENCH_SECONDS * D_FREQ + BENCH_BLOCK - 1) / BENCH_BLOCK);
+    }
+    else
+    {
+        printf("Bins match the reference after every block\n");
+    }
+}
+
+#endif
@@ -84,7 +84,10 @@ typedef struct
     // octaves we have, we only need to update FIX_B_PER_O*2 DFT bins.
     uint8_t Sdo_this_octave[BIN_CYCLE];
 
-    int32_t sAccum_octave_bins[OCTAVES];
+    // The running total of every sample pushed, and its value when each octave was last updated. The difference is
+    // the sum of the samples for that octave's next update
+    uint32_t sAccumTotal;
+    uint32_t sOctaveTotal[OCTAVES];
     uint8_t sWhichOctavePlace;
 
     uint16_t embeddedBins[FIX_BINS];
@@ -99,6 +102,10 @@ void UpdateBins32(dft32_data* dd, const uint16_t* frequencies);
 // Any more and you will exceed the accumulators and it will cause an overflow.
 void PushSample32(dft32_data* dd, int16_t dat);
 
+// Call this to push on a block of new frames of sound, with the same limits as PushSample32().
+// This is faster than calling PushSample32() for each sample.
+void PushSamples32(dft32_data* dd, const int16_t* samples, uint32_t n);
+
 #ifndef CC_EMBEDDED
 // ColorChord regular uses this to pass in floats.
 void UpdateBinsForDFT32(dft32_data* dd, const float* frequencies); // Update the frequencies
@@ -108,4 +115,9 @@ void UpdateBinsForDFT32(dft32_data* dd, const float* frequencies); // Update the
 // embeddedBins32.
 void UpdateOutputBins32(dft32_data* dd);
 
+#ifdef ENABLE_BENCHMARKS
+// Measure how fast samples can be pushed in blocks, against the old per-sample step
+void dft32Benchmark(void);
+#endif
+
 #endif
@@ -0,0 +1,478 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <string.h>
+#include "pitchDetect.h"
+
+#ifdef ENABLE_BENCHMARKS
+    #include <stdio.h>
+    #include <inttypes.h>
+    #include <math.h>
+    #include <esp_timer.h>
+#endif
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// Samples are scaled down below this before being compared, so a window of squared differences fits in 32 bits
+#define PD_MAX_SCALED 1024
+
+/// Short periods are measured across a span of several periods at least this long, in microphone samples
+#define PD_REFINE_LAG 64
+
+#ifdef ENABLE_BENCHMARKS
+    /// How long pitchDetectBenchmark() plays each note, in milliseconds
+    #define BENCH_NOTE_MS 500
+    /// The number of samples pitchDetectBenchmark() pushes at once
+    #define BENCH_BLOCK 128
+    /// The number of analyses of each note pitchDetectBenchmark() skips before measuring accuracy
+    #define BENCH_SETTLE 3
+    /// Errors larger than this are counted as wrong notes instead of inaccuracy
+    #define BENCH_WRONG_CENTS 50
+#endif
+
+//==============================================================================
+// Const Variables
+//==============================================================================
+
+/// log2(1 + i / 64), with 16 fractional bits
+static const uint32_t log2Table[65] = {
+    0,     1466,  2909,  4331,  5732,  7112,  8473,  9814,  11136, 12440, 13727, 14996, 16248,
+    17484, 18704, 19909, 21098, 22272, 23433, 24579, 25711, 26830, 27936, 29029, 30109, 31178,
+    32234, 33279, 34312, 35334, 36346, 37346, 38336, 39316, 40286, 41246, 42196, 43137, 44068,
+    44990, 45904, 46809, 47705, 48593, 49472, 50344, 51207, 52063, 52911, 53751, 54584, 55410,
+    56229, 57040, 57845, 58643, 59434, 60219, 60997, 61769, 62534, 63294, 64047, 64794, 65536,
+};
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static inline uint32_t pitchDetectDiff(const int16_t* samples, uint16_t len, uint16_t lag);
+static uint32_t pitchDetectRefine(const int16_t* samples, uint16_t len, uint16_t center, uint32_t* minDiff);
+static void pitchDetectAnalyze(pitchDetect_t* pd);
+static int32_t log2Q16(uint32_t xQ16);
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Initialize a pitch detector
+ *
+ * @param pd The pitch detector to initialize
+ * @param minHz The lowest frequency to look for. This is raised to ::PD_MIN_HZ if it is lower
+ * @param maxHz The highest frequency to look for. Higher notes are detected less precisely, and lower values of
+ * minHz let the detector respond faster
+ */
+void pitchDetectInit(pitchDetect_t* pd, uint16_t minHz, uint16_t maxHz)
+{
+    memset(pd, 0, sizeof(pitchDetect_t));
+
+    // Interpolation needs one delay on either side of the best one
+    pd->minLag = (maxHz > 0) ? PD_RATE / maxHz : 0;
+    if (pd->minLag < 2)
+    {
+        pd->minLag = 2;
+    }
+
+    pd->maxLag = (minHz > PD_MIN_HZ) ? PD_RATE / minHz : PD_MAX_LAG;
+    if (pd->maxLag > PD_MAX_LAG)
+    {
+        pd->maxLag = PD_MAX_LAG;
+    }
+    if (pd->maxLag <= pd->minLag)
+    {
+        pd->maxLag = pd->minLag + 1;
+    }
+}
+
+/**
+ * @brief Discard all buffered samples and the last result, i.e. when the microphone is turned back on
+ *
+ * @param pd The pitch detector to reset
+ */
+void pitchDetectReset(pitchDetect_t* pd)
+{
+    pd->bufLen = 0;
+    memset(&pd->result, 0, sizeof(pitchResult_t));
+}
+
+/**
+ * @brief Push a block of microphone samples into a pitch detector, and analyze them when enough have been collected
+ *
+ * @param pd The pitch detector to push samples to
+ * @param samples Samples from the microphone, at ::D_FREQ
+ * @param n The number of samples
+ * @return true if ::pitchDetect_t.result was updated, false if not
+ */
+bool pitchDetectPush(pitchDetect_t* pd, const int16_t* samples, uint32_t n)
+{
+    bool updated = false;
+    while (n)
+    {
+        uint32_t count = PD_BUF_LEN - pd->bufLen;
+        if (count > n)
+        {
+            count = n;
+        }
+        memcpy(&pd->buf[pd->bufLen], samples, count * sizeof(int16_t));
+        pd->bufLen += count;
+        samples += count;
+        n -= count;
+
+        if (PD_BUF_LEN == pd->bufLen)
+        {
+            pitchDetectAnalyze(pd);
+            updated = true;
+
+            // Keep the overlap for the next analysis
+            memmove(pd->buf, &pd->buf[PD_HOP * PD_DECIMATION], (PD_BUF_LEN - PD_HOP * PD_DECIMATION) * sizeof(int16_t));
+            pd->bufLen -= PD_HOP * PD_DECIMATION;
+        }
+    }
+    return updated;
+}
+
+/**
+ * @brief Sum the squared differences between a window of samples and a delayed copy of it
+ *
+ * @param samples The samples, which must extend lag samples past the window
+ * @param len The length of the window
+ * @param lag The delay
+ * @return The sum of squared differences
+ */
+static inline uint32_t pitchDetectDiff(const int16_t* samples, uint16_t len, uint16_t lag)
+{
+    const int16_t* delayed = &samples[lag];
+    uint32_t sum           = 0;
+    for (uint16_t i = 0; i < len; i++)
+    {
+        int32_t d = samples[i] - delayed[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+/**
+ * @brief Find the delay between samples where the difference between a window of full rate samples and a delayed copy
+ * of it is smallest, near a given delay
+ *
+ * @param samples The samples, which must extend ::PD_DECIMATION samples past the window and center
+ * @param len The length of the window
+ * @param center The delay to search around, which must be more than ::PD_DECIMATION
+ * @param minDiff [out] The smallest sum of squared differences
+ * @return The best delay, with 16 fractional bits
+ */
+static uint32_t pitchDetectRefine(const int16_t* samples, uint16_t len, uint16_t center, uint32_t* minDiff)
+{
+    uint16_t lo = center - PD_DECIMATION;
+    uint16_t hi = center + PD_DECIMATION;
+    uint32_t diffs[2 * PD_DECIMATION + 1];
+    uint16_t best = lo + 1;
+    for (uint16_t lag = lo; lag <= hi; lag++)
+    {
+        diffs[lag - lo] = pitchDetectDiff(samples, len, lag);
+        if (lag > lo && lag < hi && diffs[lag - lo] < diffs[best - lo])
+        {
+            best = lag;
+        }
+    }
+    *minDiff = diffs[best - lo];
+
+    // Fit a parabola through the differences around the best delay to find the delay between samples
+    int64_t a      = diffs[best - lo - 1];
+    int64_t b      = diffs[best - lo];
+    int64_t c      = diffs[best - lo + 1];
+    int64_t curve  = a - 2 * b + c;
+    int32_t offset = 0;
+    if (curve > 0)
+    {
+        offset = ((a - c) << 15) / curve;
+        if (offset > 32768)
+        {
+            offset = 32768;
+        }
+        else if (offset < -32768)
+        {
+            offset = -32768;
+        }
+    }
+    return ((uint32_t)best << 16) + offset;
+}
+
+/**
+ * @brief Find the period of a full buffer of samples and write it to ::pitchDetect_t.result
+ *
+ * @param pd The pitch detector to analyze
+ */
+static void pitchDetectAnalyze(pitchDetect_t* pd)
+{
+    pitchResult_t* res = &pd->result;
+    res->analyses++;
+    res->voiced = false;
+
+    // Only the newest samples are needed when looking for shorter periods
+    uint16_t maxLag      = pd->maxLag;
+    uint16_t len         = (PD_WINDOW + maxLag + 2) * PD_DECIMATION;
+    const int16_t* input = &pd->buf[PD_BUF_LEN - len];
+
+    uint16_t peak = 0;
+    for (uint16_t i = 0; i < len; i++)
+    {
+        uint16_t mag = (input[i] < 0) ? -input[i] : input[i];
+        if (mag > peak)
+        {
+            peak = mag;
+        }
+    }
+    res->level = peak;
+    if (peak < PD_MIN_LEVEL)
+    {
+        return;
+    }
+
+    // Scale the samples down so the sums of squared differences can't overflow
+    uint8_t shift = 0;
+    while ((peak >> shift) >= PD_MAX_SCALED)
+    {
+        shift++;
+    }
+    int16_t* scaled = pd->scaled;
+    int16_t* decim  = pd->decim;
+    for (uint16_t i = 0; i < len; i += PD_DECIMATION)
+    {
+        int32_t sum = 0;
+        for (uint16_t j = i; j < i + PD_DECIMATION; j++)
+        {
+            scaled[j] = input[j] >> shift;
+            sum += scaled[j];
+        }
+        decim[i / PD_DECIMATION] = sum / PD_DECIMATION;
+    }
+
+    // Compare the decimated window with delayed copies of itself. This is where most of the time goes
+    uint32_t* diff = pd->diff;
+    diff[0]        = 0;
+    for (uint16_t lag = 1; lag <= maxLag + 1; lag++)
+    {
+        diff[lag] = pitchDetectDiff(decim, PD_WINDOW, lag);
+    }
+
+    // Normalize each difference by the mean of the differences for shorter delays, so that delays near zero don't
+    // look like good matches
+    uint16_t* normDiff = pd->normDiff;
+    normDiff[0]        = PD_ONE;
+    uint32_t running   = 0;
+    for (uint16_t lag = 1; lag <= maxLag + 1; lag++)
+    {
+        running += diff[lag];
+        uint64_t norm = (0 == running) ? PD_ONE : (((uint64_t)diff[lag] * lag) << 15) / running;
+        normDiff[lag] = (norm > UINT16_MAX) ? UINT16_MAX : norm;
+    }
+
+    // Take the first dip below the threshold, which is the fundamental rather than a multiple of it. If there isn't
+    // one, fall back to the best dip
+    uint16_t best = 0;
+    for (uint16_t lag = pd->minLag; lag <= maxLag; lag++)
+    {
+        if (normDiff[lag] < PD_THRESHOLD)
+        {
+            // Follow the dip down to its bottom
+            while (lag < maxLag && normDiff[lag + 1] < normDiff[lag])
+            {
+                lag++;
+            }
+            best = lag;
+            break;
+        }
+        else if (0 == best || normDiff[lag] < normDiff[best])
+        {
+            best = lag;
+        }
+    }
+
+    res->clarity = (normDiff[best] >= PD_ONE) ? 0 : PD_ONE - normDiff[best];
+    if (normDiff[best] >= PD_UNVOICED_THRESHOLD)
+    {
+        return;
+    }
+
+    // The decimated period is only accurate to a decimated sample, so search around it at the full sample rate
+    uint32_t window   = PD_WINDOW * PD_DECIMATION;
+    uint32_t minDiff  = 0;
+    uint32_t periodQ16 = pitchDetectRefine(scaled, window, best * PD_DECIMATION, &minDiff);
+
+    // Decimation blurs short periods, so the coarse search may have found two periods instead of one. Halve the period
+    // for as long as that still matches nearly as well as an exact copy. Random samples differ by twice their energy
+    uint32_t energy = 0;
+    for (uint16_t i = 0; i < window; i++)
+    {
+        energy += scaled[i] * scaled[i];
+    }
+    uint32_t matchDiff = ((uint64_t)energy * 2 * PD_THRESHOLD) >> 15;
+    while ((periodQ16 >> 17) >= (uint32_t)(pd->minLag + 1) * PD_DECIMATION)
+    {
+        uint32_t halfDiff = 0;
+        uint32_t halfQ16  = pitchDetectRefine(scaled, window, (periodQ16 + (1 << 16)) >> 17, &halfDiff);
+        if (halfDiff > matchDiff)
+        {
+            break;
+        }
+        periodQ16 = halfQ16;
+    }
+
+    // The interpolated period is least accurate for high notes, which have short periods. Measure a span of several
+    // periods instead, which has the same error spread over all of them
+    uint32_t periods = ((uint32_t)PD_REFINE_LAG << 16) / periodQ16;
+    if (periods > 1)
+    {
+        uint32_t center = (periodQ16 * periods + (1 << 15)) >> 16;
+        if (center + PD_DECIMATION <= (uint32_t)(maxLag + 1) * PD_DECIMATION)
+        {
+            periodQ16 = pitchDetectRefine(scaled, window, center, &minDiff) / periods;
+        }
+    }
+
+    res->voiced  = true;
+    res->freqQ16 = (((uint64_t)D_FREQ) << 32) / periodQ16;
+
+    // cents = 6900 + 1200 * log2(freq / 440), with the frequency in Hz being D_FREQ / period
+    int32_t octavesFromA4 = log2Q16(D_FREQ << 16) - log2Q16(periodQ16) - log2Q16(440 << 16);
+    res->cents            = 6900 + (int32_t)((1200 * (int64_t)octavesFromA4 + 32768) >> 16);
+}
+
+/**
+ * @brief Find the base 2 logarithm of a fixed point number
+ *
+ * @param xQ16 A positive number with 16 fractional bits
+ * @return The base 2 logarithm of xQ16, with 16 fractional bits. This is accurate to about 1/20 of a cent
+ */
+static int32_t log2Q16(uint32_t xQ16)
+{
+    // The integer part is the position of the highest set bit
+    int32_t msb = 31 - __builtin_clz(xQ16);
+
+    // Interpolate the fractional part from the table using the bits after the highest set bit
+    uint32_t mantissa = (xQ16 << (31 - msb)) << 1;
+    uint32_t idx      = mantissa >> 26;
+    uint32_t frac     = (mantissa >> 10) & 0xFFFF;
+    uint32_t lo       = log2Table[idx];
+    uint32_t hi       = log2Table[idx + 1];
+
+    return ((msb - 16) << 16) + lo + (((hi - lo) * frac) >> 16);
+}
+
+#ifdef ENABLE_BENCHMARKS
+
+/**
+ * @brief Play synthetic notes across the range of the tuner through a pitch detector, and print how accurate the
+ * detected pitches were, how long the detector took to lock on, and how much CPU time it used at ::D_FREQ
+ */
+void pitchDetectBenchmark(void)
+{
+    static pitchDetect_t pd;
+    pitchDetectInit(&pd, 70, 1000);
+
+    int16_t block[BENCH_BLOCK];
+    uint32_t rng       = 0x12345678;
+    int64_t tTotal     = 0;
+    uint32_t samples   = 0;
+    uint32_t analyses  = 0;
+    uint32_t measured  = 0;
+    uint32_t unvoiced  = 0;
+    uint32_t wrong     = 0;
+    float sumAbsErr    = 0;
+    float maxAbsErr    = 0;
+    uint32_t lockTotal = 0;
+    uint32_t locked    = 0;
+
+    // From E2, the lowest guitar string, to E5, the highest violin string, each a little out of tune
+    const int firstNote = 40;
+    const int lastNote  = 76;
+    for (int note = firstNote; note <= lastNote; note++)
+    {
+        float detune = ((note * 37) % 61) - 30;
+        float freq   = 440.0f * powf(2.0f, (note - 69 + detune / 100.0f) / 12.0f);
+        float phase  = 0;
+
+        pitchDetectReset(&pd);
+        uint32_t noteAnalyses = 0;
+        int32_t lockSamples   = -1;
+        for (int32_t n = 0; n < BENCH_NOTE_MS * D_FREQ / 1000; n += BENCH_BLOCK)
+        {
+            // A plucked string has a lot of harmonics, and the microphone adds some noise
+            for (int32_t i = 0; i < BENCH_BLOCK; i++)
+            {
+                phase += 2 * (float)M_PI * freq / D_FREQ;
+                float s = 0;
+                for (int h = 1; h <= 5; h++)
+                {
+                    s += sinf(phase * h) / h;
+                }
+                rng      = rng * 1664525 + 1013904223;
+                block[i] = s * 6000 + (int16_t)(rng >> 16) / 64;
+            }
+
+            int64_t tStart = esp_timer_get_time();
+            bool updated   = pitchDetectPush(&pd, block, BENCH_BLOCK);
+            tTotal += esp_timer_get_time() - tStart;
+            samples += BENCH_BLOCK;
+
+            if (!updated)
+            {
+                continue;
+            }
+            analyses++;
+            noteAnalyses++;
+
+            float err = pd.result.voiced ? 1200 * log2f(pd.result.freqQ16 / 65536.0f / freq) : 0;
+            if (lockSamples < 0 && pd.result.voiced && fabsf(err) < 5)
+            {
+                lockSamples = n + BENCH_BLOCK;
+            }
+
+            // Only score windows which are entirely inside the note
+            if (noteAnalyses > BENCH_SETTLE)
+            {
+                measured++;
+                if (!pd.result.voiced)
+                {
+                    unvoiced++;
+                }
+                else if (fabsf(err) > BENCH_WRONG_CENTS)
+                {
+                    wrong++;
+                }
+                else
+                {
+                    sumAbsErr += fabsf(err);
+                    if (fabsf(err) > maxAbsErr)
+                    {
+                        maxAbsErr = fabsf(err);
+                    }
+                }
+            }
+        }
+
+        if (lockSamples >= 0)
+        {
+            lockTotal += lockSamples;
+            locked++;
+        }
+    }
+
+    uint32_t scored = measured - unvoiced - wrong;
+    printf("Pitch: %" PRIu32 " windows, %" PRIu32 " unvoiced, %" PRIu32 " wrong notes, mean error %.2f cents, max "
+           "%.2f cents\n",
+           measured, unvoiced, wrong, scored ? sumAbsErr / scored : 0, maxAbsErr);
+    printf("Pitch: locked within 5 cents after %" PRIu32 "ms on average, %" PRIu32 " notes never locked\n",
+           locked ? lockTotal * 1000 / D_FREQ / locked : 0, lastNote - firstNote + 1 - locked);
+    printf("Pitch: %" PRId64 "us per analysis, %" PRId64 ".%02" PRId64 "%% CPU at %dHz\n",
+           analyses ? tTotal / analyses : 0, (tTotal * 100 * D_FREQ / 1000000) / samples,
+           ((tTotal * 10000 * D_FREQ / 1000000) / samples) % 100, D_FREQ);
+}
+
+#endif
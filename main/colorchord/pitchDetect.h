@@ -0,0 +1,136 @@
+/*! \file pitchDetect.h
+ *
+ * \section pitchDetect_design Design Philosophy
+ *
+ * This is a fixed-point implementation of the YIN pitch detector, for when a single note needs to be measured
+ * precisely. The colorchord DFT in DFT32.h is better for showing every note at once, but its bins are a quarter tone
+ * apart and heavily smoothed, so it can't tell a few cents apart and takes a while to respond.
+ *
+ * Microphone samples are collected into a window, and every ::PD_HOP decimated samples the window is analyzed. First,
+ * a copy decimated by ::PD_DECIMATION is compared against delayed copies of itself. The delay where the two match best
+ * is roughly the period of the note. That period is then searched around at the full sample rate, checked for being a
+ * multiple of the real period, and refined between samples with parabolic interpolation. Short periods are measured
+ * across several periods at once, so high notes are as precise as low ones. Finally the period is converted to a
+ * frequency and to cents.
+ *
+ * The result is ready at most ::PD_LATENCY_MS after a note starts, and is updated every ::PD_HOP_MS after that. Most of
+ * the cost of an analysis is ::PD_WINDOW multiply-adds per decimated sample in the period of the lowest note. Build
+ * the emulator with <tt>make ENABLE_BENCHMARKS=true</tt> and run <tt>bench pitch</tt> in its console to measure accuracy
+ * and CPU time with synthetic notes with pitchDetectBenchmark(), or use the \c pitch console command to run a recording
+ * through the detector.
+ *
+ * \section pitchDetect_usage Usage
+ *
+ * Call pitchDetectInit() with the range of frequencies to look for. Then call pitchDetectPush() with blocks of
+ * microphone samples from the ::swadgeMode_t.fnAudioCallback. It returns true whenever ::pitchDetect_t.result was
+ * updated.
+ *
+ * ::pitchResult_t.cents is the pitch relative to MIDI note 0, so \c cents / 100 is the nearest MIDI note and
+ * \c cents % 100 is how far off it the note is. Only use the result when ::pitchResult_t.voiced is true.
+ *
+ * \section pitchDetect_example Example
+ *
+ * \code{.c}
+ * static pitchDetect_t pd;
+ *
+ * void enterMode(void)
+ * {
+ *     pitchDetectInit(&pd, 70, 1000);
+ * }
+ *
+ * void audioCallback(uint16_t* samples, uint32_t sampleCnt)
+ * {
+ *     if (pitchDetectPush(&pd, (const int16_t*)samples, sampleCnt) && pd.result.voiced)
+ *     {
+ *         int32_t note  = (pd.result.cents + 50) / 100;
+ *         int32_t error = pd.result.cents - note * 100;
+ *         // Show how far error is from 0
+ *     }
+ * }
+ * \endcode
+ */
+
+#ifndef _PITCH_DETECT_H_
+#define _PITCH_DETECT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ccconfig.h"
+
+/// The number of microphone samples averaged into each analyzed sample
+#define PD_DECIMATION 2
+
+/// The sample rate of the analyzed samples, in Hz
+#define PD_RATE (D_FREQ / PD_DECIMATION)
+
+/// The lowest frequency which can be detected, in Hz
+#define PD_MIN_HZ 50
+
+/// The longest period which can be detected, in decimated samples
+#define PD_MAX_LAG (PD_RATE / PD_MIN_HZ)
+
+/// The number of decimated samples compared for each delay
+#define PD_WINDOW 128
+
+/// The number of decimated samples between analyses
+#define PD_HOP 64
+
+/// The number of microphone samples needed for an analysis
+#define PD_BUF_LEN ((PD_WINDOW + PD_MAX_LAG + 2) * PD_DECIMATION)
+
+/// The time between analyses, in milliseconds
+#define PD_HOP_MS (PD_HOP * 1000 / PD_RATE)
+
+/// The longest time from a note starting until it is detected, in milliseconds
+#define PD_LATENCY_MS ((PD_BUF_LEN + PD_HOP * PD_DECIMATION) * 1000 / D_FREQ)
+
+/// The fixed-point value of 1.0 for ::pitchResult_t.clarity and thresholds
+#define PD_ONE 32768
+
+/// The dip in the normalized difference which is accepted as the period, out of ::PD_ONE
+#define PD_THRESHOLD (PD_ONE * 15 / 100)
+
+/// Anything with no dip in the normalized difference below this, out of ::PD_ONE, is noise
+#define PD_UNVOICED_THRESHOLD (PD_ONE * 40 / 100)
+
+/// Windows with no sample louder than this are silence
+#define PD_MIN_LEVEL 256
+
+/**
+ * @brief The pitch measured from one window of samples
+ */
+typedef struct
+{
+    bool voiced;       ///< true if a note was detected, false if the window was silence or noise
+    uint32_t freqQ16;  ///< The frequency of the note in Hz, with 16 fractional bits
+    int32_t cents;     ///< The pitch of the note in cents above MIDI note 0, i.e. 6900 is A4 at 440Hz
+    uint16_t clarity;  ///< How periodic the window was, from 0 for noise to ::PD_ONE for a pure tone
+    uint16_t level;    ///< The largest absolute sample value in the window
+    uint32_t analyses; ///< The number of analyses run, which increments each time this is written
+} pitchResult_t;
+
+/**
+ * @brief The state of a pitch detector
+ */
+typedef struct
+{
+    int16_t buf[PD_BUF_LEN];                   ///< Microphone samples waiting to be analyzed, oldest first
+    uint16_t bufLen;                           ///< The number of samples in buf
+    uint16_t minLag;                           ///< The shortest period to look for, in decimated samples
+    uint16_t maxLag;                           ///< The longest period to look for, in decimated samples
+    int16_t scaled[PD_BUF_LEN];                ///< buf, scaled down so differences can't overflow
+    int16_t decim[PD_BUF_LEN / PD_DECIMATION]; ///< scaled, decimated by ::PD_DECIMATION
+    uint32_t diff[PD_MAX_LAG + 2];             ///< The sum of squared differences for each decimated delay
+    uint16_t normDiff[PD_MAX_LAG + 2];         ///< diff normalized by its running mean, out of ::PD_ONE
+    pitchResult_t result;                      ///< The most recent result
+} pitchDetect_t;
+
+void pitchDetectInit(pitchDetect_t* pd, uint16_t minHz, uint16_t maxHz);
+void pitchDetectReset(pitchDetect_t* pd);
+bool pitchDetectPush(pitchDetect_t* pd, const int16_t* samples, uint32_t n);
+
+#ifdef ENABLE_BENCHMARKS
+void pitchDetectBenchmark(void);
+#endif
+
+#endif
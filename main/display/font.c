@@ -33,6 +33,8 @@ static void drawCharBoundsPrivate(paletteColor_t color, paletteColor_t middleCol
                                   const font_ch_t* ch, int16_t xOff, int16_t yOff, int16_t xMin, int16_t yMin,
                                   int16_t xMax, int16_t yMax);
 
+static void makeOutlineFontInternal(font_t* srcFont, font_t* dstFont, bool spiRam, arena_t* arena);
+
 //==============================================================================
 // Variables
 //==============================================================================
@@ -609,13 +611,41 @@ static void setFontPx(font_ch_t* ch, int16_t x, int16_t y, bool isSet)
 }
 
 /**
- * @brief Create the outline of a font as a separate font
+ * @brief Create the outline of a font as a separate font. Fonts which are always drawn with an outline should be
+ * processed with their outline instead, and loaded with loadFontFamily(), which is much faster and takes less RAM
  *
  * @param srcFont The source font to make an outline of
  * @param dstFont The destination font that will be initialized as an outline of the source font
  * @param spiRam true to allocate memory in SPI RAM, false to allocate memory in normal RAM
  */
 void makeOutlineFont(font_t* srcFont, font_t* dstFont, bool spiRam)
+{
+    makeOutlineFontInternal(srcFont, dstFont, spiRam, NULL);
+}
+
+/**
+ * @brief Create the outline of a font as a separate font, allocated from an arena. The outline is released with the
+ * arena, so it must not be freed with freeFont()
+ *
+ * @param srcFont The source font to make an outline of
+ * @param dstFont The destination font that will be initialized as an outline of the source font
+ * @param arena The arena to allocate the outline bitmaps from, i.e. getModeArena()
+ */
+void makeOutlineFontArena(font_t* srcFont, font_t* dstFont, arena_t* arena)
+{
+    makeOutlineFontInternal(srcFont, dstFont, true, arena);
+}
+
+/**
+ * @brief Create the outline of a font in either the heap or an arena
+ *
+ * @param srcFont The source font to make an outline of
+ * @param dstFont The destination font that will be initialized as an outline of the source font
+ * @param spiRam true to allocate memory in SPI RAM, false to allocate memory in normal RAM. Ignored if arena is not
+ * NULL
+ * @param arena The arena to allocate the outline bitmaps from, or NULL to allocate them from the heap
+ */
+static void makeOutlineFontInternal(font_t* srcFont, font_t* dstFont, bool spiRam, arena_t* arena)
 {
     // Set up calloc flags
     uint32_t callocFlags = MALLOC_CAP_DEFAULT;
@@ -640,7 +670,14 @@ void makeOutlineFont(font_t* srcFont, font_t* dstFont, bool spiRam)
         // Allocate space for the outline bitmap
         int pixels  = dstFont->height * oCh->width;
         int bytes   = (pixels / 8) + ((pixels % 8 == 0) ? 0 : 1);
-        oCh->bitmap = heap_caps_calloc(bytes, sizeof(uint8_t), callocFlags);
+        if (NULL != arena)
+        {
+            oCh->bitmap = arenaCalloc(arena, bytes, sizeof(uint8_t));
+        }
+        else
+        {
+            oCh->bitmap = heap_caps_calloc(bytes, sizeof(uint8_t), callocFlags);
+        }
 
         for (int16_t y = 0; y < dstFont->height; y++)
         {
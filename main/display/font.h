@@ -47,6 +47,7 @@
 #include <stdbool.h>
 
 #include "palette.h"
+#include "arena.h"
 
 /**
  * @brief A character used in a font_t. Each character is a bitmap with the same height as the other characters in the
@@ -93,6 +94,7 @@ uint16_t textWidth(const font_t* font, const char* text);
 uint16_t textWordWrapHeight(const font_t* font, const char* text, int16_t width, int16_t maxHeight);
 
 void makeOutlineFont(font_t* srcFont, font_t* dstFont, bool spiRam);
+void makeOutlineFontArena(font_t* srcFont, font_t* dstFont, arena_t* arena);
 int16_t drawTextMarquee(const font_t* font, paletteColor_t color, const char* text, int16_t xOff, int16_t yOff,
                         int16_t xMax, int32_t* timer);
 bool drawTextEllipsize(const font_t* font, paletteColor_t color, const char* text, int16_t xOff, int16_t yOff,
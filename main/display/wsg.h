@@ -5,7 +5,9 @@
  * WSG is a simple image format developed for Swadge sprites.
  * Each pixel in a WSG is from the web-safe palette of colors, with one extra value indicating transparent
  * (::paletteColor_t). The pixels are then compressed with <a
- * href="https://github.com/atomicobject/heatshrink">heatshrink compression</a>.
+ * href="https://github.com/lz4/lz4">LZ4</a>, which is fast to decompress, or <a
+ * href="https://github.com/atomicobject/heatshrink">heatshrink compression</a>, depending on how the asset preprocessor
+ * is configured.
  *
  * WSGs are handled individually, not in a sheet.
  * The \c assets_preprocessor program will take PNG files and convert them to WSG.
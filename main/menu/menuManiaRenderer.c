@@ -102,8 +102,7 @@ menuManiaRenderer_t* initMenuManiaRenderer(font_t* titleFont, font_t* titleFontO
     // Save or allocate title font
     if (NULL == titleFont)
     {
-        renderer->titleFont = heap_caps_calloc(1, sizeof(font_t), MALLOC_CAP_SPIRAM);
-        loadFont(RIGHTEOUS_150_FONT, renderer->titleFont, true);
+        renderer->titleFont          = heap_caps_calloc(1, sizeof(font_t), MALLOC_CAP_SPIRAM);
         renderer->titleFontAllocated = true;
     }
     else
@@ -115,8 +114,7 @@ menuManiaRenderer_t* initMenuManiaRenderer(font_t* titleFont, font_t* titleFontO
     // Save or allocate title font outline
     if (NULL == titleFontOutline)
     {
-        renderer->titleFontOutline = heap_caps_calloc(1, sizeof(font_t), MALLOC_CAP_SPIRAM);
-        makeOutlineFont(renderer->titleFont, renderer->titleFontOutline, true);
+        renderer->titleFontOutline          = heap_caps_calloc(1, sizeof(font_t), MALLOC_CAP_SPIRAM);
         renderer->titleFontOutlineAllocated = true;
     }
     else
@@ -125,6 +123,28 @@ menuManiaRenderer_t* initMenuManiaRenderer(font_t* titleFont, font_t* titleFontO
         renderer->titleFontOutlineAllocated = false;
     }
 
+    // Load the title font and its outline together, unless either was given
+    renderer->titleFontOutlineMapped = false;
+    if (renderer->titleFontAllocated && renderer->titleFontOutlineAllocated)
+    {
+        // The outline was made when the font was processed, and is used from ROM
+        renderer->titleFontOutlineMapped
+            = loadFontFamily(RIGHTEOUS_150_FONT, renderer->titleFont, renderer->titleFontOutline, true);
+    }
+
+    // Otherwise, or if the font has no outline, load the font and make the outline from it
+    if (!renderer->titleFontOutlineMapped)
+    {
+        if (renderer->titleFontAllocated)
+        {
+            loadFont(RIGHTEOUS_150_FONT, renderer->titleFont, true);
+        }
+        if (renderer->titleFontOutlineAllocated)
+        {
+            makeOutlineFont(renderer->titleFont, renderer->titleFontOutline, true);
+        }
+    }
+
     // Save or allocate menu font
     if (NULL == menuFont)
     {
@@ -138,11 +158,10 @@ menuManiaRenderer_t* initMenuManiaRenderer(font_t* titleFont, font_t* titleFontO
         renderer->menuFontAllocated = false;
     }
 
-    // Load battery images
-    loadWsg(BATT_1_WSG, &renderer->batt[0], false);
-    loadWsg(BATT_2_WSG, &renderer->batt[1], false);
-    loadWsg(BATT_3_WSG, &renderer->batt[2], false);
-    loadWsg(BATT_4_WSG, &renderer->batt[3], false);
+    // Use battery images from flash, or load them to RAM if they can't be mapped
+    const cnfsFileIdx_t battIdxs[] = {BATT_1_WSG, BATT_2_WSG, BATT_3_WSG, BATT_4_WSG};
+    wsg_t* const batts[]           = {&renderer->batt[0], &renderer->batt[1], &renderer->batt[2], &renderer->batt[3]};
+    renderer->battMapped           = loadMenuWsgs(battIdxs, batts, ARRAY_SIZE(battIdxs), false);
 
     // Initialize LEDs
     setLeds(renderer->leds, CONFIG_NUM_LEDS);
@@ -183,10 +202,14 @@ menuManiaRenderer_t* initMenuManiaRenderer(font_t* titleFont, font_t* titleFontO
  */
 void deinitMenuManiaRenderer(menuManiaRenderer_t* renderer)
 {
-    freeWsg(&renderer->batt[0]);
-    freeWsg(&renderer->batt[1]);
-    freeWsg(&renderer->batt[2]);
-    freeWsg(&renderer->batt[3]);
+    // Battery images used from flash aren't freed
+    if (!renderer->battMapped)
+    {
+        for (int i = 0; i < ARRAY_SIZE(renderer->batt); i++)
+        {
+            freeWsg(&renderer->batt[i]);
+        }
+    }
 
     // Free fonts if allocated
     if (renderer->titleFontAllocated)
@@ -196,7 +219,11 @@ void deinitMenuManiaRenderer(menuManiaRenderer_t* renderer)
     }
     if (renderer->titleFontOutlineAllocated)
     {
-        freeFont(renderer->titleFontOutline);
+        // An outline used from ROM has nothing else to free
+        if (!renderer->titleFontOutlineMapped)
+        {
+            freeFont(renderer->titleFontOutline);
+        }
         heap_caps_free(renderer->titleFontOutline);
     }
     if (renderer->menuFontAllocated)
@@ -64,10 +64,14 @@ typedef struct
                                     ///< deinitMenuManiaRenderer()
     bool titleFontOutlineAllocated; ///< true if this font was allocated by the renderer and should be freed by
                                     ///< deinitMenuManiaRenderer()
+    bool titleFontOutlineMapped;    ///< true if the outline's bitmaps are used from ROM, so only the font_t is
+                                    ///< freed
     bool menuFontAllocated;         ///< true if this font was allocated by the renderer and should be freed by
                                     ///< deinitMenuManiaRenderer()
     led_t leds[CONFIG_NUM_LEDS];    ///< An array with the RGB LED state to be output
     wsg_t batt[4];                  ///< Images for the battery levels
+    bool battMapped;                ///< true if the battery images are used from ROM, false if they were loaded to RAM
+                                    ///< and must be freed
 
     maniaRing_t rings[2];
     bool drawRings;
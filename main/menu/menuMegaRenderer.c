@@ -67,22 +67,22 @@ menuMegaRenderer_t* initMenuMegaRenderer(font_t* titleFont, font_t* titleFontOut
     renderer->bgColors    = defaultBgColors;
     renderer->numBgColors = ARRAY_SIZE(defaultBgColors);
 
-    loadWsg(MMM_BACK_WSG, &renderer->back, true);
-    loadWsg(MMM_BG_WSG, &renderer->bg, true);
-    loadWsg(MMM_BODY_WSG, &renderer->body, true);
-    loadWsg(MMM_DOWN_WSG, &renderer->down, true);
-    loadWsg(MMM_ITEM_WSG, &renderer->item, true);
-    loadWsg(MMM_ITEM_SEL_WSG, &renderer->item_sel, true);
-    loadWsg(MMM_NEXT_WSG, &renderer->next, true);
-    loadWsg(MMM_PREV_WSG, &renderer->prev, true);
-    loadWsg(MMM_SUBMENU_WSG, &renderer->submenu, true);
-    loadWsg(MMM_UP_WSG, &renderer->up, true);
+    // These are stored uncompressed, so they're used from flash and don't take any RAM, unless they can't be mapped
+    const cnfsFileIdx_t wsgIdxs[] = {
+        MMM_BACK_WSG, MMM_BG_WSG,      MMM_BODY_WSG, MMM_DOWN_WSG, MMM_ITEM_WSG, MMM_ITEM_SEL_WSG, MMM_NEXT_WSG,
+        MMM_PREV_WSG, MMM_SUBMENU_WSG, MMM_UP_WSG,   BATT_1_WSG,   BATT_2_WSG,   BATT_3_WSG,       BATT_4_WSG,
+    };
+    wsg_t* const wsgs[] = {
+        &renderer->back,     &renderer->bg,      &renderer->body,    &renderer->down,    &renderer->item,
+        &renderer->item_sel, &renderer->next,    &renderer->prev,    &renderer->submenu, &renderer->up,
+        &renderer->batt[0],  &renderer->batt[1], &renderer->batt[2], &renderer->batt[3],
+    };
+    renderer->wsgsMapped = loadMenuWsgs(wsgIdxs, wsgs, ARRAY_SIZE(wsgIdxs), true);
 
     // Save or allocate title font
     if (NULL == titleFont)
     {
-        renderer->titleFont = heap_caps_calloc(1, sizeof(font_t), MALLOC_CAP_SPIRAM);
-        loadFont(OXANIUM_FONT, renderer->titleFont, true);
+        renderer->titleFont          = heap_caps_calloc(1, sizeof(font_t), MALLOC_CAP_SPIRAM);
         renderer->titleFontAllocated = true;
     }
     else
@@ -94,8 +94,7 @@ menuMegaRenderer_t* initMenuMegaRenderer(font_t* titleFont, font_t* titleFontOut
     // Save or allocate title font outline
     if (NULL == titleFontOutline)
     {
-        renderer->titleFontOutline = heap_caps_calloc(1, sizeof(font_t), MALLOC_CAP_SPIRAM);
-        makeOutlineFont(renderer->titleFont, renderer->titleFontOutline, true);
+        renderer->titleFontOutline          = heap_caps_calloc(1, sizeof(font_t), MALLOC_CAP_SPIRAM);
         renderer->titleFontOutlineAllocated = true;
     }
     else
@@ -104,6 +103,28 @@ menuMegaRenderer_t* initMenuMegaRenderer(font_t* titleFont, font_t* titleFontOut
         renderer->titleFontOutlineAllocated = false;
     }
 
+    // Load the title font and its outline together, unless either was given
+    renderer->titleFontOutlineMapped = false;
+    if (renderer->titleFontAllocated && renderer->titleFontOutlineAllocated)
+    {
+        // The outline was made when the font was processed, and is used from ROM
+        renderer->titleFontOutlineMapped
+            = loadFontFamily(OXANIUM_FONT, renderer->titleFont, renderer->titleFontOutline, true);
+    }
+
+    // Otherwise, or if the font has no outline, load the font and make the outline from it
+    if (!renderer->titleFontOutlineMapped)
+    {
+        if (renderer->titleFontAllocated)
+        {
+            loadFont(OXANIUM_FONT, renderer->titleFont, true);
+        }
+        if (renderer->titleFontOutlineAllocated)
+        {
+            makeOutlineFont(renderer->titleFont, renderer->titleFontOutline, true);
+        }
+    }
+
     // Save or allocate menu font
     if (NULL == menuFont)
     {
@@ -117,12 +138,6 @@ menuMegaRenderer_t* initMenuMegaRenderer(font_t* titleFont, font_t* titleFontOut
         renderer->menuFontAllocated = false;
     }
 
-    // Load battery images
-    loadWsg(BATT_1_WSG, &renderer->batt[0], true);
-    loadWsg(BATT_2_WSG, &renderer->batt[1], true);
-    loadWsg(BATT_3_WSG, &renderer->batt[2], true);
-    loadWsg(BATT_4_WSG, &renderer->batt[3], true);
-
     // Initialize LEDs
     setLedsFromBg(renderer);
     setLeds(renderer->leds, CONFIG_NUM_LEDS);
@@ -144,10 +159,24 @@ menuMegaRenderer_t* initMenuMegaRenderer(font_t* titleFont, font_t* titleFontOut
  */
 void deinitMenuMegaRenderer(menuMegaRenderer_t* renderer)
 {
-    freeWsg(&renderer->batt[0]);
-    freeWsg(&renderer->batt[1]);
-    freeWsg(&renderer->batt[2]);
-    freeWsg(&renderer->batt[3]);
+    // WSGs used from flash aren't freed
+    if (!renderer->wsgsMapped)
+    {
+        freeWsg(&renderer->back);
+        freeWsg(&renderer->bg);
+        freeWsg(&renderer->body);
+        freeWsg(&renderer->down);
+        freeWsg(&renderer->item);
+        freeWsg(&renderer->item_sel);
+        freeWsg(&renderer->next);
+        freeWsg(&renderer->prev);
+        freeWsg(&renderer->submenu);
+        freeWsg(&renderer->up);
+        for (int i = 0; i < ARRAY_SIZE(renderer->batt); i++)
+        {
+            freeWsg(&renderer->batt[i]);
+        }
+    }
 
     // Free fonts if allocated
     if (renderer->titleFontAllocated)
@@ -157,7 +186,11 @@ void deinitMenuMegaRenderer(menuMegaRenderer_t* renderer)
     }
     if (renderer->titleFontOutlineAllocated)
     {
-        freeFont(renderer->titleFontOutline);
+        // An outline used from ROM has nothing else to free
+        if (!renderer->titleFontOutlineMapped)
+        {
+            freeFont(renderer->titleFontOutline);
+        }
         heap_caps_free(renderer->titleFontOutline);
     }
     if (renderer->menuFontAllocated)
@@ -166,17 +199,6 @@ void deinitMenuMegaRenderer(menuMegaRenderer_t* renderer)
         heap_caps_free(renderer->menuFont);
     }
 
-    freeWsg(&renderer->back);
-    freeWsg(&renderer->bg);
-    freeWsg(&renderer->body);
-    freeWsg(&renderer->down);
-    freeWsg(&renderer->item);
-    freeWsg(&renderer->item_sel);
-    freeWsg(&renderer->next);
-    freeWsg(&renderer->prev);
-    freeWsg(&renderer->submenu);
-    freeWsg(&renderer->up);
-
     heap_caps_free(renderer);
 }
 
@@ -48,6 +48,7 @@ typedef struct
     wsg_t submenu;        ///< A double right arrow (enter submenu)
     wsg_t back;           ///< A double left arrow (exit submenu)
     wsg_t batt[4];        ///< Images for the battery levels
+    bool wsgsMapped;      ///< true if the images are used from ROM, false if they were loaded to RAM and must be freed
     wsgPalette_t palette; ///< A palette to recolor menu images with
 
     paletteColor_t textFillColor;    ///< The color to fill text with
@@ -59,6 +60,8 @@ typedef struct
                                      ///< deinitMenuMegaRenderer()
     bool titleFontOutlineAllocated;  ///< true if this font was allocated by the renderer and should be freed by
                                      ///< deinitMenuMegaRenderer()
+    bool titleFontOutlineMapped;     ///< true if the outline's bitmaps are used from ROM, so only the font_t is
+                                     ///< freed
     bool menuFontAllocated;          ///< true if this font was allocated by the renderer and should be freed by
                                      ///< deinitMenuMegaRenderer()
 
@@ -227,3 +227,38 @@ menu_t* menuRestorePosition(const char** in, int len, menu_t* menu)
 
     return curMenu ? curMenu : menu;
 }
+
+/**
+ * @brief Load a set of renderer images, using them straight from ROM if they can all be mapped with loadWsgMapped().
+ * If any of them can't be mapped, they are all loaded to RAM with loadWsg() instead, so they can be freed together.
+ * An image that can't be loaded at all is left empty, so it draws nothing and freeWsg() skips it.
+ *
+ * @param fIdxs The cnfsFileIdx_t of each image
+ * @param wsgs A pointer to the wsg_t to load each image into
+ * @param count The number of images to load
+ * @param spiRam true to load to SPI RAM, false to load to normal RAM, if the images must be loaded to RAM
+ * @return true if the images are used from ROM and must not be freed,
+ *         false if they were loaded to RAM and must be freed with freeWsg()
+ */
+bool loadMenuWsgs(const cnfsFileIdx_t* fIdxs, wsg_t* const* wsgs, int count, bool spiRam)
+{
+    // Try to use all of the images from ROM first
+    bool mapped = true;
+    for (int i = 0; i < count && mapped; i++)
+    {
+        mapped = loadWsgMapped(fIdxs[i], wsgs[i]);
+    }
+
+    if (!mapped)
+    {
+        // Load all of them to RAM instead, so they're either all freed or none are
+        for (int i = 0; i < count; i++)
+        {
+            if (!loadWsg(fIdxs[i], wsgs[i], spiRam))
+            {
+                memset(wsgs[i], 0, sizeof(wsg_t));
+            }
+        }
+    }
+    return mapped;
+}
@@ -9,6 +9,7 @@
 #define _MENU_UTILS_H_
 
 #include "menu.h"
+#include "fs_wsg.h"
 
 const char* getMenuItemLabelText(char* buffer, int buflen, const menuItem_t* item);
 bool menuItemIsSetting(const menuItem_t* item);
@@ -19,5 +20,6 @@ bool menuItemIsBack(const menuItem_t* item);
 bool menuItemHasSubMenu(const menuItem_t* item);
 void menuSavePosition(const char** out, int len, const menu_t* menu);
 menu_t* menuRestorePosition(const char** in, int len, menu_t* menu);
+bool loadMenuWsgs(const cnfsFileIdx_t* fIdxs, wsg_t* const* wsgs, int count, bool spiRam);
 
 #endif
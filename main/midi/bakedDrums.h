@@ -2,8 +2,38 @@
 
 #include <stdint.h>
 
-extern const int8_t* bakedDrums[];
-extern const int32_t bakedDrumsLens[];
+/**
+ * @brief The ways a baked drum can be stored
+ */
+typedef enum
+{
+    BAKED_SAMPLES, ///< Signed 8-bit samples
+    BAKED_ADPCM,   ///< 4-bit IMA ADPCM codes, two samples per byte with the earlier sample in the low nibble
+    BAKED_RUNS,    ///< Pairs of bytes, the number of times a sample repeats minus one, then the signed 8-bit sample
+} bakedDrumFormat_t;
 
-extern const int8_t* bakedDonutDrums[];
-extern const int32_t bakedDonutDrumsLens[];
\ No newline at end of file
+/**
+ * @brief A drum sample baked into flash by bakeDrums()
+ */
+typedef struct
+{
+    union
+    {
+        /// @brief The samples, when format is ::BAKED_SAMPLES
+        const int8_t* samples;
+        /// @brief The ADPCM codes, when format is ::BAKED_ADPCM
+        const uint8_t* codes;
+        /// @brief The runs of samples, when format is ::BAKED_RUNS
+        const uint8_t* runs;
+    };
+
+    /// @brief The number of samples in the drum
+    int32_t len;
+
+    /// @brief How the drum is stored
+    bakedDrumFormat_t format;
+} bakedDrum_t;
+
+extern const bakedDrum_t bakedDrums[];
+
+extern const bakedDrum_t bakedDonutDrums[];
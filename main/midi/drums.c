@@ -4,13 +4,74 @@
 #include "midiNoteFreqs.h"
 #include "midiUtil.h"
 #include "cnfs.h"
+#include "macros.h"
 
 #define USE_BAKED_DRUMS
 
-#ifdef USE_BAKED_DRUMS
+#if defined(USE_BAKED_DRUMS) || defined(BAKE_DRUMS)
     #include "bakedDrums.h"
 #endif
 
+#ifdef ENABLE_BENCHMARKS
+    #include <stdio.h>
+    #include <inttypes.h>
+    #include <esp_timer.h>
+
+    /// How many times drumsBenchmark() plays each drum, so the times are long enough to measure
+    #define BENCH_REPS 8
+#endif
+
+#if defined(USE_BAKED_DRUMS) || defined(BAKE_DRUMS)
+
+/* Baked drums are stored in whichever format is smallest without sounding noticeably different, see bakeDrums().
+ *
+ * ADPCM drums are 4-bit IMA ADPCM, two samples per byte with the earlier sample in the low nibble. Each code moves a
+ * 16-bit prediction by a multiple of the current step size, and the step size grows or shrinks depending on how large
+ * the code was. The prediction is rounded down to 8 bits for output. Square waves are stored as runs of the same
+ * sample instead, which is lossless.
+ *
+ * Both are decoded one sample at a time, with the decoder state kept in the voice's percussion scratch space. The
+ * MIDI player zeroes it whenever a voice starts a note, and zero is the right starting state. Samples must be decoded in
+ * order, so if a drum is asked for an earlier sample than the last one, it starts over. That check only works on state
+ * left by the same drum. ADPCM and run state use the scratch space differently, and a kit may mix both formats, so
+ * stale state from another note could be read as an out of range run. Never reuse the scratch space without zeroing it.
+ */
+
+    /// The index of the next sample to decode, in the scratch space
+    #define ADPCM_SCRATCH_IDX 0
+    /// The 16-bit prediction, which is the last decoded sample, in the scratch space
+    #define ADPCM_SCRATCH_PREDICTION 1
+    /// The index into adpcmSteps, in the scratch space
+    #define ADPCM_SCRATCH_STEP 2
+
+    /// The index of the current run, in the scratch space
+    #define RUN_SCRATCH_RUN 0
+    /// The index of the first sample of the current run, in the scratch space
+    #define RUN_SCRATCH_START 1
+
+    /// The number of step sizes
+    #define ADPCM_NUM_STEPS 89
+
+/// The IMA ADPCM step sizes, which grow by about 10% each
+static const int16_t adpcmSteps[ADPCM_NUM_STEPS] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,
+    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,   337,   371,   408,   449,   494,
+    544,   598,   658,   724,   796,   876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,
+    9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+/// How far to move through adpcmSteps after each code, by the code's magnitude
+static const int8_t adpcmStepAdjust[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+static inline void adpcmApplyCode(uint8_t code, int32_t* prediction, int32_t* step);
+static int8_t adpcmDrumSample(const uint8_t* data, uint32_t idx, uint32_t scratch[4]);
+static int8_t runDrumSample(const uint8_t* runs, uint32_t idx, uint32_t scratch[4]);
+static inline int8_t bakedDrumSample(const bakedDrum_t* drum, uint32_t idx, bool* done, uint32_t scratch[4]);
+
+#endif
+
 #ifndef USE_BAKED_DRUMS
 
     #define FREQ_HZ(whole) (((whole) & 0xFFFFu) << 16)
@@ -210,6 +271,144 @@ static inline int8_t finishAt(uint32_t finishTime, uint32_t idx, bool* done)
 
 #endif
 
+#if defined(USE_BAKED_DRUMS) || defined(BAKE_DRUMS)
+
+/**
+ * @brief Move an ADPCM prediction by one code, and adjust the step size for the next code
+ *
+ * @param code The 4-bit code. Bit 3 is the sign, and the rest is the magnitude in quarter steps
+ * @param[in,out] prediction The 16-bit prediction to move
+ * @param[in,out] step The index into adpcmSteps to use and adjust
+ */
+static inline void adpcmApplyCode(uint8_t code, int32_t* prediction, int32_t* step)
+{
+    int32_t size = adpcmSteps[*step];
+
+    // The difference is (magnitude + 0.5) * size / 4, computed the same way by every IMA ADPCM decoder
+    int32_t diff = size >> 3;
+    if (code & 4)
+    {
+        diff += size;
+    }
+    if (code & 2)
+    {
+        diff += size >> 1;
+    }
+    if (code & 1)
+    {
+        diff += size >> 2;
+    }
+
+    *prediction = CLAMP((code & 8) ? (*prediction - diff) : (*prediction + diff), INT16_MIN, INT16_MAX);
+    *step       = CLAMP(*step + adpcmStepAdjust[code & 7], 0, ADPCM_NUM_STEPS - 1);
+}
+
+/**
+ * @brief Decode one sample of an ADPCM drum
+ *
+ * @param data The ADPCM codes for the drum
+ * @param idx The index of the sample to decode
+ * @param scratch The voice's percussion scratch space, which holds the decoder state
+ * @return The signed 8-bit sample
+ */
+static int8_t adpcmDrumSample(const uint8_t* data, uint32_t idx, uint32_t scratch[4])
+{
+    int32_t prediction = (int32_t)scratch[ADPCM_SCRATCH_PREDICTION];
+    int32_t step       = (int32_t)scratch[ADPCM_SCRATCH_STEP];
+    uint32_t next      = scratch[ADPCM_SCRATCH_IDX];
+
+    if (idx < next)
+    {
+        // Start over from the beginning
+        prediction = 0;
+        step       = 0;
+        next       = 0;
+    }
+
+    // Catch up to the requested sample. Normally this decodes exactly one sample
+    for (; next <= idx; next++)
+    {
+        adpcmApplyCode((data[next >> 1] >> ((next & 1) << 2)) & 0x0F, &prediction, &step);
+    }
+
+    scratch[ADPCM_SCRATCH_IDX]        = next;
+    scratch[ADPCM_SCRATCH_PREDICTION] = (uint32_t)prediction;
+    scratch[ADPCM_SCRATCH_STEP]       = (uint32_t)step;
+
+    // Round to 8 bits
+    return MIN((prediction + 128) >> 8, INT8_MAX);
+}
+
+/**
+ * @brief Decode one sample of a run-length encoded drum
+ *
+ * @param runs The runs of samples for the drum
+ * @param idx The index of the sample to decode
+ * @param scratch The voice's percussion scratch space, which holds the decoder state
+ * @return The signed 8-bit sample
+ */
+static int8_t runDrumSample(const uint8_t* runs, uint32_t idx, uint32_t scratch[4])
+{
+    uint32_t run   = scratch[RUN_SCRATCH_RUN];
+    uint32_t start = scratch[RUN_SCRATCH_START];
+
+    if (idx < start)
+    {
+        // Start over from the beginning
+        run   = 0;
+        start = 0;
+    }
+
+    // Skip ahead to the run with the requested sample
+    while (idx > start + runs[run * 2])
+    {
+        start += runs[run * 2] + 1;
+        run++;
+    }
+
+    scratch[RUN_SCRATCH_RUN]   = run;
+    scratch[RUN_SCRATCH_START] = start;
+    return (int8_t)runs[run * 2 + 1];
+}
+
+/**
+ * @brief Get one sample of a baked drum
+ *
+ * @param drum The baked drum
+ * @param idx The index of the sample
+ * @param[out] done Set to true once the drum is finished
+ * @param scratch The voice's percussion scratch space
+ * @return The signed 8-bit sample
+ */
+static inline int8_t bakedDrumSample(const bakedDrum_t* drum, uint32_t idx, bool* done, uint32_t scratch[4])
+{
+    if (idx >= drum->len)
+    {
+        // Drum sample finished
+        *done = true;
+        return 0;
+    }
+
+    switch (drum->format)
+    {
+        case BAKED_ADPCM:
+        {
+            return adpcmDrumSample(drum->codes, idx, scratch);
+        }
+        case BAKED_RUNS:
+        {
+            return runDrumSample(drum->runs, idx, scratch);
+        }
+        case BAKED_SAMPLES:
+        default:
+        {
+            return drum->samples[idx];
+        }
+    }
+}
+
+#endif
+
 int8_t defaultDrumkitFunc(percussionNote_t drum, uint32_t idx, bool* done, uint32_t scratch[4], void* data)
 {
 #ifdef USE_BAKED_DRUMS
@@ -222,18 +421,7 @@ int8_t defaultDrumkitFunc(percussionNote_t drum, uint32_t idx, bool* done, uint3
     }
     else
     {
-        int32_t dIdx = drum - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM;
-        if (idx >= bakedDrumsLens[dIdx])
-        {
-            // Drum sample finished
-            *done = true;
-            return 0;
-        }
-        else
-        {
-            // Drum sample playing
-            return bakedDrums[dIdx][idx];
-        }
+        return bakedDrumSample(&bakedDrums[drum - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM], idx, done, scratch);
     }
 
 #else
@@ -569,35 +757,29 @@ int8_t donutDrumkitFunc(percussionNote_t drum, uint32_t idx, bool* done, uint32_
 {
 #ifdef USE_BAKED_DRUMS
 
-    int32_t len           = 0;
-    const int8_t* samples = NULL;
+    const bakedDrum_t* baked = NULL;
     if (ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM <= drum && drum <= LOW_MID_TOM)
     {
-        len     = bakedDonutDrumsLens[0];
-        samples = bakedDonutDrums[0];
+        baked = &bakedDonutDrums[0];
     }
     else if (HIGH_MID_TOM <= drum && drum <= HIGH_BONGO)
     {
-        len     = bakedDonutDrumsLens[1];
-        samples = bakedDonutDrums[1];
+        baked = &bakedDonutDrums[1];
     }
     else if (LOW_BONGO == drum)
     {
         // Colossus Roar
-        len     = bakedDonutDrumsLens[2];
-        samples = bakedDonutDrums[2];
+        baked = &bakedDonutDrums[2];
     }
     else if (SHORT_WHISTLE == drum)
     {
         // MAG
-        len     = bakedDonutDrumsLens[3];
-        samples = bakedDonutDrums[3];
+        baked = &bakedDonutDrums[3];
     }
     else if (LONG_WHISTLE == drum)
     {
         // FEST
-        len     = bakedDonutDrumsLens[4];
-        samples = bakedDonutDrums[4];
+        baked = &bakedDonutDrums[4];
     }
     else
     {
@@ -606,15 +788,7 @@ int8_t donutDrumkitFunc(percussionNote_t drum, uint32_t idx, bool* done, uint32_
         return 0;
     }
 
-    if (idx >= len)
-    {
-        *done = true;
-        return 0;
-    }
-    else
-    {
-        return samples[idx];
-    }
+    return bakedDrumSample(baked, idx, done, scratch);
 
 #else
     const uint8_t* speeds;
@@ -732,10 +906,83 @@ int8_t donutDrumkitFunc(percussionNote_t drum, uint32_t idx, bool* done, uint32_
 #endif
 }
 
+#ifdef ENABLE_BENCHMARKS
+
+/**
+ * @brief Measure how long it takes to play every baked drum, per sample, for each format the drums are stored in
+ */
+void drumsBenchmark(void)
+{
+    #ifndef USE_BAKED_DRUMS
+    printf("The drums aren't baked, so there is nothing to measure\n");
+    #else
+    static const char* const formatNames[] = {"samples", "ADPCM", "runs"};
+    int64_t formatUs[3]                    = {0};
+    uint32_t formatSamples[3]              = {0};
+    int32_t checksum                       = 0;
+
+    for (int32_t rep = 0; rep < BENCH_REPS; rep++)
+    {
+        for (percussionNote_t n = ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM; n <= OPEN_TRIANGLE; n++)
+        {
+            const bakedDrum_t* drum = &bakedDrums[n - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM];
+            uint32_t scratch[4]     = {0};
+            bool done               = false;
+            uint32_t idx            = 0;
+
+            int64_t tStart = esp_timer_get_time();
+            while (!done)
+            {
+                checksum += defaultDrumkitFunc(n, idx++, &done, scratch, NULL);
+            }
+            formatUs[drum->format] += esp_timer_get_time() - tStart;
+            formatSamples[drum->format] += drum->len;
+        }
+
+        // One note which plays each of the donut drums
+        static const percussionNote_t donutNotes[]
+            = {ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM, HIGH_MID_TOM, LOW_BONGO, SHORT_WHISTLE, LONG_WHISTLE};
+        for (int32_t d = 0; d < ARRAY_SIZE(donutNotes); d++)
+        {
+            const bakedDrum_t* drum = &bakedDonutDrums[d];
+            uint32_t scratch[4]     = {0};
+            bool done               = false;
+            uint32_t idx            = 0;
+
+            int64_t tStart = esp_timer_get_time();
+            while (!done)
+            {
+                checksum += donutDrumkitFunc(donutNotes[d], idx++, &done, scratch, NULL);
+            }
+            formatUs[drum->format] += esp_timer_get_time() - tStart;
+            formatSamples[drum->format] += drum->len;
+        }
+    }
+
+    for (int32_t f = 0; f < 3; f++)
+    {
+        printf("%s: %" PRIu32 " samples in %" PRId64 "us, %.2fns per sample\n", formatNames[f], formatSamples[f],
+               formatUs[f], formatSamples[f] ? formatUs[f] * 1000.0 / formatSamples[f] : 0);
+    }
+    printf("Checksum %" PRId32 "\n", checksum);
+    #endif
+}
+
+#endif
+
 #ifdef BAKE_DRUMS
 
     #include <stdio.h>
+    #include <stdlib.h>
     #include <inttypes.h>
+    #include <math.h>
+    #include <string.h>
+
+    /// The number of candidate encodings the encoder keeps at each sample
+    #define ADPCM_BEAM_WIDTH 32
+
+    /// The lowest signal to noise ratio, in dB, at which a drum is baked as ADPCM rather than as samples
+    #define ADPCM_MIN_SNR 24
 
 const char* getDrumName(percussionNote_t n)
 {
@@ -790,88 +1037,335 @@ const char* getDrumName(percussionNote_t n)
 }
 
 /**
- * @brief Call this function to print out all the drum samples
+ * @brief One candidate encoding, up to some sample
+ */
+typedef struct
+{
+    int32_t prediction; ///< The decoder's prediction after the last code
+    int32_t step;       ///< The decoder's step index after the last code
+    uint64_t err;       ///< The total squared error of this encoding so far
+    uint8_t parent;     ///< The index of the candidate this one continues, at the previous sample
+    uint8_t code;       ///< The last code
+} adpcmCandidate_t;
+
+/**
+ * @brief Sort ADPCM candidates by increasing error
  *
- * This "bakes" the drums in, rather than calculating them on the fly
+ * @param a An ::adpcmCandidate_t
+ * @param b Another ::adpcmCandidate_t
+ * @return Less than, equal to, or greater than zero if a has less, equal, or more error than b
+ */
+static int adpcmCandidateCmp(const void* a, const void* b)
+{
+    uint64_t errA = ((const adpcmCandidate_t*)a)->err;
+    uint64_t errB = ((const adpcmCandidate_t*)b)->err;
+    return (errA > errB) - (errA < errB);
+}
+
+/**
+ * @brief Encode signed 8-bit samples as IMA ADPCM.
  *
- * It should be run on the emulator, not firmware.
+ * The step size can only grow so fast, so always picking the closest code can't follow sudden jumps like the edges of
+ * a square wave. Instead, the best ::ADPCM_BEAM_WIDTH encodings so far are extended by every code at each sample, and
+ * the best encoding of the whole drum is kept, which grows the step size ahead of a jump when that's better overall.
+ *
+ * @param samples The samples to encode
+ * @param len The number of samples
+ * @return The ADPCM codes, two per byte, which must be freed with free()
  */
-void bakeDrums(void)
+static uint8_t* adpcmEncode(const int8_t* samples, uint32_t len)
 {
-    printf("#include \"bakedDrums.h\"\n\n");
-    int32_t lengths[OPEN_TRIANGLE - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM + 1] = {0};
-    for (percussionNote_t n = ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM; n <= OPEN_TRIANGLE; n++)
+    uint8_t* codes = calloc((len + 1) / 2 + 1, 1);
+
+    // Remember how each candidate was reached so the best one can be traced back at the end
+    adpcmCandidate_t* history = malloc(sizeof(adpcmCandidate_t) * ADPCM_BEAM_WIDTH * (len + 1));
+    adpcmCandidate_t beam[ADPCM_BEAM_WIDTH] = {0};
+    adpcmCandidate_t next[ADPCM_BEAM_WIDTH * 16];
+    uint32_t beamLen = 1;
+
+    for (uint32_t i = 0; i < len; i++)
     {
-        int32_t idx         = 0;
-        bool done           = false;
-        uint32_t scratch[4] = {0};
-        printf("static const int8_t %s_SAMPLES[] = {\n", getDrumName(n));
-        while (!done)
+        // The decoder only has the prediction to go on, so match the sample in its 16-bit scale
+        int32_t target   = samples[i] * 256;
+        uint32_t nextLen = 0;
+        for (uint32_t b = 0; b < beamLen; b++)
         {
-            int8_t sample = defaultDrumkitFunc(n, idx, &done, scratch, NULL);
-            if (!done)
+            for (uint8_t code = 0; code < 16; code++)
             {
-                printf("%" PRId8 ", ", sample);
-                idx++;
+                adpcmCandidate_t* cand = &next[nextLen++];
+                cand->prediction       = beam[b].prediction;
+                cand->step             = beam[b].step;
+                adpcmApplyCode(code, &cand->prediction, &cand->step);
+                int64_t diff = cand->prediction - target;
+                cand->err    = beam[b].err + diff * diff;
+                cand->parent = b;
+                cand->code   = code;
             }
         }
-        printf("};\n\n");
+        qsort(next, nextLen, sizeof(adpcmCandidate_t), adpcmCandidateCmp);
 
-        lengths[n - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM] = idx;
+        // Keep the best candidates, skipping any which would decode the same from here on as a better one
+        beamLen = 0;
+        for (uint32_t c = 0; c < nextLen && beamLen < ADPCM_BEAM_WIDTH; c++)
+        {
+            bool dup = false;
+            for (uint32_t b = 0; b < beamLen; b++)
+            {
+                if (beam[b].prediction == next[c].prediction && beam[b].step == next[c].step)
+                {
+                    dup = true;
+                    break;
+                }
+            }
+            if (!dup)
+            {
+                beam[beamLen++] = next[c];
+            }
+        }
+        memcpy(&history[i * ADPCM_BEAM_WIDTH], beam, sizeof(adpcmCandidate_t) * beamLen);
     }
 
-    printf("const int8_t* bakedDrums[] = {\n");
-    for (percussionNote_t n = ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM; n <= OPEN_TRIANGLE; n++)
+    // The beam is sorted, so the first candidate is the best. Trace it back to the start
+    uint8_t b = 0;
+    for (uint32_t i = len; i-- > 0;)
     {
-        printf("%s_SAMPLES, ", getDrumName(n));
+        const adpcmCandidate_t* cand = &history[i * ADPCM_BEAM_WIDTH + b];
+        codes[i >> 1] |= cand->code << ((i & 1) << 2);
+        b = cand->parent;
     }
-    printf("};\n");
 
-    printf("const int32_t bakedDrumsLens[] = {\n");
-    for (percussionNote_t n = ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM; n <= OPEN_TRIANGLE; n++)
+    free(history);
+    return codes;
+}
+
+/**
+ * @brief Encode signed 8-bit samples as runs of the same sample
+ *
+ * @param samples The samples to encode
+ * @param len The number of samples
+ * @param[out] size Written with the size of the runs, in bytes
+ * @return The runs, which must be freed with free()
+ */
+static uint8_t* runEncode(const int8_t* samples, uint32_t len, uint32_t* size)
+{
+    uint8_t* runs = malloc(len * 2 + 2);
+    *size         = 0;
+    for (uint32_t i = 0; i < len;)
     {
-        printf("%" PRId32 ", ", lengths[n - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM]);
+        // Each run is at most 256 samples, so its length fits in a byte
+        uint32_t runLen = 1;
+        while (i + runLen < len && runLen < 256 && samples[i + runLen] == samples[i])
+        {
+            runLen++;
+        }
+        runs[(*size)++] = runLen - 1;
+        runs[(*size)++] = (uint8_t)samples[i];
+        i += runLen;
     }
-    printf("};\n");
-
-    #define NUM_DONUT_DRUMS 5
-    percussionNote_t donutDrums[NUM_DONUT_DRUMS]
-        = {ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM, HIGH_MID_TOM, LOW_BONGO, SHORT_WHISTLE, LONG_WHISTLE};
+    return runs;
+}
 
-    int32_t donutLengths[NUM_DONUT_DRUMS] = {0};
+/**
+ * @brief Measure how close a baked drum is to the original samples
+ *
+ * @param drum The baked drum
+ * @param samples The original samples
+ * @return The signal to noise ratio, in dB, or INFINITY if they are the same
+ */
+static double bakedDrumSnr(const bakedDrum_t* drum, const int8_t* samples)
+{
+    uint32_t scratch[4] = {0};
+    bool done           = false;
+    double signal       = 0;
+    double noise        = 0;
+    for (int32_t i = 0; i < drum->len; i++)
+    {
+        int32_t err = bakedDrumSample(drum, i, &done, scratch) - samples[i];
+        signal += samples[i] * samples[i];
+        noise += err * err;
+    }
+    return (noise > 0) ? 10 * log10(signal / noise) : INFINITY;
+}
 
-    for (int32_t nIdx = 0; nIdx < NUM_DONUT_DRUMS; nIdx++)
+/**
+ * @brief Render a whole drum and print it in whichever format is smallest and close enough to the original
+ *
+ * @param name The name of the drum, which the array is named after
+ * @param drumkit The drumkit function to render the drum with
+ * @param n The drum to render
+ * @param[out] len Written with the number of samples in the drum
+ * @return The format the drum was printed in
+ */
+static bakedDrumFormat_t bakeDrum(const char* name, percussionFunc_t drumkit, percussionNote_t n, int32_t* len)
+{
+    uint32_t count      = 0;
+    uint32_t cap        = 4096;
+    int8_t* samples     = malloc(cap);
+    bool done           = false;
+    uint32_t scratch[4] = {0};
+    while (!done)
     {
-        percussionNote_t n = donutDrums[nIdx];
+        int8_t sample = drumkit(n, count, &done, scratch, NULL);
+        if (!done)
+        {
+            if (count == cap)
+            {
+                cap *= 2;
+                samples = realloc(samples, cap);
+            }
+            samples[count++] = sample;
+        }
+    }
+    *len = count;
+
+    uint32_t runsSize = 0;
+    bakedDrum_t runs  = {
+        .runs   = runEncode(samples, count, &runsSize),
+        .len    = count,
+        .format = BAKED_RUNS,
+    };
+    bakedDrum_t adpcm = {
+        .codes  = adpcmEncode(samples, count),
+        .len    = count,
+        .format = BAKED_ADPCM,
+    };
+    uint32_t adpcmSize = (count + 1) / 2;
+    double adpcmSnr    = bakedDrumSnr(&adpcm, samples);
+
+    // Runs are lossless, so they're always used if they're smallest
+    bakedDrumFormat_t format = BAKED_SAMPLES;
+    if (count > 0 && adpcmSnr >= ADPCM_MIN_SNR && adpcmSize < MIN(runsSize, count))
+    {
+        format = BAKED_ADPCM;
+    }
+    else if (runsSize < count)
+    {
+        format = BAKED_RUNS;
+    }
 
-        int32_t idx         = 0;
-        bool done           = false;
-        uint32_t scratch[4] = {0};
-        printf("static const int8_t DONUT_%d_SAMPLES[] = {\n", nIdx);
-        while (!done)
+    switch (format)
+    {
+        case BAKED_ADPCM:
         {
-            int8_t sample = donutDrumkitFunc(n, idx, &done, scratch, NULL);
-            if (!done)
+            printf("// %" PRIu32 " samples as ADPCM in %" PRIu32 " bytes, SNR %.1fdB\n", count, adpcmSize, adpcmSnr);
+            printf("static const uint8_t %s_ADPCM[] = {\n", name);
+            for (uint32_t i = 0; i < adpcmSize; i++)
             {
-                printf("%" PRId8 ", ", sample);
-                idx++;
+                printf("%" PRIu8 ", ", adpcm.codes[i]);
             }
+            break;
+        }
+        case BAKED_RUNS:
+        {
+            printf("// %" PRIu32 " samples as %" PRIu32 " runs in %" PRIu32 " bytes, lossless\n", count, runsSize / 2,
+                   runsSize);
+            printf("static const uint8_t %s_RUNS[] = {\n", name);
+            for (uint32_t i = 0; i < runsSize; i++)
+            {
+                printf("%" PRIu8 ", ", runs.runs[i]);
+            }
+            break;
+        }
+        case BAKED_SAMPLES:
+        default:
+        {
+            printf("// %" PRIu32 " samples in %" PRIu32 " bytes, SNR as ADPCM would be %.1fdB\n", count, count,
+                   adpcmSnr);
+            printf("static const int8_t %s_SAMPLES[] = {\n", name);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                printf("%" PRId8 ", ", samples[i]);
+            }
+            break;
         }
-        donutLengths[nIdx] = idx;
-        printf("};\n");
     }
+    printf("};\n\n");
+
+    free((void*)runs.runs);
+    free((void*)adpcm.codes);
+    free(samples);
+    return format;
+}
+
+/**
+ * @brief Print an entry in a table of baked drums
+ *
+ * @param name The name of the drum
+ * @param len The number of samples in the drum
+ * @param format The format the drum was baked in
+ */
+static void printBakedDrum(const char* name, int32_t len, bakedDrumFormat_t format)
+{
+    switch (format)
+    {
+        case BAKED_ADPCM:
+        {
+            printf("{.codes = %s_ADPCM, .len = %" PRId32 ", .format = BAKED_ADPCM},\n", name, len);
+            break;
+        }
+        case BAKED_RUNS:
+        {
+            printf("{.runs = %s_RUNS, .len = %" PRId32 ", .format = BAKED_RUNS},\n", name, len);
+            break;
+        }
+        case BAKED_SAMPLES:
+        default:
+        {
+            printf("{.samples = %s_SAMPLES, .len = %" PRId32 ", .format = BAKED_SAMPLES},\n", name, len);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Call this function to print out all the drum samples
+ *
+ * This "bakes" the drums in, rather than calculating them on the fly. Each drum is stored in whichever format is
+ * smallest: runs of the same sample, which suits square waves and is lossless, or 4-bit ADPCM, which halves the size of
+ * anything else but is only used if the SNR is at least ::ADPCM_MIN_SNR. Drums which don't suit either, mostly noisy or
+ * very high pitched ones, are kept as 8-bit samples. Each drum is commented with its size and SNR.
+ *
+ * It should be run on the emulator, not firmware.
+ */
+void bakeDrums(void)
+{
+    #define NUM_DEFAULT_DRUMS (OPEN_TRIANGLE - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM + 1)
+    int32_t lengths[NUM_DEFAULT_DRUMS]           = {0};
+    bakedDrumFormat_t formats[NUM_DEFAULT_DRUMS] = {0};
+
+    printf("#include \"bakedDrums.h\"\n\n");
+    for (percussionNote_t n = ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM; n <= OPEN_TRIANGLE; n++)
+    {
+        int32_t dIdx = n - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM;
+        formats[dIdx] = bakeDrum(getDrumName(n), defaultDrumkitFunc, n, &lengths[dIdx]);
+    }
+
+    printf("const bakedDrum_t bakedDrums[] = {\n");
+    for (percussionNote_t n = ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM; n <= OPEN_TRIANGLE; n++)
+    {
+        int32_t dIdx = n - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM;
+        printBakedDrum(getDrumName(n), lengths[dIdx], formats[dIdx]);
+    }
+    printf("};\n\n");
+
+    #define NUM_DONUT_DRUMS 5
+    percussionNote_t donutDrums[NUM_DONUT_DRUMS]
+        = {ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM, HIGH_MID_TOM, LOW_BONGO, SHORT_WHISTLE, LONG_WHISTLE};
+
+    int32_t donutLengths[NUM_DONUT_DRUMS]           = {0};
+    bakedDrumFormat_t donutFormats[NUM_DONUT_DRUMS] = {0};
+    char names[NUM_DONUT_DRUMS][16];
 
-    printf("const int8_t* bakedDonutDrums[] = {\n");
     for (int32_t nIdx = 0; nIdx < NUM_DONUT_DRUMS; nIdx++)
     {
-        printf("DONUT_%d_SAMPLES,", nIdx);
+        snprintf(names[nIdx], sizeof(names[nIdx]), "DONUT_%" PRId32, nIdx);
+        donutFormats[nIdx] = bakeDrum(names[nIdx], donutDrumkitFunc, donutDrums[nIdx], &donutLengths[nIdx]);
     }
-    printf("};\n");
 
-    printf("const int32_t bakedDonutDrumsLens[] = {\n");
+    printf("const bakedDrum_t bakedDonutDrums[] = {\n");
     for (int32_t nIdx = 0; nIdx < NUM_DONUT_DRUMS; nIdx++)
     {
-        printf("%" PRId32 ", ", donutLengths[nIdx]);
+        printBakedDrum(names[nIdx], donutLengths[nIdx], donutFormats[nIdx]);
     }
     printf("};\n");
 }
@@ -29,4 +29,8 @@ int8_t donutDrumkitFunc(percussionNote_t drum, uint32_t idx, bool* done, uint32_
 
 #ifdef BAKE_DRUMS
 void bakeDrums(void);
+#endif
+
+#ifdef ENABLE_BENCHMARKS
+void drumsBenchmark(void);
 #endif
\ No newline at end of file
@@ -968,6 +968,26 @@ void deinitMidiParser(midiFileReader_t* reader)
     }
 }
 
+bool copyMidiParser(midiFileReader_t* dest, const midiFileReader_t* src)
+{
+    *dest        = *src;
+    dest->states = NULL;
+
+    if (src->states != NULL)
+    {
+        dest->states = heap_caps_calloc(src->stateCount, sizeof(midiTrackState_t), MALLOC_CAP_SPIRAM);
+        if (NULL == dest->states)
+        {
+            dest->stateCount = 0;
+            dest->file       = NULL;
+            return false;
+        }
+        memcpy(dest->states, src->states, src->stateCount * sizeof(midiTrackState_t));
+    }
+
+    return true;
+}
+
 bool midiNextEvent(midiFileReader_t* reader, midiEvent_t* event)
 {
     uint32_t minTime = UINT32_MAX;
@@ -1043,6 +1063,8 @@ void* globalMidiSave(void)
         midiPlayer_t* player = globalMidiPlayerGet(i);
         if (NULL != player)
         {
+            // Don't let the DAC callback change the player while it's copied
+            midiPlayerLock(player);
             memcpy(&saveState[i].player, player, sizeof(midiPlayer_t));
 
             if (player->reader.file != NULL)
@@ -1062,6 +1084,7 @@ void* globalMidiSave(void)
                     memcpy(stateCopy, stateOrig, sizeof(midiTrackState_t));
                 }
             }
+            midiPlayerUnlock(player);
         }
     }
 
@@ -1077,9 +1100,11 @@ void globalMidiRestore(void* data)
         midiPlayer_t* player = globalMidiPlayerGet(i);
         if (NULL != player)
         {
+            midiPlayerLock(player);
             midiPlayerReset(player);
 
             memcpy(player, &saveState[i].player, sizeof(midiPlayer_t));
+            midiPlayerUnlock(player);
         }
     }
 
@@ -324,6 +324,16 @@ void resetMidiParser(midiFileReader_t* reader);
  */
 void deinitMidiParser(midiFileReader_t* reader);
 
+/**
+ * @brief Copy a MIDI file reader, including its position in each track. The copy must be deinitialized separately
+ *
+ * @param dest A pointer to the MIDI file reader to copy into. Any memory it had allocated is not freed
+ * @param src A pointer to the MIDI file reader to copy
+ * @return true if the reader was copied
+ * @return false if an error occurred while allocating data for the copy
+ */
+bool copyMidiParser(midiFileReader_t* dest, const midiFileReader_t* src);
+
 /**
  * @brief Return the start time of the next event in the MIDI file being read
  *
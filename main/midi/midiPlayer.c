@@ -3,6 +3,7 @@
 #include <string.h>
 #include <inttypes.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
 
 #include "waveTables.h"
 #include "midiNoteFreqs.h"
@@ -82,9 +83,19 @@ static const uint8_t oscDither[] = {
 // Represents that no voice has been allocated to the instrument, within the special states bitmap
 #define VOICE_FREE (0x3F)
 
+// The stream clock is reset rather than smoothed if it is off by more than this many blocks, i.e. after the DAC stopped
+#define STREAM_CLOCK_RESYNC_BLOCKS 2
+
 static midiPlayer_t* globalPlayers = NULL;
 
-static uint32_t allocVoice(const voiceStates_t* states, uint8_t voiceCount);
+static uint32_t voiceKeepScore(const midiPlayer_t* player, const voiceStates_t* states, const midiVoice_t* voices,
+                               uint8_t voiceIdx);
+static uint32_t allocVoice(const midiPlayer_t* player, const voiceStates_t* states, const midiVoice_t* voices,
+                           uint8_t voiceCount);
+static void midiShedVoices(midiPlayer_t* player);
+static void midiUpdateLoad(midiPlayer_t* player, int64_t renderUs, int16_t len);
+static void midiScheduleTimedEvents(midiPlayer_t* player, int16_t len);
+static inline void midiApplyScheduledEvents(midiPlayer_t* player);
 static bool releaseNote(voiceStates_t* states, uint8_t voiceIdx, midiVoice_t* voice);
 static void midiStepVoice(midiChannel_t* channel, voiceStates_t* states, uint8_t voiceIdx, midiVoice_t* voice);
 static void setVoiceTimbre(midiVoice_t* voice, midiTimbre_t* timbre);
@@ -96,21 +107,61 @@ static void handleSysexEvent(midiPlayer_t* player, const midiSysexEvent_t* sysex
 static void handleMetaEvent(midiPlayer_t* player, const midiMetaEvent_t* event);
 static void handleEvent(midiPlayer_t* player, const midiEvent_t* event);
 static void midiSongEnd(midiPlayer_t* player);
+static void freePrepared(midiPrepared_t* prepared);
+static void applyPrepared(midiPlayer_t* player, midiPrepared_t* prepared);
+
+/**
+ * @brief Score how much a playing voice would be missed if it were stolen. The lowest scoring voice is stolen first
+ *
+ * Voices in their release stage always score lower than voices which are still being played. After that, the score is
+ * ordered by the priority of the voice's channel, then by the voice's current volume, then by how recently its note
+ * started.
+ *
+ * @param player The MIDI player which owns the voice
+ * @param states A pointer to the voice state bitmaps for the voice's pool
+ * @param voices The voice's pool
+ * @param voiceIdx The index of the voice in its pool
+ * @return uint32_t The score, where lower is a better voice to steal
+ */
+static uint32_t voiceKeepScore(const midiPlayer_t* player, const voiceStates_t* states, const midiVoice_t* voices,
+                               uint8_t voiceIdx)
+{
+    const midiVoice_t* voice = &voices[voiceIdx];
+
+    uint32_t level;
+    if ((voice->timbre->flags & TF_PERCUSSION) || voice->timbre->type == SAMPLE)
+    {
+        // These don't use the oscillator volume, so go by how hard the note was played
+        level = voice->velocity << 1 | 1;
+    }
+    else
+    {
+        level = MIN(voice->oscillators[0].cVol, 255);
+    }
+
+    // Only the order matters, so a note started more than 65535 notes ago is just as old as one started 65535 ago
+    uint32_t age = MIN(player->noteCount - voice->noteId, UINT16_MAX);
+
+    // The volume only counts in large steps, so a slightly quieter note doesn't get stolen over a much older one
+    return ((states->release & (1 << voiceIdx)) ? 0 : (1u << 31)) | (player->channels[voice->channel].priority << 23)
+           | ((level >> 4) << 19) | (UINT16_MAX - age);
+}
 
-// Check for the first unused note, then try to steal one in order of less to more bad, and return INT32_MAX if none are
-// available
 /**
  * @brief Return the index of an unallocated voice from the given voice pool.
  *
  * This function finds the voice index to allocate, but the caller is responsible for updating the state
- * bitmaps to actuallymark it as allocated.
- * If there are no unallocated voices remaining, an allocated voice index may be returned.
+ * bitmaps to actually mark it as allocated.
+ * If there are no unallocated voices remaining, the allocated voice with the lowest voiceKeepScore() is returned.
  *
+ * @param player The MIDI player which owns the pool
  * @param states A pointer to the voice state bitmaps for this pool
+ * @param voices The voices in this pool
  * @param voiceCount The number of voices in this pool
  * @return uint32_t The index of the voice to allocate
  */
-static uint32_t allocVoice(const voiceStates_t* states, uint8_t voiceCount)
+static uint32_t allocVoice(const midiPlayer_t* player, const voiceStates_t* states, const midiVoice_t* voices,
+                           uint8_t voiceCount)
 {
     uint32_t allStates = VS_ANY(states) | states->held | states->attack | states->decay | states->release
                          | states->sustain | states->sustenuto;
@@ -126,19 +177,224 @@ static uint32_t allocVoice(const voiceStates_t* states, uint8_t voiceCount)
         // Return whatever the first voice that's not allocated is
         return __builtin_ctz(unusedVoices);
     }
+
+    // No unused voices! Steal the one which will be missed the least
+    uint32_t bestIdx   = 0;
+    uint32_t bestScore = UINT32_MAX;
+    for (uint8_t voiceIdx = 0; voiceIdx < voiceCount; voiceIdx++)
+    {
+        uint32_t score = voiceKeepScore(player, states, voices, voiceIdx);
+        if (score < bestScore)
+        {
+            bestScore = score;
+            bestIdx   = voiceIdx;
+        }
+    }
+    return bestIdx;
+}
+
+/**
+ * @brief Fade out pooled voices until no more are playing than the voice budget allows, starting with the voices
+ * which will be missed the least
+ *
+ * @param player The MIDI player whose voices to shed
+ */
+static void midiShedVoices(midiPlayer_t* player)
+{
+    voiceStates_t* states = &player->poolVoiceStates;
+    midiVoice_t* voices   = player->poolVoices;
+
+    // Sampled and percussion voices don't follow the envelope, so they can't be faded out. Voices which are already
+    // fading out quickly will be gone soon, so they don't count
+    uint32_t sheddable = 0;
+    uint32_t playing   = VS_ANY(states) | states->held | states->sustenuto | states->attack | states->decay
+                       | states->sustain | states->release;
+    while (playing != 0)
+    {
+        uint8_t voiceIdx = __builtin_ctz(playing);
+        playing &= ~(1 << voiceIdx);
+
+        const midiVoice_t* voice = &voices[voiceIdx];
+        if (!(voice->timbre->flags & TF_PERCUSSION) && voice->timbre->type != SAMPLE
+            && (!(states->release & (1 << voiceIdx)) || voice->transitionTicks > MIDI_SHED_RELEASE_TICKS))
+        {
+            sheddable |= (1 << voiceIdx);
+        }
+    }
+
+    while (__builtin_popcount(sheddable) > player->voiceBudget)
+    {
+        uint32_t bestIdx   = 0;
+        uint32_t bestScore = UINT32_MAX;
+        uint32_t remaining = sheddable;
+        while (remaining != 0)
+        {
+            uint8_t voiceIdx = __builtin_ctz(remaining);
+            remaining &= ~(1 << voiceIdx);
+
+            uint32_t score = voiceKeepScore(player, states, voices, voiceIdx);
+            if (score < bestScore)
+            {
+                bestScore = score;
+                bestIdx   = voiceIdx;
+            }
+        }
+
+        // Move the voice to a short release, starting from its current volume so it doesn't click
+        uint32_t voiceBit  = (1 << bestIdx);
+        midiVoice_t* voice = &voices[bestIdx];
+        states->on &= ~voiceBit;
+        states->held &= ~voiceBit;
+        states->sustenuto &= ~voiceBit;
+        states->attack &= ~voiceBit;
+        states->decay &= ~voiceBit;
+        states->sustain &= ~voiceBit;
+        states->release |= voiceBit;
+
+        voice->transitionStartVol   = MIN(voice->oscillators[0].cVol, 255);
+        voice->targetVol            = 0;
+        voice->transitionTicksTotal = voice->transitionTicks = MIDI_SHED_RELEASE_TICKS;
+
+        sheddable &= ~voiceBit;
+        player->shedNotes++;
+    }
+}
+
+/**
+ * @brief Update a player's DSP load after rendering a block, and adjust its voice budget if it is adaptive
+ *
+ * @param player The MIDI player which rendered the block
+ * @param renderUs The time taken to render the block, in microseconds
+ * @param len The number of samples in the block
+ */
+static void midiUpdateLoad(midiPlayer_t* player, int64_t renderUs, int16_t len)
+{
+    if (len <= 0)
+    {
+        return;
+    }
+
+    int64_t load = renderUs * DAC_SAMPLE_RATE_HZ * DAC_LOAD_FULL / ((int64_t)len * 1000000);
+    if (load > UINT16_MAX)
+    {
+        load = UINT16_MAX;
+    }
+    if (load > player->peakDspLoad)
+    {
+        player->peakDspLoad = load;
+    }
+    player->dspLoad = (player->dspLoad * 7 + load) / 8;
+
+    if (!player->adaptiveVoices)
+    {
+        return;
+    }
+
+    // A single block over the deadline is about to be heard, so react to it right away rather than waiting for the
+    // average to catch up
+    if ((player->dspLoad > MIDI_LOAD_HIGH || load >= DAC_LOAD_FULL) && player->voiceBudget > MIDI_MIN_VOICE_BUDGET)
+    {
+        player->voiceBudget   = MAX(MIDI_MIN_VOICE_BUDGET, player->voiceBudget - 2);
+        player->budgetHoldoff = 32;
+        ESP_LOGD("MIDI", "DSP load %" PRIu16 ", voice budget lowered to %" PRIu8, player->dspLoad,
+                 player->voiceBudget);
+    }
+
+    if (player->dspLoad > MIDI_LOAD_HIGH || load >= DAC_LOAD_FULL)
+    {
+        // Lowering the budget only limits new notes, so fade out the notes already over it too
+        midiShedVoices(player);
+    }
+    else if (player->dspLoad < MIDI_LOAD_LOW && player->voiceBudget < player->voiceLimit)
+    {
+        // Raise the budget one voice at a time, so it settles just under the load limit
+        if (player->budgetHoldoff)
+        {
+            player->budgetHoldoff--;
+        }
+        else
+        {
+            player->voiceBudget++;
+            player->budgetHoldoff = 8;
+        }
+    }
+}
+
+/**
+ * @brief Move timed events from the queue into the sorted list of scheduled events, at the sample matching the time
+ * they were received. Called before rendering each block
+ *
+ * @param player The MIDI player about to render a block
+ * @param len The number of samples in the block
+ */
+static void midiScheduleTimedEvents(midiPlayer_t* player, int16_t len)
+{
+    int64_t now     = esp_timer_get_time();
+    int64_t blockUs = SAMPLES_TO_US((int64_t)len);
+
+    // The render task doesn't wake up at exactly the same point of every block, so only nudge the clock an eighth of
+    // the way towards the real time. That way events aren't moved around by when the block happened to be rendered
+    int64_t error = now - player->streamClock;
+    if (0 == player->streamClock || error > blockUs * STREAM_CLOCK_RESYNC_BLOCKS
+        || error < -blockUs * STREAM_CLOCK_RESYNC_BLOCKS)
+    {
+        player->streamClock = now;
+    }
     else
     {
-        // No unused voices!
-        // Try a different approach, treat notes in release state as not in use to hopefully steal one of those
-        allStates &= ~states->release;
-        unusedVoices = (~allStates) & (0xFFFFFFFFu >> (32 - voiceCount));
-        if (unusedVoices != 0)
+        player->streamClock += error / 8;
+    }
+
+    // Only this thread writes timedTail. The acquire pairs with the release in midiQueueTimedEvent(), so every event up
+    // to head is fully written
+    uint32_t tail = __atomic_load_n(&player->timedTail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&player->timedHead, __ATOMIC_ACQUIRE);
+
+    while (tail != head && player->scheduledCount < MIDI_TIMED_QUEUE_LEN)
+    {
+        const midiTimedEvent_t* timed = &player->timedQueue[tail % MIDI_TIMED_QUEUE_LEN];
+
+        // An event received exactly when this block is rendered is played streamLatency samples into it
+        int64_t offset = player->streamLatency + (timed->time - player->streamClock) * DAC_SAMPLE_RATE_HZ / 1000000;
+        if (offset < 0)
         {
-            return __builtin_ctz(unusedVoices);
+            offset = 0;
+            player->lateEvents++;
         }
+        uint64_t sample = player->streamSamples + offset;
 
-        // Gotta steal a note, so steal the first one
-        return 0;
+        // Keep the list sorted with the earliest event last. Events for the same sample stay in the order received
+        uint8_t idx = player->scheduledCount;
+        while (idx > 0 && player->scheduled[idx - 1].sample <= sample)
+        {
+            player->scheduled[idx] = player->scheduled[idx - 1];
+            idx--;
+        }
+        player->scheduled[idx].sample = sample;
+        player->scheduled[idx].event  = timed->event;
+        player->scheduledCount++;
+
+        tail++;
+    }
+
+    // Return the slots to the queueing thread
+    __atomic_store_n(&player->timedTail, tail, __ATOMIC_RELEASE);
+
+    player->streamClock += blockUs;
+}
+
+/**
+ * @brief Apply every scheduled event which is due at the current sample
+ *
+ * @param player The MIDI player about to render a sample
+ */
+static inline void midiApplyScheduledEvents(midiPlayer_t* player)
+{
+    while (player->scheduledCount
+           && player->scheduled[player->scheduledCount - 1].sample <= player->streamSamples)
+    {
+        player->scheduledCount--;
+        handleEvent(player, &player->scheduled[player->scheduledCount].event);
     }
 }
 
@@ -396,8 +652,16 @@ static void setVoiceTimbre(midiVoice_t* voice, midiTimbre_t* timbre)
         {
             case WAVETABLE:
             {
-                swSynthSetWaveFunc(&voice->oscillators[oscIdx], timbre->waveFunc,
-                                   (void*)((uintptr_t)timbre->waveIndex));
+                const int8_t* waveTable = getWaveTable(timbre->waveFunc, timbre->waveIndex);
+                if (NULL != waveTable)
+                {
+                    swSynthSetWaveTable(&voice->oscillators[oscIdx], waveTable);
+                }
+                else
+                {
+                    swSynthSetWaveFunc(&voice->oscillators[oscIdx], timbre->waveFunc,
+                                       (void*)((uintptr_t)timbre->waveIndex));
+                }
                 voice->oscillators[oscIdx].chorus = (timbre->effects.chorus) >> 3;
                 break;
             }
@@ -540,12 +804,24 @@ static int32_t midiSumOscillators(midiPlayer_t* player)
 
         // Mix this oscillator's output into the sample
         uint8_t offset = 0;
-        do
+        if (NULL != osc->waveTable)
         {
-            sum += ((osc->waveFunc((osc->accumulator.bytes[2] + oscDither[offset]) % 256, osc->waveFuncData)
-                     * ((int32_t)osc->cVol))
-                    >> 8);
-        } while (offset++ < osc->chorus);
+            do
+            {
+                sum += ((osc->waveTable[(uint8_t)(osc->accumulator.bytes[2] + oscDither[offset])]
+                         * ((int32_t)osc->cVol))
+                        >> 8);
+            } while (offset++ < osc->chorus);
+        }
+        else
+        {
+            do
+            {
+                sum += ((osc->waveFunc((osc->accumulator.bytes[2] + oscDither[offset]) % 256, osc->waveFuncData)
+                         * ((int32_t)osc->cVol))
+                        >> 8);
+            } while (offset++ < osc->chorus);
+        }
     }
 
     return sum;
@@ -1217,8 +1493,17 @@ void midiPlayerInit(midiPlayer_t* player)
         voice->timbre = percussion ? &defaultDrumkitTimbre : &acousticGrandPianoTimbre;
     }
 
+    // Allow every voice until the load says otherwise
+    midiSetVoiceBudget(player, POOL_VOICE_COUNT, true);
+
+    for (uint8_t chanIdx = 0; chanIdx < MIDI_CHANNEL_COUNT; chanIdx++)
+    {
+        player->channels[chanIdx].priority = MIDI_DEF_CHANNEL_PRIORITY;
+    }
+
     // Set up the values which must be non-zero
     midiPlayerReset(player);
+    player->streamLatency = MIDI_DEF_STREAM_LATENCY;
 }
 
 void midiPlayerReset(midiPlayer_t* player)
@@ -1235,12 +1520,28 @@ void midiPlayerReset(midiPlayer_t* player)
 
     player->sampleCount    = 0;
     player->clipped        = 0;
+    player->peakDspLoad    = 0;
+    player->stolenNotes    = 0;
+    player->shedNotes      = 0;
     player->eventAvailable = false;
     player->volume         = UINT14_MAX;
     player->headroom       = MIDI_DEF_HEADROOM;
 
     deinitMidiParser(&player->reader);
     player->paused = true;
+
+    // Drop any commands which weren't applied, freeing their prepared readers. Resets happen on the rendering thread,
+    // or under midiPlayerLock()
+    uint32_t head = __atomic_load_n(&player->cmdHead, __ATOMIC_ACQUIRE);
+    for (uint32_t tail = player->cmdTail; tail != head; tail++)
+    {
+        const midiCommand_t* cmd = &player->cmdQueue[tail % MIDI_CMD_QUEUE_LEN];
+        if (MIDI_CMD_SET_FILE == cmd->type || MIDI_CMD_SEEK == cmd->type)
+        {
+            freePrepared(cmd->prepared);
+        }
+    }
+    __atomic_store_n(&player->cmdTail, head, __ATOMIC_RELEASE);
 }
 
 void midiPlayerResetNewSong(midiPlayer_t* player)
@@ -1330,14 +1631,23 @@ int32_t midiPlayerStep(midiPlayer_t* player)
 
 void midiPlayerFillBuffer(midiPlayer_t* player, uint8_t* samples, int16_t len)
 {
+    midiApplyCommands(player);
+
     if (player->seeking)
     {
         memset(samples, 128, len);
         return;
     }
 
+    midiScheduleTimedEvents(player, len);
+
+    int64_t start = esp_timer_get_time();
+
     for (int16_t n = 0; n < len; n++)
     {
+        midiApplyScheduledEvents(player);
+        player->streamSamples++;
+
         // Step the state forward by one sample and return the next sample sum
         int32_t sample = midiPlayerStep(player);
 
@@ -1360,10 +1670,23 @@ void midiPlayerFillBuffer(midiPlayer_t* player, uint8_t* samples, int16_t len)
             samples[n] = sample + 128;
         }
     }
+
+    midiUpdateLoad(player, esp_timer_get_time() - start, len);
 }
 
 void midiPlayerFillBufferMulti(midiPlayer_t* players, uint8_t playerCount, uint8_t* samples, int16_t len)
 {
+    for (int i = 0; i < playerCount; i++)
+    {
+        midiApplyCommands(&players[i]);
+        if (!players[i].seeking)
+        {
+            midiScheduleTimedEvents(&players[i], len);
+        }
+    }
+
+    int64_t start = esp_timer_get_time();
+
     for (int16_t n = 0; n < len; n++)
     {
         int32_t sample = 0;
@@ -1374,6 +1697,9 @@ void midiPlayerFillBufferMulti(midiPlayer_t* players, uint8_t playerCount, uint8
                 continue;
             }
 
+            midiApplyScheduledEvents(&players[i]);
+            players[i].streamSamples++;
+
             // Apply the player's headroom to its sample sum
             sample += (midiPlayerStep(&players[i]) * players[i].headroom);
         }
@@ -1395,6 +1721,13 @@ void midiPlayerFillBufferMulti(midiPlayer_t* players, uint8_t playerCount, uint8
             samples[n] = sample + 128;
         }
     }
+
+    // The players share the deadline, so they share the load
+    int64_t renderUs = esp_timer_get_time() - start;
+    for (int i = 0; i < playerCount; i++)
+    {
+        midiUpdateLoad(&players[i], renderUs, len);
+    }
 }
 
 void midiAllSoundOff(midiPlayer_t* player)
@@ -1567,8 +1900,8 @@ void midiNoteOn(midiPlayer_t* player, uint8_t chanId, uint8_t note, uint8_t velo
     // Percussion gets its own
     voiceStates_t* states = chan->percussion ? &player->percVoiceStates : &player->poolVoiceStates;
     midiVoice_t* voices   = chan->percussion ? player->percVoices : player->poolVoices;
-    uint8_t voiceCount    = chan->percussion ? PERCUSSION_VOICES : POOL_VOICE_COUNT;
-    uint32_t voiceIdx     = allocVoice(states, voiceCount);
+    uint8_t voiceCount    = chan->percussion ? PERCUSSION_VOICES : player->voiceBudget;
+    uint32_t voiceIdx     = allocVoice(player, states, voices, voiceCount);
 
     if (chan->timbre.flags & TF_MONO)
     {
@@ -1688,6 +2021,12 @@ void midiNoteOn(midiPlayer_t* player, uint8_t chanId, uint8_t note, uint8_t velo
     // This is necessary to fix stuck notes, but doesn't take care of everything
     if (stolen)
     {
+        if (0 == (voiceBit & states->release))
+        {
+            // The stolen note was still being played, so it was cut off
+            player->stolenNotes++;
+        }
+
         uint8_t stolenChannel = voices[voiceIdx].channel;
         if (player->channels[stolenChannel].percussion == chan->percussion
             && (player->channels[stolenChannel].allocedVoices & voiceBit))
@@ -1711,6 +2050,7 @@ void midiNoteOn(midiPlayer_t* player, uint8_t chanId, uint8_t note, uint8_t velo
     voice->note     = note;
     voice->channel  = chanId;
     voice->velocity = velocity;
+    voice->noteId   = ++player->noteCount;
 
     // TODO: Add a note -> voice map in the channel?
 
@@ -1719,8 +2059,10 @@ void midiNoteOn(midiPlayer_t* player, uint8_t chanId, uint8_t note, uint8_t velo
 
     if ((chan->timbre.flags & TF_PERCUSSION))
     {
-        // Reset the percussion voice state
+        // Reset the percussion voice state. The voice may have been taken from a note which was still playing, and its
+        // scratch space may hold another drum's decoder state in a different layout
         voice->sampleTick = 0;
+        memset(voice->percScratch, 0, sizeof(voice->percScratch));
     }
     else if (chan->timbre.type == SAMPLE)
     {
@@ -2357,6 +2699,19 @@ void midiSetFile(midiPlayer_t* player, const midiFile_t* song)
     }
 }
 
+void midiSetVoiceBudget(midiPlayer_t* player, uint8_t budget, bool adaptive)
+{
+    player->voiceLimit     = CLAMP(budget, 1, POOL_VOICE_COUNT);
+    player->voiceBudget    = player->voiceLimit;
+    player->adaptiveVoices = adaptive;
+    player->budgetHoldoff  = 0;
+}
+
+void midiSetChannelPriority(midiPlayer_t* player, uint8_t channel, uint8_t priority)
+{
+    player->channels[channel].priority = priority;
+}
+
 void midiPause(midiPlayer_t* player, bool pause)
 {
     player->paused = pause;
@@ -2452,6 +2807,382 @@ void midiSeek(midiPlayer_t* player, uint32_t ticks)
     midiPause(player, paused || stopped);
 }
 
+bool midiQueueCommand(midiPlayer_t* player, const midiCommand_t* cmd)
+{
+    // Only this thread writes cmdHead. The acquire pairs with the release in midiApplyCommands(), so the slot about to
+    // be overwritten is known to have been applied already
+    uint32_t head = __atomic_load_n(&player->cmdHead, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&player->cmdTail, __ATOMIC_ACQUIRE);
+    if (head - tail >= MIDI_CMD_QUEUE_LEN)
+    {
+        ESP_LOGD("MIDI", "Command queue full, dropping command %d", cmd->type);
+        return false;
+    }
+
+    player->cmdQueue[head % MIDI_CMD_QUEUE_LEN] = *cmd;
+
+    // Publish the command only after it is fully written
+    __atomic_store_n(&player->cmdHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool midiQueueNoteOn(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    midiCommand_t cmd = {
+        .type     = MIDI_CMD_NOTE_ON,
+        .channel  = channel,
+        .note     = note,
+        .velocity = velocity,
+    };
+    return midiQueueCommand(player, &cmd);
+}
+
+bool midiQueueNoteOff(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    midiCommand_t cmd = {
+        .type     = MIDI_CMD_NOTE_OFF,
+        .channel  = channel,
+        .note     = note,
+        .velocity = velocity,
+    };
+    return midiQueueCommand(player, &cmd);
+}
+
+bool midiQueueControlChange(midiPlayer_t* player, uint8_t channel, midiControl_t control, uint8_t val)
+{
+    midiCommand_t cmd = {
+        .type         = MIDI_CMD_CONTROL_CHANGE,
+        .channel      = channel,
+        .control      = control,
+        .controlValue = val,
+    };
+    return midiQueueCommand(player, &cmd);
+}
+
+bool midiQueuePitchWheel(midiPlayer_t* player, uint8_t channel, uint16_t value)
+{
+    midiCommand_t cmd = {
+        .type    = MIDI_CMD_PITCH_WHEEL,
+        .channel = channel,
+        .pitch   = value,
+    };
+    return midiQueueCommand(player, &cmd);
+}
+
+bool midiQueueSetProgram(midiPlayer_t* player, uint8_t channel, uint8_t program)
+{
+    midiCommand_t cmd = {
+        .type    = MIDI_CMD_SET_PROGRAM,
+        .channel = channel,
+        .program = program,
+    };
+    return midiQueueCommand(player, &cmd);
+}
+
+bool midiQueueAllSoundOff(midiPlayer_t* player)
+{
+    midiCommand_t cmd = {
+        .type = MIDI_CMD_ALL_SOUND_OFF,
+    };
+    return midiQueueCommand(player, &cmd);
+}
+
+bool midiQueueSetFile(midiPlayer_t* player, const midiFile_t* file)
+{
+    midiPrepared_t* prepared = heap_caps_calloc(1, sizeof(midiPrepared_t), MALLOC_CAP_8BIT);
+    if (NULL == prepared)
+    {
+        return false;
+    }
+
+    // Allocate and parse the start of each track here, rather than on the rendering thread
+    if (NULL != file && !initMidiParser(&prepared->reader, file))
+    {
+        heap_caps_free(prepared);
+        return false;
+    }
+
+    midiCommand_t cmd = {
+        .type     = MIDI_CMD_SET_FILE,
+        .prepared = prepared,
+    };
+    if (!midiQueueCommand(player, &cmd))
+    {
+        freePrepared(prepared);
+        return false;
+    }
+    return true;
+}
+
+bool midiQueuePause(midiPlayer_t* player, bool pause)
+{
+    midiCommand_t cmd = {
+        .type  = MIDI_CMD_PAUSE,
+        .pause = pause,
+    };
+    return midiQueueCommand(player, &cmd);
+}
+
+bool midiQueueTogglePause(midiPlayer_t* player)
+{
+    midiCommand_t cmd = {
+        .type = MIDI_CMD_TOGGLE_PAUSE,
+    };
+    return midiQueueCommand(player, &cmd);
+}
+
+bool midiQueueSeek(midiPlayer_t* player, uint32_t ticks)
+{
+    // Seek with a copy of the player, so the song can be replayed without holding up the renderer. It has its own
+    // voices, and no callbacks
+    midiPlayer_t* scratch    = heap_caps_malloc(sizeof(midiPlayer_t), MALLOC_CAP_SPIRAM);
+    midiPrepared_t* prepared = heap_caps_calloc(1, sizeof(midiPrepared_t), MALLOC_CAP_8BIT);
+    if (NULL == scratch || NULL == prepared)
+    {
+        heap_caps_free(scratch);
+        heap_caps_free(prepared);
+        return false;
+    }
+    midiPlayerInit(scratch);
+
+    // Copy the position in the song. Locking also applies any file change queued before this
+    midiPlayerLock(player);
+    bool copied = (MIDI_FILE == player->mode) && (NULL != player->reader.file)
+                  && copyMidiParser(&scratch->reader, &player->reader);
+    if (copied)
+    {
+        memcpy(scratch->channels, player->channels, sizeof(scratch->channels));
+        scratch->tempo          = player->tempo;
+        scratch->sampleCount    = player->sampleCount;
+        scratch->pendingEvent   = player->pendingEvent;
+        scratch->eventAvailable = player->eventAvailable;
+    }
+    midiPlayerUnlock(player);
+
+    if (!copied)
+    {
+        midiPlayerReset(scratch);
+        heap_caps_free(scratch);
+        heap_caps_free(prepared);
+        return false;
+    }
+
+    // Replay the song up to the seek point, from the start if it's behind
+    scratch->mode   = MIDI_FILE;
+    scratch->paused = false;
+    midiSeek(scratch, ticks);
+
+    // Take the reader, and the state it left the channels in. The scratch player's voices are thrown away
+    prepared->reader = scratch->reader;
+    memset(&scratch->reader, 0, sizeof(scratch->reader));
+    prepared->ticks = ticks;
+    prepared->seek  = true;
+    // midiSeek() pauses the player if it reached the end of the song
+    prepared->stopped = scratch->paused;
+    memcpy(prepared->channels, scratch->channels, sizeof(prepared->channels));
+    for (uint8_t chanIdx = 0; chanIdx < MIDI_CHANNEL_COUNT; chanIdx++)
+    {
+        prepared->channels[chanIdx].allocedVoices = 0;
+    }
+    prepared->tempo          = scratch->tempo;
+    prepared->sampleCount    = scratch->sampleCount;
+    prepared->pendingEvent   = scratch->pendingEvent;
+    prepared->eventAvailable = scratch->eventAvailable;
+
+    midiPlayerReset(scratch);
+    heap_caps_free(scratch);
+
+    midiCommand_t cmd = {
+        .type     = MIDI_CMD_SEEK,
+        .prepared = prepared,
+    };
+    if (!midiQueueCommand(player, &cmd))
+    {
+        freePrepared(prepared);
+        return false;
+    }
+    return true;
+}
+
+bool midiQueueTimedEvent(midiPlayer_t* player, const midiEvent_t* event, int64_t time)
+{
+    // Only this thread writes timedHead. The acquire pairs with the release in midiScheduleTimedEvents(), so the slot
+    // about to be overwritten is known to have been scheduled already
+    uint32_t head = __atomic_load_n(&player->timedHead, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&player->timedTail, __ATOMIC_ACQUIRE);
+    if (head - tail >= MIDI_TIMED_QUEUE_LEN)
+    {
+        ESP_LOGD("MIDI", "Timed event queue full, dropping event");
+        return false;
+    }
+
+    player->timedQueue[head % MIDI_TIMED_QUEUE_LEN].time  = time;
+    player->timedQueue[head % MIDI_TIMED_QUEUE_LEN].event = *event;
+
+    // Publish the event only after it is fully written
+    __atomic_store_n(&player->timedHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void midiSetStreamLatency(midiPlayer_t* player, uint32_t samples)
+{
+    player->streamLatency = samples;
+}
+
+void midiApplyCommands(midiPlayer_t* player)
+{
+    // Only this thread writes cmdTail. The acquire pairs with the release in midiQueueCommand(), so every command up to
+    // head is fully written
+    uint32_t head = __atomic_load_n(&player->cmdHead, __ATOMIC_ACQUIRE);
+    uint32_t tail;
+
+    // Reload the tail each time, since a song-finished callback run by a command may apply commands itself
+    while ((int32_t)(head - (tail = __atomic_load_n(&player->cmdTail, __ATOMIC_RELAXED))) > 0)
+    {
+        // Copy the command and release its slot before applying it, so it's never applied twice
+        midiCommand_t copy = player->cmdQueue[tail % MIDI_CMD_QUEUE_LEN];
+        __atomic_store_n(&player->cmdTail, tail + 1, __ATOMIC_RELEASE);
+
+        const midiCommand_t* cmd = &copy;
+        switch (cmd->type)
+        {
+            case MIDI_CMD_NOTE_ON:
+            {
+                midiNoteOn(player, cmd->channel, cmd->note, cmd->velocity);
+                break;
+            }
+
+            case MIDI_CMD_NOTE_OFF:
+            {
+                midiNoteOff(player, cmd->channel, cmd->note, cmd->velocity);
+                break;
+            }
+
+            case MIDI_CMD_CONTROL_CHANGE:
+            {
+                midiControlChange(player, cmd->channel, cmd->control, cmd->controlValue);
+                break;
+            }
+
+            case MIDI_CMD_PITCH_WHEEL:
+            {
+                midiPitchWheel(player, cmd->channel, cmd->pitch);
+                break;
+            }
+
+            case MIDI_CMD_SET_PROGRAM:
+            {
+                midiSetProgram(player, cmd->channel, cmd->program);
+                break;
+            }
+
+            case MIDI_CMD_ALL_SOUND_OFF:
+            {
+                midiAllSoundOff(player);
+                break;
+            }
+
+            case MIDI_CMD_SET_FILE:
+            case MIDI_CMD_SEEK:
+            {
+                applyPrepared(player, cmd->prepared);
+                break;
+            }
+
+            case MIDI_CMD_PAUSE:
+            {
+                midiPause(player, cmd->pause);
+                break;
+            }
+
+            case MIDI_CMD_TOGGLE_PAUSE:
+            {
+                midiPause(player, !player->paused);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Free a reader prepared by midiQueueSetFile() or midiQueueSeek()
+ *
+ * @param prepared The prepared reader to free
+ */
+static void freePrepared(midiPrepared_t* prepared)
+{
+    deinitMidiParser(&prepared->reader);
+    heap_caps_free(prepared);
+}
+
+/**
+ * @brief Swap a reader prepared by midiQueueSetFile() or midiQueueSeek() into a player, and free what's left of it
+ *
+ * @param player The MIDI player
+ * @param prepared The prepared reader to swap in
+ */
+static void applyPrepared(midiPlayer_t* player, midiPrepared_t* prepared)
+{
+    bool paused = player->paused;
+
+    if (prepared->seek)
+    {
+        // Voices from before the seek point don't carry over
+        midiAllSoundOff(player);
+    }
+
+    // Swap the readers, keeping the player's setting for text events. The old reader is freed with the prepared one
+    midiFileReader_t oldReader        = player->reader;
+    prepared->reader.handleMetaEvents = oldReader.handleMetaEvents;
+    player->reader                    = prepared->reader;
+    prepared->reader                  = oldReader;
+
+    if (NULL == player->reader.file)
+    {
+        player->mode   = MIDI_STREAMING;
+        player->paused = true;
+    }
+    else
+    {
+        player->mode = MIDI_FILE;
+    }
+
+    if (prepared->seek)
+    {
+        memcpy(player->channels, prepared->channels, sizeof(player->channels));
+        player->tempo          = prepared->tempo;
+        player->sampleCount    = prepared->sampleCount;
+        player->pendingEvent   = prepared->pendingEvent;
+        player->eventAvailable = prepared->eventAvailable;
+
+        if (prepared->stopped && (uint32_t)-1 != prepared->ticks)
+        {
+            // End the song like midiSeek() does, without looping
+            bool loop    = player->loop;
+            player->loop = false;
+            midiSongEnd(player);
+            player->loop = loop;
+        }
+        midiPause(player, paused || prepared->stopped);
+    }
+
+    freePrepared(prepared);
+}
+
+void midiPlayerLock(midiPlayer_t* player)
+{
+    dacLock();
+
+    // The renderer is stopped, so this thread may consume the queue. Apply it now so earlier queued commands don't
+    // take effect after the direct changes made under the lock
+    midiApplyCommands(player);
+}
+
+void midiPlayerUnlock(midiPlayer_t* player)
+{
+    dacUnlock();
+}
+
 //==============================================================================
 // System-wide MIDI player functions
 //==============================================================================
@@ -2460,11 +3191,16 @@ void initGlobalMidiPlayer(void)
 {
     if (!globalPlayers)
     {
-        globalPlayers = heap_caps_calloc(NUM_GLOBAL_PLAYERS, sizeof(midiPlayer_t), MALLOC_CAP_8BIT);
+        // Set up the players before publishing them, since the DAC may already be asking for samples
+        midiPlayer_t* players = heap_caps_calloc(NUM_GLOBAL_PLAYERS, sizeof(midiPlayer_t), MALLOC_CAP_8BIT);
         for (int i = 0; i < NUM_GLOBAL_PLAYERS; i++)
         {
-            midiPlayerInit(&globalPlayers[i]);
+            midiPlayerInit(&players[i]);
         }
+
+        dacLock();
+        globalPlayers = players;
+        dacUnlock();
     }
 }
 
@@ -2472,15 +3208,20 @@ void deinitGlobalMidiPlayer(void)
 {
     if (globalPlayers)
     {
+        // Take the players away from the DAC before freeing them, since it may still be asking for samples
+        dacLock();
+        midiPlayer_t* players = globalPlayers;
+        globalPlayers         = NULL;
+        dacUnlock();
+
         for (int i = 0; i < NUM_GLOBAL_PLAYERS; i++)
         {
-            midiPause(&globalPlayers[i], true);
-            midiAllSoundOff(&globalPlayers[i]);
-            midiPlayerReset(&globalPlayers[i]);
+            midiPause(&players[i], true);
+            midiAllSoundOff(&players[i]);
+            midiPlayerReset(&players[i]);
         }
 
-        heap_caps_free(globalPlayers);
-        globalPlayers = NULL;
+        heap_caps_free(players);
     }
 }
 
@@ -2502,11 +3243,13 @@ void globalMidiPlayerPlaySong(midiFile_t* song, uint8_t songIdx)
 
     if (globalPlayers)
     {
+        midiPlayerLock(&globalPlayers[songIdx]);
         midiPause(&globalPlayers[songIdx], true);
         midiPlayerResetNewSong(&globalPlayers[songIdx]);
         globalPlayers[songIdx].sampleCount = 0;
         midiSetFile(&globalPlayers[songIdx], song);
         midiPause(&globalPlayers[songIdx], false);
+        midiPlayerUnlock(&globalPlayers[songIdx]);
     }
 }
 
@@ -2514,8 +3257,11 @@ void globalMidiPlayerPlaySongCb(midiFile_t* song, uint8_t songIdx, songFinishedC
 {
     if (globalPlayers)
     {
+        // Hold the lock across both, so the song can't finish before the callback is set
+        midiPlayerLock(&globalPlayers[songIdx]);
         globalMidiPlayerPlaySong(song, songIdx);
         globalPlayers[songIdx].songFinishedCallback = cb;
+        midiPlayerUnlock(&globalPlayers[songIdx]);
     }
 }
 
@@ -2525,6 +3271,7 @@ void globalMidiPlayerSetVolume(uint8_t trackType, int32_t volumeSetting)
     {
         midiPlayer_t* player = &globalPlayers[trackType];
 
+        midiPlayerLock(player);
         if (volumeSetting <= 0)
         {
             player->volume = 0;
@@ -2537,6 +3284,7 @@ void globalMidiPlayerSetVolume(uint8_t trackType, int32_t volumeSetting)
         {
             player->volume = (1 << (volumeSetting - 1));
         }
+        midiPlayerUnlock(player);
     }
 }
 
@@ -2546,7 +3294,9 @@ void globalMidiPlayerPauseAll(void)
     {
         for (int i = 0; i < NUM_GLOBAL_PLAYERS; i++)
         {
+            midiPlayerLock(&globalPlayers[i]);
             midiPause(&globalPlayers[i], true);
+            midiPlayerUnlock(&globalPlayers[i]);
         }
     }
 }
@@ -2557,7 +3307,9 @@ void globalMidiPlayerResumeAll(void)
     {
         for (int i = 0; i < NUM_GLOBAL_PLAYERS; i++)
         {
+            midiPlayerLock(&globalPlayers[i]);
             midiPause(&globalPlayers[i], false);
+            midiPlayerUnlock(&globalPlayers[i]);
         }
     }
 }
@@ -2568,6 +3320,7 @@ void globalMidiPlayerStop(bool reset)
     {
         for (int i = 0; i < NUM_GLOBAL_PLAYERS; i++)
         {
+            midiPlayerLock(&globalPlayers[i]);
             midiPause(&globalPlayers[i], true);
 
             if (reset)
@@ -2576,6 +3329,7 @@ void globalMidiPlayerStop(bool reset)
             }
             // TODO: implement seek
             // midiSeek(&globalPlayers[i], 0);
+            midiPlayerUnlock(&globalPlayers[i]);
         }
     }
 }
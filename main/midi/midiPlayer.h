@@ -51,6 +51,78 @@
  * // Play a drum kit sound at full velocity on channel 10, which is reserved for percussion
  * midiNoteOn(player, 9, ACOUSTIC_SNARE, 0x7F);
  * \endcode
+ *
+ * \section midiPlayer_queue Command Queue
+ *
+ * A MIDI player is rendered by the DAC callback, which may run at the same time as the mode's main loop. In the
+ * emulator it runs on a separate audio thread. Calling functions like midiNoteOn() or midiSeek() directly from the main
+ * loop while the player is playing can race with rendering.
+ *
+ * Instead, the main loop can queue commands with midiQueueNoteOn(), midiQueueNoteOff(), midiQueueSeek(), and the other
+ * \c midiQueue functions. Each player has a lock-free single-producer, single-consumer ring of ::MIDI_CMD_QUEUE_LEN
+ * commands. midiPlayerFillBuffer() and midiPlayerFillBufferMulti() apply all queued commands at the start of each
+ * block, so the renderer never waits on the main loop and the player is never modified mid-block. The queue functions
+ * return false if the queue is full. Only one thread may queue commands for a given player.
+ *
+ * midiQueueSetFile() and midiQueueSeek() do their slow work on the thread queueing them. They set up the file reader,
+ * and replay the song up to the seek point, before queueing the command. The renderer only swaps the result in.
+ *
+ * \code{.c}
+ * // Play a note from the main loop while a song is playing
+ * midiQueueNoteOn(globalMidiPlayerGet(MIDI_BGM), 0, 60, 0x7F);
+ * \endcode
+ *
+ * Functions without a queued version, or changes to several fields at once, must be made while holding
+ * midiPlayerLock(). It waits for the DAC callback to return and applies any commands still queued, so they take effect
+ * in the order they were made. Samples aren't rendered while it's held, so release it with midiPlayerUnlock() soon.
+ * The \c globalMidiPlayer functions take it themselves.
+ *
+ * \code{.c}
+ * // Change the tempo and volume together
+ * midiPlayerLock(player);
+ * midiSetTempo(player, 500000);
+ * player->volume = UINT14_MAX;
+ * midiPlayerUnlock(player);
+ * \endcode
+ *
+ * \section midiPlayer_timed Timed Events
+ *
+ * Events from a live source, like a USB MIDI keyboard, arrive while earlier samples are being played. Applying each one
+ * at the start of the next block would shift it by however far into the current block it arrived, so notes would
+ * jitter by up to a block. Instead, queue the event with midiQueueTimedEvent() along with the time it arrived. At the
+ * start of each block, queued events are sorted by the sample they belong at, which is the time they arrived plus
+ * ::midiPlayer_t.streamLatency samples. Each event is then applied exactly at its sample within the block.
+ *
+ * The player keeps a clock of when each block is rendered, smoothed so that the render task waking up a little early or
+ * late doesn't move events. The default latency of one ::DAC_BUF_SIZE block is the smallest that leaves room for events
+ * which arrive just before a block is rendered. Events which arrive too late for their sample are applied at the start
+ * of the block and counted in ::midiPlayer_t.lateEvents. Set the latency with midiSetStreamLatency(). A latency of 0
+ * applies every event at the start of the next block. Only one thread may queue timed events for a player.
+ *
+ * usbMidiSetPlayer() sends USB MIDI events to a player this way, timestamped as they are received.
+ *
+ * \section midiPlayer_load Voice Budget
+ *
+ * Each player measures how long it takes to render a block of samples, as a fraction of the time the block takes to
+ * play. This is kept in ::midiPlayer_t.dspLoad, in units of ::DAC_LOAD_FULL. If rendering takes longer than playback,
+ * the DAC runs out of samples and the audio glitches. See dacGetStats() for underrun counts.
+ *
+ * To avoid that, the player limits how many pooled voices new notes may use to ::midiPlayer_t.voiceBudget. While the
+ * load is above ::MIDI_LOAD_HIGH, the budget is lowered, down to ::MIDI_MIN_VOICE_BUDGET, and new notes steal voices
+ * within the budget instead of adding more. If more voices are still playing than the budget allows, the least
+ * important ones are faded out over ::MIDI_SHED_RELEASE_TICKS samples and counted in ::midiPlayer_t.shedNotes. When the
+ * load falls below ::MIDI_LOAD_LOW, the budget slowly climbs back to ::POOL_VOICE_COUNT. Percussion voices are not
+ * limited. Call midiSetVoiceBudget() to set a fixed budget instead, i.e. for rendering offline where there is no
+ * deadline. A fixed budget also limits how much of the pool a player uses, i.e. for a player which only plays a few
+ * sound effects at once.
+ *
+ * \section midiPlayer_steal Voice Stealing
+ *
+ * When a note starts and every voice it may use is playing, one of them is stolen. Voices in their release stage are
+ * stolen before voices which are still being played. After that, voices on channels with a lower priority are stolen
+ * first, then the quietest voices, and then the oldest. Call midiSetChannelPriority() to keep i.e. a melody playing
+ * over its accompaniment. Notes which are cut off while still being played are counted in
+ * ::midiPlayer_t.stolenNotes.
  */
 
 //==============================================================================
@@ -74,6 +146,16 @@
 #define POOL_VOICE_COUNT 24
 // The number of voices reserved for percussion
 #define PERCUSSION_VOICES 8
+// The fewest pooled voices the adaptive voice budget will reduce to
+#define MIDI_MIN_VOICE_BUDGET 8
+// The DSP load above which the adaptive voice budget is lowered, where DAC_LOAD_FULL means fully loaded
+#define MIDI_LOAD_HIGH 850
+// The DSP load below which the adaptive voice budget is raised again
+#define MIDI_LOAD_LOW 600
+// The number of samples over which voices over the budget are faded out
+#define MIDI_SHED_RELEASE_TICKS 256
+// The priority channels start with. Voices on higher priority channels are stolen last
+#define MIDI_DEF_CHANNEL_PRIORITY 64
 // The number of oscillators each voice gets. Maybe we'll need more than one for like, chorus?
 #define OSC_PER_VOICE 1
 // The number of global MIDI players
@@ -110,6 +192,15 @@
 /// @brief Convert MIDI ticks to microseconds
 #define MIDI_TICKS_TO_US(ticks, tempo, div) (int64_t)((int64_t)((int64_t)(ticks) * (int64_t)(tempo)) / ((int64_t)(div)))
 
+/// @brief The number of commands which can be waiting in a MIDI player's command queue
+#define MIDI_CMD_QUEUE_LEN 32
+
+/// @brief The number of timestamped events which can be waiting in a MIDI player's timed event queue
+#define MIDI_TIMED_QUEUE_LEN 32
+
+/// @brief The default delay between a timed event arriving and being played, in samples
+#define MIDI_DEF_STREAM_LATENCY DAC_BUF_SIZE
+
 /// @brief Callback function used to provide feedback when a song finishes playing
 typedef void (*songFinishedCbFn)(void);
 
@@ -430,6 +521,91 @@ typedef void (*midiTextCallback_t)(metaEventType_t type, const char* text, uint3
  */
 typedef bool (*midiStreamingCallback_t)(midiEvent_t* event);
 
+/**
+ * @brief The kinds of commands which can be queued for a MIDI player to apply between blocks
+ */
+typedef enum
+{
+    MIDI_CMD_NOTE_ON,        ///< Call midiNoteOn()
+    MIDI_CMD_NOTE_OFF,       ///< Call midiNoteOff()
+    MIDI_CMD_CONTROL_CHANGE, ///< Call midiControlChange()
+    MIDI_CMD_PITCH_WHEEL,    ///< Call midiPitchWheel()
+    MIDI_CMD_SET_PROGRAM,    ///< Call midiSetProgram()
+    MIDI_CMD_ALL_SOUND_OFF,  ///< Call midiAllSoundOff()
+    MIDI_CMD_SET_FILE,       ///< Swap in a reader prepared by midiQueueSetFile()
+    MIDI_CMD_PAUSE,          ///< Call midiPause()
+    MIDI_CMD_TOGGLE_PAUSE,   ///< Call midiPause() with the opposite of ::midiPlayer_t.paused
+    MIDI_CMD_SEEK,           ///< Swap in a reader and channel state prepared by midiQueueSeek()
+} midiCommandType_t;
+
+typedef struct midiPrepared midiPrepared_t;
+
+/**
+ * @brief A command queued for a MIDI player, with the arguments of the function it calls
+ */
+typedef struct
+{
+    /// @brief The kind of command
+    midiCommandType_t type;
+
+    /// @brief The channel, for channel commands
+    uint8_t channel;
+
+    union
+    {
+        /// @brief The note and velocity, for ::MIDI_CMD_NOTE_ON and ::MIDI_CMD_NOTE_OFF
+        struct
+        {
+            uint8_t note;
+            uint8_t velocity;
+        };
+
+        /// @brief The controller and value, for ::MIDI_CMD_CONTROL_CHANGE
+        struct
+        {
+            midiControl_t control;
+            uint8_t controlValue;
+        };
+
+        /// @brief The 14-bit pitch wheel value, for ::MIDI_CMD_PITCH_WHEEL
+        uint16_t pitch;
+
+        /// @brief The program number, for ::MIDI_CMD_SET_PROGRAM
+        uint8_t program;
+
+        /// @brief The prepared reader to swap in, for ::MIDI_CMD_SET_FILE and ::MIDI_CMD_SEEK. It is freed once
+        /// applied
+        midiPrepared_t* prepared;
+
+        /// @brief Whether to pause or play, for ::MIDI_CMD_PAUSE
+        bool pause;
+    };
+} midiCommand_t;
+
+/**
+ * @brief A MIDI event with the time it was received, for midiQueueTimedEvent()
+ */
+typedef struct
+{
+    /// @brief The time the event was received, from esp_timer_get_time()
+    int64_t time;
+
+    /// @brief The event to apply
+    midiEvent_t event;
+} midiTimedEvent_t;
+
+/**
+ * @brief A MIDI event waiting to be applied at a particular sample
+ */
+typedef struct
+{
+    /// @brief The value of ::midiPlayer_t.streamSamples at which to apply the event
+    uint64_t sample;
+
+    /// @brief The event to apply
+    midiEvent_t event;
+} midiScheduledEvent_t;
+
 /**
  * @brief Defines the sound characteristics of a particular instrument.
  */
@@ -540,6 +716,9 @@ typedef struct
     /// @brief The index of the MIDI channel that owns the currently playing note
     uint8_t channel;
 
+    /// @brief The value of ::midiPlayer_t.noteCount when the playing note started, used to find the oldest note
+    uint32_t noteId;
+
     /// @brief The synthesizer oscillators used to generate the sounds
     synthOscillator_t oscillators[OSC_PER_VOICE];
 
@@ -633,8 +812,45 @@ typedef struct
 
     /// @brief If set, events on this channel will be completely ignored
     bool ignore;
+
+    /// @brief How important this channel's notes are when voices must be stolen. Higher priority notes are stolen last
+    uint8_t priority;
 } midiChannel_t;
 
+/**
+ * @brief A file reader set up by midiQueueSetFile() or midiQueueSeek() on the thread queueing commands, so the renderer
+ * only has to swap it in
+ */
+struct midiPrepared
+{
+    /// @brief The reader for the new file, or positioned at the seek point
+    midiFileReader_t reader;
+
+    /// @brief The tick which was seeked to, for seeks
+    uint32_t ticks;
+
+    /// @brief True if this is a seek, and the fields below are valid
+    bool seek;
+
+    /// @brief True if the seek reached the end of the song
+    bool stopped;
+
+    /// @brief The channel states at the seek point, without any voices allocated
+    midiChannel_t channels[MIDI_CHANNEL_COUNT];
+
+    /// @brief The tempo at the seek point
+    uint32_t tempo;
+
+    /// @brief The sample count at the seek point
+    uint64_t sampleCount;
+
+    /// @brief The next event after the seek point
+    midiEvent_t pendingEvent;
+
+    /// @brief True if pendingEvent is valid
+    bool eventAvailable;
+};
+
 /**
  * @brief Tracks the state of the entire MIDI apparatus.
  */
@@ -696,6 +912,35 @@ typedef struct
     /// Note: This is not set when using \c midiPlayerFillBufferMulti()
     uint32_t clipped;
 
+    /// @brief The number of pooled voices which new notes may use, up to ::POOL_VOICE_COUNT
+    uint8_t voiceBudget;
+
+    /// @brief The highest value voiceBudget may be raised to
+    uint8_t voiceLimit;
+
+    /// @brief If true, voiceBudget is adjusted automatically based on dspLoad
+    bool adaptiveVoices;
+
+    /// @brief The number of blocks to wait before raising voiceBudget again
+    uint8_t budgetHoldoff;
+
+    /// @brief The smoothed time taken to render a block, as a fraction of the time the block takes to play.
+    /// ::DAC_LOAD_FULL means rendering takes exactly as long as playback. With \c midiPlayerFillBufferMulti(), this is
+    /// the load of all the players together
+    uint16_t dspLoad;
+
+    /// @brief The highest unsmoothed value of dspLoad since the player was reset
+    uint16_t peakDspLoad;
+
+    /// @brief The total number of notes started, used to order voices by age
+    uint32_t noteCount;
+
+    /// @brief The number of notes cut off to make room for new notes since the player was reset
+    uint32_t stolenNotes;
+
+    /// @brief The number of notes faded out early to lower the DSP load since the player was reset
+    uint32_t shedNotes;
+
     /// @brief The number of samples elapsed in the playing song
     uint64_t sampleCount;
 
@@ -716,6 +961,43 @@ typedef struct
 
     /// @brief If true, the playing file will automatically repeat when complete
     bool loop;
+
+    /// @brief Commands queued by the main loop, to be applied before rendering the next block
+    midiCommand_t cmdQueue[MIDI_CMD_QUEUE_LEN];
+
+    /// @brief The total number of commands ever queued. Only written by the thread queueing commands
+    uint32_t cmdHead;
+
+    /// @brief The total number of commands ever applied. Only written by the thread rendering samples
+    uint32_t cmdTail;
+
+    /// @brief Timed events queued by midiQueueTimedEvent(), to be scheduled before rendering the next block
+    midiTimedEvent_t timedQueue[MIDI_TIMED_QUEUE_LEN];
+
+    /// @brief The total number of timed events ever queued. Only written by the thread queueing events
+    uint32_t timedHead;
+
+    /// @brief The total number of timed events ever scheduled. Only written by the thread rendering samples
+    uint32_t timedTail;
+
+    /// @brief Timed events waiting for their sample, sorted so the last one is applied first
+    midiScheduledEvent_t scheduled[MIDI_TIMED_QUEUE_LEN];
+
+    /// @brief The number of events in scheduled
+    uint8_t scheduledCount;
+
+    /// @brief The total number of samples rendered, which timed events are scheduled against. This counts even while
+    /// paused, unlike sampleCount
+    uint64_t streamSamples;
+
+    /// @brief The smoothed time at which the next block is expected to be rendered, or 0 before the first block
+    int64_t streamClock;
+
+    /// @brief The delay between a timed event arriving and being played, in samples
+    uint32_t streamLatency;
+
+    /// @brief The number of timed events which arrived too late to be played at their sample
+    uint32_t lateEvents;
 } midiPlayer_t;
 
 /**
@@ -726,7 +1008,8 @@ typedef struct
 void midiPlayerInit(midiPlayer_t* player);
 
 /**
- * @brief Reset the MIDI player state
+ * @brief Reset the MIDI player state. Commands which are still queued are dropped, so this must be called by the
+ * thread rendering samples or under midiPlayerLock()
  *
  * @param player The MIDI player to reset
  */
@@ -961,6 +1244,26 @@ void midiSetTempo(midiPlayer_t* player, uint32_t tempo);
  */
 void midiSetFile(midiPlayer_t* player, const midiFile_t* file);
 
+/**
+ * @brief Set the number of pooled voices which new notes may use
+ *
+ * @param player The MIDI player
+ * @param budget The number of voices, from 1 to ::POOL_VOICE_COUNT
+ * @param adaptive If true, the budget will be lowered automatically when the DSP load is high and raised back up to
+ * \c budget when it falls. If false, the budget is fixed
+ */
+void midiSetVoiceBudget(midiPlayer_t* player, uint8_t budget, bool adaptive);
+
+/**
+ * @brief Set how important a channel's notes are when voices must be stolen
+ *
+ * @param player The MIDI player
+ * @param channel The MIDI channel to set the priority of
+ * @param priority The priority, where notes on higher priority channels are stolen last. The default is
+ * ::MIDI_DEF_CHANNEL_PRIORITY
+ */
+void midiSetChannelPriority(midiPlayer_t* player, uint8_t channel, uint8_t priority);
+
 /**
  * @brief Set the paused state of a MIDI song
  *
@@ -982,6 +1285,164 @@ void midiPause(midiPlayer_t* player, bool pause);
  */
 void midiSeek(midiPlayer_t* player, uint32_t ticks);
 
+/**
+ * @brief Queue a command to be applied before the player renders its next block. This is safe to call while another
+ * thread is rendering, but only one thread may queue commands for a player
+ *
+ * @param player The MIDI player to queue the command for
+ * @param cmd The command to queue. It is copied
+ * @return true if the command was queued, false if the queue is full
+ */
+bool midiQueueCommand(midiPlayer_t* player, const midiCommand_t* cmd);
+
+/**
+ * @brief Queue a call to midiNoteOn()
+ *
+ * @param player The MIDI player
+ * @param channel The MIDI channel on which to start the note
+ * @param note The note number to start
+ * @param velocity The velocity of the note to start
+ * @return true if the command was queued, false if the queue is full
+ */
+bool midiQueueNoteOn(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity);
+
+/**
+ * @brief Queue a call to midiNoteOff()
+ *
+ * @param player The MIDI player
+ * @param channel The MIDI channel on which to stop the note
+ * @param note The note number to stop
+ * @param velocity The release velocity
+ * @return true if the command was queued, false if the queue is full
+ */
+bool midiQueueNoteOff(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity);
+
+/**
+ * @brief Queue a call to midiControlChange()
+ *
+ * @param player The MIDI player
+ * @param channel The MIDI channel to change a control on
+ * @param control The control to change
+ * @param val The new value of the control
+ * @return true if the command was queued, false if the queue is full
+ */
+bool midiQueueControlChange(midiPlayer_t* player, uint8_t channel, midiControl_t control, uint8_t val);
+
+/**
+ * @brief Queue a call to midiPitchWheel()
+ *
+ * @param player The MIDI player
+ * @param channel The MIDI channel to bend
+ * @param value The 14-bit pitch wheel value
+ * @return true if the command was queued, false if the queue is full
+ */
+bool midiQueuePitchWheel(midiPlayer_t* player, uint8_t channel, uint16_t value);
+
+/**
+ * @brief Queue a call to midiSetProgram()
+ *
+ * @param player The MIDI player
+ * @param channel The MIDI channel to set the program for
+ * @param program The program number
+ * @return true if the command was queued, false if the queue is full
+ */
+bool midiQueueSetProgram(midiPlayer_t* player, uint8_t channel, uint8_t program);
+
+/**
+ * @brief Queue a call to midiAllSoundOff()
+ *
+ * @param player The MIDI player
+ * @return true if the command was queued, false if the queue is full
+ */
+bool midiQueueAllSoundOff(midiPlayer_t* player);
+
+/**
+ * @brief Set up a reader for a file, and queue a command to swap it in like midiSetFile(). The reader's memory is
+ * allocated on this thread, not the renderer's
+ *
+ * @param player The MIDI player
+ * @param file A pointer to the MIDI file to be played, or NULL to stop file playback. It must remain valid while it is
+ * played
+ * @return true if the command was queued, false if the queue is full or memory could not be allocated
+ */
+bool midiQueueSetFile(midiPlayer_t* player, const midiFile_t* file);
+
+/**
+ * @brief Queue a call to midiPause()
+ *
+ * @param player The MIDI player
+ * @param pause True to pause, false to play
+ * @return true if the command was queued, false if the queue is full
+ */
+bool midiQueuePause(midiPlayer_t* player, bool pause);
+
+/**
+ * @brief Queue a command to pause the player if it is playing, or play it if it is paused. Unlike calling
+ * midiQueuePause() with the opposite of ::midiPlayer_t.paused, this uses the paused state when the command is applied
+ *
+ * @param player The MIDI player
+ * @return true if the command was queued, false if the queue is full
+ */
+bool midiQueueTogglePause(midiPlayer_t* player);
+
+/**
+ * @brief Seek the playing file like midiSeek(), without blocking the renderer. The song is replayed up to the seek
+ * point on this thread, with a copy of the player, and a command is queued to swap the result in. Notes which were
+ * held across the seek point are not carried over. This briefly locks the player with midiPlayerLock() to copy it, so
+ * it must only be used with players rendered by the DAC callback
+ *
+ * @param player The MIDI player
+ * @param ticks The absolute number of MIDI ticks to seek to, or -1 to seek to the end of the song
+ * @return true if the command was queued, false if the queue is full, memory could not be allocated, or no file is
+ * playing
+ */
+bool midiQueueSeek(midiPlayer_t* player, uint32_t ticks);
+
+/**
+ * @brief Queue a MIDI event to be applied at the sample matching the time it was received. This is safe to call while
+ * another thread is rendering, but only one thread may queue timed events for a player
+ *
+ * @param player The MIDI player to queue the event for
+ * @param event The event to queue. It is copied
+ * @param time The time the event was received, from esp_timer_get_time()
+ * @return true if the event was queued, false if the queue is full
+ */
+bool midiQueueTimedEvent(midiPlayer_t* player, const midiEvent_t* event, int64_t time);
+
+/**
+ * @brief Set the delay between a timed event arriving and being played. Longer delays leave more room for the render
+ * task to run late before events lose their timing
+ *
+ * @param player The MIDI player
+ * @param samples The delay in samples. ::MIDI_DEF_STREAM_LATENCY is the default, and 0 plays each event at the start of
+ * the next block
+ */
+void midiSetStreamLatency(midiPlayer_t* player, uint32_t samples);
+
+/**
+ * @brief Apply all commands queued for a MIDI player. This is called automatically by midiPlayerFillBuffer() and
+ * midiPlayerFillBufferMulti(), and must only be called by the thread rendering samples or by midiPlayerLock()
+ *
+ * @param player The MIDI player to apply queued commands to
+ */
+void midiApplyCommands(midiPlayer_t* player);
+
+/**
+ * @brief Keep the DAC callback from rendering a MIDI player, so it can be changed directly from the main loop. Any
+ * commands already queued for the player are applied first. This only applies to players rendered by the DAC
+ * callback, and must be followed by midiPlayerUnlock()
+ *
+ * @param player The MIDI player to lock
+ */
+void midiPlayerLock(midiPlayer_t* player);
+
+/**
+ * @brief Let the DAC callback render a MIDI player again after midiPlayerLock()
+ *
+ * @param player The MIDI player to unlock
+ */
+void midiPlayerUnlock(midiPlayer_t* player);
+
 //==============================================================================
 // Global MIDI Player Functions
 //==============================================================================
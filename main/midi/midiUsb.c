@@ -1,6 +1,8 @@
 #include "midiUsb.h"
 
 #include <esp_log.h>
+#include <esp_system.h>
+#include <esp_timer.h>
 
 #include "swadge2024.h"
 #include "tinyusb.h"
@@ -52,6 +54,15 @@ static const char* midiStringDescriptor[5] = {
     "Swadge MIDI interface", // 4: MIDI
 };
 
+/// @brief The player which received events are sent to, or NULL to leave them for usbMidiCallback()
+static midiPlayer_t* usbMidiPlayer = NULL;
+
+/// @brief The function called with each received event, or NULL
+static usbMidiMonitorCb_t usbMidiMonitor = NULL;
+
+/// @brief The number of USB receive callbacks currently running, so the player isn't changed out from under one
+static uint32_t usbMidiRxBusy = 0;
+
 /**
  * @brief MIDI Device Config Descriptor
  */
@@ -140,6 +151,58 @@ bool usbMidiCallback(midiEvent_t* event)
     return false;
 }
 
+void usbMidiSetPlayer(midiPlayer_t* player, usbMidiMonitorCb_t monitorCb)
+{
+    // Stop sending events to the old player first, then wait for any callback which already has it to finish
+    __atomic_store_n(&usbMidiPlayer, NULL, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&usbMidiRxBusy, __ATOMIC_SEQ_CST))
+    {
+        taskYIELD();
+    }
+
+    usbMidiMonitor = monitorCb;
+    __atomic_store_n(&usbMidiPlayer, player, __ATOMIC_SEQ_CST);
+}
+
+midiPlayer_t* usbMidiGetPlayer(void)
+{
+    return __atomic_load_n(&usbMidiPlayer, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Called by TinyUSB from the USB task when MIDI data is received. If a player is set, read every packet and
+ * queue it for the player with the time it arrived
+ *
+ * @param itf The MIDI interface which received data
+ */
+void tud_midi_rx_cb(uint8_t itf)
+{
+    __atomic_add_fetch(&usbMidiRxBusy, 1, __ATOMIC_SEQ_CST);
+
+    midiPlayer_t* player = __atomic_load_n(&usbMidiPlayer, __ATOMIC_SEQ_CST);
+    if (NULL != player)
+    {
+        // Everything in this callback arrived in the same USB transfer
+        int64_t now       = esp_timer_get_time();
+        uint8_t packet[4] = {0, 0, 0, 0};
+        midiEvent_t event;
+
+        while (tud_midi_available() && tud_midi_packet_read(packet))
+        {
+            if (packet[0] && handlePacket(&event, packet))
+            {
+                midiQueueTimedEvent(player, &event, now);
+                if (NULL != usbMidiMonitor)
+                {
+                    usbMidiMonitor(&event);
+                }
+            }
+        }
+    }
+
+    __atomic_sub_fetch(&usbMidiRxBusy, 1, __ATOMIC_SEQ_CST);
+}
+
 bool installMidiUsb(void)
 {
     tinyusb_config_t const tusb_cfg = {
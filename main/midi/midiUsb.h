@@ -1,6 +1,14 @@
 #pragma once
 
 #include "midiFileParser.h"
+#include "midiPlayer.h"
+
+/**
+ * @brief A function called with each MIDI event received from USB, i.e. to display it
+ *
+ * @param event The event which was received
+ */
+typedef void (*usbMidiMonitorCb_t)(const midiEvent_t* event);
 
 /**
  * @brief Check for and return the next MIDI event from USB
@@ -11,6 +19,22 @@
  */
 bool usbMidiCallback(midiEvent_t* event);
 
+/**
+ * @brief Send MIDI events from USB to a player as soon as they are received, timestamped so they play at the right
+ * sample. See midiQueueTimedEvent(). While a player is set, usbMidiCallback() won't return any events
+ *
+ * @param player The player to send events to, or NULL to stop sending events
+ * @param monitorCb A function to call with each event received, or NULL. This is called from the USB task
+ */
+void usbMidiSetPlayer(midiPlayer_t* player, usbMidiMonitorCb_t monitorCb);
+
+/**
+ * @brief Get the player which MIDI events from USB are sent to
+ *
+ * @return The player set with usbMidiSetPlayer(), or NULL if there isn't one
+ */
+midiPlayer_t* usbMidiGetPlayer(void);
+
 /**
  * @brief Install the MIDI USB driver
  *
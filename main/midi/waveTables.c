@@ -1,5 +1,6 @@
 #include "waveTables.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
 // MIDI program wavetables. Envelopes sold separately
@@ -1895,4 +1896,18 @@ int8_t waveTableFunc(uint16_t idx, void* data)
 int8_t magfestWaveTableFunc(uint16_t idx, void* data)
 {
     return waveTablesMagfest[(uint32_t)((uintptr_t)data)][idx];
-}
\ No newline at end of file
+}
+
+const int8_t* getWaveTable(waveFunc_t waveFunc, uint16_t waveIndex)
+{
+    // Let oscillators read the table directly instead of calling the function for every sample
+    if (waveFunc == waveTableFunc)
+    {
+        return waveTables[waveIndex];
+    }
+    else if (waveFunc == magfestWaveTableFunc)
+    {
+        return waveTablesMagfest[waveIndex];
+    }
+    return NULL;
+}
@@ -4,4 +4,5 @@
 #include "swSynth.h"
 
 int8_t waveTableFunc(uint16_t idx, void* data);
-int8_t magfestWaveTableFunc(uint16_t idx, void* data);
\ No newline at end of file
+int8_t magfestWaveTableFunc(uint16_t idx, void* data);
+const int8_t* getWaveTable(waveFunc_t waveFunc, uint16_t waveIndex);
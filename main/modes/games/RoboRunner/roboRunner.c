@@ -278,13 +278,17 @@ static void runnerEnterMode()
     loadFont(RODIN_EB_FONT, &rd->titleFont, true);
     loadMidiFile(CHOWA_RACE_MID, &rd->bgm, true);
     midiPlayer_t* player = globalMidiPlayerGet(MIDI_BGM);
-    player->loop         = true;
+    midiPlayerLock(player);
+    player->loop = true;
     midiGmOn(player);
     globalMidiPlayerSetVolume(MIDI_BGM, 12);
     globalMidiPlayerPlaySong(&rd->bgm, MIDI_BGM);
+    midiPlayerUnlock(player);
     rd->sfxPlayer = globalMidiPlayerGet(MIDI_SFX);
+    midiPlayerLock(rd->sfxPlayer);
     midiGmOn(rd->sfxPlayer);
     midiPause(rd->sfxPlayer, false);
+    midiPlayerUnlock(rd->sfxPlayer);
     for (int idx = 0; idx < WINDOW_COUNT; idx++)
     {
         rd->windowXCoords[idx] = idx * (TFT_WIDTH + 4 * WINDOW_BORDER + WINDOW_BORDER) / WINDOW_COUNT;
@@ -463,7 +467,7 @@ static void handleObstacles(int64_t elapsedUs)
             vec_t colVec;
             if (rd->obstacles[idx].active && rectRectIntersection(rd->robot.rect, rd->obstacles[idx].rect, &colVec))
             {
-                midiNoteOn(rd->sfxPlayer, 9, HIGH_TOM, 0x7F);
+                midiQueueNoteOn(rd->sfxPlayer, 9, HIGH_TOM, 0x7F);
                 rd->robot.dead    = true;
                 rd->robot.animIdx = 0;
                 rd->feetTraveledTotal += rd->feetTraveled;
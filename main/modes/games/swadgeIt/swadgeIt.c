@@ -885,16 +885,16 @@ static bool swadgeItInput(swadgeItEvt_t evt)
  */
 static void swadgeItAudioCallback(uint16_t* samples, uint32_t sampleCnt)
 {
-    while (sampleCnt--)
+    while (sampleCnt)
     {
-        // Get and process the sample
-        int16_t samp = *(samples++);
-
-        // Push to colorchord
-        PushSample32(&si->dd, samp);
+        // Push samples to colorchord in blocks, up to the next frame
+        uint32_t blockCnt = MIN(sampleCnt, (uint32_t)(128 - si->micSamplesProcessed));
+        PushSamples32(&si->dd, (const int16_t*)samples, blockCnt);
+        samples += blockCnt;
+        sampleCnt -= blockCnt;
 
         // If enough samples have been processed
-        si->micSamplesProcessed++;
+        si->micSamplesProcessed += blockCnt;
         if (128 == si->micSamplesProcessed)
         {
             // Handle the frame
@@ -404,7 +404,8 @@ static swadgedoku_t* sd = NULL;
 
 static void swadgedokuEnterMode(void)
 {
-    sd = calloc(1, sizeof(swadgedoku_t));
+    // The game state, its three fonts, and the note image all fit in the arena's first 16KB block
+    sd = arenaCalloc(getModeArena(), 1, sizeof(swadgedoku_t));
     if (!sd)
     {
         // make cppcheck happy
@@ -414,11 +415,11 @@ static void swadgedokuEnterMode(void)
 
     sd->screen = SWADGEDOKU_MAIN_MENU;
 
-    loadFont(RADIOSTARS_FONT, &sd->drawCtx.gridFont, true);
-    loadFont(TINY_NUMBERS_FONT, &sd->drawCtx.noteFont, true);
-    loadFont(SONIC_FONT, &sd->drawCtx.uiFont, true);
+    loadFontArena(RADIOSTARS_FONT, &sd->drawCtx.gridFont, getModeArena());
+    loadFontArena(TINY_NUMBERS_FONT, &sd->drawCtx.noteFont, getModeArena());
+    loadFontArena(SONIC_FONT, &sd->drawCtx.uiFont, getModeArena());
 
-    loadWsg(SUDOKU_NOTES_WSG, &sd->drawCtx.noteTakingIcon, true);
+    loadWsgArena(SUDOKU_NOTES_WSG, &sd->drawCtx.noteTakingIcon, getModeArena());
 
     int32_t nvsVal;
     if (!readNvs32(settingKeyMaxLevel, &nvsVal))
@@ -458,12 +459,6 @@ static void swadgedokuExitMode(void)
         free(val);
     }
 
-    freeFont(&sd->drawCtx.gridFont);
-    freeFont(&sd->drawCtx.noteFont);
-    freeFont(&sd->drawCtx.uiFont);
-
-    freeWsg(&sd->drawCtx.noteTakingIcon);
-
     free(sd->player.notes);
     free(sd->player.overlay.gridOpts);
 
@@ -474,7 +469,8 @@ static void swadgedokuExitMode(void)
     deinitMenu(sd->menu);
     deinitMenu(sd->emptyMenu);
     deinitMenu(sd->pauseMenu);
-    free(sd);
+
+    // sd was allocated from the mode arena, which is released after this returns
     sd = NULL;
 }
 
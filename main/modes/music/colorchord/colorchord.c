@@ -377,23 +377,26 @@ void colorchordAudioCb(uint16_t* samples, uint32_t sampleCnt)
     uint16_t sampleHistHead  = colorchord->sampleHistHead;
     uint16_t sampleHistCount = colorchord->sampleHistCount;
 
-    // For each sample
-    for (uint32_t idx = 0; idx < sampleCnt; idx++)
+    while (sampleCnt)
     {
-        uint16_t sample = samples[idx];
+        // Push samples to colorchord in blocks, up to the next frame
+        uint32_t blockCnt = MIN(sampleCnt, (uint32_t)(128 - colorchord->samplesProcessed));
+        PushSamples32(&colorchord->dd, (const int16_t*)samples, blockCnt);
 
-        // Push to colorchord
-        PushSample32(&colorchord->dd, sample);
-
-        sampleHist[sampleHistHead] = sample;
-        sampleHistHead++;
-        if (sampleHistHead == sampleHistCount)
+        for (uint32_t idx = 0; idx < blockCnt; idx++)
         {
-            sampleHistHead = 0;
+            sampleHist[sampleHistHead] = samples[idx];
+            sampleHistHead++;
+            if (sampleHistHead == sampleHistCount)
+            {
+                sampleHistHead = 0;
+            }
         }
+        samples += blockCnt;
+        sampleCnt -= blockCnt;
 
         // If 128 samples have been pushed
-        colorchord->samplesProcessed++;
+        colorchord->samplesProcessed += blockCnt;
         if (colorchord->samplesProcessed >= 128)
         {
             // Update LEDs
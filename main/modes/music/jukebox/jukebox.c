@@ -432,6 +432,8 @@ void jukeboxButtonCallback(buttonEvt_t* evt)
             {
                 if (jukebox->inMusicSubmode)
                 {
+                    // Set up the player and start the song together, so the DAC doesn't render it half set up
+                    midiPlayerLock(soundGetPlayerBgm());
                     if (soundGetPlayerBgm() != NULL)
                     {
                         soundGetPlayerBgm()->loop
@@ -449,9 +451,11 @@ void jukeboxButtonCallback(buttonEvt_t* evt)
 
                     soundPlayBgmCb(&musicCategories[jukebox->categoryIdx].songs[jukebox->songIdx].song, BZR_STEREO,
                                    jukeboxBzrDoneCb);
+                    midiPlayerUnlock(soundGetPlayerBgm());
                 }
                 else
                 {
+                    midiPlayerLock(soundGetPlayerSfx());
                     if (soundGetPlayerSfx() != NULL)
                     {
                         soundGetPlayerSfx()->loop
@@ -469,6 +473,7 @@ void jukeboxButtonCallback(buttonEvt_t* evt)
 
                     soundPlaySfxCb(&sfxCategories[jukebox->categoryIdx].songs[jukebox->songIdx].song, BZR_STEREO,
                                    jukeboxBzrDoneCb);
+                    midiPlayerUnlock(soundGetPlayerSfx());
                 }
                 jukebox->isPlaying            = true;
                 jukebox->usBetweenDecorations = 0;
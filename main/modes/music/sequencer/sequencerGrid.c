@@ -191,7 +191,7 @@ void addOrRemoveNote(sequencerVars_t* sv, bool playPreview)
         // Stop it first if it's currently exampling
         if (0 < sv->exampleMidiNoteTimer)
         {
-            midiNoteOff(globalMidiPlayerGet(MIDI_BGM), sv->exampleMidiChannel, sv->exampleMidiNote, MIDI_VELOCITY);
+            midiQueueNoteOff(globalMidiPlayerGet(MIDI_BGM), sv->exampleMidiChannel, sv->exampleMidiNote, MIDI_VELOCITY);
         }
 
         // Set the example note and timer
@@ -200,7 +200,7 @@ void addOrRemoveNote(sequencerVars_t* sv, bool playPreview)
         sv->exampleMidiNoteTimer = (sv->usPerBeat * 4) / (sv->noteParams.type);
 
         // Play it
-        midiNoteOn(globalMidiPlayerGet(MIDI_BGM), sv->exampleMidiChannel, sv->exampleMidiNote, MIDI_VELOCITY);
+        midiQueueNoteOn(globalMidiPlayerGet(MIDI_BGM), sv->exampleMidiChannel, sv->exampleMidiNote, MIDI_VELOCITY);
     }
 }
 
@@ -354,7 +354,7 @@ void runSequencerTimers(sequencerVars_t* sv, int32_t elapsedUs)
         if (0 >= sv->exampleMidiNoteTimer)
         {
             // Stop the example note
-            midiNoteOff(globalMidiPlayerGet(MIDI_BGM), sv->exampleMidiChannel, sv->exampleMidiNote, MIDI_VELOCITY);
+            midiQueueNoteOff(globalMidiPlayerGet(MIDI_BGM), sv->exampleMidiChannel, sv->exampleMidiNote, MIDI_VELOCITY);
         }
     }
 
@@ -458,7 +458,7 @@ void runSequencerTimers(sequencerVars_t* sv, int32_t elapsedUs)
                 {
                     // Turn the note on
                     note->isOn = true;
-                    midiNoteOn(globalMidiPlayerGet(MIDI_BGM), note->channel, note->midiNum, MIDI_VELOCITY);
+                    midiQueueNoteOn(globalMidiPlayerGet(MIDI_BGM), note->channel, note->midiNum, MIDI_VELOCITY);
                 }
             }
             // If the note is on, and shouldn't be
@@ -466,7 +466,7 @@ void runSequencerTimers(sequencerVars_t* sv, int32_t elapsedUs)
             {
                 // Turn it off
                 note->isOn = false;
-                midiNoteOff(globalMidiPlayerGet(MIDI_BGM), note->channel, note->midiNum, MIDI_VELOCITY);
+                midiQueueNoteOff(globalMidiPlayerGet(MIDI_BGM), note->channel, note->midiNum, MIDI_VELOCITY);
             }
 
             // Iterate
@@ -642,7 +642,7 @@ static void stopSequencer(sequencerVars_t* sv)
     sv->isPlaying = false;
 
     // Stop MIDI
-    midiAllSoundOff(globalMidiPlayerGet(MIDI_BGM));
+    midiQueueAllSoundOff(globalMidiPlayerGet(MIDI_BGM));
 
     // Stop here
     sv->gridOffsetTarget.x = sv->gridOffset.x;
@@ -172,6 +172,7 @@ static void sequencerEnterMode(void)
     // Init midi
     initGlobalMidiPlayer();
     midiPlayer_t* player = globalMidiPlayerGet(MIDI_BGM);
+    midiPlayerLock(player);
     // Configure MIDI for streaming
     player->mode              = MIDI_STREAMING;
     player->streamingCallback = NULL;
@@ -183,6 +184,7 @@ static void sequencerEnterMode(void)
     {
         midiSetProgram(player, instrumentVals[ch], instrumentPrograms[ch]);
     }
+    midiPlayerUnlock(player);
 
     // Start in the middle of the piano
     sv->cursorPos.y        = NUM_PIANO_KEYS / 2;
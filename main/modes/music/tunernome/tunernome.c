@@ -18,6 +18,7 @@
 
 #include "embeddedNf.h"
 #include "embeddedOut.h"
+#include "pitchDetect.h"
 #include "esp_timer.h"
 #include "linked_list.h"
 #include "mainMenu.h"
@@ -47,6 +48,10 @@
 #define CHROMATIC_OFFSET              6 // adjust start point by quarter tones
 #define SENSITIVITY                   5
 #define TONAL_DIFF_IN_TUNE_DEVIATION  10
+#define PITCH_CENTS_TO_TONAL_DIFF     4 // so the pitch detector is in tune within 2.5 cents
+#define PITCH_MAX_CENTS_OFF           100 // how far the pitch detector's note may be from a string and still count
+#define PITCH_MIN_HZ                  70
+#define PITCH_MAX_HZ                  1000
 
 // Tuner screen definitions
 #define TUNER_CENTER_Y                (TFT_HEIGHT - tunernome->ibm_vga8.height * 2 - 8 - CORNER_OFFSET)
@@ -144,6 +149,8 @@ typedef struct
     dft32_data dd;
     embeddedNf_data end;
     embeddedOut_data eod;
+    pitchDetect_t pd;
+    bool usePitchDetect;
     int audioSamplesProcessed;
     uint32_t intensities_filt[CONFIG_NUM_LEDS];
     int32_t diffs_filt[CONFIG_NUM_LEDS];
@@ -197,8 +204,8 @@ void recalcMetronome(void);
 void plotInstrumentNameAndNotesAndStrings(const char* instrumentName, const char* const* instrumentNotes,
                                           const uint16_t* stringIdxToLedIdx, uint16_t numNotes);
 void plotTopSemiCircle(int xm, int ym, int r, paletteColor_t col);
-void instrumentTunerMagic(const uint16_t freqBinIdxs[], uint16_t numStrings, led_t colors[],
-                          const uint16_t stringIdxToLedIdx[]);
+void instrumentTunerMagic(const uint16_t freqBinIdxs[], const uint8_t stringNotes[], uint16_t numStrings,
+                          led_t colors[], const uint16_t stringIdxToLedIdx[]);
 void tunernomeMainLoop(int64_t elapsedUs);
 void ledReset(void* timer_arg);
 void fasterBpmChange(void* timer_arg);
@@ -208,6 +215,7 @@ static inline int16_t getMagnitude(uint16_t idx);
 static inline int16_t getDiffAround(uint16_t idx);
 static inline int16_t getSemiMagnitude(int16_t idx);
 static inline int16_t getSemiDiffAround(uint16_t idx);
+static void getPitchTunerValues(int32_t targetCents, bool anyOctave, int16_t* intensity, int16_t* tonalDiff);
 
 /*============================================================================
  * Variables
@@ -281,6 +289,14 @@ const uint16_t freqBinIdxsBanjo[] = {
     58  // D
 };
 
+/**
+ * MIDI notes of each instrument's strings, in the same order as the freqBinIdxs arrays. Used by the pitch detector
+ */
+const uint8_t stringNotesGuitar[]  = {40, 45, 50, 55, 59, 64};
+const uint8_t stringNotesViolin[]  = {55, 62, 69, 76};
+const uint8_t stringNotesUkulele[] = {67, 60, 64, 69};
+const uint8_t stringNotesBanjo[]   = {67, 50, 55, 59, 62};
+
 const led_position_t ledIdxToPos[CONFIG_NUM_LEDS]
     = {LED_POS_DOWN, LED_POS_UP,   LED_POS_UP,   LED_POS_UP,  LED_POS_DOWN,
        LED_POS_DOWN, LED_POS_DOWN, LED_POS_DOWN, LED_POS_DOWN};
@@ -316,6 +332,8 @@ static const char rightStrMetronome1[] = "Touch: Strings";
 static const char rightStrMetronome2[] = "Pause: Metronome";
 static const char inTuneStr[]          = "In-Tune";
 static const char sharpStr[]           = "Sharp";
+static const char detectorDftStr[]     = "L/R: DFT";
+static const char detectorPitchStr[]   = "L/R: YIN";
 
 // TODO: these should be const after being assigned
 static int TUNER_FLAT_THRES_X;
@@ -386,6 +404,7 @@ void tunernomeEnterMode(void)
     switchToSubmode(TN_TUNER);
 
     InitColorChord(&tunernome->end, &tunernome->dd);
+    pitchDetectInit(&tunernome->pd, PITCH_MIN_HZ, PITCH_MAX_HZ);
 
     tunernome->blinkTimerUs     = 0;
     tunernome->clickTimerUs     = 0;
@@ -405,6 +424,9 @@ void switchToSubmode(tnMode newMode)
             // Disable speaker, enable mic
             switchToMicrophone();
 
+            // Don't detect a pitch from samples from before the mic was turned off
+            pitchDetectReset(&tunernome->pd);
+
             tunernome->mode = newMode;
 
             led_t leds[CONFIG_NUM_LEDS] = {{0}};
@@ -420,11 +442,13 @@ void switchToSubmode(tnMode newMode)
             switchToSpeaker();
 
             // Configure MIDI for streaming
-            midiPlayer_t* player      = globalMidiPlayerGet(MIDI_BGM);
+            midiPlayer_t* player = globalMidiPlayerGet(MIDI_BGM);
+            midiPlayerLock(player);
             player->mode              = MIDI_STREAMING;
             player->streamingCallback = NULL;
             midiGmOn(player);
             midiPause(player, false);
+            midiPlayerUnlock(player);
 
             tunernome->mode = newMode;
 
@@ -531,6 +555,40 @@ static inline int16_t getSemiDiffAround(uint16_t idx)
     return getSemiMagnitude(idx + 1) - getSemiMagnitude(idx - 1);
 }
 
+/**
+ * Convert the pitch detector's latest result into the intensity and tonal difference for a target note, scaled like
+ * the ones derived from the DFT so both can be displayed the same way
+ *
+ * @param targetCents The target note, in cents above MIDI note 0
+ * @param anyOctave true to compare against the target note in any octave, false to compare against that exact note
+ * @param intensity [out] How clear the detected note is, 0 to 255. This is 0 if the detected note isn't near the target
+ * @param tonalDiff [out] How sharp (positive) or flat (negative) the detected note is compared to the target
+ */
+static void getPitchTunerValues(int32_t targetCents, bool anyOctave, int16_t* intensity, int16_t* tonalDiff)
+{
+    const pitchResult_t* res = &tunernome->pd.result;
+
+    *intensity = 0;
+    *tonalDiff = 0;
+    if (!res->voiced)
+    {
+        return;
+    }
+
+    int32_t centsOff = res->cents - targetCents;
+    if (anyOctave)
+    {
+        // Wrap to the nearest octave of the target
+        centsOff = ((centsOff % 1200) + 1200 + 600) % 1200 - 600;
+    }
+
+    if (ABS(centsOff) <= PITCH_MAX_CENTS_OFF)
+    {
+        *intensity = MIN(res->clarity >> 7, 255);
+        *tonalDiff = centsOff * PITCH_CENTS_TO_TONAL_DIFF;
+    }
+}
+
 /**
  * Recalculate the per-bpm values for the metronome
  */
@@ -627,32 +685,44 @@ void plotInstrumentNameAndNotesAndStrings(const char* instrumentName, const char
  * Instrument-agnostic tuner magic. Updates LEDs
  * @param freqBinIdxs An array of the indices of notes for the instrument's strings. See freqBinIdxsGuitar for an
  * example.
+ * @param stringNotes An array of the MIDI notes of the instrument's strings, used instead of freqBinIdxs when the pitch
+ * detector is selected. See stringNotesGuitar for an example.
  * @param numStrings The number of strings on the instrument, also the number of elements in freqBinIdxs and
  * stringIdxToLedIdx, if applicable
  * @param colors The RGB colors of the LEDs to set
  * @param stringIdxToLedIdx A remapping from each index into freqBinIdxs (same index into stringIdxToLedIdx), to the
  * index of an LED to map that string/freqBinIdx to. Set to NULL to skip remapping.
  */
-void instrumentTunerMagic(const uint16_t freqBinIdxs[], uint16_t numStrings, led_t colors[],
-                          const uint16_t stringIdxToLedIdx[])
+void instrumentTunerMagic(const uint16_t freqBinIdxs[], const uint8_t stringNotes[], uint16_t numStrings,
+                          led_t colors[], const uint16_t stringIdxToLedIdx[])
 {
     uint32_t i;
     for (i = 0; i < numStrings; i++)
     {
-        // Pick out the current magnitude and filter it
-        tunernome->intensities_filt[i] = (getMagnitude(freqBinIdxs[i] + GUITAR_OFFSET) + tunernome->intensities_filt[i])
-                                         - (tunernome->intensities_filt[i] >> 5);
+        int16_t intensity, tonalDiff;
+        if (tunernome->usePitchDetect)
+        {
+            // Only the string nearest to the detected note lights up
+            getPitchTunerValues(stringNotes[i] * 100, false, &intensity, &tonalDiff);
+        }
+        else
+        {
+            // Pick out the current magnitude and filter it
+            tunernome->intensities_filt[i]
+                = (getMagnitude(freqBinIdxs[i] + GUITAR_OFFSET) + tunernome->intensities_filt[i])
+                  - (tunernome->intensities_filt[i] >> 5);
 
-        // Pick out the difference around current magnitude and filter it too
-        tunernome->diffs_filt[i] = (getDiffAround(freqBinIdxs[i] + GUITAR_OFFSET) + tunernome->diffs_filt[i])
-                                   - (tunernome->diffs_filt[i] >> 5);
+            // Pick out the difference around current magnitude and filter it too
+            tunernome->diffs_filt[i] = (getDiffAround(freqBinIdxs[i] + GUITAR_OFFSET) + tunernome->diffs_filt[i])
+                                       - (tunernome->diffs_filt[i] >> 5);
 
-        // This is the magnitude of the target frequency bin, cleaned up
-        int16_t intensity = (tunernome->intensities_filt[i] >> SENSITIVITY) - 40; // drop a baseline.
-        intensity         = CLAMP(intensity, 0, 255);
+            // This is the magnitude of the target frequency bin, cleaned up
+            intensity = (tunernome->intensities_filt[i] >> SENSITIVITY) - 40; // drop a baseline.
+            intensity = CLAMP(intensity, 0, 255);
 
-        // This is the tonal difference. You "calibrate" out the intensity.
-        int16_t tonalDiff = (tunernome->diffs_filt[i] >> SENSITIVITY) * 200 / (intensity + 1);
+            // This is the tonal difference. You "calibrate" out the intensity.
+            tonalDiff = (tunernome->diffs_filt[i] >> SENSITIVITY) * 200 / (intensity + 1);
+        }
 
         int32_t red, grn, blu;
         // Is the note in tune, i.e. is the magnitude difference in surrounding bins small?
@@ -753,7 +823,7 @@ void tunernomeMainLoop(int64_t elapsedUs)
                 if (tunernome->isSilent)
                 {
                     // Turn off tone
-                    midiNoteOff(globalMidiPlayerGet(MIDI_BGM), 0, tunernome->midiNote, 0x7F);
+                    midiQueueNoteOff(globalMidiPlayerGet(MIDI_BGM), 0, tunernome->midiNote, 0x7F);
                 }
                 break;
             }
@@ -895,6 +965,19 @@ void tunernomeMainLoop(int64_t elapsedUs)
                     drawCircleQuadrants(METRONOME_CENTER_X, TUNER_CENTER_Y, TUNER_RADIUS, false, false, true, true,
                                         c555);
 
+                    // The pitch detector is precise enough to show the number of cents off
+                    if (tunernome->usePitchDetect
+                        && tunernome->semitone_intensity_filt[tunernome->curTunerMode - SEMITONE_0] >= 1000)
+                    {
+                        char centsStr[16];
+                        snprintf(centsStr, sizeof(centsStr), "%+d cents",
+                                 tunernome->tonalDiff[tunernome->curTunerMode - SEMITONE_0]
+                                     / PITCH_CENTS_TO_TONAL_DIFF);
+                        drawText(&tunernome->ibm_vga8, c555, centsStr,
+                                 (TFT_WIDTH - textWidth(&tunernome->ibm_vga8, centsStr)) / 2,
+                                 TUNER_CENTER_Y - tunernome->ibm_vga8.height - TUNER_ARROW_Y_OFFSET);
+                    }
+
                     // Plot text on top of everything else
                     uint8_t semitoneNum = (tunernome->curTunerMode - SEMITONE_0);
                     bool shouldDrawFlat
@@ -941,6 +1024,10 @@ void tunernomeMainLoop(int64_t elapsedUs)
             drawText(&tunernome->ibm_vga8, c555, gainStr, afterText,
                      TFT_HEIGHT - tunernome->ibm_vga8.height - CORNER_OFFSET);
 
+            // Draw which detector is in use
+            drawText(&tunernome->ibm_vga8, c555, tunernome->usePitchDetect ? detectorPitchStr : detectorDftStr,
+                     CORNER_OFFSET, TFT_HEIGHT - (2 * tunernome->ibm_vga8.height) - 2 - CORNER_OFFSET);
+
             uint16_t widestRightStrMetronomeWidth = MAX(textWidth(&tunernome->ibm_vga8, rightStrMetronome1),
                                                         textWidth(&tunernome->ibm_vga8, rightStrMetronome2));
 
@@ -1071,7 +1158,7 @@ void tunernomeMainLoop(int64_t elapsedUs)
                     tunernome->clickTimerUs -= elapsedUs;
                     if (tunernome->clickTimerUs <= 0)
                     {
-                        midiNoteOff(globalMidiPlayerGet(MIDI_BGM), 0, tunernome->midiNote, 0x7F);
+                        midiQueueNoteOff(globalMidiPlayerGet(MIDI_BGM), 0, tunernome->midiNote, 0x7F);
                     }
                 }
             }
@@ -1110,7 +1197,7 @@ void tunernomeMainLoop(int64_t elapsedUs)
                 if (!tunernome->isSilent)
                 {
                     // Click  here
-                    midiNoteOn(globalMidiPlayerGet(MIDI_BGM), 0, tunernome->midiNote, 0x7F);
+                    midiQueueNoteOn(globalMidiPlayerGet(MIDI_BGM), 0, tunernome->midiNote, 0x7F);
                     tunernome->clickTimerUs = DEFAULT_FRAME_RATE_US * 3;
                 }
 
@@ -1254,9 +1341,14 @@ void tunernomeProcessButtons(buttonEvt_t* evt)
                         switchToSubmode(TN_METRONOME);
                         break;
                     }
-                    // TODO: left/right to cycle common tunings per-instrument?
                     case PB_LEFT:
                     case PB_RIGHT:
+                    {
+                        // Switch between the DFT and the pitch detector
+                        tunernome->usePitchDetect = !tunernome->usePitchDetect;
+                        pitchDetectReset(&tunernome->pd);
+                        break;
+                    }
                     case PB_SELECT:
                     default:
                     {
@@ -1378,17 +1470,24 @@ void tunernomeSampleHandler(uint16_t* samples, uint32_t sampleCnt)
 {
     if (tunernome->mode == TN_TUNER)
     {
-        for (uint32_t i = 0; i < sampleCnt; i++)
+        if (tunernome->usePitchDetect)
+        {
+            pitchDetectPush(&tunernome->pd, (const int16_t*)samples, sampleCnt);
+        }
+        else
         {
-            PushSample32(&tunernome->dd, samples[i]);
+            PushSamples32(&tunernome->dd, (const int16_t*)samples, sampleCnt);
         }
         tunernome->audioSamplesProcessed += sampleCnt;
 
         // If at least 128 samples have been processed
         if (tunernome->audioSamplesProcessed >= 128)
         {
-            // Colorchord magic
-            HandleFrameInfo(&tunernome->end, &tunernome->dd);
+            if (!tunernome->usePitchDetect)
+            {
+                // Colorchord magic
+                HandleFrameInfo(&tunernome->end, &tunernome->dd);
+            }
 
             led_t colors[CONFIG_NUM_LEDS] = {{0}};
 
@@ -1396,22 +1495,26 @@ void tunernomeSampleHandler(uint16_t* samples, uint32_t sampleCnt)
             {
                 case GUITAR_TUNER:
                 {
-                    instrumentTunerMagic(freqBinIdxsGuitar, NUM_GUITAR_STRINGS, colors, sixNoteStringIdxToLedIdx);
+                    instrumentTunerMagic(freqBinIdxsGuitar, stringNotesGuitar, NUM_GUITAR_STRINGS, colors,
+                                         sixNoteStringIdxToLedIdx);
                     break;
                 }
                 case VIOLIN_TUNER:
                 {
-                    instrumentTunerMagic(freqBinIdxsViolin, NUM_VIOLIN_STRINGS, colors, fourNoteStringIdxToLedIdx);
+                    instrumentTunerMagic(freqBinIdxsViolin, stringNotesViolin, NUM_VIOLIN_STRINGS, colors,
+                                         fourNoteStringIdxToLedIdx);
                     break;
                 }
                 case UKULELE_TUNER:
                 {
-                    instrumentTunerMagic(freqBinIdxsUkulele, NUM_UKULELE_STRINGS, colors, fourNoteStringIdxToLedIdx);
+                    instrumentTunerMagic(freqBinIdxsUkulele, stringNotesUkulele, NUM_UKULELE_STRINGS, colors,
+                                         fourNoteStringIdxToLedIdx);
                     break;
                 }
                 case BANJO_TUNER:
                 {
-                    instrumentTunerMagic(freqBinIdxsBanjo, NUM_BANJO_STRINGS, colors, fiveNoteStringIdxToLedIdx);
+                    instrumentTunerMagic(freqBinIdxsBanjo, stringNotesBanjo, NUM_BANJO_STRINGS, colors,
+                                         fiveNoteStringIdxToLedIdx);
                     break;
                 }
                 case MAX_GUITAR_MODES:
@@ -1433,6 +1536,18 @@ void tunernomeSampleHandler(uint16_t* samples, uint32_t sampleCnt)
                 {
                     for (uint8_t semitone = 0; semitone < NUM_SEMITONES; semitone++)
                     {
+                        if (tunernome->usePitchDetect)
+                        {
+                            getPitchTunerValues(semitone * 100, true, &tunernome->intensity[semitone],
+                                                &tunernome->tonalDiff[semitone]);
+
+                            // Keep the needle up while the note is detected
+                            tunernome->semitone_intensity_filt[semitone]
+                                = tunernome->intensity[semitone] ? (tunernome->intensity[semitone] + 40) << SENSITIVITY
+                                                                 : 0;
+                            continue;
+                        }
+
                         // uint8_t semitoneIdx = (tunernome->curTunerMode - SEMITONE_0) * 2;
                         uint8_t semitoneIdx = semitone * 2;
                         // Pick out the current magnitude and filter it
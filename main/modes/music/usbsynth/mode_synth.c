@@ -345,7 +345,7 @@ static void synthEnterMode(void);
 static void synthExitMode(void);
 static void synthMainLoop(int64_t elapsedUs);
 static void synthDacCallback(uint8_t* samples, int16_t len);
-static bool synthUsbMidiCbWrapper(midiEvent_t* event);
+static void synthUsbMidiMonitor(const midiEvent_t* event);
 
 static void synthSetupPlayer(void);
 static void synthApplyConfig(void);
@@ -1363,6 +1363,7 @@ swadgeMode_t synthMode = {
     .fnEspNowSendCb           = NULL,
     .fnAdvancedUSB            = NULL,
     .fnDacCb                  = synthDacCallback,
+    .arenaSize                = 64 * 1024,
 };
 
 static const uint32_t lfsrTaps[] = {
@@ -1389,10 +1390,14 @@ static synthData_t* sd;
 
 static void synthEnterMode(void)
 {
-    sd = heap_caps_calloc(1, sizeof(synthData_t), MALLOC_CAP_SPIRAM);
-    loadFont(IBM_VGA_8_FONT, &sd->font, true);
-    loadFont(SONIC_FONT, &sd->betterFont, true);
-    makeOutlineFont(&sd->betterFont, &sd->betterOutline, true);
+    // The instrument and control images and the fonts fit in the 64KB that .arenaSize reserves, so loading them takes
+    // one heap allocation instead of several hundred
+    arena_t* arena = getModeArena();
+
+    sd = arenaCalloc(arena, 1, sizeof(synthData_t));
+    loadFontArena(IBM_VGA_8_FONT, &sd->font, arena);
+    loadFontArena(SONIC_FONT, &sd->betterFont, arena);
+    makeOutlineFontArena(&sd->betterFont, &sd->betterOutline, arena);
 
     sd->perc[9] = true;
     midiPlayerInit(&sd->midiPlayer);
@@ -1576,54 +1581,54 @@ static void synthEnterMode(void)
     hashInit(&sd->menuMap, 512);
 
     // GM Instrument Category Images
-    loadWsg(PIANO_WSG, &sd->instrumentImages[0], true);
-    loadWsg(CHROMATIC_PERCUSSION_WSG, &sd->instrumentImages[1], true);
-    loadWsg(ORGAN_WSG, &sd->instrumentImages[2], true);
-    loadWsg(GUITAR_WSG, &sd->instrumentImages[3], true);
-    loadWsg(BASS_WSG, &sd->instrumentImages[4], true);
-    loadWsg(SOLO_STRINGS_WSG, &sd->instrumentImages[5], true);
-    loadWsg(ENSEMBLE_WSG, &sd->instrumentImages[6], true);
-    loadWsg(BRASS_WSG, &sd->instrumentImages[7], true);
-    loadWsg(REED_WSG, &sd->instrumentImages[8], true);
-    loadWsg(PIPE_WSG, &sd->instrumentImages[9], true);
-    loadWsg(SYNTH_LEAD_WSG, &sd->instrumentImages[10], true);
-    loadWsg(SYNTH_PAD_WSG, &sd->instrumentImages[11], true);
-    loadWsg(SYNTH_EFFECTS_WSG, &sd->instrumentImages[12], true);
-    loadWsg(ETHNIC_WSG, &sd->instrumentImages[13], true);
-    loadWsg(PERCUSSIVE_WSG, &sd->instrumentImages[14], true);
-    loadWsg(SOUND_EFFECTS_WSG, &sd->instrumentImages[15], true);
+    loadWsgArena(PIANO_WSG, &sd->instrumentImages[0], arena);
+    loadWsgArena(CHROMATIC_PERCUSSION_WSG, &sd->instrumentImages[1], arena);
+    loadWsgArena(ORGAN_WSG, &sd->instrumentImages[2], arena);
+    loadWsgArena(GUITAR_WSG, &sd->instrumentImages[3], arena);
+    loadWsgArena(BASS_WSG, &sd->instrumentImages[4], arena);
+    loadWsgArena(SOLO_STRINGS_WSG, &sd->instrumentImages[5], arena);
+    loadWsgArena(ENSEMBLE_WSG, &sd->instrumentImages[6], arena);
+    loadWsgArena(BRASS_WSG, &sd->instrumentImages[7], arena);
+    loadWsgArena(REED_WSG, &sd->instrumentImages[8], arena);
+    loadWsgArena(PIPE_WSG, &sd->instrumentImages[9], arena);
+    loadWsgArena(SYNTH_LEAD_WSG, &sd->instrumentImages[10], arena);
+    loadWsgArena(SYNTH_PAD_WSG, &sd->instrumentImages[11], arena);
+    loadWsgArena(SYNTH_EFFECTS_WSG, &sd->instrumentImages[12], arena);
+    loadWsgArena(ETHNIC_WSG, &sd->instrumentImages[13], arena);
+    loadWsgArena(PERCUSSIVE_WSG, &sd->instrumentImages[14], arena);
+    loadWsgArena(SOUND_EFFECTS_WSG, &sd->instrumentImages[15], arena);
 
     // Percussion channel image
-    loadWsg(PERCUSSION_WSG, &sd->percussionImage, true);
+    loadWsgArena(PERCUSSION_WSG, &sd->percussionImage, arena);
 
     // Custom bank image
-    loadWsg(MAGFEST_BANK_WSG, &sd->magfestBankImage, true);
+    loadWsgArena(MAGFEST_BANK_WSG, &sd->magfestBankImage, arena);
 
     // Play/Pause/Etc Icons
-    loadWsg(PAUSE_WSG, &sd->pauseIcon, true);
-    loadWsg(PLAY_WSG, &sd->playIcon, true);
-    loadWsg(PLAYPAUSE_WSG, &sd->playPauseIcon, true);
-    loadWsg(FAST_FORWARD_WSG, &sd->ffwIcon, true);
-    loadWsg(SKIP_WSG, &sd->skipIcon, true);
-    loadWsg(LOOP_WSG, &sd->loopIcon, true);
-    loadWsg(SHUFFLE_WSG, &sd->shuffleIcon, true);
-    loadWsg(STOP_WSG, &sd->stopIcon, true);
+    loadWsgArena(PAUSE_WSG, &sd->pauseIcon, arena);
+    loadWsgArena(PLAY_WSG, &sd->playIcon, arena);
+    loadWsgArena(PLAYPAUSE_WSG, &sd->playPauseIcon, arena);
+    loadWsgArena(FAST_FORWARD_WSG, &sd->ffwIcon, arena);
+    loadWsgArena(SKIP_WSG, &sd->skipIcon, arena);
+    loadWsgArena(LOOP_WSG, &sd->loopIcon, arena);
+    loadWsgArena(SHUFFLE_WSG, &sd->shuffleIcon, arena);
+    loadWsgArena(STOP_WSG, &sd->stopIcon, arena);
 
     // Images for Wheel Menu
-    loadWsg(OPEN_SONG_WSG, &sd->fileImage, true);
-    loadWsg(PLAYER_WSG, &sd->playerImage, true);
-    loadWsg(CHANNELS_WSG, &sd->channelSetupImage, true);
-    loadWsg(INTERFACE_WSG, &sd->uiImage, true);
-    loadWsg(MIDI_VOLUME_WSG, &sd->volumeImage, true);
-    loadWsg(BUTTON_A_WSG, &sd->buttonImage, true);
-    loadWsg(TOUCHPAD_WSG, &sd->touchImage, true);
-    loadWsg(VIEW_MODE_WSG, &sd->viewModeImage, true);
-    loadWsg(USB_MODE_WSG, &sd->usbModeImage, true);
-    loadWsg(HAMBURGER_WSG, &sd->menuImage, true);
-    loadWsg(PITCH_WHEEL_WSG, &sd->pitchImage, true);
-    loadWsg(RESET_WSG, &sd->resetImage, true);
-    loadWsg(IGNORE_WSG, &sd->ignoreImage, true);
-    loadWsg(ENABLE_WSG, &sd->enableImage, true);
+    loadWsgArena(OPEN_SONG_WSG, &sd->fileImage, arena);
+    loadWsgArena(PLAYER_WSG, &sd->playerImage, arena);
+    loadWsgArena(CHANNELS_WSG, &sd->channelSetupImage, arena);
+    loadWsgArena(INTERFACE_WSG, &sd->uiImage, arena);
+    loadWsgArena(MIDI_VOLUME_WSG, &sd->volumeImage, arena);
+    loadWsgArena(BUTTON_A_WSG, &sd->buttonImage, arena);
+    loadWsgArena(TOUCHPAD_WSG, &sd->touchImage, arena);
+    loadWsgArena(VIEW_MODE_WSG, &sd->viewModeImage, arena);
+    loadWsgArena(USB_MODE_WSG, &sd->usbModeImage, arena);
+    loadWsgArena(HAMBURGER_WSG, &sd->menuImage, arena);
+    loadWsgArena(PITCH_WHEEL_WSG, &sd->pitchImage, arena);
+    loadWsgArena(RESET_WSG, &sd->resetImage, arena);
+    loadWsgArena(IGNORE_WSG, &sd->ignoreImage, arena);
+    loadWsgArena(ENABLE_WSG, &sd->enableImage, arena);
 
     synthSetupMenu(true);
     setupShuffle(sd->customFiles.length);
@@ -1644,37 +1649,6 @@ static void synthExitMode(void)
         heap_caps_free(textInfo);
     }
 
-    freeWsg(&sd->fileImage);
-    freeWsg(&sd->playerImage);
-    freeWsg(&sd->channelSetupImage);
-    freeWsg(&sd->uiImage);
-    freeWsg(&sd->volumeImage);
-    freeWsg(&sd->buttonImage);
-    freeWsg(&sd->touchImage);
-    freeWsg(&sd->viewModeImage);
-    freeWsg(&sd->usbModeImage);
-    freeWsg(&sd->menuImage);
-    freeWsg(&sd->pitchImage);
-    freeWsg(&sd->resetImage);
-    freeWsg(&sd->ignoreImage);
-    freeWsg(&sd->enableImage);
-
-    freeWsg(&sd->pauseIcon);
-    freeWsg(&sd->playIcon);
-    freeWsg(&sd->playPauseIcon);
-    freeWsg(&sd->ffwIcon);
-    freeWsg(&sd->skipIcon);
-    freeWsg(&sd->loopIcon);
-    freeWsg(&sd->shuffleIcon);
-    freeWsg(&sd->stopIcon);
-
-    freeWsg(&sd->magfestBankImage);
-    freeWsg(&sd->percussionImage);
-    for (int i = 0; i < 16; i++)
-    {
-        freeWsg(&sd->instrumentImages[i]);
-    }
-
     deinitWheelMenu(sd->wheelMenu);
     deinitMenuMegaRenderer(sd->renderer);
     deinitMenu(sd->menu);
@@ -1688,6 +1662,9 @@ static void synthExitMode(void)
 
     hashDeinit(&sd->menuMap);
 
+    // Stop sending USB events to the player before it's freed
+    usbMidiSetPlayer(NULL, NULL);
+
     unloadLyrics(&sd->karaoke);
     unloadMidiFile(&sd->midiFile);
     midiPlayerReset(&sd->midiPlayer);
@@ -1711,10 +1688,7 @@ static void synthExitMode(void)
         heap_caps_free(customFilename);
     }
 
-    freeFont(&sd->betterOutline);
-    freeFont(&sd->betterFont);
-    freeFont(&sd->font);
-    heap_caps_free(sd);
+    // Everything else was allocated from the mode arena
     sd = NULL;
 }
 
@@ -1880,13 +1854,13 @@ static void synthMainLoop(int64_t elapsedUs)
                         else
                         {
                             // 50ms of note
-                            midiNoteOn(&sd->midiPlayer, 0, ++sd->startupNote, 0x7f);
+                            midiQueueNoteOn(&sd->midiPlayer, 0, ++sd->startupNote, 0x7f);
                             sd->noteTime = 50000;
                         }
                     }
                     else
                     {
-                        midiNoteOff(&sd->midiPlayer, 0, sd->startupNote, 0x7f);
+                        midiQueueNoteOff(&sd->midiPlayer, 0, sd->startupNote, 0x7f);
                         // 25ms of silence between the notes
                         sd->noteTime = 25000;
                     }
@@ -1898,7 +1872,7 @@ static void synthMainLoop(int64_t elapsedUs)
                 if (sd->noteTime <= 0)
                 {
                     // Just play each drum note with a quarter-second gap between
-                    midiNoteOn(&sd->midiPlayer, 9, sd->startupNote++, 0x7f);
+                    midiQueueNoteOn(&sd->midiPlayer, 9, sd->startupNote++, 0x7f);
                     sd->noteTime = 250000;
 
                     if (ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM <= sd->startupNote && sd->startupNote <= OPEN_TRIANGLE)
@@ -1984,23 +1958,30 @@ static void synthSetupPlayer(void)
         sd->installed = installMidiUsb();
     }
 
+    midiPlayerLock(&sd->midiPlayer);
     if (sd->fileMode)
     {
+        usbMidiSetPlayer(NULL, NULL);
         sd->midiPlayer.loop                = sd->loop;
         sd->midiPlayer.textMessageCallback = midiTextCallback;
     }
     else
     {
-        sd->midiPlayer.streamingCallback = synthUsbMidiCbWrapper;
+        // Events are timestamped as they arrive over USB, so they play at the right sample instead of the next block
+        sd->midiPlayer.streamingCallback = NULL;
         sd->midiPlayer.mode              = MIDI_STREAMING;
+        usbMidiSetPlayer(&sd->midiPlayer, synthUsbMidiMonitor);
         midiPause(&sd->midiPlayer, false);
     }
+    midiPlayerUnlock(&sd->midiPlayer);
 
     synthApplyConfig();
 }
 
 static void synthApplyConfig(void)
 {
+    // The configuration is saved to NVS below, after the player is unlocked
+    midiPlayerLock(&sd->midiPlayer);
     sd->midiPlayer.headroom = sd->headroom;
 
     if (sd->gmMode)
@@ -2044,6 +2025,7 @@ static void synthApplyConfig(void)
             memcpy(&configBlob[confCount++], inConf, sizeof(synthControlConfig_t));
         }
     }
+    midiPlayerUnlock(&sd->midiPlayer);
 
     if (confCount > 0)
     {
@@ -2615,9 +2597,11 @@ static void unloadLyrics(karaokeInfo_t* karInfo)
 static void synthSetFile(cnfsFileIdx_t fIdx)
 {
     // First: stop and reset the MIDI player
+    midiPlayerLock(&sd->midiPlayer);
     midiPlayerReset(&sd->midiPlayer);
 
     synthSetupPlayer();
+    midiPlayerUnlock(&sd->midiPlayer);
 
     // Next: Free any text that might reference the song file still
     midiTextInfo_t* textInfo = NULL;
@@ -2680,13 +2664,18 @@ static void synthSetFile(cnfsFileIdx_t fIdx)
     {
         sd->fileMode = true;
 
+        // This also runs from songEndCb() on the rendering thread, so lock the player rather than queueing
+        midiPlayerLock(&sd->midiPlayer);
         midiPlayerReset(&sd->midiPlayer);
         synthSetupPlayer();
         midiSetFile(&sd->midiPlayer, &sd->midiFile);
+        midiPlayerUnlock(&sd->midiPlayer);
         preloadLyrics(&sd->karaoke, &sd->midiFile);
 
         // And tell it to play immediately
+        midiPlayerLock(&sd->midiPlayer);
         midiPause(&sd->midiPlayer, false);
+        midiPlayerUnlock(&sd->midiPlayer);
 
         writeNvs32(nvsKeyLastSong, fIdx);
         sd->stopped = false;
@@ -2862,6 +2851,16 @@ static void drawSynthMode(int64_t elapsedUs)
         snprintf(countsBuf, sizeof(countsBuf), "%" PRIu32, sd->midiPlayer.clipped);
         drawText(&sd->font, c500, countsBuf, TFT_WIDTH - textWidth(&sd->font, countsBuf) - 15,
                  TFT_HEIGHT - sd->font.height - 15);
+
+        // Display the DSP load, voice budget, and underruns above that
+        dacStats_t dacStats;
+        dacGetStats(&dacStats);
+        char loadBuf[40];
+        snprintf(loadBuf, sizeof(loadBuf), "%" PRIu16 "%% %" PRIu8 "v %" PRIu32 "u %" PRIu32 "l",
+                 sd->midiPlayer.dspLoad / (DAC_LOAD_FULL / 100), sd->midiPlayer.voiceBudget, dacStats.underruns,
+                 dacStats.lateRefills);
+        drawText(&sd->font, (sd->midiPlayer.dspLoad > MIDI_LOAD_HIGH) ? c500 : c050, loadBuf,
+                 TFT_WIDTH - textWidth(&sd->font, loadBuf) - 15, TFT_HEIGHT - sd->font.height * 2 - 19);
     }
 
     // Draw BPM
@@ -3375,16 +3374,12 @@ static void synthDacCallback(uint8_t* samples, int16_t len)
     }
 }
 
-static bool synthUsbMidiCbWrapper(midiEvent_t* event)
+static void synthUsbMidiMonitor(const midiEvent_t* event)
 {
-    bool realResult = usbMidiCallback(event);
-
-    if (realResult && event->type == MIDI_EVENT)
+    if (event->type == MIDI_EVENT)
     {
         midiWriteEvent(sd->lastPackets[event->midi.status & 0xF], 4, event);
     }
-
-    return realResult;
 }
 
 static void synthHandleButton(const buttonEvt_t evt)
@@ -3436,13 +3431,13 @@ static void synthHandleButton(const buttonEvt_t evt)
                         const char* drumName = gmDrumNames[sd->startupNote - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM];
                         midiTextCallback(TEXT, drumName, strlen(drumName));
                     }
-                    midiNoteOn(&sd->midiPlayer, sd->localChannel, sd->startupNote, 0x7F);
+                    midiQueueNoteOn(&sd->midiPlayer, sd->localChannel, sd->startupNote, 0x7F);
                     break;
                 }
 
                 case PB_B:
                 {
-                    midiNoteOff(&sd->midiPlayer, sd->localChannel, sd->startupNote, 0x7F);
+                    midiQueueNoteOff(&sd->midiPlayer, sd->localChannel, sd->startupNote, 0x7F);
                     break;
                 }
             }
@@ -3456,7 +3451,9 @@ static void synthHandleButton(const buttonEvt_t evt)
             {
                 case PB_UP:
                 {
+                    midiPlayerLock(&sd->midiPlayer);
                     midiSetTempo(&sd->midiPlayer, BPM_TO_TEMPO(1 + TEMPO_TO_BPM(sd->midiPlayer.tempo)));
+                    midiPlayerUnlock(&sd->midiPlayer);
                     if (!sd->upHeld)
                     {
                         sd->upHeld      = true;
@@ -3468,15 +3465,21 @@ static void synthHandleButton(const buttonEvt_t evt)
                 case PB_DOWN:
                 {
                     // Tempo down
+                    midiPlayerLock(&sd->midiPlayer);
                     if (TEMPO_TO_BPM(sd->midiPlayer.tempo) > 1)
                     {
                         midiSetTempo(&sd->midiPlayer, BPM_TO_TEMPO(TEMPO_TO_BPM(sd->midiPlayer.tempo) - 1));
+                        midiPlayerUnlock(&sd->midiPlayer);
                         if (!sd->downHeld)
                         {
                             sd->downHeld      = true;
                             sd->downHeldTimer = 500000;
                         }
                     }
+                    else
+                    {
+                        midiPlayerUnlock(&sd->midiPlayer);
+                    }
                     break;
                 }
 
@@ -3492,14 +3495,14 @@ static void synthHandleButton(const buttonEvt_t evt)
                     }
                     else if (sd->fileMode && sd->midiPlayer.sampleCount > seekLeftAmt)
                     {
-                        midiSeek(&sd->midiPlayer,
-                                 SAMPLES_TO_MIDI_TICKS(sd->midiPlayer.sampleCount - seekLeftAmt, sd->midiPlayer.tempo,
-                                                       sd->midiPlayer.reader.division));
+                        midiQueueSeek(&sd->midiPlayer,
+                                      SAMPLES_TO_MIDI_TICKS(sd->midiPlayer.sampleCount - seekLeftAmt,
+                                                            sd->midiPlayer.tempo, sd->midiPlayer.reader.division));
                     }
                     else if (sd->fileMode && sd->midiPlayer.sampleCount > (DAC_SAMPLE_RATE_HZ / 2))
                     {
-                        // Restart song
-                        midiSeek(&sd->midiPlayer, 0);
+                        // Restart song. synthApplyConfig() locks the player, which applies the seek first
+                        midiQueueSeek(&sd->midiPlayer, 0);
                         synthApplyConfig();
                     }
                     else
@@ -3520,9 +3523,9 @@ static void synthHandleButton(const buttonEvt_t evt)
                     {
                         // Seek Right
                         const uint32_t seekRightAmt = DAC_SAMPLE_RATE_HZ;
-                        midiSeek(&sd->midiPlayer,
-                                 SAMPLES_TO_MIDI_TICKS(sd->midiPlayer.sampleCount + seekRightAmt, sd->midiPlayer.tempo,
-                                                       sd->midiPlayer.reader.division));
+                        midiQueueSeek(&sd->midiPlayer,
+                                      SAMPLES_TO_MIDI_TICKS(sd->midiPlayer.sampleCount + seekRightAmt,
+                                                            sd->midiPlayer.tempo, sd->midiPlayer.reader.division));
                     }
                     break;
                 }
@@ -3546,7 +3549,7 @@ static void synthHandleButton(const buttonEvt_t evt)
                         }
                         else
                         {
-                            midiPause(&sd->midiPlayer, !sd->midiPlayer.paused);
+                            midiQueueTogglePause(&sd->midiPlayer);
                         }
                     }
                     else
@@ -3560,6 +3563,7 @@ static void synthHandleButton(const buttonEvt_t evt)
                 {
                     if (sd->fileMode)
                     {
+                        midiPlayerLock(&sd->midiPlayer);
                         if (sd->midiPlayer.paused)
                         {
                             sd->stopped = true;
@@ -3570,10 +3574,11 @@ static void synthHandleButton(const buttonEvt_t evt)
                         {
                             midiPause(&sd->midiPlayer, true);
                         }
+                        midiPlayerUnlock(&sd->midiPlayer);
                     }
                     else
                     {
-                        midiAllSoundOff(&sd->midiPlayer);
+                        midiQueueAllSoundOff(&sd->midiPlayer);
                     }
                     break;
                 }
@@ -3601,7 +3606,7 @@ static void synthHandleButton(const buttonEvt_t evt)
                     if (sd->midiPlayer.sampleCount > DAC_SAMPLE_RATE_HZ)
                     {
                         // If you click left after the song has played for 1s, restart first
-                        midiSeek(&sd->midiPlayer, 0);
+                        midiQueueSeek(&sd->midiPlayer, 0);
                     }
                     else
                     {
@@ -3692,10 +3697,13 @@ static void synthHandleInput(int64_t elapsedUs)
                 if (pitch != sd->pitch)
                 {
                     sd->pitch = pitch;
+                    // Bend every channel at once, rather than filling the command queue
+                    midiPlayerLock(&sd->midiPlayer);
                     for (uint8_t ch = 0; ch < 16; ch++)
                     {
                         midiPitchWheel(&sd->midiPlayer, ch, sd->pitch);
                     }
+                    midiPlayerUnlock(&sd->midiPlayer);
                 }
             }
         }
@@ -3704,10 +3712,12 @@ static void synthHandleInput(int64_t elapsedUs)
             // Touchpad released after we set local pitch value
             sd->localPitch = false;
             sd->pitch      = 0x2000;
+            midiPlayerLock(&sd->midiPlayer);
             for (uint8_t ch = 0; ch < 16; ch++)
             {
                 midiPitchWheel(&sd->midiPlayer, ch, sd->pitch);
             }
+            midiPlayerUnlock(&sd->midiPlayer);
         }
     }
 
@@ -3720,13 +3730,13 @@ static void synthHandleInput(int64_t elapsedUs)
         {
             if (!sd->startupDrums)
             {
-                midiNoteOff(&sd->midiPlayer, 0, sd->startupNote, 0x7f);
+                midiQueueNoteOff(&sd->midiPlayer, 0, sd->startupNote, 0x7f);
                 sd->startupDrums = true;
                 sd->startupNote  = ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM;
             }
             else
             {
-                midiNoteOff(&sd->midiPlayer, 0, sd->startupNote, 0x7f);
+                midiQueueNoteOff(&sd->midiPlayer, 0, sd->startupNote, 0x7f);
                 sd->startupSeqComplete = true;
             }
         }
@@ -4097,9 +4107,11 @@ static void synthMenuCb(const char* label, bool selected, uint32_t value)
 
                 // not file mode
                 // synthSetFile(NULL);
+                midiPlayerLock(&sd->midiPlayer);
                 midiPlayerReset(&sd->midiPlayer);
 
                 synthSetupPlayer();
+                midiPlayerUnlock(&sd->midiPlayer);
 
                 writeNvs32(nvsKeyMode, sd->fileMode);
             }
@@ -4157,8 +4169,10 @@ static void synthMenuCb(const char* label, bool selected, uint32_t value)
             sd->screen = SS_VIEW;
         }
 
-        sd->loop            = value ? true : false;
+        sd->loop = value ? true : false;
+        midiPlayerLock(&sd->midiPlayer);
         sd->midiPlayer.loop = sd->loop;
+        midiPlayerUnlock(&sd->midiPlayer);
     }
     else if (label == menuItemShuffle)
     {
@@ -4291,8 +4305,10 @@ static void synthMenuCb(const char* label, bool selected, uint32_t value)
     }
     else if (label == menuItemHeadroom)
     {
-        sd->headroom            = value;
+        sd->headroom = value;
+        midiPlayerLock(&sd->midiPlayer);
         sd->midiPlayer.headroom = sd->headroom;
+        midiPlayerUnlock(&sd->midiPlayer);
         writeNvs32(nvsKeyHeadroom, value);
     }
     else if (label == menuItemSelectChan)
@@ -4357,15 +4373,15 @@ static void synthMenuCb(const char* label, bool selected, uint32_t value)
                         saveControl = false;
                         if (selected)
                         {
-                            midiControlChange(&sd->midiPlayer, sd->menuSelectedChannel, desc->control, 0);
+                            midiQueueControlChange(&sd->midiPlayer, sd->menuSelectedChannel, desc->control, 0);
                         }
                     }
                     else
                     {
                         if (desc->type == CTRL_SWITCH)
                         {
-                            midiControlChange(&sd->midiPlayer, sd->menuSelectedChannel, desc->control,
-                                              BOOL_TO_MIDI(value));
+                            midiQueueControlChange(&sd->midiPlayer, sd->menuSelectedChannel, desc->control,
+                                                   BOOL_TO_MIDI(value));
                         }
                         else if (desc->type == CTRL_CC_LSB || desc->type == CTRL_CC_MSB)
                         {
@@ -4381,13 +4397,15 @@ static void synthMenuCb(const char* label, bool selected, uint32_t value)
                                 lsbControl = desc->control & ~1;
                             }
 
-                            midiControlChange(&sd->midiPlayer, sd->menuSelectedChannel, msbControl,
-                                              (value >> 7) & 0x7F);
-                            midiControlChange(&sd->midiPlayer, sd->menuSelectedChannel, lsbControl, value & 0x7F);
+                            midiQueueControlChange(&sd->midiPlayer, sd->menuSelectedChannel, msbControl,
+                                                   (value >> 7) & 0x7F);
+                            midiQueueControlChange(&sd->midiPlayer, sd->menuSelectedChannel, lsbControl,
+                                                   value & 0x7F);
                         }
                         else if (desc->type == CTRL_7BIT)
                         {
-                            midiControlChange(&sd->midiPlayer, sd->menuSelectedChannel, desc->control, value & 0x7F);
+                            midiQueueControlChange(&sd->midiPlayer, sd->menuSelectedChannel, desc->control,
+                                                   value & 0x7F);
                         }
                     }
 
@@ -38,15 +38,17 @@ void initCredits(credits_t* credits, font_t* font, const creditsEntry_t* entries
     // Init MIDI player is initialized
     initGlobalMidiPlayer();
     midiPlayer_t* player = globalMidiPlayerGet(MIDI_BGM);
-    midiGmOn(player);
 
     // Load the MIDI file
     loadMidiFile(HD_CREDITS_MID, &credits->song, true);
-    midiSetFile(player, &credits->song);
 
     // Play the song
+    midiPlayerLock(player);
+    midiGmOn(player);
+    midiSetFile(player, &credits->song);
     player->loop = true;
     midiPause(player, false);
+    midiPlayerUnlock(player);
 
     // Turn off LEDs
     led_t leds[CONFIG_NUM_LEDS] = {0};
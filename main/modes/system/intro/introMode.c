@@ -753,14 +753,16 @@ static void introMainLoop(int64_t elapsedUs)
  */
 void introAudioCallback(uint16_t* samples, uint32_t sampleCnt)
 {
-    // For each sample
-    for (uint32_t idx = 0; idx < sampleCnt; idx++)
+    while (sampleCnt)
     {
-        // Push to test
-        PushSample32(&iv->dd, samples[idx]);
+        // Push samples in blocks, up to the next frame
+        uint32_t blockCnt = MIN(sampleCnt, (uint32_t)(128 - iv->samplesProcessed));
+        PushSamples32(&iv->dd, (const int16_t*)samples, blockCnt);
+        samples += blockCnt;
+        sampleCnt -= blockCnt;
 
         // If 128 samples have been pushed
-        iv->samplesProcessed++;
+        iv->samplesProcessed += blockCnt;
         if (iv->samplesProcessed >= 128)
         {
             // Update LEDs
@@ -837,10 +839,12 @@ static void introTutorialCb(tutorialState_t* state, const tutorialStep_t* prev,
 
             // Set and play the song
             midiPlayer_t* player = globalMidiPlayerGet(MIDI_BGM);
+            midiPlayerLock(player);
             midiGmOn(player);
             midiSetFile(player, &iv->song);
             player->loop = true;
             midiPause(player, false);
+            midiPlayerUnlock(player);
 
             iv->drawMode = DRAW_SPK;
         }
@@ -270,7 +270,9 @@ static void mainMenuEnterMode(void)
 #endif
     loadMidiFile(SECRET_MID, &mainMenu->fanfare, true);
     initGlobalMidiPlayer();
+    midiPlayerLock(globalMidiPlayerGet(MIDI_BGM));
     midiGmOn(globalMidiPlayerGet(MIDI_BGM));
+    midiPlayerUnlock(globalMidiPlayerGet(MIDI_BGM));
 
     // Allocate the menu
     mainMenu->menu = initMenu(mainMenuTitle, mainMenuCb);
@@ -194,10 +194,12 @@ void testEnterMode(void)
     loadMidiFile(HD_CREDITS_MID, &test->song, true);
     switchToSpeaker();
     midiPlayer_t* player = globalMidiPlayerGet(MIDI_BGM);
+    midiPlayerLock(player);
     midiGmOn(player);
     midiSetFile(player, &test->song);
     player->loop = true;
     midiPause(player, false);
+    midiPlayerUnlock(player);
     test->spkActive = true;
 
     // Clear out accel setting.
@@ -776,14 +778,16 @@ void testReadAndValidateTouch(void)
  */
 void testAudioCb(uint16_t* samples, uint32_t sampleCnt)
 {
-    // For each sample
-    for (uint32_t idx = 0; idx < sampleCnt; idx++)
+    while (sampleCnt)
     {
-        // Push to test
-        PushSample32(&test->dd, samples[idx]);
+        // Push samples in blocks, up to the next frame
+        uint32_t blockCnt = MIN(sampleCnt, (uint32_t)(128 - test->samplesProcessed));
+        PushSamples32(&test->dd, (const int16_t*)samples, blockCnt);
+        samples += blockCnt;
+        sampleCnt -= blockCnt;
 
         // If 128 samples have been pushed
-        test->samplesProcessed++;
+        test->samplesProcessed += blockCnt;
         if (test->samplesProcessed >= 128)
         {
             // Update LEDs
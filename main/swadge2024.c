@@ -238,6 +238,23 @@
     #error "Define what hardware is being built for"
 #endif
 
+/// @brief The maximum number of boot phases which may be timestamped
+#define MAX_BOOT_PHASES 24
+
+/// @brief The size of each block added to the mode arena when it fills up
+#define MODE_ARENA_BLOCK_SIZE (16 * 1024)
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/// @brief A timestamp for a single phase of boot
+typedef struct
+{
+    const char* name; ///< The name of the phase which just completed
+    int64_t tUs;      ///< The time at which the phase completed, in microseconds since boot
+} bootPhase_t;
+
 //==============================================================================
 // Variables
 //==============================================================================
@@ -263,10 +280,25 @@ static int64_t timeExitPressed = 0;
 
 /// @brief System font
 static font_t sysFont;
+/// @brief true if the system font has been loaded. It's loaded lazily by getSysFont() or deferred after boot
+static bool sysFontLoaded = false;
+
+/// @brief Timestamps for the boot phases, reported after the deferred initialization completes
+static bootPhase_t bootPhases[MAX_BOOT_PHASES];
+/// @brief The number of boot phases which have been timestamped
+static uint8_t numBootPhases = 0;
+/// @brief The index of the next deferred initialization function to run, see runDeferredInit()
+static uint8_t deferredInitIdx = 0;
 
 /// @brief Infinite impulse response filter for mic samples
 static uint32_t samp_iir = 0;
 
+/// @brief Memory which lives as long as the current Swadge mode, see getModeArena()
+static arena_t modeArena;
+
+/// @brief true if the current mode has been entered and not exited, so dacCallback() may call its fnDacCb
+static bool modeDacReady = false;
+
 //==============================================================================
 // Function declarations
 //==============================================================================
@@ -277,6 +309,13 @@ static void swadgeModeEspNowSendCb(const uint8_t* mac_addr, esp_now_send_status_
 static void setSwadgeMode(void* swadgeMode);
 static void initOptionalPeripherals(void);
 static void dacCallback(uint8_t* samples, int16_t len);
+static void markBootPhase(const char* name);
+static void reportBootPhases(void);
+static bool runDeferredInit(void);
+static void loadSysFont(void);
+static void reserveModeArena(void);
+static void releaseModeArena(void);
+static void setModeDacReady(bool ready);
 
 //==============================================================================
 // Functions
@@ -287,6 +326,8 @@ static void dacCallback(uint8_t* samples, int16_t len);
  */
 void app_main(void)
 {
+    markBootPhase("start");
+
     // Make sure there isn't a pin conflict
     if (GPIO_SAO_1 != GPIO_NUM_17)
     {
@@ -298,9 +339,11 @@ void app_main(void)
 
     // Init NVS. Do this first to get test mode status and crashwrap logs
     initNvs(true);
+    markBootPhase("nvs");
 
     // Read settings from NVS
     readAllSettings();
+    markBootPhase("settings");
 
 #ifdef CONFIG_FACTORY_TEST_NORMAL
     // If test mode was passed
@@ -347,9 +390,11 @@ void app_main(void)
 #endif
         );
     }
+    markBootPhase("usb");
 
     // Check for prior crash info and install crash wrapper
     checkAndInstallCrashwrap();
+    markBootPhase("crashwrap");
 
     /* This function is called from startup code. Applications do not need to
      * call this function before using other esp_timer APIs. Before calling
@@ -359,6 +404,7 @@ void app_main(void)
 
     // Init file system
     initCnfs();
+    markBootPhase("cnfs");
 
     // Init buttons and touch pads
     gpio_num_t pushButtons[] = {
@@ -381,6 +427,7 @@ void app_main(void)
     };
     initButtons(pushButtons, sizeof(pushButtons) / sizeof(pushButtons[0]), touchPads,
                 sizeof(touchPads) / sizeof(touchPads[0]));
+    markBootPhase("buttons");
 
     // Init TFT, use a different LEDC channel than buzzer
     initTFT(SPI2_HOST,
@@ -394,8 +441,10 @@ void app_main(void)
             LEDC_CHANNEL_2,             // Channel to use for PWM backlight
             LEDC_TIMER_2,               // Timer to use for PWM backlight
             getTftBrightnessSetting()); // TFT Brightness
+    markBootPhase("tft");
 
     initShapes();
+    markBootPhase("shapes");
 
     // Initialize the RGB LEDs
     gpio_num_t ledMirrorGpio = GPIO_NUM_NC;
@@ -407,18 +456,21 @@ void app_main(void)
 #endif
 
     initLeds(GPIO_NUM_39, ledMirrorGpio, getLedBrightnessSetting());
+    markBootPhase("leds");
 
     initCh32v003(GPIO_SAO_2);
+    markBootPhase("ch32v003");
 
     // Initialize optional peripherals, depending on the mode's requests
     initOptionalPeripherals();
+    markBootPhase("peripherals");
 
     // Initialize the loop timer
     static int64_t tLastLoopUs = 0;
     tLastLoopUs                = esp_timer_get_time();
 
-    // Initialize system font and trophy-get sound
-    loadFont(IBM_VGA_8_FONT, &sysFont, true);
+    // The system font and username system are not needed for the first frame. They are initialized by
+    // runDeferredInit() after the first frame is drawn, or on demand if the mode uses them sooner
 
     // Initialize the swadge mode
     if (NULL != cSwadgeMode->fnEnterMode)
@@ -427,11 +479,11 @@ void app_main(void)
         {
             trophySystemInit(cSwadgeMode->trophyData, cSwadgeMode->modeName);
         }
+        reserveModeArena();
         cSwadgeMode->fnEnterMode();
     }
-
-    // Initialize username settings
-    initUsernameSystem();
+    setModeDacReady(true);
+    markBootPhase("mode enter");
 
     // Run the main loop, forever
     while (true)
@@ -468,10 +520,7 @@ void app_main(void)
             }
         }
 
-#if defined(CONFIG_SOUND_OUTPUT_SPEAKER)
-        // Check if a DAC buffer needs to be filled
-        dacPoll();
-#elif defined(CONFIG_SOUND_OUTPUT_BUZZER)
+#if defined(CONFIG_SOUND_OUTPUT_BUZZER)
         // Check for buzzer callback flags from the ISR
         bzrCheckSongDone();
 #endif
@@ -481,8 +530,8 @@ void app_main(void)
             checkEspNowRxQueue();
         }
 
-        // Only draw to the TFT every frameRateUs
-        static uint64_t tAccumDraw = 0;
+        // Only draw to the TFT every frameRateUs. Start with a full accumulation so the first frame is drawn ASAP
+        static uint64_t tAccumDraw = DEFAULT_FRAME_RATE_US;
         tAccumDraw += tElapsedUs;
         if (tAccumDraw >= frameRateUs)
         {
@@ -534,30 +583,41 @@ void app_main(void)
                 // Lower the flag
                 shouldShowQuickSettings = false;
 
-                // Save the current mode
+                // Save the current mode. The mode under the quick settings keeps rendering audio
+                setModeDacReady(false);
                 modeBehindQuickSettings = cSwadgeMode;
                 cSwadgeMode             = &quickSettingsMode;
                 // Show the quick settings
                 quickSettingsMode.fnEnterMode();
+                setModeDacReady(true);
             }
             else if (shouldHideQuickSettings)
             {
                 // Lower the flag
                 shouldHideQuickSettings = false;
                 // Hide the quick settings
+                setModeDacReady(false);
                 quickSettingsMode.fnExitMode();
                 // Restore the mode
                 cSwadgeMode = modeBehindQuickSettings;
+                setModeDacReady(true);
             }
 
             // If trophies are not null, draw
             if (NULL != cSwadgeMode->trophyData)
             {
-                trophyDraw(&sysFont, mainLoopCallDelay);
+                trophyDraw(getSysFont(), mainLoopCallDelay);
             }
 
             // Draw to the TFT
             drawDisplayTft(cSwadgeMode->fnBackgroundDrawCallback);
+
+            // Run one deferred initialization function after each frame, in the idle time before the next one
+            if (runDeferredInit())
+            {
+                // All done, print the boot timing
+                reportBootPhases();
+            }
         }
 
         // If the mode should be switched, do it now
@@ -583,11 +643,13 @@ void app_main(void)
         taskYIELD();
     }
 
-    // Deinitialize the swadge mode
+    // Deinitialize the swadge mode. Keep the DAC from calling into it first
+    setModeDacReady(false);
     if (NULL != cSwadgeMode->fnExitMode)
     {
         cSwadgeMode->fnExitMode();
     }
+    releaseModeArena();
 
     deinitSystem();
 }
@@ -608,6 +670,10 @@ static void initOptionalPeripherals(void)
     }
     else
     {
+#if defined(CONFIG_SOUND_OUTPUT_SPEAKER)
+        // The players must be ready before the DAC starts asking them for samples
+        initGlobalMidiPlayer();
+#endif
         setDacShutdown(false);
 
         // Otherwise initialize the battery monitor as a oneshot ADC
@@ -620,7 +686,6 @@ static void initOptionalPeripherals(void)
         initDac(DAC_CHANNEL_MASK_CH0, // GPIO_NUM_17
                 GPIO_NUM_18, dacCallback);
         dacStart();
-        initGlobalMidiPlayer();
 #elif defined(CONFIG_SOUND_OUTPUT_BUZZER)
     #error "Buzzer is no longer supported, get with the times!"
 #endif
@@ -655,19 +720,26 @@ static void initOptionalPeripherals(void)
 void deinitSystem(void)
 {
     // Deinit font and sfx
-    freeFont(&sysFont);
+    if (sysFontLoaded)
+    {
+        freeFont(&sysFont);
+        sysFontLoaded = false;
+    }
 
-    // Deinit the swadge mode
+    // Deinit the swadge mode. Keep the DAC from calling into it first
+    setModeDacReady(false);
     if (NULL != cSwadgeMode->fnExitMode)
     {
         cSwadgeMode->fnExitMode();
     }
+    releaseModeArena();
 
     // Deinitialize everything
     deinitButtons();
 #if defined(CONFIG_SOUND_OUTPUT_SPEAKER)
-    deinitGlobalMidiPlayer();
+    // Stop the DAC first so the render task isn't using the players when they're freed
     deinitDac();
+    deinitGlobalMidiPlayer();
 #elif defined(CONFIG_SOUND_OUTPUT_BUZZER)
     deinitBuzzer();
 #endif
@@ -728,11 +800,13 @@ static void setSwadgeMode(void* swadgeMode)
         swadgeMode = &mainMenuMode;
     }
 
-    // Stop the prior mode
+    // Stop the prior mode. Keep the DAC from calling into it first
+    setModeDacReady(false);
     if (cSwadgeMode->fnExitMode)
     {
         cSwadgeMode->fnExitMode();
     }
+    releaseModeArena();
 
     // Set and start the new mode
     cSwadgeMode = swadgeMode;
@@ -742,8 +816,10 @@ static void setSwadgeMode(void* swadgeMode)
         {
             trophySystemInit(cSwadgeMode->trophyData, cSwadgeMode->modeName);
         }
+        reserveModeArena();
         cSwadgeMode->fnEnterMode();
     }
+    setModeDacReady(true);
 }
 
 /**
@@ -766,11 +842,13 @@ void softSwitchToPendingSwadge(void)
 {
     if (pendingSwadgeMode)
     {
-        // Exit the current mode
+        // Exit the current mode. Keep the DAC from calling into it first
+        setModeDacReady(false);
         if (NULL != cSwadgeMode->fnExitMode)
         {
             cSwadgeMode->fnExitMode();
         }
+        releaseModeArena();
 
         // Stop the music
         soundStop(true);
@@ -789,8 +867,10 @@ void softSwitchToPendingSwadge(void)
             {
                 trophySystemInit(cSwadgeMode->trophyData, cSwadgeMode->modeName);
             }
+            reserveModeArena();
             cSwadgeMode->fnEnterMode();
         }
+        setModeDacReady(true);
 
         // Reenable the TFT backlight
         enableTFTBacklight();
@@ -875,15 +955,33 @@ uint32_t getFrameRateUs(void)
 }
 
 /**
- * @brief
+ * @brief Let dacCallback() call the current mode's fnDacCb, or keep it from doing so. This waits for a running
+ * callback to return, so the mode may be exited and its memory released safely after this is called with false
+ *
+ * @param ready true if the current mode has been entered, false if it is about to be exited
+ */
+static void setModeDacReady(bool ready)
+{
+#if defined(CONFIG_SOUND_OUTPUT_SPEAKER)
+    dacLock();
+    modeDacReady = ready;
+    dacUnlock();
+#else
+    modeDacReady = ready;
+#endif
+}
+
+/**
+ * @brief Fill a buffer of DAC samples from the current mode's fnDacCb, or from the global MIDI player if the mode
+ * doesn't have one or is being switched
  *
- * @param samples
- * @param len
+ * @param samples The buffer to fill
+ * @param len The number of samples to fill
  */
 void dacCallback(uint8_t* samples, int16_t len)
 {
-    // If there is a DAC callback for the current mode
-    if (cSwadgeMode->fnDacCb)
+    // If there is a DAC callback for the current mode, and it's safe to call
+    if (modeDacReady && cSwadgeMode->fnDacCb)
     {
         // Call that
         cSwadgeMode->fnDacCb(samples, len);
@@ -904,11 +1002,11 @@ void switchToSpeaker(void)
     stopMic();
     deinitMic();
 
-    // Start the speaker
+    // Start the speaker. The players are made first, so they're ready before the DAC asks them for samples
+    initGlobalMidiPlayer();
     initDac(DAC_CHANNEL_MASK_CH0, // GPIO_NUM_17
             GPIO_NUM_18, dacCallback);
     setDacShutdown(false);
-    initGlobalMidiPlayer();
 
     // Start battery monitoring
     initBattmon(GPIO_NUM_6);
@@ -922,11 +1020,11 @@ void switchToMicrophone(void)
     // Stop battery monitoring
     deinitBattmon();
 
-    // Stop the speaker
-    globalMidiPlayerStop(true);
-    deinitGlobalMidiPlayer();
+    // Stop the speaker. The DAC is stopped first so the render task isn't using the players when they're freed
     setDacShutdown(true);
     deinitDac();
+    globalMidiPlayerStop(true);
+    deinitGlobalMidiPlayer();
 
     // Reset the IIR
     samp_iir = 0;
@@ -992,11 +1090,142 @@ void powerUpPeripherals(void)
     }
 }
 
+/**
+ * @brief Get the Swadge mode which is currently running. This may be the quick settings mode.
+ *
+ * @return The current Swadge mode
+ */
+const swadgeMode_t* getCurrentSwadgeMode(void)
+{
+    return cSwadgeMode;
+}
+
 /**
  * @brief Get the Sys Ibm Font. Font is pre-loaded fto ensure a font is always available for devs to use.
  *
+ * The font is loaded after the first frame is drawn at boot. If it's requested before then, it is loaded here.
  */
 font_t* getSysFont(void)
 {
+    loadSysFont();
     return &sysFont;
 }
+
+/**
+ * @brief Get the arena for memory which lives as long as the current Swadge mode. Memory allocated from this arena
+ * must not be freed, it is all released after the mode's swadgeMode_t.fnExitMode is called.
+ *
+ * @return The mode arena
+ */
+arena_t* getModeArena(void)
+{
+    if (0 == modeArena.blockSize)
+    {
+        // The mode didn't ask for a reservation, so start with the default block size
+        arenaInit(&modeArena, MODE_ARENA_BLOCK_SIZE, MODE_ARENA_BLOCK_SIZE, MALLOC_CAP_SPIRAM);
+    }
+    return &modeArena;
+}
+
+/**
+ * @brief Reserve the mode arena before the mode is entered, if the mode requested it with swadgeMode_t.arenaSize
+ */
+static void reserveModeArena(void)
+{
+    if (cSwadgeMode->arenaSize && 0 == modeArena.blockSize)
+    {
+        arenaInit(&modeArena, cSwadgeMode->arenaSize, MODE_ARENA_BLOCK_SIZE, MALLOC_CAP_SPIRAM);
+    }
+}
+
+/**
+ * @brief Release everything allocated from the mode arena after the mode has exited
+ */
+static void releaseModeArena(void)
+{
+    if (modeArena.blockSize)
+    {
+        ESP_LOGI("ARENA", "%s used %zu bytes (peak) in %" PRIu32 " allocations", cSwadgeMode->modeName, modeArena.peak,
+                 modeArena.numAllocs);
+        arenaDeinit(&modeArena);
+    }
+}
+
+/**
+ * @brief Load the system font if it isn't loaded yet
+ */
+static void loadSysFont(void)
+{
+    if (!sysFontLoaded)
+    {
+        loadFont(IBM_VGA_8_FONT, &sysFont, true);
+        sysFontLoaded = true;
+    }
+}
+
+/**
+ * @brief Record the time at which a boot phase completed. These are reported after boot by reportBootPhases()
+ *
+ * @param name The name of the phase which just completed. This must be a string literal
+ */
+static void markBootPhase(const char* name)
+{
+    if (numBootPhases < MAX_BOOT_PHASES)
+    {
+        bootPhases[numBootPhases].name = name;
+        bootPhases[numBootPhases].tUs  = esp_timer_get_time();
+        numBootPhases++;
+    }
+}
+
+/**
+ * @brief Print the time each boot phase took to the debug output. This is done after boot completes so that USB
+ * debug output is available and printing doesn't slow down the boot itself
+ */
+static void reportBootPhases(void)
+{
+    for (uint8_t i = 1; i < numBootPhases; i++)
+    {
+        ESP_LOGI("BOOT", "%-12s %8" PRId64 " us, %8" PRId64 " us since boot", bootPhases[i].name,
+                 bootPhases[i].tUs - bootPhases[i - 1].tUs, bootPhases[i].tUs);
+    }
+}
+
+/**
+ * @brief Run the next initialization function which isn't required to draw the first frame. Each call runs at most one
+ * function so that the deferred work is spread across frames.
+ *
+ * @return true if the last deferred function was just run, false if there are more to run or they were all already run
+ */
+static bool runDeferredInit(void)
+{
+    // Initialization which doesn't need to happen before the first frame is drawn
+    static void (*const deferredInits[])(void) = {
+        initUsernameSystem,
+        loadSysFont,
+    };
+
+    if (deferredInitIdx > ARRAY_SIZE(deferredInits))
+    {
+        // Everything was already run
+        return false;
+    }
+    else if (0 == deferredInitIdx)
+    {
+        // This is the first call, right after the first frame was drawn
+        markBootPhase("first frame");
+    }
+    else
+    {
+        // Run the next deferred function
+        deferredInits[deferredInitIdx - 1]();
+    }
+
+    deferredInitIdx++;
+    if (deferredInitIdx > ARRAY_SIZE(deferredInits))
+    {
+        markBootPhase("deferred");
+        return true;
+    }
+    return false;
+}
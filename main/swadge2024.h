@@ -212,6 +212,7 @@
 #include "p2pConnection.h"
 
 // General utilities
+#include "arena.h"
 #include "linked_list.h"
 #include "macros.h"
 #include "trigonometry.h"
@@ -281,6 +282,13 @@ typedef struct swadgeMode
      */
     bool overrideSelectBtn;
 
+    /**
+     * @brief This is a setting, not a function pointer. If this is non-zero, this many bytes are reserved from SPIRAM
+     * for getModeArena() before fnEnterMode() is called. If the arena fills up, smaller blocks are added as needed.
+     * All of it is released after fnExitMode() is called. If this is zero, the arena is reserved on first use instead.
+     */
+    uint32_t arenaSize;
+
     /**
      * @brief This function is called when this mode is started. It should initialize variables and start the mode.
      */
@@ -392,6 +400,8 @@ void powerDownPeripherals(void);
 void powerUpPeripherals(void);
 
 // Getters
+const swadgeMode_t* getCurrentSwadgeMode(void);
+arena_t* getModeArena(void);
 font_t* getSysFont(void);
 midiFile_t* getSysSound(void);
 
@@ -0,0 +1,264 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+
+#include "arena.h"
+#include "macros.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// Round a size up to the arena alignment
+#define ARENA_ROUND(s) (((s) + (ARENA_ALIGN - 1)) & ~((size_t)ARENA_ALIGN - 1))
+
+/// The size of a block header, rounded so the data after it is aligned
+#define ARENA_HDR_SIZE ARENA_ROUND(sizeof(arenaBlock_t))
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static arenaBlock_t* arenaNewBlock(arena_t* arena, size_t size);
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Allocate a new block from the heap. It is not linked into the arena
+ *
+ * @param arena The arena to allocate a block for
+ * @param size The number of usable bytes in the block
+ * @return The new block, or NULL if the heap is exhausted
+ */
+static arenaBlock_t* arenaNewBlock(arena_t* arena, size_t size)
+{
+    arenaBlock_t* block = heap_caps_malloc_tag(ARENA_HDR_SIZE + size, arena->caps, "arena");
+    if (NULL == block)
+    {
+        ESP_LOGE("ARENA", "Failed to allocate a %zu byte block", size);
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    arena->numBlocks++;
+    return block;
+}
+
+/**
+ * @brief Initialize an arena and reserve its first block
+ *
+ * @param arena The arena to initialize
+ * @param reserve The size of the first block, in bytes. This should be large enough for everything expected to be
+ * allocated from the arena
+ * @param blockSize The size of each block added when the arena fills up, in bytes
+ * @param caps The heap capabilities to allocate blocks with, i.e. \c MALLOC_CAP_SPIRAM or \c MALLOC_CAP_8BIT
+ * @return true if the first block was reserved, false if the heap is exhausted. The arena may still be used either
+ * way
+ */
+bool arenaInit(arena_t* arena, size_t reserve, size_t blockSize, uint32_t caps)
+{
+    memset(arena, 0, sizeof(arena_t));
+    arena->blockSize = ARENA_ROUND(blockSize);
+    arena->caps      = caps;
+    arena->blocks    = arenaNewBlock(arena, ARENA_ROUND(reserve));
+    arena->first     = arena->blocks;
+    return NULL != arena->blocks;
+}
+
+/**
+ * @brief Allocate memory from an arena. This memory must not be freed, it is released by arenaReset() or
+ * arenaDeinit(). The memory is not zeroed
+ *
+ * @param arena The arena to allocate from
+ * @param size The number of bytes to allocate
+ * @return A pointer to the memory, aligned to ::ARENA_ALIGN bytes, or NULL if the heap is exhausted
+ */
+void* arenaAlloc(arena_t* arena, size_t size)
+{
+    size = ARENA_ROUND(size);
+
+    arenaBlock_t* block = arena->blocks;
+    if (NULL == block || block->size - block->used < size)
+    {
+        if (size > arena->blockSize)
+        {
+            // Large allocations get a dedicated block, linked behind the current one so its free space isn't lost
+            block = arenaNewBlock(arena, size);
+            if (NULL == block)
+            {
+                return NULL;
+            }
+            if (NULL != arena->blocks)
+            {
+                block->next         = arena->blocks->next;
+                arena->blocks->next = block;
+            }
+            else
+            {
+                arena->blocks = block;
+            }
+        }
+        else
+        {
+            // Start a new block
+            block = arenaNewBlock(arena, arena->blockSize);
+            if (NULL == block)
+            {
+                return NULL;
+            }
+            block->next   = arena->blocks;
+            arena->blocks = block;
+        }
+    }
+
+    void* mem = ((uint8_t*)block) + ARENA_HDR_SIZE + block->used;
+    block->used += size;
+
+    arena->numAllocs++;
+    arena->used += size;
+    if (arena->used > arena->peak)
+    {
+        arena->peak = arena->used;
+    }
+    return mem;
+}
+
+/**
+ * @brief Allocate zeroed memory for an array from an arena. This memory must not be freed, it is released by
+ * arenaReset() or arenaDeinit()
+ *
+ * @param arena The arena to allocate from
+ * @param num The number of elements to allocate
+ * @param size The size of each element
+ * @return A pointer to the zeroed memory, or NULL if the heap is exhausted
+ */
+void* arenaCalloc(arena_t* arena, size_t num, size_t size)
+{
+    void* mem = arenaAlloc(arena, num * size);
+    if (NULL != mem)
+    {
+        memset(mem, 0, num * size);
+    }
+    return mem;
+}
+
+/**
+ * @brief Release all allocations from an arena. The block reserved by arenaInit() is kept for reuse and the rest are
+ * returned to the heap
+ *
+ * @param arena The arena to reset
+ */
+void arenaReset(arena_t* arena)
+{
+    if (arena->numAllocs)
+    {
+        ESP_LOGD("ARENA", "Reset after %" PRIu32 " allocations, %zu bytes in %" PRIu32 " blocks", arena->numAllocs,
+                 arena->used, arena->numBlocks);
+    }
+
+    // The reserved block isn't always at the end of the chain, since large allocations are linked in behind the
+    // current block
+    arenaBlock_t* block = arena->blocks;
+    while (NULL != block)
+    {
+        arenaBlock_t* next = block->next;
+        if (block != arena->first)
+        {
+            heap_caps_free(block);
+            arena->numBlocks--;
+        }
+        block = next;
+    }
+
+    if (NULL != arena->first)
+    {
+        arena->first->next = NULL;
+        arena->first->used = 0;
+    }
+    arena->blocks    = arena->first;
+    arena->numAllocs = 0;
+    arena->used      = 0;
+}
+
+/**
+ * @brief Release all allocations from an arena and return all of its blocks to the heap
+ *
+ * @param arena The arena to deinitialize
+ */
+void arenaDeinit(arena_t* arena)
+{
+    arenaReset(arena);
+    if (NULL != arena->first)
+    {
+        heap_caps_free(arena->first);
+    }
+    memset(arena, 0, sizeof(arena_t));
+}
+
+#ifdef TEST_ARENA
+
+/**
+ * @brief Check the blocks an arena holds after a reset, and exit if they're wrong
+ *
+ * @param arena The arena which was just reset
+ * @param reserve The size the arena's first block was reserved with
+ */
+static void validateReset(arena_t* arena, size_t reserve)
+{
+    if (1 != arena->numBlocks || arena->blocks != arena->first || NULL != arena->blocks->next
+        || ARENA_ROUND(reserve) != arena->blocks->size || 0 != arena->blocks->used || 0 != arena->used)
+    {
+        ESP_LOGE("ARENA", "Reset kept %" PRIu32 " blocks, the current one is %zu bytes", arena->numBlocks,
+                 (NULL == arena->blocks) ? 0 : arena->blocks->size);
+        exit(1);
+    }
+}
+
+/**
+ * @brief Check that resetting an arena keeps only the block reserved by arenaInit(), no matter how the other blocks
+ * were chained on
+ */
+void arenaTester(void)
+{
+    const size_t reserve   = 1000;
+    const size_t blockSize = 256;
+    arena_t arena;
+    arenaInit(&arena, reserve, blockSize, MALLOC_CAP_8BIT);
+
+    // An oversized allocation while the reserved block is current is linked in behind it
+    arenaAlloc(&arena, reserve * 4);
+    arenaReset(&arena);
+    validateReset(&arena, reserve);
+
+    // The whole reserve must still be usable without a new block
+    arenaAlloc(&arena, reserve);
+    if (1 != arena.numBlocks)
+    {
+        ESP_LOGE("ARENA", "The reserved block was not reused");
+        exit(1);
+    }
+
+    // Fill the reserved block, then chain on normal and oversized blocks
+    for (int i = 0; i < 8; i++)
+    {
+        arenaAlloc(&arena, blockSize / 2);
+        arenaAlloc(&arena, blockSize * 2);
+    }
+    arenaReset(&arena);
+    validateReset(&arena, reserve);
+
+    arenaDeinit(&arena);
+    ESP_LOGD("ARENA", "Arena validated");
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*! \file arena.h
+ *
+ * \section arena_design Design Philosophy
+ *
+ * An arena is a bump allocator. Memory is reserved from the heap in large blocks, and each allocation just advances a
+ * pointer within the current block. Individual allocations are never freed. Instead, the whole arena is released at
+ * once with arenaReset() or arenaDeinit().
+ *
+ * This is a good fit for data that lives exactly as long as a Swadge mode. Instead of dozens of
+ * heap_caps_malloc()/heap_caps_free() pairs spread across a mode's enter and exit functions, the mode allocates from
+ * getModeArena() and the system releases everything after the mode's ::swadgeMode_t.fnExitMode is called. This means
+ * fewer calls into the heap allocator, no per-allocation header overhead, and no fragmentation left behind after the
+ * mode exits.
+ *
+ * The first block is reserved up front, and should be sized for everything the arena is expected to hold. When the
+ * current block is full, a new block is chained on. Allocations larger than the block size get a dedicated block. All
+ * allocations are aligned to 8 bytes.
+ *
+ * Lists and hash maps can be backed by an arena too. See ::list_t.arena and hashInitArena().
+ *
+ * \section arena_usage Usage
+ *
+ * For mode-lifetime data, call getModeArena() and allocate from it with arenaAlloc() or arenaCalloc(). Do not free
+ * this memory, the system will do it. Set ::swadgeMode_t.arenaSize to reserve the first block before the mode's
+ * ::swadgeMode_t.fnEnterMode is called. Assets can be loaded into an arena with loadWsgArena(), loadFontArena(), and
+ * makeOutlineFontArena(), and must not be freed with freeWsg() or freeFont() afterwards.
+ *
+ * For a private arena, call arenaInit() with the size to reserve, the size of any further blocks, and the heap
+ * capabilities to allocate blocks with, i.e. \c MALLOC_CAP_SPIRAM or \c MALLOC_CAP_8BIT. arenaReset() releases all
+ * allocations but keeps the first block for reuse, and arenaDeinit() returns all memory to the heap.
+ *
+ * \section arena_example Example
+ *
+ * \code{.c}
+ * // Allocate the mode's data from the mode arena. There is no need to free it in the exit function
+ * myModeData_t* md = arenaCalloc(getModeArena(), 1, sizeof(myModeData_t));
+ *
+ * // Lists backed by the mode arena don't need to be cleared either
+ * md->items.arena = getModeArena();
+ * push(&md->items, someItem);
+ * \endcode
+ */
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/// @brief The alignment of every arena allocation, in bytes
+#define ARENA_ALIGN 8
+
+/**
+ * @brief A single block of arena memory. Blocks are chained so the arena can grow
+ */
+typedef struct arenaBlock
+{
+    struct arenaBlock* next; ///< The previously filled block, or NULL
+    size_t size;             ///< The number of usable bytes in this block
+    size_t used;             ///< The number of bytes already allocated from this block
+} arenaBlock_t;
+
+/**
+ * @brief A bump allocator that releases all of its allocations at once
+ */
+typedef struct
+{
+    arenaBlock_t* blocks; ///< The current block, which links to all prior blocks
+    arenaBlock_t* first;  ///< The block reserved by arenaInit(), which arenaReset() keeps, or NULL
+    size_t blockSize;     ///< The size of each block added when the arena fills up, in bytes
+    uint32_t caps;        ///< The heap capabilities used when allocating blocks
+    uint32_t numAllocs;   ///< The number of allocations made since the last reset
+    uint32_t numBlocks;   ///< The number of blocks currently reserved from the heap
+    size_t used;          ///< The number of bytes allocated since the last reset
+    size_t peak;          ///< The largest value of used since the arena was initialized
+} arena_t;
+
+bool arenaInit(arena_t* arena, size_t reserve, size_t blockSize, uint32_t caps);
+void* arenaAlloc(arena_t* arena, size_t size);
+void* arenaCalloc(arena_t* arena, size_t num, size_t size);
+void arenaReset(arena_t* arena);
+void arenaDeinit(arena_t* arena);
+
+#ifdef TEST_ARENA
+// Check that resetting an arena keeps only its reserved block
+void arenaTester(void);
+#endif
+
+#endif
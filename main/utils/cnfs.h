@@ -30,6 +30,9 @@
  * There is more SPI RAM available, but it is slower to access than normal RAM.
  * Swadge modes should use normal RAM if they can, and use SPI RAM if the mode is asset-heavy.
  *
+ * Assets which are stored uncompressed may instead be used straight from flash with loadWsgMapped() and
+ * loadTxtMapped(), which take no RAM at all.
+ *
  * \section cnfs_example Example
  *
  * \code{.c}
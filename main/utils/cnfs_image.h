@@ -0,0 +1,401 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t len;    ///< The length of the file
+    uint32_t offset; ///< The offset of the file in cnfs_data[]
+} cnfsFileEntry;
+
+typedef enum
+{
+    _55_ARROW_PZL_WSG = 0, ///< 55-arrow_PZL.wsg
+    _55_ARROW_SLV_WSG = 1, ///< 55-arrow_SLV.wsg
+    _55_CHECK_PZL_WSG = 2, ///< 55-check_PZL.wsg
+    _55_CHECK_SLV_WSG = 3, ///< 55-check_SLV.wsg
+    _55_CROWN_PZL_WSG = 4, ///< 55-crown_PZL.wsg
+    _55_CROWN_SLV_WSG = 5, ///< 55-crown_SLV.wsg
+    _55_FLOWER_PZL_WSG = 6, ///< 55-flower_PZL.wsg
+    _55_FLOWER_SLV_WSG = 7, ///< 55-flower_SLV.wsg
+    _55_GHOST_PZL_WSG = 8, ///< 55-ghost_PZL.wsg
+    _55_GHOST_SLV_WSG = 9, ///< 55-ghost_SLV.wsg
+    _55_HEART_PZL_WSG = 10, ///< 55-heart_PZL.wsg
+    _55_HEART_SLV_WSG = 11, ///< 55-heart_SLV.wsg
+    _55_KITTY_PZL_WSG = 12, ///< 55-kitty_PZL.wsg
+    _55_KITTY_SLV_WSG = 13, ///< 55-kitty_SLV.wsg
+    _55_PACMAN_PZL_WSG = 14, ///< 55-pacman_PZL.wsg
+    _55_PACMAN_SLV_WSG = 15, ///< 55-pacman_SLV.wsg
+    _55_RAINBOW_PZL_WSG = 16, ///< 55-rainbow_PZL.wsg
+    _55_RAINBOW_SLV_WSG = 17, ///< 55-rainbow_SLV.wsg
+    _55_TRIANGLE_PZL_WSG = 18, ///< 55-triangle_PZL.wsg
+    _55_TRIANGLE_SLV_WSG = 19, ///< 55-triangle_SLV.wsg
+    _6F_MAG_1_PZL_WSG = 20, ///< 6F-mag1_PZL.wsg
+    _6F_MAG_1_SLV_WSG = 21, ///< 6F-mag1_SLV.wsg
+    _6F_MAG_2_PZL_WSG = 22, ///< 6F-mag2_PZL.wsg
+    _6F_MAG_2_SLV_WSG = 23, ///< 6F-mag2_SLV.wsg
+    _6F_MAG_3_PZL_WSG = 24, ///< 6F-mag3_PZL.wsg
+    _6F_MAG_3_SLV_WSG = 25, ///< 6F-mag3_SLV.wsg
+    _6F_MAGLOGO_PZL_WSG = 26, ///< 6F-maglogo_PZL.wsg
+    _6F_MAGLOGO_SLV_WSG = 27, ///< 6F-maglogo_SLV.wsg
+    _6F_MUSIC_PZL_WSG = 28, ///< 6F-music_PZL.wsg
+    _6F_MUSIC_SLV_WSG = 29, ///< 6F-music_SLV.wsg
+    _8F_FLYINDONUT_PZL_WSG = 30, ///< 8F-flyindonut_PZL.wsg
+    _8F_FLYINDONUT_SLV_WSG = 31, ///< 8F-flyindonut_SLV.wsg
+    _8F_MTYPE_PZL_WSG = 32, ///< 8F-mtype_PZL.wsg
+    _8F_MTYPE_SLV_WSG = 33, ///< 8F-mtype_SLV.wsg
+    _8F_PERSONALDEMON_PZL_WSG = 34, ///< 8F-personaldemon_PZL.wsg
+    _8F_PERSONALDEMON_SLV_WSG = 35, ///< 8F-personaldemon_SLV.wsg
+    _8F_SHREDDER_PZL_WSG = 36, ///< 8F-shredder_PZL.wsg
+    _8F_SHREDDER_SLV_WSG = 37, ///< 8F-shredder_SLV.wsg
+    _8F_STOMP_PZL_WSG = 38, ///< 8F-stomp_PZL.wsg
+    _8F_STOMP_SLV_WSG = 39, ///< 8F-stomp_SLV.wsg
+    AA_APPLE_PZL_WSG = 40, ///< AA-apple_PZL.wsg
+    AA_APPLE_SLV_WSG = 41, ///< AA-apple_SLV.wsg
+    AA_BABA_PZL_WSG = 42, ///< AA-baba_PZL.wsg
+    AA_BABA_SLV_WSG = 43, ///< AA-baba_SLV.wsg
+    AA_DRAGONBALL_PZL_WSG = 44, ///< AA-dragonball_PZL.wsg
+    AA_DRAGONBALL_SLV_WSG = 45, ///< AA-dragonball_SLV.wsg
+    AA_HEARTPIECE_PZL_WSG = 46, ///< AA-heartpiece_PZL.wsg
+    AA_HEARTPIECE_SLV_WSG = 47, ///< AA-heartpiece_SLV.wsg
+    AA_METROID_PZL_WSG = 48, ///< AA-metroid_PZL.wsg
+    AA_METROID_SLV_WSG = 49, ///< AA-metroid_SLV.wsg
+    AA_MOONSTICK_PZL_WSG = 50, ///< AA-moonstick_PZL.wsg
+    AA_MOONSTICK_SLV_WSG = 51, ///< AA-moonstick_SLV.wsg
+    AA_PEACH_PZL_WSG = 52, ///< AA-peach_PZL.wsg
+    AA_PEACH_SLV_WSG = 53, ///< AA-peach_SLV.wsg
+    AA_POKEBALL_PZL_WSG = 54, ///< AA-pokeball_PZL.wsg
+    AA_POKEBALL_SLV_WSG = 55, ///< AA-pokeball_SLV.wsg
+    AA_SWORD_PZL_WSG = 56, ///< AA-sword_PZL.wsg
+    AA_SWORD_SLV_WSG = 57, ///< AA-sword_SLV.wsg
+    AA_TOADSTOOL_PZL_WSG = 58, ///< AA-toadstool_PZL.wsg
+    AA_TOADSTOOL_SLV_WSG = 59, ///< AA-toadstool_SLV.wsg
+    AF_DONUTJUMP_PZL_WSG = 60, ///< AF-donutjump_PZL.wsg
+    AF_DONUTJUMP_SLV_WSG = 61, ///< AF-donutjump_SLV.wsg
+    AF_PICROSS_PZL_WSG = 62, ///< AF-picross_PZL.wsg
+    AF_PICROSS_SLV_WSG = 63, ///< AF-picross_SLV.wsg
+    AF_SUPERSWADGELAND_PZL_WSG = 64, ///< AF-superswadgeland_PZL.wsg
+    AF_SUPERSWADGELAND_SLV_WSG = 65, ///< AF-superswadgeland_SLV.wsg
+    AF_SWADGEBROS_PZL_WSG = 66, ///< AF-swadgebros_PZL.wsg
+    AF_SWADGEBROS_SLV_WSG = 67, ///< AF-swadgebros_SLV.wsg
+    AF_TILTRADS_PZL_WSG = 68, ///< AF-tiltrads_PZL.wsg
+    AF_TILTRADS_SLV_WSG = 69, ///< AF-tiltrads_SLV.wsg
+    BARREL_1_WSG = 70, ///< Barrel-1.wsg
+    BARREL_2_WSG = 71, ///< Barrel-2.wsg
+    BARREL_3_WSG = 72, ///< Barrel-3.wsg
+    CF_GALACTICBRICKDOWN_PZL_WSG = 73, ///< CF-galacticbrickdown_PZL.wsg
+    CF_GALACTICBRICKDOWN_SLV_WSG = 74, ///< CF-galacticbrickdown_SLV.wsg
+    CF_LUMBERJACKS_PZL_WSG = 75, ///< CF-lumberjacks_PZL.wsg
+    CF_LUMBERJACKS_SLV_WSG = 76, ///< CF-lumberjacks_SLV.wsg
+    CF_MAGTROIDPOCKET_PZL_WSG = 77, ///< CF-magtroidpocket_PZL.wsg
+    CF_MAGTROIDPOCKET_SLV_WSG = 78, ///< CF-magtroidpocket_SLV.wsg
+    CF_PUSHYKAWAIIGO_PZL_WSG = 79, ///< CF-pushykawaiigo_PZL.wsg
+    CF_PUSHYKAWAIIGO_SLV_WSG = 80, ///< CF-pushykawaiigo_SLV.wsg
+    CHOWA_RACE_MID = 81, ///< Chowa_Race.mid
+    EF_2048_PZL_WSG = 82, ///< EF-2048_PZL.wsg
+    EF_2048_SLV_WSG = 83, ///< EF-2048_SLV.wsg
+    EF_BIGBUG_PZL_WSG = 84, ///< EF-bigbug_PZL.wsg
+    EF_BIGBUG_SLV_WSG = 85, ///< EF-bigbug_SLV.wsg
+    EF_CHOWAGROVE_PZL_WSG = 86, ///< EF-chowagrove_PZL.wsg
+    EF_CHOWAGROVE_SLV_WSG = 87, ///< EF-chowagrove_SLV.wsg
+    EF_HUNTERSPUZZLES_PZL_WSG = 88, ///< EF-hunterspuzzles_PZL.wsg
+    EF_HUNTERSPUZZLES_SLV_WSG = 89, ///< EF-hunterspuzzles_SLV.wsg
+    EF_PANGO_PZL_WSG = 90, ///< EF-pango_PZL.wsg
+    EF_PANGO_SLV_WSG = 91, ///< EF-pango_SLV.wsg
+    EF_SWADGEHERO_PZL_WSG = 92, ///< EF-swadgehero_PZL.wsg
+    EF_SWADGEHERO_SLV_WSG = 93, ///< EF-swadgehero_SLV.wsg
+    EF_ULTIMATETTT_PZL_WSG = 94, ///< EF-ultimatettt_PZL.wsg
+    EF_ULTIMATETTT_SLV_WSG = 95, ///< EF-ultimatettt_SLV.wsg
+    FF_ACLEAF_PZL_WSG = 96, ///< FF-acleaf_PZL.wsg
+    FF_ACLEAF_SLV_WSG = 97, ///< FF-acleaf_SLV.wsg
+    FF_DOUBLEBASS_PZL_WSG = 98, ///< FF-doublebass_PZL.wsg
+    FF_DOUBLEBASS_SLV_WSG = 99, ///< FF-doublebass_SLV.wsg
+    FF_DRUM_PZL_WSG = 100, ///< FF-drum_PZL.wsg
+    FF_DRUM_SLV_WSG = 101, ///< FF-drum_SLV.wsg
+    FF_METEOR_PZL_WSG = 102, ///< FF-meteor_PZL.wsg
+    FF_METEOR_SLV_WSG = 103, ///< FF-meteor_SLV.wsg
+    FF_PSLOGO_PZL_WSG = 104, ///< FF-pslogo_PZL.wsg
+    FF_PSLOGO_SLV_WSG = 105, ///< FF-pslogo_SLV.wsg
+    FF_SAX_PZL_WSG = 106, ///< FF-sax_PZL.wsg
+    FF_SAX_SLV_WSG = 107, ///< FF-sax_SLV.wsg
+    FF_SFCLOGO_PZL_WSG = 108, ///< FF-sfclogo_PZL.wsg
+    FF_SFCLOGO_SLV_WSG = 109, ///< FF-sfclogo_SLV.wsg
+    FF_TANK_PZL_WSG = 110, ///< FF-tank_PZL.wsg
+    FF_TANK_SLV_WSG = 111, ///< FF-tank_SLV.wsg
+    FF_TRUMPET_PZL_WSG = 112, ///< FF-trumpet_PZL.wsg
+    FF_TRUMPET_SLV_WSG = 113, ///< FF-trumpet_SLV.wsg
+    FF_WING_PZL_WSG = 114, ///< FF-wing_PZL.wsg
+    FF_WING_SLV_WSG = 115, ///< FF-wing_SLV.wsg
+    FAIRY_FOUNTAIN_MID = 116, ///< Fairy_Fountain.mid
+    FAUXRIO_KART_MID = 117, ///< Fauxrio_Kart.mid
+    FOLLINESQUE_MID = 118, ///< Follinesque.mid
+    LAMP_WSG = 119, ///< Lamp.wsg
+    MAG_FEST_BOUNCER_WSG = 120, ///< MagFestBouncer.wsg
+    ROBO_DEAD_WSG = 121, ///< RoboDead.wsg
+    ROBO_LEFT_WSG = 122, ///< RoboLeft.wsg
+    ROBO_RIGHT_WSG = 123, ///< RoboRight.wsg
+    ROBO_STANDING_WSG = 124, ///< RoboStanding.wsg
+    ARROW_10_WSG = 125, ///< arrow10.wsg
+    ARROW_12_WSG = 126, ///< arrow12.wsg
+    ARROW_18_WSG = 127, ///< arrow18.wsg
+    ARROW_19_WSG = 128, ///< arrow19.wsg
+    ARROW_21_WSG = 129, ///< arrow21.wsg
+    ARROW_5_WSG = 130, ///< arrow5.wsg
+    ARROW_8_WSG = 131, ///< arrow8.wsg
+    ARROW_9_WSG = 132, ///< arrow9.wsg
+    BACKLIGHT_DISABLED_WSG = 133, ///< backlightDisabled.wsg
+    BACKLIGHT_ENABLED_WSG = 134, ///< backlightEnabled.wsg
+    BANANA_MID = 135, ///< banana.mid
+    BASS_WSG = 136, ///< bass.wsg
+    BATT_1_WSG = 137, ///< batt1.wsg
+    BATT_2_WSG = 138, ///< batt2.wsg
+    BATT_3_WSG = 139, ///< batt3.wsg
+    BATT_4_WSG = 140, ///< batt4.wsg
+    BLOCK_1_MID = 141, ///< block1.mid
+    BLOCK_2_MID = 142, ///< block2.mid
+    BRASS_WSG = 143, ///< brass.wsg
+    BRONZE_TROPHY_WSG = 144, ///< bronzeTrophy.wsg
+    BUTTON_A_WSG = 145, ///< button_a.wsg
+    BUTTON_B_WSG = 146, ///< button_b.wsg
+    BUTTON_MENU_WSG = 147, ///< button_menu.wsg
+    BUTTON_PAUSE_WSG = 148, ///< button_pause.wsg
+    BUTTON_SYSTEM_WSG = 149, ///< button_system.wsg
+    BUTTON_UP_WSG = 150, ///< button_up.wsg
+    CC_BACKGROUND_DESK_WSG = 151, ///< ccBackgroundDesk.wsg
+    CC_BACKGROUND_MAT_WSG = 152, ///< ccBackgroundMat.wsg
+    CC_CALENDAR_WSG = 153, ///< ccCalendar.wsg
+    CC_FINGERS_WSG = 154, ///< ccFingers.wsg
+    CC_GRASS_WSG = 155, ///< ccGrass.wsg
+    CC_MUG_WSG = 156, ///< ccMug.wsg
+    CC_MUG_LIQUID_WSG = 157, ///< ccMugLiquid.wsg
+    CC_MUG_SPILLED_WSG = 158, ///< ccMugSpilled.wsg
+    CC_MUG_SPILLED_LIQUID_WSG = 159, ///< ccMugSpilledLiquid.wsg
+    CC_NEEDLE_LEFT_WSG = 160, ///< ccNeedleLeft.wsg
+    CC_NEEDLE_RIGHT_WSG = 161, ///< ccNeedleRight.wsg
+    CC_PACKAGE_WSG = 162, ///< ccPackage.wsg
+    CC_PACKAGE_STARBURST_WSG = 163, ///< ccPackageStarburst.wsg
+    CC_PAINT_LABEL_WSG = 164, ///< ccPaintLabel.wsg
+    CC_PAINT_TUBE_WSG = 165, ///< ccPaintTube.wsg
+    CC_SPILL_WSG = 166, ///< ccSpill.wsg
+    CC_SPRAY_WSG = 167, ///< ccSpray.wsg
+    CC_SPRAY_CAN_WSG = 168, ///< ccSprayCan.wsg
+    CC_SPRAY_CAN_GRAPHICS_WSG = 169, ///< ccSprayCanGraphics.wsg
+    CC_SPRAY_NOZZLE_WSG = 170, ///< ccSprayNozzle.wsg
+    CC_THREAD_WSG = 171, ///< ccThread.wsg
+    CC_TIMER_LEFT_WSG = 172, ///< ccTimerLeft.wsg
+    CC_TIMER_RIGHT_WSG = 173, ///< ccTimerRight.wsg
+    CC_TUMBLEWEED_WSG = 174, ///< ccTumbleweed.wsg
+    CHANNELS_WSG = 175, ///< channels.wsg
+    CHROMATIC_PERCUSSION_WSG = 176, ///< chromatic_percussion.wsg
+    COLOSSUS_BIN = 177, ///< colossus.bin
+    DEFAULT_SETTING_WSG = 178, ///< defaultSetting.wsg
+    DN_KING_WSG = 179, ///< dn_King.wsg
+    DN_KING_SMALL_WSG = 180, ///< dn_KingSmall.wsg
+    DN_PAWN_WSG = 181, ///< dn_Pawn.wsg
+    DN_PAWN_SMALL_WSG = 182, ///< dn_PawnSmall.wsg
+    DN_ALBUM_WSG = 183, ///< dn_album.wsg
+    DN_ALPHA_DOWN_WSG = 184, ///< dn_alpha_down.wsg
+    DN_ALPHA_ORTHO_WSG = 185, ///< dn_alpha_ortho.wsg
+    DN_ALPHA_UP_WSG = 186, ///< dn_alpha_up.wsg
+    DN_BUCKET_HAT_DOWN_WSG = 187, ///< dn_bucketHat_down.wsg
+    DN_BUCKET_HAT_UP_WSG = 188, ///< dn_bucketHat_up.wsg
+    DN_CHESS_ORTHO_WSG = 189, ///< dn_chess_ortho.wsg
+    DN_CURTAIN_WSG = 190, ///< dn_curtain.wsg
+    DN_DANCENONYDA_WSG = 191, ///< dn_dancenonyda.wsg
+    DN_GROUND_TILE_WSG = 192, ///< dn_groundTile.wsg
+    DN_STAGE_LIGHT_WSG = 193, ///< dn_stageLight.wsg
+    DN_STATUS_LIGHT_WSG = 194, ///< dn_statusLight.wsg
+    DN_TEXT_BOX_WSG = 195, ///< dn_textBox.wsg
+    DN_TFT_WSG = 196, ///< dn_tft.wsg
+    DONUT_FEST_BIN = 197, ///< donut_fest.bin
+    DONUT_MAG_BIN = 198, ///< donut_mag.bin
+    DOUBLE_QUAVER_WSG = 199, ///< doubleQuaver.wsg
+    EARLY_GAMEBOY_FONT = 200, ///< early_gameboy.font
+    EIGHTBIT_ATARI_GRUBE_2_FONT = 201, ///< eightbit_atari_grube2.font
+    ENABLE_WSG = 202, ///< enable.wsg
+    ENSEMBLE_WSG = 203, ///< ensemble.wsg
+    ETHNIC_WSG = 204, ///< ethnic.wsg
+    EXAMPLE_BG_WSG = 205, ///< exampleBG.wsg
+    F_CLEF_WSG = 206, ///< fClef.wsg
+    FAST_FORWARD_WSG = 207, ///< fast_forward.wsg
+    FLAT_IBM_VGA_8_WSG = 208, ///< flat_ibm_vga8.wsg
+    FLAT_LOGBOOK_WSG = 209, ///< flat_logbook.wsg
+    GAMECUBE_MID = 210, ///< gamecube.mid
+    GMCC_MID = 211, ///< gmcc.mid
+    GOLD_CORNER_TR_WSG = 212, ///< goldCornerTR.wsg
+    GOLD_TROPHY_WSG = 213, ///< goldTrophy.wsg
+    GUITAR_WSG = 214, ///< guitar.wsg
+    HALF_NOTE_WSG = 215, ///< halfNote.wsg
+    HAMBURGER_WSG = 216, ///< hamburger.wsg
+    HD_CREDITS_MID = 217, ///< hd_credits.mid
+    HOTROD_MID = 218, ///< hotrod.mid
+    IBM_VGA_8_FONT = 219, ///< ibm_vga8.font
+    IGNORE_WSG = 220, ///< ignore.wsg
+    INTERFACE_WSG = 221, ///< interface.wsg
+    INTRO_SWADGE_WSG = 222, ///< intro_swadge.wsg
+    JUKEBOX_WSG = 223, ///< jukebox.wsg
+    KID_0_WSG = 224, ///< kid0.wsg
+    KID_1_WSG = 225, ///< kid1.wsg
+    LEDS_DISABLED_WSG = 226, ///< ledsDisabled.wsg
+    LEDS_ENABLED_WSG = 227, ///< ledsEnabled.wsg
+    LOGBOOK_FONT = 228, ///< logbook.font
+    LOOP_WSG = 229, ///< loop.wsg
+    MAGFEST_BIN = 230, ///< magfest.bin
+    MAGFEST_BANK_WSG = 231, ///< magfest_bank.wsg
+    MATRIX_DROPS_CFUN_BIN = 232, ///< matrix_drops.cfun.bin
+    MATRIX_DROPS_CFUN_BIN_BIN = 233, ///< matrix_drops.cfun.bin.bin
+    MATRIX_GRADIENT_CFUN_BIN = 234, ///< matrix_gradient.cfun.bin
+    MATRIX_GRADIENT_CFUN_BIN_BIN = 235, ///< matrix_gradient.cfun.bin.bin
+    METRONOME_BOTTOM_WSG = 236, ///< metronomeBottom.wsg
+    METRONOME_TOP_WSG = 237, ///< metronomeTop.wsg
+    MIDI_VOLUME_WSG = 238, ///< midi_volume.wsg
+    MM_FONT = 239, ///< mm.font
+    MMM_BACK_WSG = 240, ///< mmm_back.wsg
+    MMM_BG_WSG = 241, ///< mmm_bg.wsg
+    MMM_BODY_WSG = 242, ///< mmm_body.wsg
+    MMM_DOWN_WSG = 243, ///< mmm_down.wsg
+    MMM_ITEM_WSG = 244, ///< mmm_item.wsg
+    MMM_ITEM_SEL_WSG = 245, ///< mmm_item_sel.wsg
+    MMM_NEXT_WSG = 246, ///< mmm_next.wsg
+    MMM_PREV_WSG = 247, ///< mmm_prev.wsg
+    MMM_SUBMENU_WSG = 248, ///< mmm_submenu.wsg
+    MMM_UP_WSG = 249, ///< mmm_up.wsg
+    MMX_TROPHY_WSG = 250, ///< mmxTrophy.wsg
+    MUSIC_DISABLED_WSG = 251, ///< musicDisabled.wsg
+    MUSIC_ENABLED_WSG = 252, ///< musicEnabled.wsg
+    NORI_2_BIN = 253, ///< nori2.bin
+    ODE_MID = 254, ///< ode.mid
+    OPEN_SONG_WSG = 255, ///< open_song.wsg
+    ORGAN_WSG = 256, ///< organ.wsg
+    OXANIUM_FONT = 257, ///< oxanium.font
+    PANGO_FW_FONT = 258, ///< pango-fw.font
+    PAUSE_WSG = 259, ///< pause.wsg
+    PERCUSSION_WSG = 260, ///< percussion.wsg
+    PERCUSSIVE_WSG = 261, ///< percussive.wsg
+    PIANO_WSG = 262, ///< piano.wsg
+    PIPE_WSG = 263, ///< pipe.wsg
+    PITCH_WHEEL_WSG = 264, ///< pitch_wheel.wsg
+    PLAY_WSG = 265, ///< play.wsg
+    PLAYER_WSG = 266, ///< player.wsg
+    PLAYPAUSE_WSG = 267, ///< playpause.wsg
+    PRESS_IT_RAW = 268, ///< press_it.raw
+    PULSE_AUX_FONT = 269, ///< pulseAux.font
+    QUAVER_WSG = 270, ///< quaver.wsg
+    RADIOSTARS_FONT = 271, ///< radiostars.font
+    REED_WSG = 272, ///< reed.wsg
+    RESET_WSG = 273, ///< reset.wsg
+    RETRO_LOGO_FONT = 274, ///< retro_logo.font
+    RIGHTEOUS_150_FONT = 275, ///< righteous_150.font
+    RODIN_EB_FONT = 276, ///< rodin_eb.font
+    SECRET_MID = 277, ///< secret.mid
+    SEQ_DRUMS_WSG = 278, ///< seq_drums.wsg
+    SEQ_EIGHTH_NOTE_WSG = 279, ///< seq_eighth_note.wsg
+    SEQ_GUITAR_WSG = 280, ///< seq_guitar.wsg
+    SEQ_HALF_NOTE_WSG = 281, ///< seq_half_note.wsg
+    SEQ_PIANO_WSG = 282, ///< seq_piano.wsg
+    SEQ_QUARTER_NOTE_WSG = 283, ///< seq_quarter_note.wsg
+    SEQ_SAX_WSG = 284, ///< seq_sax.wsg
+    SEQ_SIXTEENTH_NOTE_WSG = 285, ///< seq_sixteenth_note.wsg
+    SEQ_SYNTH_WSG = 286, ///< seq_synth.wsg
+    SEQ_TRUMPET_WSG = 287, ///< seq_trumpet.wsg
+    SEQ_WHOLE_NOTE_WSG = 288, ///< seq_whole_note.wsg
+    SEVEN_SEGMENT_FONT = 289, ///< seven_segment.font
+    SFX_DISABLED_WSG = 290, ///< sfxDisabled.wsg
+    SFX_ENABLED_WSG = 291, ///< sfxEnabled.wsg
+    SHAKE_IT_RAW = 292, ///< shake_it.raw
+    SHOUT_IT_RAW = 293, ///< shout_it.raw
+    SHUFFLE_WSG = 294, ///< shuffle.wsg
+    SILVER_TROPHY_WSG = 295, ///< silverTrophy.wsg
+    SKIP_WSG = 296, ///< skip.wsg
+    SOLO_STRINGS_WSG = 297, ///< solo_strings.wsg
+    SONIC_FONT = 298, ///< sonic.font
+    SOUND_EFFECTS_WSG = 299, ///< sound_effects.wsg
+    SPK_WSG = 300, ///< spk.wsg
+    STEREO_MID = 301, ///< stereo.mid
+    STEREO_TEST_MID = 302, ///< stereo_test.mid
+    STOP_WSG = 303, ///< stop.wsg
+    SUDOKU_NOTES_WSG = 304, ///< sudoku_notes.wsg
+    SUDOKU_PUZ_000_BSP = 305, ///< sudoku_puz_000.bsp
+    SUDOKU_PUZ_001_BSP = 306, ///< sudoku_puz_001.bsp
+    SUDOKU_PUZ_002_BSP = 307, ///< sudoku_puz_002.bsp
+    SUDOKU_PUZ_003_BSP = 308, ///< sudoku_puz_003.bsp
+    SUDOKU_PUZ_004_BSP = 309, ///< sudoku_puz_004.bsp
+    SUDOKU_PUZ_005_BSP = 310, ///< sudoku_puz_005.bsp
+    SUDOKU_PUZ_006_BSP = 311, ///< sudoku_puz_006.bsp
+    SUDOKU_PUZ_007_BSP = 312, ///< sudoku_puz_007.bsp
+    SUDOKU_PUZ_008_BSP = 313, ///< sudoku_puz_008.bsp
+    SUDOKU_PUZ_009_BSP = 314, ///< sudoku_puz_009.bsp
+    SUDOKU_PUZ_010_BSP = 315, ///< sudoku_puz_010.bsp
+    SUDOKU_PUZ_011_BSP = 316, ///< sudoku_puz_011.bsp
+    SUDOKU_PUZ_012_BSP = 317, ///< sudoku_puz_012.bsp
+    SUDOKU_PUZ_013_BSP = 318, ///< sudoku_puz_013.bsp
+    SUDOKU_PUZ_014_BSP = 319, ///< sudoku_puz_014.bsp
+    SUDOKU_PUZ_015_BSP = 320, ///< sudoku_puz_015.bsp
+    SUDOKU_PUZ_016_BSP = 321, ///< sudoku_puz_016.bsp
+    SUDOKU_PUZ_017_BSP = 322, ///< sudoku_puz_017.bsp
+    SUDOKU_PUZ_018_BSP = 323, ///< sudoku_puz_018.bsp
+    SUDOKU_PUZ_019_BSP = 324, ///< sudoku_puz_019.bsp
+    SUDOKU_PUZ_020_BSP = 325, ///< sudoku_puz_020.bsp
+    SUDOKU_PUZ_021_BSP = 326, ///< sudoku_puz_021.bsp
+    SUDOKU_PUZ_022_BSP = 327, ///< sudoku_puz_022.bsp
+    SUDOKU_PUZ_023_BSP = 328, ///< sudoku_puz_023.bsp
+    SUDOKU_PUZ_024_BSP = 329, ///< sudoku_puz_024.bsp
+    SUDOKU_PUZ_025_BSP = 330, ///< sudoku_puz_025.bsp
+    SUDOKU_PUZ_026_BSP = 331, ///< sudoku_puz_026.bsp
+    SUDOKU_PUZ_027_BSP = 332, ///< sudoku_puz_027.bsp
+    SUDOKU_PUZ_028_BSP = 333, ///< sudoku_puz_028.bsp
+    SUDOKU_PUZ_029_BSP = 334, ///< sudoku_puz_029.bsp
+    SUDOKU_PUZ_030_BSP = 335, ///< sudoku_puz_030.bsp
+    SUDOKU_PUZ_031_BSP = 336, ///< sudoku_puz_031.bsp
+    SUDOKU_PUZ_032_BSP = 337, ///< sudoku_puz_032.bsp
+    SUDOKU_PUZ_033_BSP = 338, ///< sudoku_puz_033.bsp
+    SUDOKU_PUZ_034_BSP = 339, ///< sudoku_puz_034.bsp
+    SUDOKU_PUZ_035_BSP = 340, ///< sudoku_puz_035.bsp
+    SUDOKU_PUZ_036_BSP = 341, ///< sudoku_puz_036.bsp
+    SUDOKU_PUZ_037_BSP = 342, ///< sudoku_puz_037.bsp
+    SUDOKU_PUZ_038_BSP = 343, ///< sudoku_puz_038.bsp
+    SUDOKU_PUZ_039_BSP = 344, ///< sudoku_puz_039.bsp
+    SUDOKU_PUZ_040_BSP = 345, ///< sudoku_puz_040.bsp
+    SUDOKU_PUZ_041_BSP = 346, ///< sudoku_puz_041.bsp
+    SUDOKU_PUZ_042_BSP = 347, ///< sudoku_puz_042.bsp
+    SUDOKU_PUZ_043_BSP = 348, ///< sudoku_puz_043.bsp
+    SUDOKU_PUZ_044_BSP = 349, ///< sudoku_puz_044.bsp
+    SUDOKU_PUZ_045_BSP = 350, ///< sudoku_puz_045.bsp
+    SUDOKU_PUZ_046_BSP = 351, ///< sudoku_puz_046.bsp
+    SUDOKU_PUZ_047_BSP = 352, ///< sudoku_puz_047.bsp
+    SUDOKU_PUZ_048_BSP = 353, ///< sudoku_puz_048.bsp
+    SUDOKU_PUZ_049_BSP = 354, ///< sudoku_puz_049.bsp
+    SWIRL_IT_RAW = 355, ///< swirl_it.raw
+    SYNTH_EFFECTS_WSG = 356, ///< synth_effects.wsg
+    SYNTH_LEAD_WSG = 357, ///< synth_lead.wsg
+    SYNTH_PAD_WSG = 358, ///< synth_pad.wsg
+    TAILLESS_QUAVER_WSG = 359, ///< taillessQuaver.wsg
+    TINY_NUMBERS_FONT = 360, ///< tiny_numbers.font
+    TOM_THUMB_FONT = 361, ///< tom_thumb.font
+    TOUCH_GEM_WSG = 362, ///< touch-gem.wsg
+    TOUCHPAD_WSG = 363, ///< touchpad.wsg
+    TOUCHPAD_JOYSTICK_WSG = 364, ///< touchpad_joystick.wsg
+    TOUCHPAD_SPIN_WSG = 365, ///< touchpad_spin.wsg
+    TREBLE_CLEF_WSG = 366, ///< trebleClef.wsg
+    TUT_WSG = 367, ///< tut.wsg
+    TWO_TAIL_QUAVER_WSG = 368, ///< twoTailQuaver.wsg
+    UNKNOWN_PUZZLE_WSG = 369, ///< unknownPuzzle.wsg
+    UP_CURSOR_8_WSG = 370, ///< upCursor8.wsg
+    USB_WSG = 371, ///< usb.wsg
+    USB_MODE_WSG = 372, ///< usb_mode.wsg
+    VIEW_MODE_WSG = 373, ///< view_mode.wsg
+    WHOLE_NOTE_WSG = 374, ///< wholeNote.wsg
+    WILHELM_BIN = 375, ///< wilhelm.bin
+    WINGED_TROPHY_WSG = 376, ///< wingedTrophy.wsg
+    WOOD_BACKGROUND_WSG = 377, ///< woodBackground.wsg
+    WOOD_TEXTURE_64_WSG = 378, ///< woodTexture64.wsg
+    YALIKEJAZZ_MID = 379, ///< yalikejazz.mid
+    CNFS_NUM_FILES = 380,
+} cnfsFileIdx_t;
+
+/// A hash of all file names. A binary CNFS image must match it to be used instead of this one
+#define CNFS_NAMES_HASH 0x229A4F35U
+
+const uint8_t* getCnfsImage(void);
+int32_t getCnfsSize(void);
+const cnfsFileEntry* getCnfsFiles(void);
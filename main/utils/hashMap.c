@@ -7,10 +7,18 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
+#include <inttypes.h>
 
 #include <esp_log.h>
 #include <esp_heap_caps.h>
 
+#include "macros.h"
+
+#ifdef ENABLE_BENCHMARKS
+    #include <stdio.h>
+    #include <esp_timer.h>
+#endif
+
 //==============================================================================
 // Defines
 //==============================================================================
@@ -18,429 +26,388 @@
 // #define HASH_LOG(...) ESP_LOGI("HashMap", __VA_ARGS__)
 #define HASH_LOG(...)
 
-//==============================================================================
-// Structs
-//==============================================================================
+/// The smallest number of slots a table will have. Table sizes are always a power of two
+#define HASH_MIN_SIZE 8
 
-/**
- * @brief A single key-value pair in the hash map
- *
- */
-typedef struct
-{
-    ///<  The key's hash value
-    uint32_t hash;
+/// The minimum number of old slots migrated to the new table by each put or remove during a resize
+#define HASH_MIGRATE_SLOTS 8
 
-    ///<  The key of this pair, or NULL if this node is empty
-    const void* key;
+#ifdef ENABLE_BENCHMARKS
+    /// The size of each string key hashBenchmark() uses, which is enough for "0" through "99999"
+    #define BENCH_KEY_LEN 8
+#endif
 
-    ///<  The value of this pair
-    void* value;
-} hashNode_t;
+//==============================================================================
+// Structs
+//==============================================================================
 
 /**
- * @brief A single element of the hash map array, holding either one value or a list of values.
+ * @brief A single slot of the hash map's table, holding at most one key-value pair
  *
- * While holding a single value, the item's key, hash, and value are held directly in the struct.
- * While holding multiple values, each item is stored as a value in a linked list, heap-allocated.
+ * Entries are kept in Robin Hood order: an entry is never further from its home slot than the entries probed before
+ * it, which keeps lookups short and lets removal shift the rest of a cluster back instead of leaving a tombstone.
  */
 typedef struct hashBucket
 {
-    ///<  Whether the bucket contains multiple or a single item
-    bool hasMulti;
+    /// The key's hash value
+    uint32_t hash;
 
     union
     {
-        ///<  The node's single-item contents, when hasMulti is false
-        hashNode_t single;
+        /// The key of this pair, when inlined is false
+        const void* key;
 
-        ///<  The node's multi-item contents, when hasMulti is true
-        list_t multi;
+        /// A copy of the string key of this pair, when inlined is true
+        char inlineKey[HASH_INLINE_KEY_LEN];
     };
-} hashBucket_t;
-
-/**
- * @brief The internal state of a hash map iterator
- *
- */
-typedef struct hashIterState
-{
-    ///<  The bucket containing the current item
-    hashBucket_t* curBucket;
 
-    ///<  The list node containing the current item, if within a multi bucket
-    node_t* curListNode;
-
-    ///<  The node containing the current item
-    hashNode_t* curNode;
+    /// The value of this pair
+    void* value;
 
-    ///<  The number of items returned by the iterator
-    int returned;
+    /// The distance from this entry's home slot plus one, or 0 if this slot is empty
+    uint16_t dist;
 
-    ///<  Whether the iterator has already been advanced, after removing the previous item
-    bool removed;
-} hashIterState_t;
+    /// Whether the key was copied into inlineKey
+    bool inlined;
+} hashBucket_t;
 
 //==============================================================================
 // Static Function Prototypes
 //==============================================================================
 
-static void hashCheckSize(hashMap_t* map);
-static hashNode_t* hashFindNode(hashMap_t* map, const void* key, uint32_t* hashOut, hashBucket_t** bucketOut,
-                                node_t** multiOut);
-static hashNode_t* bucketPut(hashMap_t* map, hashBucket_t* bucket, const void* key, void* value, uint32_t hash,
-                             int* count);
-static hashNode_t bucketRemove(hashMap_t* map, hashBucket_t* bucket, hashNode_t* node, node_t* multiNode, int* count);
-static bool hashIterNext(const hashMap_t* map, hashIterator_t* iter);
+static hashBucket_t* hashAllocTable(hashMap_t* map, int size);
+static void hashFreeTable(hashMap_t* map, hashBucket_t* table);
+static uint32_t hashHomeSlot(uint32_t hash, int size);
+static uint32_t hashOf(const hashMap_t* map, const void* key);
+static const void* slotKey(const hashBucket_t* slot);
+static bool slotMatches(const hashMap_t* map, const hashBucket_t* slot, uint32_t hash, const void* key);
+static hashBucket_t* tableFind(const hashMap_t* map, hashBucket_t* table, int size, uint32_t hash, const void* key);
+static hashBucket_t* tablePut(hashBucket_t* table, int size, hashBucket_t* entry);
+static void tableRemove(hashBucket_t* table, int size, hashBucket_t* slot);
+static int tableFirstEmpty(const hashBucket_t* table, int size);
+static void hashOldRemoved(hashMap_t* map);
+static void hashMigrate(hashMap_t* map, int slots);
+static bool hashCheckSize(hashMap_t* map);
+static bool hashIterNext(const hashMap_t* map, hashIterator_t* iter, bool advance);
 
 //==============================================================================
 // Functions
 //==============================================================================
 
 /**
- * @brief Check the hash map's size and resize it if necessary.
+ * @brief Allocate a zeroed table from the map's arena, or the heap if it has none
  *
- * Runtime: O(n)
- *
- * @param map The hash map to resize
+ * @param map The map to allocate a table for
+ * @param size The number of slots in the table
+ * @return The new table, or NULL if memory is exhausted
  */
-static void hashCheckSize(hashMap_t* map)
+static hashBucket_t* hashAllocTable(hashMap_t* map, int size)
 {
-    // if count >= size * .75
-    if (map->count * 4 >= 3 * map->size)
+    if (NULL != map->arena)
     {
-        int size = map->size * 2;
-        HASH_LOG("Resizing backing array from %d to %d (count=%d)", map->size, size, map->count);
-        hashBucket_t* newArray = heap_caps_realloc(map->values, size * sizeof(hashBucket_t), MALLOC_CAP_8BIT);
-
-        if (newArray != NULL)
-        {
-            // Zero the new memory as realloc does not do it for us
-            memset(newArray + map->size, 0, (size - map->size) * sizeof(hashBucket_t));
+        return arenaCalloc(map->arena, size, sizeof(hashBucket_t));
+    }
+    return heap_caps_calloc_tag(size, sizeof(hashBucket_t), MALLOC_CAP_8BIT, "hashMap");
+}
 
-            int moved = 0;
-            // Rehash everything in the old portion of the array
-            for (int i = 0; i < map->size; i++)
-            {
-                hashBucket_t* bucket = &newArray[i];
-                if (bucket->hasMulti)
-                {
-                    // Need to store the next list node here before deleting the current one
-                    node_t* nextNode = NULL;
-                    for (node_t* listNode = bucket->multi.first; listNode != NULL; listNode = nextNode)
-                    {
-                        nextNode = listNode->next;
-
-                        hashNode_t* node = listNode->val;
-                        if ((node->hash % size) != i)
-                        {
-                            // The node belongs in a different bucket after the resize
-                            hashNode_t tmp = bucketRemove(map, bucket, node, listNode, NULL);
-                            node = bucketPut(map, &newArray[tmp.hash % size], tmp.key, tmp.value, tmp.hash, NULL);
-                            moved++;
-                        }
-                    }
-                }
-                else
-                {
-                    hashNode_t* node = &bucket->single;
-                    if (node->key && (node->hash % size != i))
-                    {
-                        // The node belongs in a different bucket after the resize
-                        hashNode_t tmp = bucketRemove(map, bucket, node, NULL, NULL);
-                        node           = bucketPut(map, &newArray[tmp.hash % size], tmp.key, tmp.value, tmp.hash, NULL);
-                        moved++;
-                    }
-                }
-            }
+/**
+ * @brief Free a table allocated with hashAllocTable(). Tables allocated from an arena are left for the arena to release
+ *
+ * @param map The map the table belongs to
+ * @param table The table to free
+ */
+static void hashFreeTable(hashMap_t* map, hashBucket_t* table)
+{
+    if (NULL == map->arena && NULL != table)
+    {
+        heap_caps_free(table);
+    }
+}
 
-            HASH_LOG("Moved %d nodes after resizing", moved);
+/**
+ * @brief Find the slot an entry would occupy if there were no collisions
+ *
+ * The hash is scrambled with a Fibonacci multiply and the top bits are used, so weak hash functions still spread out
+ * over a power-of-two table.
+ *
+ * @param hash The entry's hash
+ * @param size The number of slots in the table, a power of two no smaller than ::HASH_MIN_SIZE
+ * @return The index of the entry's home slot
+ */
+static uint32_t hashHomeSlot(uint32_t hash, int size)
+{
+    return (hash * 0x9E3779B1u) >> (__builtin_clz((uint32_t)size) + 1);
+}
 
-            map->size   = size;
-            map->values = newArray;
-        }
-        else
-        {
-            ESP_LOGE("HashMap", "Failed to resize HashMap");
-        }
-    }
+/**
+ * @brief Hash a key with the map's hash function
+ *
+ * @param map The map the key belongs to
+ * @param key The key to hash
+ * @return The key's hash
+ */
+static uint32_t hashOf(const hashMap_t* map, const void* key)
+{
+    return map->hashFunc ? map->hashFunc(key) : hashString(key);
 }
 
 /**
- * @brief Find and return a pointer to the node for a given key, and optionally returns its hash and pointers to its
- * bucket and list node
+ * @brief Get the key stored in an occupied slot
  *
- * Runtime: O(1) average case, O(n) worst case (all items in the same bucket) but not common
+ * @param slot The slot to get the key of
+ * @return The key, which points into the table itself if it was inlined
+ */
+static const void* slotKey(const hashBucket_t* slot)
+{
+    return slot->inlined ? (const void*)slot->inlineKey : slot->key;
+}
+
+/**
+ * @brief Check whether an occupied slot holds the given key
  *
- * @param map The hash map to search
- * @param key The key to use for searching
- * @param[out] hashOut A pointer to an int32_t to write the calculated hash into
- * @param[out] bucketOut A pointer to a pointer to a bucket to be set to the containing bucket
- * @param[out] multiOut A pointer to a pointer to a list node to be set to the containing list item, if any
- * @return hashNode_t* A pointer to the node corresponding to the given key, if any was found
+ * @param map The map the slot belongs to
+ * @param slot The slot to check
+ * @param hash The hash of the key
+ * @param key The key to look for
+ * @return true if the slot holds the key
  */
-static hashNode_t* hashFindNode(hashMap_t* map, const void* key, uint32_t* hashOut, hashBucket_t** bucketOut,
-                                node_t** multiOut)
+static bool slotMatches(const hashMap_t* map, const hashBucket_t* slot, uint32_t hash, const void* key)
 {
-    uint32_t hash        = map->hashFunc ? map->hashFunc(key) : hashString((const char*)key);
-    int index            = hash % map->size;
-    hashBucket_t* bucket = &map->values[index];
-    eqFunction_t eqFn    = map->eqFunc ? map->eqFunc : strEq;
-    // We can always dereference the first pointer because if the list is emptied, hasMulti should be false
-    // (It could still have only 1 entry but that's fine)
-    hashNode_t* node    = NULL;
-    node_t* listNodeOut = NULL;
-
-    if (bucket->hasMulti)
+    if (slot->hash != hash)
     {
-        node = bucket->multi.first->val;
+        return false;
+    }
+    else if (slot->inlined)
+    {
+        // Only string keys are ever inlined
+        return 0 == strcmp(slot->inlineKey, (const char*)key);
     }
     else
     {
-        node = &bucket->single;
+        return map->eqFunc ? map->eqFunc(slot->key, key) : strEq(slot->key, key);
     }
+}
 
-    int tries = 1;
-    if (node->key != NULL && (node->hash != hash || !eqFn(node->key, key)))
+/**
+ * @brief Find the slot holding a key in a table
+ *
+ * @param map The map the table belongs to
+ * @param table The table to search, or NULL
+ * @param size The number of slots in the table
+ * @param hash The hash of the key
+ * @param key The key to look for
+ * @return The slot holding the key, or NULL if it is not in the table
+ */
+static hashBucket_t* tableFind(const hashMap_t* map, hashBucket_t* table, int size, uint32_t hash, const void* key)
+{
+    if (NULL == table)
     {
-        // Node doesn't match!
-        node = NULL;
-
-        if (bucket->hasMulti)
-        {
-            for (node_t* listNode = bucket->multi.first; listNode != NULL; listNode = listNode->next)
-            {
-                tries++;
-                hashNode_t* newNode = listNode->val;
-                if (newNode->hash == hash && eqFn(newNode->key, key))
-                {
-                    node        = newNode;
-                    listNodeOut = listNode;
-                    break;
-                }
-            }
-        }
+        return NULL;
     }
 
-    if (node)
+    uint32_t mask = size - 1;
+    uint32_t idx  = hashHomeSlot(hash, size);
+    for (uint16_t dist = 1;; dist++)
     {
-        if (!map->hashFunc || map->hashFunc == hashString)
+        hashBucket_t* slot = &table[idx];
+
+        // An empty slot, or an entry closer to its home than this key would be, means the key isn't here
+        if (slot->dist < dist)
         {
-            HASH_LOG("Found %s node %d for key %s after %d %s", (node->key) ? "in-use" : "new", index, (const char*)key,
-                     tries, (tries == 1) ? "try" : "tries");
+            return NULL;
         }
-        else
+        else if (slotMatches(map, slot, hash, key))
         {
-            HASH_LOG("Found %s node %d for key %p after %d %s", (node->key) ? "in-use" : "new", index, (const void*)key,
-                     tries, (tries == 1) ? "try" : "tries");
+            return slot;
         }
+        idx = (idx + 1) & mask;
     }
-    else
+}
+
+/**
+ * @brief Insert an entry into a table, which must not already hold its key and must have a free slot
+ *
+ * Whenever the entry being placed has probed further than the entry in a slot, the two are swapped and placement
+ * continues with the displaced entry.
+ *
+ * @param table The table to insert into
+ * @param size The number of slots in the table
+ * @param entry The entry to insert. This is used as scratch space and is clobbered
+ * @return The slot the entry was placed in
+ */
+static hashBucket_t* tablePut(hashBucket_t* table, int size, hashBucket_t* entry)
+{
+    hashBucket_t* placed = NULL;
+    uint32_t mask        = size - 1;
+    uint32_t idx         = hashHomeSlot(entry->hash, size);
+
+    entry->dist = 1;
+    while (true)
     {
-        if (!map->hashFunc || map->hashFunc == hashString)
+        hashBucket_t* slot = &table[idx];
+        if (0 == slot->dist)
         {
-            HASH_LOG("Did not find node for key %s after %d %s", (const char*)key, tries,
-                     (tries == 1) ? "try" : "tries");
+            *slot = *entry;
+            return placed ? placed : slot;
         }
-        else
+        else if (slot->dist < entry->dist)
         {
-            HASH_LOG("Did not find node for key %p after %d %s", (const void*)key, tries,
-                     (tries == 1) ? "try" : "tries");
+            hashBucket_t tmp = *slot;
+            *slot            = *entry;
+            *entry           = tmp;
+            if (NULL == placed)
+            {
+                placed = slot;
+            }
         }
+        entry->dist++;
+        idx = (idx + 1) & mask;
     }
+}
 
-    if (hashOut)
+/**
+ * @brief Remove the entry in a slot, then shift the rest of its cluster back by one so no tombstone is needed
+ *
+ * @param table The table to remove from
+ * @param size The number of slots in the table
+ * @param slot The occupied slot to empty
+ */
+static void tableRemove(hashBucket_t* table, int size, hashBucket_t* slot)
+{
+    uint32_t mask = size - 1;
+    uint32_t idx  = slot - table;
+    while (true)
     {
-        *hashOut = hash;
+        uint32_t next = (idx + 1) & mask;
+
+        // Stop at an empty slot or an entry already in its home slot
+        if (table[next].dist <= 1)
+        {
+            memset(&table[idx], 0, sizeof(hashBucket_t));
+            return;
+        }
+
+        table[idx] = table[next];
+        table[idx].dist--;
+        idx = next;
     }
+}
 
-    if (bucketOut)
+/**
+ * @brief Find the first empty slot in a table. Every table has one, since tables are never more than 75% full
+ *
+ * @param table The table to search
+ * @param size The number of slots in the table
+ * @return The index of the first empty slot
+ */
+static int tableFirstEmpty(const hashBucket_t* table, int size)
+{
+    int idx = 0;
+    while (idx < size && 0 != table[idx].dist)
     {
-        *bucketOut = bucket;
+        idx++;
     }
+    return idx;
+}
 
-    if (multiOut)
+/**
+ * @brief Account for an entry leaving the table being resized away from, and free that table once it is empty
+ *
+ * @param map The map being resized
+ */
+static void hashOldRemoved(hashMap_t* map)
+{
+    if (0 == --map->oldCount)
     {
-        *multiOut = listNodeOut;
+        HASH_LOG("Finished resizing to %d slots", map->size);
+        hashFreeTable(map, map->oldValues);
+        map->oldValues = NULL;
+        map->oldSize   = 0;
     }
-
-    return node;
 }
 
 /**
- * @brief Insert an entry into the given bucket, converting the bucket to a multi-bucket if necessary.
+ * @brief Move entries from the table being resized away from into the current table
  *
- * Runtime: O(1) average case, O(n) worst case (all items in same bucket)
+ * Migration moves whole clusters and always stops on an empty slot, so lookups into the rest of the old table still
+ * find what they are looking for. Once the old table is empty it is freed.
  *
- * @param map The map the bucket is part of
- * @param bucket The bucket to insert into
- * @param key The key of the new entry
- * @param value The value of the new entry
- * @param hash The hash of the new entry key
- * @param[out] count If non-NULL, will be incremented if the value is inserted
- * @return hashNode_t* A pointer to the newly-inserted node
+ * @param map The map to migrate
+ * @param slots The minimum number of old slots to migrate, or INT32_MAX to finish the resize
  */
-static hashNode_t* bucketPut(hashMap_t* map, hashBucket_t* bucket, const void* key, void* value, uint32_t hash,
-                             int* count)
+static void hashMigrate(hashMap_t* map, int slots)
 {
-    eqFunction_t eqFn = map->eqFunc ? map->eqFunc : strEq;
-    // We can always dereference the first pointer because if the list is emptied, hasMulti should be false
-    // (It could still have only 1 entry but that's fine)
-    hashNode_t* node = bucket->hasMulti ? (hashNode_t*)bucket->multi.first->val : &bucket->single;
-
-    int tries = 1;
-    if (node->key != NULL && (node->hash != hash || !eqFn(node->key, key)))
+    while (NULL != map->oldValues)
     {
-        // Node is non-empty and doesn't match hash
-        hashNode_t* newNode;
-
-        // This bucket doesn't have multiple entries yet, so we need to convert it
-        if (!bucket->hasMulti)
+        hashBucket_t* slot = &map->oldValues[map->migrateIdx];
+        if (0 != slot->dist)
         {
-            // Gotta make it a multi-bucket
-            HASH_LOG("Bucket collision; converting bucket to multi-value");
-
-            // Copy the first node itself
-            newNode = heap_caps_malloc(sizeof(hashNode_t), MALLOC_CAP_8BIT);
-            memcpy(newNode, node, sizeof(hashNode_t));
-
-            // Init the list data
-            bucket->hasMulti = true;
-            memset(&bucket->multi, 0, sizeof(list_t));
-
-            // And add the new first node to the list
-            push(&bucket->multi, newNode);
+            hashBucket_t entry = *slot;
+            tablePut(map->values, map->size, &entry);
+            memset(slot, 0, sizeof(hashBucket_t));
 
-            // Now, we should also add an empty node
-            newNode = heap_caps_calloc(1, sizeof(hashNode_t), MALLOC_CAP_8BIT);
-            push(&bucket->multi, newNode);
-
-            if (count)
-            {
-                (*count)++;
-            }
+            hashOldRemoved(map);
         }
-        else
+        else if (slots <= 0)
         {
-            // There should always be a last item in the list if it's multi
-            newNode = bucket->multi.last->val;
+            return;
         }
 
-        if (newNode->key == NULL)
-        {
-            // If the 'new node' is empty, it should be the correct one already
-            node = newNode;
-        }
-        else
+        if (NULL == map->oldValues)
         {
-            // Search through the nodes until we find a matching one
-            // I don't think we would ever come across an empty one here since it should always be last if it's there
-            node = NULL;
-            for (node_t* listNode = bucket->multi.first; listNode != NULL; listNode = listNode->next)
-            {
-                tries++;
-                newNode = listNode->val;
-                if (newNode->hash == hash && eqFn(newNode->key, key))
-                {
-                    node = newNode;
-                    break;
-                }
-            }
-
-            if (node == NULL)
-            {
-                // Gotta add one
-                node = heap_caps_calloc(1, sizeof(hashNode_t), MALLOC_CAP_8BIT);
-                push(&bucket->multi, node);
-
-                if (count)
-                {
-                    (*count)++;
-                }
-            }
+            // That was the last entry
+            return;
         }
+        map->migrateIdx = (map->migrateIdx + 1) & (map->oldSize - 1);
+        slots--;
     }
-    else if (!node->key && count)
-    {
-        (*count)++;
-    }
-
-    if (!map->hashFunc || map->hashFunc == hashString)
-    {
-        HASH_LOG("Added node for key %s", (const char*)key);
-    }
-    else
-    {
-        HASH_LOG("Added node for key %p", key);
-    }
-
-    node->hash  = hash;
-    node->key   = key;
-    node->value = value;
-
-    return node;
 }
 
 /**
- * @brief Helper function to remove an entry from a bucket, but not necessarily from a map
+ * @brief Start doubling the table if adding one more entry would make it more than 75% full
  *
- * Runtime: O(1) average case, O(n) worst case (all items in same bucket)
+ * The entries are not moved all at once. The current table becomes the old table, and each following put or remove
+ * migrates a few of its slots, so no single call pays for the whole resize.
  *
- * @param map The map containing the bucket
- * @param bucket The bucket containing the item
- * @param node The hash map node for the item to remove
- * @param multiNode If the bucket is a multi-item bucket, the list node
- * @param[out] count The count of items, to be decremented if set
- * @return A copy of the node that was removed
+ * @param map The map to check the size of
+ * @return true if there is room for another entry, false if the table is full and could not grow
  */
-static hashNode_t bucketRemove(hashMap_t* map, hashBucket_t* bucket, hashNode_t* node, node_t* multiNode, int* count)
+static bool hashCheckSize(hashMap_t* map)
 {
-    hashNode_t result = {0};
-    if (bucket->hasMulti)
+    int newCount = map->count - map->oldCount + 1;
+    if (newCount * 4 <= map->size * 3)
     {
-        hashNode_t* value = removeEntry(&bucket->multi, multiNode);
-        if (value->key)
-        {
-            if (count)
-            {
-                (*count)--;
-            }
-            result = *value;
-        }
-        heap_caps_free(value);
-        value = NULL;
-
-        // Un-multi-ify the bucket if its list is empty
-        if (bucket->multi.length == 0)
-        {
-            bucket->hasMulti = false;
-            memset(&bucket->single, 0, sizeof(hashNode_t));
-        }
+        return true;
     }
-    else
-    {
-        if (node->key != NULL && count)
-        {
-            (*count)--;
-        }
 
-        result = *node;
+    // Only one resize can be in progress at a time
+    hashMigrate(map, INT32_MAX);
+
+    hashBucket_t* newTable = hashAllocTable(map, map->size * 2);
+    if (NULL == newTable)
+    {
+        ESP_LOGE("HashMap", "Failed to grow to %d slots", map->size * 2);
 
-        node->hash  = 0;
-        node->key   = NULL;
-        node->value = NULL;
+        // Keep going until there is only one empty slot left, which lookups and iteration rely on
+        return newCount < map->size;
     }
 
-    if (!map->hashFunc || map->hashFunc == hashString)
+    HASH_LOG("Resizing from %d to %d slots", map->size, map->size * 2);
+
+    if (0 == map->count)
     {
-        HASH_LOG("Removed node for key %s", (const char*)result.key);
+        hashFreeTable(map, map->values);
     }
     else
     {
-        HASH_LOG("Removed node for key %p", result.key);
+        map->oldValues  = map->values;
+        map->oldSize    = map->size;
+        map->oldCount   = map->count;
+        map->migrateIdx = tableFirstEmpty(map->oldValues, map->oldSize);
     }
-
-    return result;
+    map->values = newTable;
+    map->size *= 2;
+    return true;
 }
 
 /**
@@ -588,35 +555,33 @@ void* hashRemove(hashMap_t* map, const char* key)
 /**
  * @brief Create or update a key-value pair in the hash map with a non-string key
  *
+ * Updating the value of a key already in the map never moves entries, so it is safe during iteration. Adding a new
+ * key is not.
+ *
  * @param map The hash map to update
  * @param key The key to associate the value with
  * @param value The value to add to the map
  */
 void hashPutBin(hashMap_t* map, const void* key, void* value)
 {
-    hashCheckSize(map);
-
-    uint32_t hash = map->hashFunc ? map->hashFunc(key) : hashString((const char*)key);
-    int index     = (hash % map->size);
-    int newCount  = map->count;
-    bucketPut(map, &map->values[index], key, value, hash, &newCount);
+    bool stringKeys = (!map->hashFunc || map->hashFunc == hashString);
+    uint32_t hash   = hashOf(map, key);
 
-    if (map->count != newCount)
+    hashBucket_t* slot = tableFind(map, map->values, map->size, hash, key);
+    if (NULL == slot)
     {
-        map->count = newCount;
+        slot = tableFind(map, map->oldValues, map->oldSize, hash, key);
+    }
 
-        if (!map->hashFunc || map->hashFunc == hashString)
-        {
-            HASH_LOG("Put: %s = %p, count now %d", (const char*)key, value, map->count);
-        }
-        else
+    if (NULL != slot)
+    {
+        if (!slot->inlined)
         {
-            HASH_LOG("Put: %p = %p, count now %d", key, value, map->count);
+            slot->key = key;
         }
-    }
-    else
-    {
-        if (!map->hashFunc || map->hashFunc == hashString)
+        slot->value = value;
+
+        if (stringKeys)
         {
             HASH_LOG("Set: %s = %p", (const char*)key, value);
         }
@@ -624,6 +589,41 @@ void hashPutBin(hashMap_t* map, const void* key, void* value)
         {
             HASH_LOG("Set: %p = %p", key, value);
         }
+        return;
+    }
+
+    hashMigrate(map, HASH_MIGRATE_SLOTS);
+    if (!hashCheckSize(map))
+    {
+        return;
+    }
+
+    hashBucket_t entry = {
+        .hash  = hash,
+        .value = value,
+    };
+
+    size_t keyLen;
+    if (map->inlineKeys && stringKeys && (keyLen = strlen((const char*)key)) < HASH_INLINE_KEY_LEN)
+    {
+        memcpy(entry.inlineKey, key, keyLen + 1);
+        entry.inlined = true;
+    }
+    else
+    {
+        entry.key = key;
+    }
+
+    tablePut(map->values, map->size, &entry);
+    map->count++;
+
+    if (stringKeys)
+    {
+        HASH_LOG("Put: %s = %p, count now %d", (const char*)key, value, map->count);
+    }
+    else
+    {
+        HASH_LOG("Put: %p = %p, count now %d", key, value, map->count);
     }
 }
 
@@ -636,16 +636,28 @@ void hashPutBin(hashMap_t* map, const void* key, void* value)
  */
 void* hashGetBin(hashMap_t* map, const void* key)
 {
-    hashNode_t* node = hashFindNode(map, key, NULL, NULL, NULL);
+    uint32_t hash = hashOf(map, key);
 
-    if (node == NULL || node->key == NULL)
+    // During a resize, search whichever table holds more entries first
+    hashBucket_t* slot;
+    if (map->oldCount * 2 > map->count)
     {
-        return NULL;
+        slot = tableFind(map, map->oldValues, map->oldSize, hash, key);
+        if (NULL == slot)
+        {
+            slot = tableFind(map, map->values, map->size, hash, key);
+        }
     }
     else
     {
-        return node->value;
+        slot = tableFind(map, map->values, map->size, hash, key);
+        if (NULL == slot)
+        {
+            slot = tableFind(map, map->oldValues, map->oldSize, hash, key);
+        }
     }
+
+    return (NULL == slot) ? NULL : slot->value;
 }
 
 /**
@@ -657,46 +669,46 @@ void* hashGetBin(hashMap_t* map, const void* key)
  */
 void* hashRemoveBin(hashMap_t* map, const void* key)
 {
-    uint32_t hash;
-    hashBucket_t* bucket = NULL;
-    node_t* multiNode    = NULL;
-    hashNode_t* node     = hashFindNode(map, key, &hash, &bucket, &multiNode);
+    uint32_t hash = hashOf(map, key);
+    void* value   = NULL;
 
-    if (node != NULL && bucket != NULL && (!bucket->hasMulti || multiNode != NULL))
+    hashBucket_t* slot = tableFind(map, map->values, map->size, hash, key);
+    if (NULL != slot)
     {
-        hashNode_t removed = bucketRemove(map, bucket, node, multiNode, &map->count);
-
-        // Even though we found the node, there still might not be a match in the bucket
-        if (removed.key != NULL)
-        {
-            return removed.value;
-        }
-        else
-        {
-            // Nothing found
-            return NULL;
-        }
+        value = slot->value;
+        tableRemove(map->values, map->size, slot);
+        map->count--;
+    }
+    else if (NULL != (slot = tableFind(map, map->oldValues, map->oldSize, hash, key)))
+    {
+        value = slot->value;
+        tableRemove(map->oldValues, map->oldSize, slot);
+        map->count--;
+        hashOldRemoved(map);
     }
     else
     {
         // Nothing to remove, key not found
         return NULL;
     }
+
+    HASH_LOG("Removed node for key %p, count now %d", key, map->count);
+    hashMigrate(map, HASH_MIGRATE_SLOTS);
+    return value;
 }
 
 /**
  * @brief Initialize a hash map for string keys
  *
+ * To store short string keys inside the map rather than keeping a reference, set ::hashMap_t.inlineKeys after this
+ * and before adding anything.
+ *
  * @param map A pointer to a hashMap_t struct to be initialized
  * @param initialSize The initial size of the hash map
  */
 void hashInit(hashMap_t* map, int initialSize)
 {
-    map->count    = 0;
-    map->size     = initialSize;
-    map->values   = heap_caps_calloc(map->size, sizeof(hashBucket_t), MALLOC_CAP_8BIT);
-    map->hashFunc = NULL;
-    map->eqFunc   = NULL;
+    hashInitArena(map, initialSize, NULL, NULL, NULL);
 }
 
 /**
@@ -709,10 +721,34 @@ void hashInit(hashMap_t* map, int initialSize)
  */
 void hashInitBin(hashMap_t* map, int initialSize, hashFunction_t hashFunc, eqFunction_t eqFunc)
 {
-    hashInit(map, initialSize);
+    hashInitArena(map, initialSize, hashFunc, eqFunc, NULL);
+}
+
+/**
+ * @brief Initialize a hash map which allocates its table from an arena rather than the heap
+ *
+ * @param map A pointer to a hashMap_t struct to be initialized
+ * @param initialSize The initial size of the hash map
+ * @param hashFunc The hash function to use for the key datatype, or NULL for string keys
+ * @param eqFunc The comparison function to use for the key datatype, or NULL for string keys
+ * @param arena The arena to allocate from, or NULL to use the heap. It must outlive the map
+ */
+void hashInitArena(hashMap_t* map, int initialSize, hashFunction_t hashFunc, eqFunction_t eqFunc, arena_t* arena)
+{
+    memset(map, 0, sizeof(hashMap_t));
+
+    // Table sizes are a power of two so the home slot can be found without a division
+    int size = HASH_MIN_SIZE;
+    while (size < initialSize)
+    {
+        size *= 2;
+    }
 
     map->hashFunc = hashFunc;
     map->eqFunc   = eqFunc;
+    map->arena    = arena;
+    map->values   = hashAllocTable(map, size);
+    map->size     = (NULL == map->values) ? 0 : size;
 }
 
 /**
@@ -722,167 +758,97 @@ void hashInitBin(hashMap_t* map, int initialSize, hashFunction_t hashFunc, eqFun
  */
 void hashDeinit(hashMap_t* map)
 {
-    if (map->count > 0)
-    {
-        for (hashBucket_t* bucket = map->values; bucket < (map->values + map->size); bucket++)
-        {
-            if (bucket->hasMulti && bucket->multi.length > 0)
-            {
-                hashNode_t* node = NULL;
-                while (NULL != (node = pop(&bucket->multi)))
-                {
-                    heap_caps_free(node);
-                }
-            }
-        }
-    }
-
-    heap_caps_free(map->values);
-    map->size     = 0;
-    map->count    = 0;
-    map->eqFunc   = NULL;
-    map->hashFunc = NULL;
+    // Tables allocated from an arena are released with the arena
+    hashFreeTable(map, map->values);
+    hashFreeTable(map, map->oldValues);
+    memset(map, 0, sizeof(hashMap_t));
 }
 
 /**
- * @brief Advance the iterator's internal state to the next item, allocating it if it has not yet been initialized
+ * @brief Advance the iterator to the next occupied slot
+ *
+ * The main table is iterated first, then the table being resized away from, if there is one. Each table is walked
+ * circularly starting from an empty slot, so removing an entry can only shift entries the iterator has not reached yet
+ * back into the current slot.
  *
  * @param map The hash map
- * @param iterator The iterator to advance
+ * @param iter The iterator to advance
+ * @param advance true to move past the current slot, false to check the current slot again
  * @return true if the iterator was advanced
  * @return false if the iterator was not advanced because it reached the end of the hash map
  */
-static bool hashIterNext(const hashMap_t* map, hashIterator_t* iterator)
+static bool hashIterNext(const hashMap_t* map, hashIterator_t* iter, bool advance)
 {
-    hashIterState_t* state = iterator->_state;
-    do
+    if (0 == iter->_phase)
     {
-        bool nextBucket = false;
+        iter->_phase = 1;
+        iter->_start = tableFirstEmpty(map->values, map->size);
+        iter->_pos   = 0;
+        advance      = false;
+    }
 
-        if (state == NULL)
-        {
-            // Start the iteration
-            iterator->_state = state = heap_caps_calloc(1, sizeof(hashIterState_t), MALLOC_CAP_8BIT);
-            state->curBucket         = map->values;
-            // Set nextBucket without incrementing curBucket
-            // This just sets up the vars for the initial bucket
-            nextBucket = true;
-        }
-        else
+    while (iter->_phase <= 2)
+    {
+        const hashBucket_t* table = (1 == iter->_phase) ? map->values : map->oldValues;
+        int size                  = (1 == iter->_phase) ? map->size : map->oldSize;
+
+        if (NULL != table)
         {
-            if (state->curListNode)
+            for (iter->_pos += advance ? 1 : 0; iter->_pos < size; iter->_pos++)
             {
-                // This is a multi item node, try to go to the next list node
-                state->curListNode = state->curListNode->next;
-
-                // There was no next list node! Go to the next bucket instead
-                if (!state->curListNode)
+                const hashBucket_t* slot = &table[(iter->_start + iter->_pos) & (size - 1)];
+                if (0 != slot->dist)
                 {
-                    state->curBucket++;
-                    nextBucket = true;
+                    iter->key   = slotKey(slot);
+                    iter->value = slot->value;
+                    return true;
                 }
-                else
-                {
-                    state->curNode = (hashNode_t*)state->curListNode->val;
-                }
-            }
-            else
-            {
-                // This is a single item node, so just go to the next bucket
-                state->curBucket++;
-                nextBucket = true;
             }
         }
 
-        // Set up after moving to a new bucket
-        if (nextBucket)
+        // Move on to the table being resized away from
+        iter->_phase++;
+        iter->_pos = 0;
+        advance    = false;
+        if (2 == iter->_phase && NULL != map->oldValues)
         {
-            // Check for the end of the array before dereferencing curBucket
-            if (state->curBucket - map->values >= map->size)
-            {
-                // End of the line
-                return false;
-            }
-
-            if (state->curBucket->hasMulti)
-            {
-                // Use the first node of the next bucket
-                state->curListNode = state->curBucket->multi.first;
-                state->curNode     = (hashNode_t*)state->curListNode->val;
-            }
-            else
-            {
-                // Use the single-item node of the bucket
-                state->curNode     = &state->curBucket->single;
-                state->curListNode = NULL;
-            }
+            iter->_start = tableFirstEmpty(map->oldValues, map->oldSize);
         }
+    }
 
-        // If the node we've picked is an empty bucket, continue until we find a non-empty one
-    } while (!state->curNode->key);
-
-    return true;
+    iter->key   = NULL;
+    iter->value = NULL;
+    return false;
 }
 
 /**
  * @brief Advance the given iterator to the next item, or return false if there is no next item
  *
- * The \c iterator should point to a zero-initialized struct at the start of iteration. Once iteration
- * completes and this function returns \c false, \c iterator will be reset. If iteration is stopped
- * before this function returns \c false, the iterator must be reset with hashIterReset() to prevent
- * memory leaks.
- *
- * Items in the hash map are not returned in any particular order.
+ * The iterator should point to a zero-initialized struct at the start of iteration. Once iteration
+ * completes and this function returns false, the iterator will be reset automatically. If iteration
+ * is stopped before this function returns false, the iterator must be reset with hashIterReset().
  *
- * It is possible to remove items during iteration, but this must be done with hashIterRemove(). Using
- * hashRemove() or hashRemoveBin() during iteration is not allowed and will cause undefined behavior.
+ * Iteration does not allocate any memory. The values of keys already in the map may be updated with hashPut() during
+ * iteration, but new keys must not be added.
  *
- * Adding or udpating items during iteration is permitted, with the caveat that a new item inserted during
- * iteration may or may not later be returned by the iterator.
- *
- * @param[in] map The map to iterate over
- * @param[in,out] iterator A pointer to a hashIterator_t struct
+ * @param map The map to iterate over
+ * @param iterator A pointer to a hashIterator_t struct
  * @return true if the iterator returned an item
  * @return false if iteration is complete and no item was returned
  */
 bool hashIterate(const hashMap_t* map, hashIterator_t* iterator)
 {
-    hashIterState_t* state = iterator->_state;
+    // hashIterRemove() already moved on to the next item
+    bool advance        = !iterator->_removed;
+    iterator->_removed = false;
 
-    // Exit early
-    if (state != NULL && state->returned == map->count)
+    if (3 != iterator->_phase && hashIterNext(map, iterator, advance))
     {
-        hashIterReset(iterator);
-        return false;
-    }
-
-    // If we just removed a node, don't advance the iterator -- it was already advanced in order to prevent bad data
-    if ((iterator->_state && iterator->_state->removed) || hashIterNext(map, iterator))
-    {
-        state = iterator->_state;
-        // Finally, set the iterator values
-        iterator->key   = state->curNode->key;
-        iterator->value = state->curNode->value;
-
-        // Keep track of how many we've returned via this iterator
-        state->returned++;
-
-        // Reset the 'removed' flag
-        state->removed = false;
-
-        HASH_LOG("Iterated over %d/%d", state->returned, map->count);
-
-        // Return true to indicate iteration shoud continue
         return true;
     }
-    else
-    {
-        HASH_LOG("Done iterating after %d/%d!", iterator->_state ? iterator->_state->returned : 0, map->count);
-        // No next item!
-        hashIterReset(iterator);
 
-        return false;
-    }
+    hashIterReset(iterator);
+    return false;
 }
 
 /**
@@ -902,66 +868,45 @@ bool hashIterate(const hashMap_t* map, hashIterator_t* iterator)
  */
 bool hashIterRemove(hashMap_t* map, hashIterator_t* iter)
 {
-    if (!iter || !iter->_state)
+    if (!iter || 0 == iter->_phase || 3 == iter->_phase)
     {
-        // Can't do anything with nulls...
+        // Not currently on an item
         return false;
     }
 
-    hashIterState_t* state = iter->_state;
-    bool result            = false;
-
-    int newCount         = map->count;
-    node_t* nextListNode = state->curBucket->hasMulti ? state->curListNode->next : NULL;
-    bucketRemove(map, state->curBucket, state->curNode, state->curListNode, &newCount);
-    if (newCount != map->count)
-    {
-        int diff = map->count - newCount;
-        state->returned -= diff;
-        map->count     = newCount;
-        state->removed = true;
-        HASH_LOG("Removed %d nodes in iterator, map now has %d nodes", diff, map->count);
-    }
-    else
-    {
-        ESP_LOGW("HashMap", "WARN: Count didn't change on remove for some reason?");
-    }
-
-    state->curListNode = nextListNode;
-    if (nextListNode == NULL)
+    if (1 == iter->_phase)
     {
-        result = hashIterNext(map, iter);
+        tableRemove(map->values, map->size, &map->values[(iter->_start + iter->_pos) & (map->size - 1)]);
+        map->count--;
     }
     else
     {
-        state->curNode = nextListNode->val;
-        result         = true;
+        tableRemove(map->oldValues, map->oldSize, &map->oldValues[(iter->_start + iter->_pos) & (map->oldSize - 1)]);
+        map->count--;
+        hashOldRemoved(map);
     }
+    HASH_LOG("Removed node in iterator, map now has %d nodes", map->count);
 
-    return result;
+    // The next entry of the cluster may have been shifted into this slot, so check it again
+    iter->_removed = true;
+    return hashIterNext(map, iter, false);
 }
 
 /**
- * @brief Reset the given iterator struct, freeing any memory associated with it
+ * @brief Reset the given iterator struct so it can be used to iterate again
  *
  * @param iterator A pointer to the iterator struct to be reset
  */
 void hashIterReset(hashIterator_t* iterator)
 {
-    if (iterator->_state)
-    {
-        heap_caps_free(iterator->_state);
-    }
-
-    iterator->_state = NULL;
-    iterator->key    = NULL;
-    iterator->value  = NULL;
+    memset(iterator, 0, sizeof(hashIterator_t));
 }
 
 /**
  * @brief Prints out a detailed report on the hash map state.
  *
- * This can be useful when testing to determine the effectiveness of a hash function.
+ * This can be useful when testing to determine the effectiveness of a hash function. Entries far from their home slot
+ * mean the hash function is clustering keys.
  *
  * @param map The hash map to print the state of
  */
@@ -970,56 +915,120 @@ void hashReport(const hashMap_t* map)
     bool stringKeys = (!map->hashFunc || map->hashFunc == hashString);
 
     ESP_LOGI("HashMap", "================");
-    ESP_LOGI("HashMap", "Hash Map %p contains %d items in %d buckets", (const void*)map, map->count, map->size);
-    for (hashBucket_t* bucket = map->values; bucket < (map->values + map->size); bucket++)
+    ESP_LOGI("HashMap", "Hash map has %d items in %d slots", map->count, map->size);
+    if (NULL != map->oldValues)
     {
-        uint32_t bucketIdx = (uint32_t)(bucket - map->values);
-        if (bucket->hasMulti && bucket->multi.length > 0)
+        ESP_LOGI("HashMap", "Resizing, %d items left to migrate from %d slots", map->oldCount, map->oldSize);
+    }
+
+    uint32_t totalDist = 0;
+    uint16_t maxDist   = 0;
+    for (int slotIdx = 0; slotIdx < map->size; slotIdx++)
+    {
+        const hashBucket_t* slot = &map->values[slotIdx];
+        if (0 == slot->dist)
         {
-            ESP_LOGI("HashMap", "Bucket %04" PRIu32 " contains %d nodes:", bucketIdx, bucket->multi.length);
-            uint32_t nodeIdx = 0;
-            for (node_t* node = bucket->multi.first; NULL != node; node = node->next, nodeIdx++)
-            {
-                hashNode_t* hashNode = (hashNode_t*)(node->val);
+            ESP_LOGI("HashMap", "Slot %04d is empty", slotIdx);
+            continue;
+        }
 
-                if (stringKeys)
-                {
-                    ESP_LOGI("HashMap",
-                             "            Node %02" PRIu32 " has hash=%08" PRIx32 ", value=%p, and key=\"%s\"", nodeIdx,
-                             hashNode->hash, hashNode->value, (const char*)hashNode->key);
-                }
-                else
-                {
-                    ESP_LOGI("HashMap",
-                             "            Node %02" PRIu32 " has hash=%08" PRIx32 ", value=%p, and key=\"%p\"", nodeIdx,
-                             hashNode->hash, hashNode->value, hashNode->key);
-                }
-            }
+        totalDist += slot->dist - 1;
+        maxDist = MAX(maxDist, slot->dist - 1);
+
+        if (stringKeys)
+        {
+            ESP_LOGI("HashMap", "Slot %04d has hash=%08" PRIx32 ", distance=%" PRIu16 ", value=%p, and key=\"%s\"",
+                     slotIdx, slot->hash, (uint16_t)(slot->dist - 1), slot->value, (const char*)slotKey(slot));
         }
         else
         {
-            if (bucket->single.value != NULL)
+            ESP_LOGI("HashMap", "Slot %04d has hash=%08" PRIx32 ", distance=%" PRIu16 ", value=%p, and key=%p",
+                     slotIdx, slot->hash, (uint16_t)(slot->dist - 1), slot->value, slotKey(slot));
+        }
+    }
+
+    int newCount = map->count - map->oldCount;
+    if (newCount > 0)
+    {
+        ESP_LOGI("HashMap", "Probe distance: average %" PRIu32 ".%02" PRIu32 ", max %" PRIu16,
+                 totalDist / newCount, (totalDist * 100 / newCount) % 100, maxDist);
+    }
+    ESP_LOGI("HashMap", "================");
+}
+
+#ifdef ENABLE_BENCHMARKS
+
+/**
+ * @brief Measure insert, lookup, and iteration time for int and string keys at several map sizes
+ *
+ * Each map starts small so the times include resizing. The largest maps need more memory than a Swadge has, so this is
+ * meant to be run on the host, with an allocator that isn't limited to the Swadge's largest heap block.
+ */
+void hashBenchmark(void)
+{
+    static const int32_t counts[] = {100, 1000, 10000, 100000};
+
+    char* strKeys
+        = heap_caps_malloc_tag(counts[ARRAY_SIZE(counts) - 1] * BENCH_KEY_LEN, MALLOC_CAP_SPIRAM, "hashBench");
+    for (int32_t i = 0; i < counts[ARRAY_SIZE(counts) - 1]; i++)
+    {
+        snprintf(&strKeys[i * BENCH_KEY_LEN], BENCH_KEY_LEN, "%" PRId32, i);
+    }
+
+    for (int32_t c = 0; c < (int32_t)ARRAY_SIZE(counts); c++)
+    {
+        int32_t n = counts[c];
+        for (int32_t useStr = 0; useStr < 2; useStr++)
+        {
+            hashMap_t map;
+            if (useStr)
             {
-                if (stringKeys)
-                {
-                    ESP_LOGI("HashMap",
-                             "Bucket %04" PRIu32 " contains a single node with hash=%08" PRIx32
-                             ", value=%p, and key=\"%s\"",
-                             bucketIdx, bucket->single.hash, bucket->single.value, (const char*)bucket->single.key);
-                }
-                else
+                hashInit(&map, 16);
+            }
+            else
+            {
+                hashInitBin(&map, 16, hashInt, intsEq);
+            }
+
+            // Int keys start at 1 so none of them are NULL
+            int64_t tStart = esp_timer_get_time();
+            for (int32_t i = 0; i < n; i++)
+            {
+                const void* key = useStr ? (const void*)&strKeys[i * BENCH_KEY_LEN] : (const void*)((intptr_t)i + 1);
+                hashPutBin(&map, key, (void*)((intptr_t)i));
+            }
+            int64_t tPut = esp_timer_get_time() - tStart;
+
+            int32_t misses = 0;
+            tStart         = esp_timer_get_time();
+            for (int32_t i = 0; i < n; i++)
+            {
+                const void* key = useStr ? (const void*)&strKeys[i * BENCH_KEY_LEN] : (const void*)((intptr_t)i + 1);
+                if ((void*)((intptr_t)i) != hashGetBin(&map, key))
                 {
-                    ESP_LOGI("HashMap",
-                             "Bucket %04" PRIu32 " contains a single node with hash=%08" PRIx32
-                             ", value=%p, and key=%p",
-                             bucketIdx, bucket->single.hash, bucket->single.value, bucket->single.key);
+                    misses++;
                 }
             }
-            else
+            int64_t tGet = esp_timer_get_time() - tStart;
+
+            int32_t seen        = 0;
+            hashIterator_t iter = {0};
+            tStart              = esp_timer_get_time();
+            while (hashIterate(&map, &iter))
             {
-                ESP_LOGI("HashMap", "Bucket %04" PRIu32 " is empty", bucketIdx);
+                seen++;
             }
+            int64_t tIter = esp_timer_get_time() - tStart;
+
+            printf("%6" PRId32 " %s keys: put %" PRId64 "us, get %" PRId64 "us, iterate %" PRId64
+                   "us (%" PRId32 " misses, %" PRId32 " iterated)\n",
+                   n, useStr ? "str" : "int", tPut, tGet, tIter, misses, seen);
+
+            hashDeinit(&map);
         }
     }
-    ESP_LOGI("HashMap", "================");
-}
\ No newline at end of file
+
+    heap_caps_free(strKeys);
+}
+
+#endif
@@ -17,12 +17,22 @@
  * the key of an entry in the map, remove it and add it with the new key instead.
  *
  * Basic operations against the hash map have O(1) time in the average case, with O(n) time in the worst case.
- * Hash collisions are handled by storing multiple items within the same bucket in a linked list. Resizing is O(k),
- * where k is the number of buckets in the hash map, and should occur once in every k put operations.
+ * Entries are stored directly in a single table using open addressing with Robin Hood probing: when an entry
+ * collides, it moves along to the next slot, and takes over any slot whose entry is closer to its own home slot.
+ * This keeps probe sequences short and evenly spread, and lets a lookup stop early once it passes where its key would
+ * have been. Removing an entry shifts the rest of its cluster back by one, so no tombstones are left behind and a map
+ * with many removals stays as fast as a fresh one.
  *
- * Iteration over the map is O(k) best case, O(k+n) worst case, and O(k) average case, as we do not know ahead of time
- * which buckets or keys are in use. This could theoretically be improved to O(n) worst case if keys were also kept in
- * a separate array, but this would be a marginal improvement with a lot of added complexity.
+ * Growing the table is incremental. When the map becomes about 75% full, a table twice the size is allocated, and
+ * each following put or remove moves a few entries from the old table into it. Lookups check both tables until the
+ * old one is empty. This spreads the O(n) cost of resizing over many calls, instead of stalling a single frame.
+ *
+ * Iteration over the map is O(k), where k is the number of slots in the table, and does not allocate any memory.
+ *
+ * Short string keys, up to ::HASH_INLINE_KEY_LEN - 1 characters, can optionally be copied into the table itself by
+ * setting ::hashMap_t.inlineKeys. Such keys don't need to stay valid after they are added, and comparing them does not
+ * need to follow a pointer. The key returned by hashIterate() for an inlined key points into the table, and is only
+ * valid until the map is next modified.
  *
  * \section hashMap_caveats Caveats
  *
@@ -46,11 +56,16 @@
  *
  * hashDeinit() deallocates a hash map and all its entries.
  *
+ * hashInitArena() initializes a hash map which allocates its table from an ::arena_t instead of the heap. The old
+ * table left behind by a resize is not returned until the arena is released, so this is best used with a generous
+ * initial size. A map backed by getModeArena() does not need to be deinitialized when the mode exits.
+ *
  * hashIterate() can be used to loop over a hash map's entries.
  *
  * hashIterReset() is used to reset an iterator if iteration stopped before hashIterate() returned false.
  *
- * hashIterRemove() can be used to safely remove entries during iteration.
+ * hashIterRemove() can be used to safely remove entries during iteration. The values of existing entries may be
+ * updated with hashPut() during iteration, but new entries must not be added until iteration is complete.
  *
  * hashPutBin(), hashGetBin(), and hashRemoveBin() are variants of the normal hash map functions which accept
  * a void pointer in the \c key argument, rather than a char pointer. You must provide hash and equality
@@ -374,7 +389,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#include "linked_list.h"
+#include "arena.h"
 
 /**
  * @brief A function that takes a pointer to key data and returns its hash value
@@ -389,9 +404,11 @@ typedef uint32_t (*hashFunction_t)(const void* data);
  */
 typedef bool (*eqFunction_t)(const void* a, const void* b);
 
+/// @brief The size of the buffer for keys stored with ::hashMap_t.inlineKeys, including the NUL terminator
+#define HASH_INLINE_KEY_LEN 8
+
 // Forward-declared internal structs
 typedef struct hashBucket hashBucket_t;
-typedef struct hashIterState hashIterState_t;
 
 /**
  * @brief Struct used for iterating through a hash map efficiently
@@ -403,8 +420,18 @@ typedef struct
     /// @brief The value of the current key-value pair
     void* value;
 
-    /// @internal @brief Internal iterator state
-    hashIterState_t* _state;
+    /// @internal @brief Which table is being iterated: 0 before starting, 1 for the main table, 2 for the table being
+    /// resized away from, and 3 when finished
+    uint8_t _phase;
+
+    /// @internal @brief Whether the iterator has already been advanced, after removing the previous item
+    bool _removed;
+
+    /// @internal @brief The empty slot iteration of the current table started from
+    int _start;
+
+    /// @internal @brief The offset of the current slot from _start
+    int _pos;
 } hashIterator_t;
 
 /**
@@ -412,13 +439,13 @@ typedef struct
  */
 typedef struct
 {
-    /// @brief The total number of allocated buckets in the hash map
+    /// @brief The total number of slots in the hash map's table. This is always a power of two
     int size;
 
     /// @brief The actual number of items stored in the hash map
     int count;
 
-    /// @brief The array of bucket values
+    /// @brief The table of slots
     hashBucket_t* values;
 
     /// @brief The key hash function to use, or NULL to use hashString()
@@ -426,6 +453,24 @@ typedef struct
 
     /// @brief The key equality function to use, or NULL to use strEq()
     eqFunction_t eqFunc;
+
+    /// @brief The arena to allocate tables from, or NULL to use the heap
+    arena_t* arena;
+
+    /// @brief Set this after initialization to copy string keys shorter than ::HASH_INLINE_KEY_LEN into the map
+    bool inlineKeys;
+
+    /// @brief The table being resized away from, or NULL if no resize is in progress
+    hashBucket_t* oldValues;
+
+    /// @brief The number of slots in oldValues
+    int oldSize;
+
+    /// @brief The number of items, included in count, which have not been moved out of oldValues yet
+    int oldCount;
+
+    /// @brief The next slot in oldValues to move into values
+    int migrateIdx;
 } hashMap_t;
 
 // Default hash functions
@@ -450,6 +495,7 @@ void* hashRemoveBin(hashMap_t* map, const void* key);
 
 void hashInit(hashMap_t* map, int initialSize);
 void hashInitBin(hashMap_t* map, int initialSize, hashFunction_t hashFunc, eqFunction_t eqFunc);
+void hashInitArena(hashMap_t* map, int initialSize, hashFunction_t hashFunc, eqFunction_t eqFunc, arena_t* arena);
 void hashDeinit(hashMap_t* map);
 
 bool hashIterate(const hashMap_t* map, hashIterator_t* iterator);
@@ -458,4 +504,8 @@ void hashIterReset(hashIterator_t* iterator);
 
 void hashReport(const hashMap_t* map);
 
+#ifdef ENABLE_BENCHMARKS
+void hashBenchmark(void);
+#endif
+
 #endif
@@ -43,10 +43,16 @@ bool checkForShake(vec3d_t* lastOrientation, list_t* shakeHistory, bool* isShook
             int32_t tDelta = delta.x + delta.y + delta.z;
 
             // Add the value to the history list
-            push(shakeHistory, (void*)((intptr_t)tDelta));
-            if (shakeHistory->length > SHAKE_HYSTERESIS)
+            if (shakeHistory->length >= SHAKE_HYSTERESIS)
             {
-                shift(shakeHistory);
+                // The history is full, so recycle the oldest node rather than freeing it and allocating a new one
+                node_t* oldest = shiftNode(shakeHistory);
+                oldest->val    = (void*)((intptr_t)tDelta);
+                pushNode(shakeHistory, oldest);
+            }
+            else
+            {
+                push(shakeHistory, (void*)((intptr_t)tDelta));
             }
 
             // If it's not shaking and over the threshold
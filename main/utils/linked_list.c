@@ -9,8 +9,11 @@
 #include <esp_log.h>
 #include <esp_random.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
 
 #include "linked_list.h"
+#include "arena.h"
+#include "macros.h"
 
 //==============================================================================
 // Defines
@@ -22,10 +25,33 @@
     #define VALIDATE_LIST(func, line, nl, list, target)
 #endif
 
+#ifdef ENABLE_BENCHMARKS
+    /// The number of nodes listBenchmark() keeps in the list, like a short queue
+    #define BENCH_QUEUE_LEN 16
+    /// The number of pushes and shifts listBenchmark() times for each kind of node
+    #define BENCH_OPS 1000000
+#endif
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief A block of nodes allocated at once by a ::nodePool_t
+ */
+typedef struct nodePoolSlab
+{
+    struct nodePoolSlab* next; ///< The next slab in the pool
+    node_t nodes[];            ///< The nodes in this slab
+} nodePoolSlab_t;
+
 //==============================================================================
 // Function Prototypes
 //==============================================================================
 
+static node_t* allocNode(list_t* list);
+static void freeNode(list_t* list, node_t* node);
+
 #ifdef TEST_LIST
 static void validateList(const char* func, int line, bool nl, list_t* list, node_t* target);
 #endif
@@ -35,30 +61,271 @@ static void validateList(const char* func, int line, bool nl, list_t* list, node
 //==============================================================================
 
 /**
- * @brief Add to the end of the list
+ * @brief Allocate a node for a list, from the list's pool or arena if it has one
+ *
+ * @param list The list the node will be added to
+ * @return The new node, or NULL if the pool, arena, or heap is exhausted
+ */
+static node_t* allocNode(list_t* list)
+{
+    if (NULL != list->pool)
+    {
+        return nodePoolAlloc(list->pool);
+    }
+    else if (NULL != list->arena)
+    {
+        return arenaAlloc(list->arena, sizeof(node_t));
+    }
+    return heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
+}
+
+/**
+ * @brief Free a node removed from a list. Pooled nodes are returned to the pool, and nodes allocated from an arena
+ * are released with the arena instead
+ *
+ * @param list The list the node was removed from
+ * @param node The node to free
+ */
+static void freeNode(list_t* list, node_t* node)
+{
+    if (NULL != list->pool)
+    {
+        nodePoolFree(list->pool, node);
+    }
+    else if (NULL == list->arena)
+    {
+        heap_caps_free(node);
+    }
+}
+
+/**
+ * @brief Initialize a pool of nodes. Nodes are allocated from the heap in slabs, and freed nodes are kept for reuse
+ * rather than returned to the heap. A pool may be shared by any number of lists
+ *
+ * @param pool The pool to initialize
+ * @param nodesPerSlab The number of nodes to allocate at once when the pool runs out
+ * @param caps The heap capabilities to allocate slabs with, i.e. \c MALLOC_CAP_SPIRAM or \c MALLOC_CAP_8BIT
+ */
+void nodePoolInit(nodePool_t* pool, uint16_t nodesPerSlab, uint32_t caps)
+{
+    pool->freeNodes    = NULL;
+    pool->slabs        = NULL;
+    pool->nodesPerSlab = nodesPerSlab ? nodesPerSlab : 1;
+    pool->caps         = caps;
+    pool->numNodes     = 0;
+    pool->numFree      = 0;
+}
+
+/**
+ * @brief Free all of a pool's slabs. Any list using this pool must be cleared or abandoned first
+ *
+ * @param pool The pool to deinitialize
+ */
+void nodePoolDeinit(nodePool_t* pool)
+{
+    if (pool->numFree != pool->numNodes)
+    {
+        ESP_LOGW("LIST", "Node pool freed with %d nodes still in use", pool->numNodes - pool->numFree);
+    }
+
+    while (NULL != pool->slabs)
+    {
+        nodePoolSlab_t* next = pool->slabs->next;
+        heap_caps_free(pool->slabs);
+        pool->slabs = next;
+    }
+    pool->freeNodes = NULL;
+    pool->numNodes  = 0;
+    pool->numFree   = 0;
+}
+
+/**
+ * @brief Get a node from a pool, allocating a new slab if the pool is empty
+ *
+ * @param pool The pool to get a node from
+ * @return A node, or NULL if the heap is exhausted
+ */
+node_t* nodePoolAlloc(nodePool_t* pool)
+{
+    if (NULL == pool->freeNodes)
+    {
+        nodePoolSlab_t* slab = heap_caps_malloc_tag(sizeof(nodePoolSlab_t) + pool->nodesPerSlab * sizeof(node_t),
+                                                    pool->caps, "nodePool");
+        if (NULL == slab)
+        {
+            return NULL;
+        }
+        slab->next  = pool->slabs;
+        pool->slabs = slab;
+
+        // Link all the new nodes into the free list
+        for (uint16_t i = 0; i < pool->nodesPerSlab; i++)
+        {
+            slab->nodes[i].next = pool->freeNodes;
+            pool->freeNodes     = &slab->nodes[i];
+        }
+        pool->numNodes += pool->nodesPerSlab;
+        pool->numFree += pool->nodesPerSlab;
+    }
+
+    node_t* node    = pool->freeNodes;
+    pool->freeNodes = node->next;
+    pool->numFree--;
+    return node;
+}
+
+/**
+ * @brief Return a node to the pool it was allocated from
+ *
+ * @param pool The pool to return the node to
+ * @param node The node to return
+ */
+void nodePoolFree(nodePool_t* pool, node_t* node)
+{
+    node->next      = pool->freeNodes;
+    pool->freeNodes = node;
+    pool->numFree++;
+}
+
+/**
+ * @brief Add a node to the end of the list. The node is not allocated or copied, so it may be embedded in the value it
+ * points to
  *
  * @param list The list to add to
- * @param val The value to be added
+ * @param node The node to add. Its ::node_t.val should already be set
  */
-void push(list_t* list, void* val)
+void pushNode(list_t* list, node_t* node)
 {
-    VALIDATE_LIST(__func__, __LINE__, true, list, val);
-    node_t* newLast = heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
-    newLast->val    = val;
-    newLast->next   = NULL;
-    newLast->prev   = list->last;
+    VALIDATE_LIST(__func__, __LINE__, true, list, node);
+    node->next = NULL;
+    node->prev = list->last;
+
+    if (list->length == 0)
+    {
+        list->first = node;
+        list->last  = node;
+    }
+    else
+    {
+        list->last->next = node;
+        list->last       = node;
+    }
+    list->length++;
+    VALIDATE_LIST(__func__, __LINE__, false, list, node);
+}
+
+/**
+ * @brief Add a node to the front of the list. The node is not allocated or copied, so it may be embedded in the value
+ * it points to
+ *
+ * @param list The list to add to
+ * @param node The node to add. Its ::node_t.val should already be set
+ */
+void unshiftNode(list_t* list, node_t* node)
+{
+    VALIDATE_LIST(__func__, __LINE__, true, list, node);
+    node->next = list->first;
+    node->prev = NULL;
 
     if (list->length == 0)
     {
-        list->first = newLast;
-        list->last  = newLast;
+        list->first = node;
+        list->last  = node;
     }
     else
     {
-        list->last->next = newLast;
-        list->last       = newLast;
+        list->first->prev = node;
+        list->first       = node;
     }
     list->length++;
+    VALIDATE_LIST(__func__, __LINE__, false, list, node);
+}
+
+/**
+ * @brief Remove the last node from the list without freeing it
+ *
+ * @param list The list to remove the last node from
+ * @return The removed node, or NULL if the list was empty
+ */
+node_t* popNode(list_t* list)
+{
+    node_t* target = list->last;
+    if (target != NULL)
+    {
+        unlinkNode(list, target);
+    }
+    return target;
+}
+
+/**
+ * @brief Remove the first node from the list without freeing it
+ *
+ * @param list The list to remove the first node from
+ * @return The removed node, or NULL if the list was empty
+ */
+node_t* shiftNode(list_t* list)
+{
+    node_t* target = list->first;
+    if (target != NULL)
+    {
+        unlinkNode(list, target);
+    }
+    return target;
+}
+
+/**
+ * @brief Remove a specific node from the list without freeing it.
+ * This relinks the node's neighbors, but does not validate that it was part of the given ::list_t.
+ *
+ * @param list The list to remove the node from
+ * @param node The node to remove
+ */
+void unlinkNode(list_t* list, node_t* node)
+{
+    VALIDATE_LIST(__func__, __LINE__, true, list, node);
+
+    // Adjust first and last, if necessary
+    if (list->first == node)
+    {
+        list->first = node->next;
+    }
+    if (list->last == node)
+    {
+        list->last = node->prev;
+    }
+
+    // Relink previous and next nodes, if able
+    if (NULL != node->prev)
+    {
+        node->prev->next = node->next;
+    }
+    if (NULL != node->next)
+    {
+        node->next->prev = node->prev;
+    }
+
+    node->next = NULL;
+    node->prev = NULL;
+    list->length--;
+    VALIDATE_LIST(__func__, __LINE__, false, list, NULL);
+}
+
+/**
+ * @brief Add to the end of the list
+ *
+ * @param list The list to add to
+ * @param val The value to be added
+ */
+void push(list_t* list, void* val)
+{
+    VALIDATE_LIST(__func__, __LINE__, true, list, val);
+    node_t* newLast = allocNode(list);
+    if (NULL == newLast)
+    {
+        return;
+    }
+    newLast->val = val;
+    pushNode(list, newLast);
     VALIDATE_LIST(__func__, __LINE__, false, list, val);
 }
 
@@ -94,7 +361,7 @@ void* pop(list_t* list)
 
         // Get the last node val, then free it and update length
         retval = target->val;
-        heap_caps_free(target);
+        freeNode(list, target);
         list->length--;
     }
 
@@ -111,22 +378,13 @@ void* pop(list_t* list)
 void unshift(list_t* list, void* val)
 {
     VALIDATE_LIST(__func__, __LINE__, true, list, val);
-    node_t* newFirst = heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
-    newFirst->val    = val;
-    newFirst->next   = list->first;
-    newFirst->prev   = NULL;
-
-    if (list->length == 0)
+    node_t* newFirst = allocNode(list);
+    if (NULL == newFirst)
     {
-        list->first = newFirst;
-        list->last  = newFirst;
+        return;
     }
-    else
-    {
-        list->first->prev = newFirst;
-        list->first       = newFirst;
-    }
-    list->length++;
+    newFirst->val = val;
+    unshiftNode(list, newFirst);
     VALIDATE_LIST(__func__, __LINE__, false, list, val);
 }
 
@@ -162,7 +420,7 @@ void* shift(list_t* list)
 
         // Get the first node val, then free it and update length
         retval = target->val;
-        heap_caps_free(target);
+        freeNode(list, target);
         list->length--;
     }
 
@@ -176,28 +434,35 @@ void* shift(list_t* list)
  * @param list The list to add to
  * @param val The value to add
  * @param index The index to add the value at
- * @return true if the value was added, false if the index was invalid
+ * @return true if the value was added, false if the index was invalid or there was no memory for it
  */
 bool addIdx(list_t* list, void* val, uint16_t index)
 {
     VALIDATE_LIST(__func__, __LINE__, true, list, val);
+    uint16_t oldLength = list->length;
     // If the index is 0, we're adding to the start of the list
     if (index == 0)
     {
         unshift(list, val);
+        return list->length != oldLength;
     }
     // Else if the index is the length, we're adding to the end of the list
     else if (index == list->length - 1)
     {
         push(list, val);
+        return list->length != oldLength;
     }
     // Else if the index we're trying to add to is before the end of the list
     else if (index < list->length - 1)
     {
-        node_t* newNode = heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
-        newNode->val    = val;
-        newNode->next   = NULL;
-        newNode->prev   = NULL;
+        node_t* newNode = allocNode(list);
+        if (NULL == newNode)
+        {
+            return false;
+        }
+        newNode->val  = val;
+        newNode->next = NULL;
+        newNode->prev = NULL;
 
         node_t* current = list->first;
         for (uint16_t i = 0; i < index - 1; i++)
@@ -249,10 +514,14 @@ void addBefore(list_t* list, void* val, node_t* entry)
     else
     {
         node_t* prev    = entry->prev;
-        node_t* newNode = heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
-        newNode->val    = val;
-        newNode->prev   = prev;
-        newNode->next   = entry;
+        node_t* newNode = allocNode(list);
+        if (NULL == newNode)
+        {
+            return;
+        }
+        newNode->val  = val;
+        newNode->prev = prev;
+        newNode->next = entry;
 
         if (prev)
         {
@@ -288,10 +557,14 @@ void addAfter(list_t* list, void* val, node_t* entry)
     else
     {
         node_t* next    = entry->next;
-        node_t* newNode = heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
-        newNode->val    = val;
-        newNode->prev   = entry;
-        newNode->next   = next;
+        node_t* newNode = allocNode(list);
+        if (NULL == newNode)
+        {
+            return;
+        }
+        newNode->val  = val;
+        newNode->prev = entry;
+        newNode->next = next;
 
         if (next)
         {
@@ -350,7 +623,7 @@ void* removeIdx(list_t* list, uint16_t index)
         current->next       = target->next;
         current->next->prev = current;
 
-        heap_caps_free(target);
+        freeNode(list, target);
         target = NULL;
 
         list->length--;
@@ -416,7 +689,7 @@ void* removeEntry(list_t* list, node_t* entry)
     VALIDATE_LIST(__func__, __LINE__, false, list, entry);
 
     // free the memory
-    heap_caps_free(entry);
+    freeNode(list, entry);
 
     // Return the value
     return retVal;
@@ -615,4 +888,66 @@ void listTester(void)
     ESP_LOGD("LV", "List validated");
 }
 
+#endif
+
+#ifdef ENABLE_BENCHMARKS
+
+/**
+ * @brief Measure push and shift throughput for heap allocated, pooled, and intrusive nodes. The list is kept at a
+ * steady length like a queue, which is the common hot path
+ */
+void listBenchmark(void)
+{
+    // Heap allocated nodes
+    list_t heapList = {0};
+    int64_t tStart  = esp_timer_get_time();
+    for (int32_t i = 0; i < BENCH_OPS; i++)
+    {
+        push(&heapList, (void*)((intptr_t)i));
+        if (heapList.length > BENCH_QUEUE_LEN)
+        {
+            shift(&heapList);
+        }
+    }
+    int64_t tHeap = esp_timer_get_time() - tStart;
+    clear(&heapList);
+
+    // Pooled nodes
+    nodePool_t pool;
+    nodePoolInit(&pool, BENCH_QUEUE_LEN + 1, MALLOC_CAP_8BIT);
+    list_t poolList = {.pool = &pool};
+    tStart          = esp_timer_get_time();
+    for (int32_t i = 0; i < BENCH_OPS; i++)
+    {
+        push(&poolList, (void*)((intptr_t)i));
+        if (poolList.length > BENCH_QUEUE_LEN)
+        {
+            shift(&poolList);
+        }
+    }
+    int64_t tPool = esp_timer_get_time() - tStart;
+    clear(&poolList);
+    nodePoolDeinit(&pool);
+
+    // Intrusive nodes, recycled from the head to the tail
+    node_t nodes[BENCH_QUEUE_LEN];
+    list_t intrusiveList = {0};
+    for (int32_t i = 0; i < BENCH_QUEUE_LEN; i++)
+    {
+        nodes[i].val = NULL;
+        pushNode(&intrusiveList, &nodes[i]);
+    }
+    tStart = esp_timer_get_time();
+    for (int32_t i = 0; i < BENCH_OPS; i++)
+    {
+        node_t* node = shiftNode(&intrusiveList);
+        node->val    = (void*)((intptr_t)i);
+        pushNode(&intrusiveList, node);
+    }
+    int64_t tIntrusive = esp_timer_get_time() - tStart;
+
+    printf("push+shift x%d: heap %" PRId64 "us, pool %" PRId64 "us, intrusive %" PRId64 "us\n", BENCH_OPS, tHeap,
+           tPool, tIntrusive);
+}
+
 #endif
\ No newline at end of file
@@ -21,6 +21,22 @@
  *
  * Links are allocated, so when done with a list, be sure to call clear() when done.
  *
+ * If ::list_t.arena is set before the first node is added, links are allocated from that arena instead of the heap.
+ * Removing a node does not return its memory, so this is best for lists that only grow, or that live as long as the
+ * arena. A list backed by getModeArena() does not need to be cleared when the mode exits.
+ *
+ * If ::list_t.pool is set before the first node is added, links are allocated from that ::nodePool_t instead. A pool
+ * allocates nodes from the heap in slabs and keeps removed nodes for reuse, so lists which churn, like queues, don't
+ * call into the heap on every add and remove. One pool may be shared by many lists. Initialize it with nodePoolInit()
+ * and free it with nodePoolDeinit() once every list using it has been cleared.
+ *
+ * \section linked_list_intrusive Intrusive Lists
+ *
+ * pushNode(), unshiftNode(), popNode(), shiftNode(), and unlinkNode() add and remove nodes which are owned by the
+ * caller, so no memory is allocated or freed at all. Usually the ::node_t is embedded in the struct it points to.
+ * Don't mix these with the allocating functions in the same list, and don't call clear() on an intrusive list.
+ * A node may also be moved from one list to another, or recycled within a list, without being freed.
+ *
  * \section linked_list_example Example
  *
  * Creating an empty list:
@@ -61,6 +77,23 @@
  * // Remove from tail
  * uint32_t* poppedVal = pop(myList);
  * \endcode
+ *
+ * An intrusive list:
+ * \code{.c}
+ * typedef struct
+ * {
+ *     int32_t data;
+ *     node_t node;
+ * } myItem_t;
+ *
+ * list_t myItems = {0};
+ * myItem_t item  = {.data = 5};
+ * // Point the embedded node at the item, then add it
+ * item.node.val = &item;
+ * pushNode(&myItems, &item.node);
+ * // Remove it. Nothing is freed
+ * myItem_t* removed = shiftNode(&myItems)->val;
+ * \endcode
  */
 
 #ifndef _LINKED_LIST_H
@@ -69,6 +102,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "arena.h"
+
 /**
  * @brief A node in a doubly linked list with pointers to the previous and next values (which may be NULL), and a \c
  * void* to arbritray data
@@ -80,14 +115,29 @@ typedef struct node
     struct node* prev; ///< The previous node in the list
 } node_t;
 
+/**
+ * @brief A pool of nodes which are allocated in slabs and reused after being removed from a list
+ */
+typedef struct
+{
+    node_t* freeNodes;          ///< Nodes available for reuse, linked through ::node_t.next
+    struct nodePoolSlab* slabs; ///< All slabs of nodes allocated by this pool
+    uint16_t nodesPerSlab;      ///< The number of nodes allocated at once when the pool runs out
+    uint32_t caps;              ///< The heap capabilities used when allocating slabs
+    int numNodes;               ///< The total number of nodes in all slabs
+    int numFree;                ///< The number of nodes available for reuse
+} nodePool_t;
+
 /**
  * @brief A doubly linked list with pointers to the first and last nodes
  */
 typedef struct
 {
-    node_t* first; ///< The first node in the list
-    node_t* last;  ///< The last node in the list
-    int length;    ///< The number of nodes in the list
+    node_t* first;    ///< The first node in the list
+    node_t* last;     ///< The last node in the list
+    int length;       ///< The number of nodes in the list
+    arena_t* arena;   ///< The arena to allocate nodes from, or NULL to use the heap
+    nodePool_t* pool; ///< The pool to allocate nodes from, or NULL. This takes priority over arena
 } list_t;
 
 void push(list_t* list, void* val);
@@ -102,9 +152,25 @@ void* removeEntry(list_t* list, node_t* entry);
 void clear(list_t* list);
 node_t* getNextWraparound(list_t* list, node_t* node);
 
+void pushNode(list_t* list, node_t* node);
+void unshiftNode(list_t* list, node_t* node);
+node_t* popNode(list_t* list);
+node_t* shiftNode(list_t* list);
+void unlinkNode(list_t* list, node_t* node);
+
+void nodePoolInit(nodePool_t* pool, uint16_t nodesPerSlab, uint32_t caps);
+void nodePoolDeinit(nodePool_t* pool);
+node_t* nodePoolAlloc(nodePool_t* pool);
+void nodePoolFree(nodePool_t* pool, node_t* node);
+
 #ifdef TEST_LIST
 // Exercise the linked list functions
 void listTester(void);
 #endif
 
+#ifdef ENABLE_BENCHMARKS
+// Measure push and shift throughput for heap, pooled, and intrusive nodes
+void listBenchmark(void);
+#endif
+
 #endif
@@ -138,6 +138,7 @@ static uint8_t baseMac[6];
 static int listLen[3];
 static uint8_t mutatorSeeds[3];
 nameData_t swadgeUsername;
+static bool usernameSystemReady = false;
 
 //==============================================================================
 // Functions
@@ -145,6 +146,13 @@ nameData_t swadgeUsername;
 
 void initUsernameSystem()
 {
+    // This may be called lazily from any of the functions below, only initialize once
+    if (usernameSystemReady)
+    {
+        return;
+    }
+    usernameSystemReady = true;
+
     listLen[0] = ARRAY_SIZE(adjList1);
     listLen[1] = ARRAY_SIZE(adjList2);
     listLen[2] = ARRAY_SIZE(nounList);
@@ -171,6 +179,7 @@ void initUsernameSystem()
 
 void generateMACUsername(nameData_t* nd)
 {
+    initUsernameSystem();
     nd->idxs[ADJ1] = mutatorSeeds[0];
     nd->idxs[ADJ2] = mutatorSeeds[1];
     nd->idxs[NOUN] = mutatorSeeds[2];
@@ -181,6 +190,7 @@ void generateMACUsername(nameData_t* nd)
 
 void generateRandUsername(nameData_t* nd)
 {
+    initUsernameSystem();
     if (nd->user)
     {
         nd->idxs[ADJ1] = _checkIfUserIdxInBounds(esp_random(), listLen[ADJ1], mutatorSeeds[ADJ1]);
@@ -201,6 +211,7 @@ void generateRandUsername(nameData_t* nd)
 
 void setUsernameFromND(nameData_t* nd)
 {
+    initUsernameSystem();
     if (nd->user)
     {
         nd->idxs[ADJ1] = _checkIfUserIdxInBounds(nd->idxs[ADJ1], listLen[ADJ1], mutatorSeeds[ADJ1]);
@@ -228,6 +239,7 @@ void setUsernameFromIdxs(nameData_t* nd, int idx1, int idx2, int idx3, int rando
 
 bool handleUsernamePickerInput(buttonEvt_t* evt, nameData_t* nd)
 {
+    initUsernameSystem();
     if (evt->down)
     {
         if (evt->button & PB_LEFT)
@@ -379,6 +391,7 @@ void drawUsernamePicker(nameData_t* nd)
 
 nameData_t* getSystemUsername(void)
 {
+    initUsernameSystem();
     return &swadgeUsername;
 }
 
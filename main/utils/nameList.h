@@ -50,6 +50,8 @@ typedef struct
 /**
  * @brief Call this to initialize the MAC variable. Call inside the swadge2024.h file.
  *
+ * This is deferred until after the first frame is drawn at boot. It is safe to call multiple times, and the other
+ * functions in this file will call it on demand if they are used before the deferred initialization runs.
  */
 void initUsernameSystem(void);
 
@@ -106,23 +106,23 @@
     /**
      * @brief Play a specific note
      *
-     * Calls midiNoteOn() or bzrPlayNote()
+     * Calls midiQueueNoteOn() or bzrPlayNote(), so the note starts with the next block the DAC renders
      *
      * @param freq The frequency of the note to play
      * @param channel The channel (L/R/Stereo) to play on, ignored for DAC speakers
      * @param vol The volume of the note to play
      *
      */
-    #define soundPlayNote(freq, channel, vol) midiNoteOn(globalMidiPlayerGet(channel), 0, freq, vol)
+    #define soundPlayNote(freq, channel, vol) midiQueueNoteOn(globalMidiPlayerGet(channel), 0, freq, vol)
 
     /**
      * @brief Stop a specific note
      *
-     * Calls spkStopNote() or bzrStopNote()
+     * Calls midiQueueNoteOff() or bzrStopNote()
      *
      * @param channel The channel (L/R/Stereo) to stop, ignored for DAC speakers
      */
-    #define soundStopNote(channel) midiNoteOff(globalMidiPlayerGet(channel), 0, freq, vol)
+    #define soundStopNote(channel) midiQueueNoteOff(globalMidiPlayerGet(channel), 0, freq, vol)
 
     /**
      * @brief Return the MIDI player used for SFX
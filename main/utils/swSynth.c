@@ -4,12 +4,26 @@
 
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 #include "esp_attr.h"
 #include "hdw-dac.h"
 #include "swSynth.h"
 #include "macros.h"
 #include "fp_math.h"
 
+#ifdef ENABLE_BENCHMARKS
+    #include <esp_timer.h>
+#endif
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+#ifdef ENABLE_BENCHMARKS
+    /// The number of oscillators swSynthBenchmark() renders at once
+    #define BENCH_OSCILLATORS 32
+#endif
+
 //==============================================================================
 // Constant variables
 //==============================================================================
@@ -83,6 +97,61 @@ static const int8_t triTab[] = {
     -18,  -16,  -14,  -12,  -10,  -8,   -6,   -4,   -2,
 };
 
+/**
+ * @brief Table of 256 8-bit signed values for a sawtooth wave
+ *
+ * \code{.c}
+ * for(int i = 0; i < 256; i++)
+ * {
+ *     printf("%d, ", i - 128);
+ * }
+ * @endcode
+ */
+static const int8_t sawTab[] = {
+    -128, -127, -126, -125, -124, -123, -122, -121, -120, -119, -118, -117, -116, -115, -114, -113, -112, -111, -110,
+    -109, -108, -107, -106, -105, -104, -103, -102, -101, -100, -99,  -98,  -97,  -96,  -95,  -94,  -93,  -92,  -91,
+    -90,  -89,  -88,  -87,  -86,  -85,  -84,  -83,  -82,  -81,  -80,  -79,  -78,  -77,  -76,  -75,  -74,  -73,  -72,
+    -71,  -70,  -69,  -68,  -67,  -66,  -65,  -64,  -63,  -62,  -61,  -60,  -59,  -58,  -57,  -56,  -55,  -54,  -53,
+    -52,  -51,  -50,  -49,  -48,  -47,  -46,  -45,  -44,  -43,  -42,  -41,  -40,  -39,  -38,  -37,  -36,  -35,  -34,
+    -33,  -32,  -31,  -30,  -29,  -28,  -27,  -26,  -25,  -24,  -23,  -22,  -21,  -20,  -19,  -18,  -17,  -16,  -15,
+    -14,  -13,  -12,  -11,  -10,  -9,   -8,   -7,   -6,   -5,   -4,   -3,   -2,   -1,   0,    1,    2,    3,    4,
+    5,    6,    7,    8,    9,    10,   11,   12,   13,   14,   15,   16,   17,   18,   19,   20,   21,   22,   23,
+    24,   25,   26,   27,   28,   29,   30,   31,   32,   33,   34,   35,   36,   37,   38,   39,   40,   41,   42,
+    43,   44,   45,   46,   47,   48,   49,   50,   51,   52,   53,   54,   55,   56,   57,   58,   59,   60,   61,
+    62,   63,   64,   65,   66,   67,   68,   69,   70,   71,   72,   73,   74,   75,   76,   77,   78,   79,   80,
+    81,   82,   83,   84,   85,   86,   87,   88,   89,   90,   91,   92,   93,   94,   95,   96,   97,   98,   99,
+    100,  101,  102,  103,  104,  105,  106,  107,  108,  109,  110,  111,  112,  113,  114,  115,  116,  117,  118,
+    119,  120,  121,  122,  123,  124,  125,  126,  127,
+};
+
+/**
+ * @brief Table of 256 8-bit signed values for a square wave. This has a smaller amplitude than the other waves because
+ * it is naturally louder
+ *
+ * \code{.c}
+ * for(int i = 0; i < 256; i++)
+ * {
+ *     printf("%d, ", (i >= 128) ? 64 : -64);
+ * }
+ * @endcode
+ */
+static const int8_t sqrTab[] = {
+    -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,
+    -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,
+    -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,
+    -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,
+    -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,
+    -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,
+    -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  -64,  64,   64,   64,   64,   64,
+    64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,
+    64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,
+    64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,
+    64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,
+    64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,
+    64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,   64,
+    64,   64,   64,   64,   64,   64,   64,   64,   64,
+};
+
 static const uint8_t chorusOffsets[] = {
     139, 227, 5,   103, 241, 67, 251, 109, 197, 59,  61,  3,   53,  229, 127, 23,  73,  223,
     13,  19,  47,  7,   181, 37, 2,   239, 29,  113, 167, 131, 41,  151, 83,  137, 11,  193,
@@ -94,49 +163,27 @@ static const uint8_t chorusOffsets[] = {
 //==============================================================================
 
 /**
- * @brief Get an 8-bit signed sample from a 256 point sine wave.
+ * @brief Get the 256 point wave table for a shape
  *
- * @param idx The index to get, must be between 0 and 255
- * @return A signed 8-bit sample of a sine wave
+ * @param shape The shape to get a table for
+ * @return The shape's wave table, or NULL if the shape has no table (i.e. noise)
  */
-static int8_t sineGen(uint16_t idx, void* data __attribute__((unused)))
+static const int8_t* shapeTable(oscillatorShape_t shape)
 {
-    return sinTab[idx];
-}
-
-/**
- * @brief Get an 8-bit signed sample from a 256 point square wave.
- *
- * This has a smaller amplitude than the other waves because it is naturally louder
- *
- * @param idx The index to get, must be between 0 and 255
- * @return A signed 8-bit sample of a square wave
- */
-static int8_t squareGen(uint16_t idx, void* data __attribute__((unused)))
-{
-    return (idx >= 128) ? 64 : -64;
-}
-
-/**
- * @brief Get an 8-bit signed sample from a 256 point sawtooth wave.
- *
- * @param idx The index to get, must be between 0 and 255
- * @return A signed 8-bit sample of a sawtooth wave
- */
-static int8_t sawtoothGen(uint16_t idx, void* data __attribute__((unused)))
-{
-    return (idx - 128);
-}
-
-/**
- * @brief Get an 8-bit signed sample from a 256 point triangle wave.
- *
- * @param idx The index to get, must be between 0 and 255
- * @return A signed 8-bit sample of a triangle wave
- */
-static int8_t triangleGen(uint16_t idx, void* data __attribute__((unused)))
-{
-    return triTab[idx];
+    switch (shape)
+    {
+        case SHAPE_SINE:
+            return sinTab;
+        case SHAPE_SAWTOOTH:
+            return sawTab;
+        case SHAPE_TRIANGLE:
+            return triTab;
+        case SHAPE_SQUARE:
+            return sqrTab;
+        case SHAPE_NOISE:
+            break;
+    }
+    return NULL;
 }
 
 /**
@@ -204,44 +251,21 @@ void swSynthInitOscillatorWave(synthOscillator_t* osc, waveFunc_t waveFunc, void
 /**
  * @brief Set a software synthesizer oscillator's shape
  *
+ * Sine, sawtooth, triangle, and square shapes are played from a wave table. Noise is generated by a function.
+ *
  * @param osc The oscillator to set the shape for
  * @param shape The shape to set (sine, square, sawtooth, triangle, or noise)
  */
 void swSynthSetShape(synthOscillator_t* osc, oscillatorShape_t shape)
 {
     osc->waveFuncData = NULL;
-    switch (shape)
-    {
-        case SHAPE_SINE:
-        {
-            osc->waveFunc = sineGen;
-            break;
-        }
-        case SHAPE_SAWTOOTH:
-        {
-            osc->waveFunc = sawtoothGen;
-            break;
-        }
-        case SHAPE_SQUARE:
-        {
-            osc->waveFunc = squareGen;
-            break;
-        }
-        case SHAPE_TRIANGLE:
-        {
-            osc->waveFunc = triangleGen;
-            break;
-        }
-        case SHAPE_NOISE:
-        {
-            osc->waveFunc = noiseGen;
-            break;
-        }
-    }
+    osc->waveTable    = shapeTable(shape);
+    osc->waveFunc     = (NULL == osc->waveTable) ? noiseGen : NULL;
 }
 
 /**
- * @brief Set the wave function of an oscillator
+ * @brief Set the wave function of an oscillator. Use swSynthSetWaveTable() instead if the wave is a fixed table of
+ * samples, which is much faster to play
  *
  * @param osc The oscillator to set the wave function of
  * @param waveFunc The wave function to use
@@ -249,10 +273,25 @@ void swSynthSetShape(synthOscillator_t* osc, oscillatorShape_t shape)
  */
 void swSynthSetWaveFunc(synthOscillator_t* osc, waveFunc_t waveFunc, void* waveFuncData)
 {
+    osc->waveTable    = NULL;
     osc->waveFunc     = waveFunc;
     osc->waveFuncData = waveFuncData;
 }
 
+/**
+ * @brief Set the wave table of an oscillator
+ *
+ * @param osc The oscillator to set the wave table of
+ * @param waveTable A table of 256 signed 8-bit samples for one period of the wave. It is not copied, so it must remain
+ * valid while the oscillator uses it
+ */
+void swSynthSetWaveTable(synthOscillator_t* osc, const int8_t* waveTable)
+{
+    osc->waveTable    = waveTable;
+    osc->waveFunc     = NULL;
+    osc->waveFuncData = NULL;
+}
+
 /**
  * @brief Set the frequency of an oscillator
  *
@@ -345,32 +384,90 @@ int32_t swSynthSumOscillators(synthOscillator_t* oscillators[], uint16_t numOsci
 
         // Mix this oscillator's output into the sample
         uint8_t offset = 0;
-        do
+        if (NULL != osc->waveTable)
+        {
+            do
+            {
+                sample += ((osc->waveTable[(uint8_t)(osc->accumulator.bytes[2] + chorusOffsets[offset])]
+                            * ((int32_t)osc->cVol))
+                           / 256);
+            } while (offset++ < osc->chorus);
+        }
+        else
         {
-            sample += ((osc->waveFunc((osc->accumulator.bytes[2] + chorusOffsets[offset]) % 256, osc->waveFuncData)
-                        * ((int32_t)osc->cVol))
-                       / 256);
-        } while (offset++ < osc->chorus);
+            do
+            {
+                sample += ((osc->waveFunc((osc->accumulator.bytes[2] + chorusOffsets[offset]) % 256,
+                                          osc->waveFuncData)
+                            * ((int32_t)osc->cVol))
+                           / 256);
+            } while (offset++ < osc->chorus);
+        }
     }
 
     return sample;
 }
 
+/**
+ * @brief Get a single sample of a shape's wave
+ *
+ * @param shape The shape to sample
+ * @param idx The index into the wave, from 0 to 255
+ * @return A signed 8-bit sample
+ */
 int8_t swSynthSampleWave(oscillatorShape_t shape, uint8_t idx)
 {
-    switch (shape)
+    const int8_t* table = shapeTable(shape);
+    return (NULL == table) ? noiseGen(idx, NULL) : table[idx];
+}
+
+#ifdef ENABLE_BENCHMARKS
+
+/**
+ * @brief A wave function which reads the sine table, to measure the cost of calling a function per sample
+ *
+ * @param idx The index to get, must be between 0 and 255
+ * @return A signed 8-bit sample of a sine wave
+ */
+static int8_t benchSineFunc(uint16_t idx, void* data __attribute__((unused)))
+{
+    return sinTab[idx];
+}
+
+/**
+ * @brief Measure how many oscillators can be rendered in real time with a wave function and with a wave table
+ */
+void swSynthBenchmark(void)
+{
+    synthOscillator_t oscs[BENCH_OSCILLATORS];
+    synthOscillator_t* oscPtrs[BENCH_OSCILLATORS];
+    int32_t checksum = 0;
+
+    for (int32_t method = 0; method < 2; method++)
     {
-        case SHAPE_SINE:
-            return sineGen(idx, NULL);
-        case SHAPE_SAWTOOTH:
-            return sawtoothGen(idx, NULL);
-        case SHAPE_TRIANGLE:
-            return triangleGen(idx, NULL);
-        case SHAPE_SQUARE:
-            return squareGen(idx, NULL);
-        case SHAPE_NOISE:
-            return noiseGen(idx, NULL);
+        for (int32_t i = 0; i < BENCH_OSCILLATORS; i++)
+        {
+            swSynthInitOscillator(&oscs[i], SHAPE_SINE, 110 + 20 * i, 200);
+            if (0 == method)
+            {
+                swSynthSetWaveFunc(&oscs[i], benchSineFunc, NULL);
+            }
+            oscPtrs[i] = &oscs[i];
+        }
+
+        // Render one second of audio
+        int64_t tStart = esp_timer_get_time();
+        for (int32_t n = 0; n < DAC_SAMPLE_RATE_HZ; n++)
+        {
+            checksum += swSynthSumOscillators(oscPtrs, BENCH_OSCILLATORS);
+        }
+        int64_t tRender = esp_timer_get_time() - tStart;
+
+        static const char* const names[] = {"wave function", "wave table"};
+        printf("%s: %d oscillators for 1s in %" PRId64 "us, ~%" PRId64 " oscillators in real time\n", names[method],
+               BENCH_OSCILLATORS, tRender, (tRender > 0) ? ((int64_t)BENCH_OSCILLATORS * 1000000) / tRender : 0);
     }
+    printf("Checksum %" PRId32 "\n", checksum);
+}
 
-    return 0;
-}
\ No newline at end of file
+#endif
@@ -17,6 +17,10 @@
  *
  * Call swSynthMixOscillators() to step a set of oscillators, mix their output, and return it for a DAC buffer.
  *
+ * Sine, sawtooth, triangle, and square waves are played from 256 point wave tables. Custom waves can be played from a
+ * table too, with swSynthSetWaveTable(). For waves which can't be a fixed table, swSynthSetWaveFunc() sets a function
+ * to call for every sample instead, which is slower.
+ *
  * \section swSynth_example Example
  *
  * \code{.c}
@@ -105,13 +109,14 @@ typedef int8_t (*waveFunc_t)(uint16_t idx, void* data);
  */
 typedef struct
 {
-    waveFunc_t waveFunc;    ///< A pointer to the function which generates samples
-    void* waveFuncData;     ///< A pointer to pass to the wave function
-    oscAccum_t accumulator; ///< An accumulator to increment the wave sample
-    int32_t stepSize;       ///< The step that should be added to the accumulator each sample, dependent on frequency
-    uint32_t tVol;          ///< The target volume (amplitude)
-    uint32_t cVol;          ///< The current volume which smoothly transitions to the target volume
-    uint8_t chorus;         ///< The number of offset samples to return
+    const int8_t* waveTable; ///< A table of 256 samples to play, or NULL to use waveFunc
+    waveFunc_t waveFunc;     ///< A pointer to the function which generates samples, if there is no waveTable
+    void* waveFuncData;      ///< A pointer to pass to the wave function
+    oscAccum_t accumulator;  ///< An accumulator to increment the wave sample
+    int32_t stepSize;        ///< The step that should be added to the accumulator each sample, dependent on frequency
+    uint32_t tVol;           ///< The target volume (amplitude)
+    uint32_t cVol;           ///< The current volume which smoothly transitions to the target volume
+    uint8_t chorus;          ///< The number of offset samples to return
 } synthOscillator_t;
 
 //==============================================================================
@@ -123,9 +128,14 @@ void swSynthInitOscillatorWave(synthOscillator_t* osc, waveFunc_t waveFunc, void
                                uint8_t volume);
 void swSynthSetShape(synthOscillator_t* osc, oscillatorShape_t shape);
 void swSynthSetWaveFunc(synthOscillator_t* osc, waveFunc_t waveFunc, void* waveFuncData);
+void swSynthSetWaveTable(synthOscillator_t* osc, const int8_t* waveTable);
 void swSynthSetFreq(synthOscillator_t* osc, uint32_t freq);
 void swSynthSetFreqPrecise(synthOscillator_t* osc, uq16_16 freq);
 void swSynthSetVolume(synthOscillator_t* osc, uint8_t volume);
 uint8_t swSynthMixOscillators(synthOscillator_t* oscillators[], uint16_t numOscillators);
 int32_t swSynthSumOscillators(synthOscillator_t* oscillators[], uint16_t numOscillators);
 int8_t swSynthSampleWave(oscillatorShape_t shape, uint8_t idx);
+
+#ifdef ENABLE_BENCHMARKS
+void swSynthBenchmark(void);
+#endif
@@ -0,0 +1,255 @@
+#include "asset_cache.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// @brief The first line of a cache file, followed by the tool hash. Change the version if the format changes
+static const char cacheHeader[] = "assets_preprocessor cache 1";
+
+/// @brief The FNV-1a prime for 64-bit hashes
+#define FNV_PRIME 0x100000001b3ULL
+
+static int compareEntries(const void* a, const void* b);
+static int compareNameToEntry(const void* name, const void* entry);
+
+/**
+ * @brief Add bytes to a 64-bit FNV-1a hash
+ *
+ * @param data The bytes to hash
+ * @param len The number of bytes to hash
+ * @param hash The hash so far, or ::ASSET_HASH_INIT to start a new one
+ * @return uint64_t The updated hash
+ */
+uint64_t hashBytes(const void* data, size_t len, uint64_t hash)
+{
+    const uint8_t* bytes = data;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * @brief Add a string and its NUL terminator to a 64-bit FNV-1a hash. The terminator keeps i.e. "ab" + "c" from
+ * hashing the same as "a" + "bc"
+ *
+ * @param str The string to hash, or NULL to hash an empty string
+ * @param hash The hash so far, or ::ASSET_HASH_INIT to start a new one
+ * @return uint64_t The updated hash
+ */
+uint64_t hashString(const char* str, uint64_t hash)
+{
+    if (NULL == str)
+    {
+        str = "";
+    }
+    return hashBytes(str, strlen(str) + 1, hash);
+}
+
+/**
+ * @brief Add the contents of a file to a 64-bit FNV-1a hash
+ *
+ * @param path The file to hash
+ * @param hash [in,out] The hash so far, or ::ASSET_HASH_INIT to start a new one. Updated with the file's contents
+ * @return true if the whole file was read
+ * @return false if the file could not be read
+ */
+bool hashFile(const char* path, uint64_t* hash)
+{
+    FILE* file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        return false;
+    }
+
+    uint8_t buf[16384];
+    size_t read;
+    while (0 < (read = fread(buf, 1, sizeof(buf), file)))
+    {
+        *hash = hashBytes(buf, read, *hash);
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+/**
+ * @brief Compare two cache entries by name, for qsort() and bsearch()
+ *
+ * @param a The first entry
+ * @param b The second entry
+ * @return int The order of the entries' names
+ */
+static int compareEntries(const void* a, const void* b)
+{
+    return strcmp(((const assetCacheEntry_t*)a)->inName, ((const assetCacheEntry_t*)b)->inName);
+}
+
+/**
+ * @brief Compare a name to a cache entry's name, for bsearch()
+ *
+ * @param name The name to look for
+ * @param entry The entry to compare it to
+ * @return int The order of the names
+ */
+static int compareNameToEntry(const void* name, const void* entry)
+{
+    return strcmp((const char*)name, ((const assetCacheEntry_t*)entry)->inName);
+}
+
+/**
+ * @brief Load a cache file. If the file doesn't exist, is damaged, or was written by a different build of the asset
+ * preprocessor, the cache will be empty
+ *
+ * @param cache [out] The cache to load into. It must be freed with freeAssetCache()
+ * @param path The cache file to load
+ * @param toolHash The hash of the running asset preprocessor
+ * @return true if the cache file was loaded
+ * @return false if the cache is empty
+ */
+bool loadAssetCache(assetCache_t* cache, const char* path, uint64_t toolHash)
+{
+    memset(cache, 0, sizeof(assetCache_t));
+    cache->toolHash = toolHash;
+
+    FILE* file = fopen(path, "r");
+    if (NULL == file)
+    {
+        return false;
+    }
+
+    char line[512];
+    uint64_t fileToolHash = 0;
+    if (NULL == fgets(line, sizeof(line), file) || strncmp(line, cacheHeader, strlen(cacheHeader))
+        || 1 != sscanf(line + strlen(cacheHeader), " %" SCNx64, &fileToolHash) || fileToolHash != toolHash)
+    {
+        // Anything about how the files were generated might have changed, so start over
+        fclose(file);
+        return false;
+    }
+
+    while (NULL != fgets(line, sizeof(line), file))
+    {
+        uint64_t inHash  = 0;
+        uint64_t optHash = 0;
+        int nameStart    = 0;
+        if (2 != sscanf(line, "%" SCNx64 " %" SCNx64 " %n", &inHash, &optHash, &nameStart) || 0 == nameStart)
+        {
+            continue;
+        }
+
+        // Trim the newline off the name
+        line[strcspn(line, "\r\n")] = '\0';
+        if ('\0' != line[nameStart])
+        {
+            addAssetCacheEntry(cache, &line[nameStart], inHash, optHash);
+        }
+    }
+    fclose(file);
+
+    qsort(cache->entries, cache->count, sizeof(assetCacheEntry_t), compareEntries);
+    return true;
+}
+
+/**
+ * @brief Find what an input file's output was generated from. The cache must be sorted, as it is by loadAssetCache()
+ *
+ * @param cache The cache to search
+ * @param inName The input file path, relative to the input directory
+ * @return const assetCacheEntry_t* The entry for the input file, or NULL if there is none
+ */
+const assetCacheEntry_t* findAssetCacheEntry(const assetCache_t* cache, const char* inName)
+{
+    if (0 == cache->count)
+    {
+        return NULL;
+    }
+
+    return bsearch(inName, cache->entries, cache->count, sizeof(assetCacheEntry_t), compareNameToEntry);
+}
+
+/**
+ * @brief Add an entry to the end of a cache. This doesn't keep the cache sorted, so it is meant for building a cache to
+ * save
+ *
+ * @param cache The cache to add to
+ * @param inName The input file path, relative to the input directory
+ * @param inHash The hash of the input file's contents
+ * @param optHash The hash of everything else which affects the output
+ * @return true if the entry was added
+ * @return false if memory could not be allocated
+ */
+bool addAssetCacheEntry(assetCache_t* cache, const char* inName, uint64_t inHash, uint64_t optHash)
+{
+    if (cache->count == cache->capacity)
+    {
+        size_t newCapacity            = cache->capacity ? cache->capacity * 2 : 256;
+        assetCacheEntry_t* newEntries = realloc(cache->entries, newCapacity * sizeof(assetCacheEntry_t));
+        if (NULL == newEntries)
+        {
+            return false;
+        }
+        cache->entries  = newEntries;
+        cache->capacity = newCapacity;
+    }
+
+    char* nameCopy = strdup(inName);
+    if (NULL == nameCopy)
+    {
+        return false;
+    }
+
+    cache->entries[cache->count++] = (assetCacheEntry_t){
+        .inName = nameCopy,
+        .inHash  = inHash,
+        .optHash = optHash,
+    };
+    return true;
+}
+
+/**
+ * @brief Write a cache to a file
+ *
+ * @param cache The cache to write
+ * @param path The file to write it to
+ * @return true if the file was written
+ * @return false if there was an error writing the file
+ */
+bool saveAssetCache(const assetCache_t* cache, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (NULL == file)
+    {
+        return false;
+    }
+
+    fprintf(file, "%s %016" PRIx64 "\n", cacheHeader, cache->toolHash);
+    for (size_t i = 0; i < cache->count; i++)
+    {
+        const assetCacheEntry_t* entry = &cache->entries[i];
+        fprintf(file, "%016" PRIx64 " %016" PRIx64 " %s\n", entry->inHash, entry->optHash, entry->inName);
+    }
+
+    bool ok = !ferror(file);
+    return (0 == fclose(file)) && ok;
+}
+
+/**
+ * @brief Free the memory used by a cache
+ *
+ * @param cache The cache to free
+ */
+void freeAssetCache(assetCache_t* cache)
+{
+    for (size_t i = 0; i < cache->count; i++)
+    {
+        free(cache->entries[i].inName);
+    }
+    free(cache->entries);
+    memset(cache, 0, sizeof(assetCache_t));
+}
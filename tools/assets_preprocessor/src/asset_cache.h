@@ -0,0 +1,54 @@
+#ifndef _ASSET_CACHE_H_
+#define _ASSET_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief The starting value for hashBytes(), hashString(), and hashFile()
+#define ASSET_HASH_INIT 0xcbf29ce484222325ULL
+
+/**
+ * @brief What an input file's output was generated from, the last time it was generated
+ */
+typedef struct
+{
+    /// @brief The input file path, relative to the input directory
+    char* inName;
+
+    /// @brief The hash of the input file's contents
+    uint64_t inHash;
+
+    /// @brief The hash of everything else which affects the output, like the options file and processor
+    uint64_t optHash;
+} assetCacheEntry_t;
+
+/**
+ * @brief A list of input files and what their outputs were generated from
+ */
+typedef struct
+{
+    /// @brief The hash of the asset preprocessor itself, so all entries are discarded when it is rebuilt
+    uint64_t toolHash;
+
+    /// @brief The entries, sorted by name once the cache is loaded
+    assetCacheEntry_t* entries;
+
+    /// @brief The number of entries
+    size_t count;
+
+    /// @brief The number of entries there is space for
+    size_t capacity;
+} assetCache_t;
+
+uint64_t hashBytes(const void* data, size_t len, uint64_t hash);
+uint64_t hashString(const char* str, uint64_t hash);
+bool hashFile(const char* path, uint64_t* hash);
+
+bool loadAssetCache(assetCache_t* cache, const char* path, uint64_t toolHash);
+const assetCacheEntry_t* findAssetCacheEntry(const assetCache_t* cache, const char* inName);
+bool addAssetCacheEntry(assetCache_t* cache, const char* inName, uint64_t inHash, uint64_t optHash);
+bool saveAssetCache(const assetCache_t* cache, const char* path);
+void freeAssetCache(assetCache_t* cache);
+
+#endif
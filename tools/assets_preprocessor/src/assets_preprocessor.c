@@ -7,6 +7,7 @@
 #include <ftw.h>
 #include <getopt.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -17,7 +18,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#if defined(WINDOWS) || defined(__WINDOWS__) || defined(_WINDOWS) || defined(WIN32) || defined(WIN64) \
+    || defined(_WIN32) || defined(_WIN64) || defined(__WIN32__) || defined(__TOS_WIN__) || defined(_MSC_VER)
+    #include <windows.h>
+#endif
+
 #include "assets_preprocessor.h"
+#include "asset_cache.h"
 #include "fileUtils.h"
 
 //==============================================================================
@@ -52,6 +59,40 @@ static const assetProcessor_t* allAssetProcessors[] = {
 // END Asset Processor List
 //==============================================================================
 
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief One input file to process into one output file
+ */
+typedef struct
+{
+    char inFile[256];                 ///< The path to the input file
+    char outFile[256];                ///< The path to the output file
+    char optionsFilename[256];        ///< The path to the options file, if hasOptions is set
+    bool hasOptions;                  ///< true if an options file applies to the input file
+    const fileProcessorMap_t* extMap; ///< The extension mapping which matched the input file
+    uint64_t inHash;                  ///< The hash of the input file, if the cache is enabled
+    uint64_t optHash;                 ///< The hash of the options and processor, if the cache is enabled
+    size_t nextSameOutput;            ///< The index of the next job with the same output file, or SIZE_MAX
+    bool chained;                     ///< true if this job runs after an earlier one with the same output file
+    bool cached;                      ///< true if the output file was already up to date
+    bool failed;                      ///< true if the input file could not be processed
+    int64_t elapsedUs;                ///< The time taken to check and process the file, in microseconds
+} assetJob_t;
+
+/**
+ * @brief How many files one processor handled, and how long it took
+ */
+typedef struct
+{
+    const char* name; ///< The processor's name
+    int files;        ///< The number of files which use this processor
+    int cached;       ///< The number of files which were already up to date
+    int64_t us;       ///< The total time spent on this processor's files, in microseconds
+} processorStats_t;
+
 //==============================================================================
 // Variables
 //==============================================================================
@@ -66,6 +107,23 @@ const processorOptions_t* globalConfig = NULL;
 static const fileProcessorMap_t* loadedExtMappings = NULL;
 static size_t loadedExtMappingCount                = 0;
 
+/// Every file to process, in the order they were found
+static assetJob_t* jobs   = NULL;
+static size_t jobCount    = 0;
+static size_t jobCapacity = 0;
+
+/// The index of the next job for a thread to run
+static size_t nextJob = 0;
+
+/// The number of jobs to run at once
+static long numThreads = 1;
+
+/// What each output file was made from the last time the preprocessor ran, if cacheEnabled
+static assetCache_t oldCache;
+
+/// true to skip files based on the cache, false to skip them based on timestamps
+static bool cacheEnabled = false;
+
 //==============================================================================
 // Function declarations
 //==============================================================================
@@ -73,6 +131,16 @@ static size_t loadedExtMappingCount                = 0;
 void print_usage(void);
 bool startsWith(const char* path, const char* prefix);
 bool endsWith(const char* filename, const char* suffix);
+static int64_t getTimeUs(void);
+static bool findOptionsFile(const char* inFile, const char* inExt, char* optionsFilename, size_t n);
+static int collectFile(const char* inFile, const struct stat* st, int tflag);
+static bool hashJobOptions(const assetJob_t* job, uint64_t* hash);
+static void checkJob(assetJob_t* job);
+static void runJob(assetJob_t* job, bool force);
+static void* jobThread(void* arg);
+static void runJobs(void);
+static bool runProcessor(const assetJob_t* job);
+static void printStats(int64_t wallUs);
 static const assetProcessor_t* findProcessor(const char* name);
 static void setupConfig(assetProcessor_t* execProcessors, size_t* procCount, fileProcessorMap_t* mappings,
                         size_t* mapCount, const processorOptions_t* options);
@@ -94,7 +162,7 @@ static const char optionsFileExtension[] = "opts";
 void print_usage(void)
 {
     printf("Usage:\n  assets_preprocessor\n    -i INPUT_DIRECTORY\n    -o OUTPUT_DIRECTORY\n    [-t "
-           "TIMESTAMP_FILE_OUTPUT]\n    [-c CONFIG_FILE]\n    [-v]\n");
+           "TIMESTAMP_FILE_OUTPUT]\n    [-c CONFIG_FILE]\n    [-m CACHE_FILE]\n    [-j JOBS]\n    [-v]\n");
     printf("\n All Asset processors:\n");
     for (int n = 0; n < sizeof(allAssetProcessors) / sizeof(*allAssetProcessors); n++)
     {
@@ -103,6 +171,18 @@ void print_usage(void)
     printf("\n");
 }
 
+/**
+ * @brief Get a monotonic time, for measuring how long processing takes
+ *
+ * @return int64_t The time since an arbitrary point, in microseconds
+ */
+static int64_t getTimeUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 bool startsWith(const char* path, const char* prefix)
 {
     if (strlen(prefix) > strlen(path))
@@ -131,563 +211,833 @@ bool endsWith(const char* filename, const char* suffix)
 }
 
 /**
- * @brief TODO
+ * @brief Find the options file which applies to an input file. This is the file's own options file if it has one, or
+ * else the nearest directory options file inside the input directory
  *
- * @param fpath
- * @param st
- * @param tflag
- * @return int
+ * @param inFile The input file
+ * @param inExt The input file's extension, without the leading '.'
+ * @param optionsFilename [out] Written with the options file's path
+ * @param n The size of optionsFilename
+ * @return true if an options file was found
+ * @return false if no options apply to the input file
  */
-static int processFile(const char* inFile, const struct stat* st __attribute__((unused)), int tflag)
+static bool findOptionsFile(const char* inFile, const char* inExt, char* optionsFilename, size_t n)
+{
+    // Add the whole input file path to the buffer
+    strncpy(optionsFilename, inFile, n);
+
+    // Clip off the input extension
+    optionsFilename[strlen(optionsFilename) - strlen(inExt)] = '\0';
+
+    // And append the options file extension
+    strcat(optionsFilename, optionsFileExtension);
+
+    // Now, check if the options filename exists
+    bool hasOptions = doesFileExist(optionsFilename);
+
+    if (!hasOptions)
+    {
+        // First, just remove the filename and replace it with the opts extension
+        // This should be guaranteed to be inside the assets dir still...
+        char* lastSlash  = strrchr(optionsFilename, '/');
+        *(lastSlash + 1) = '\0';
+        strcat(optionsFilename, ".");
+        strcat(optionsFilename, optionsFileExtension);
+
+        hasOptions = doesFileExist(optionsFilename);
+        if (!hasOptions)
+        {
+            do
+            {
+                // Trim the first slash, of "/.opts"
+                lastSlash  = strrchr(optionsFilename, '/');
+                *lastSlash = '\0';
+                // Find the next previous slash
+                lastSlash = strrchr(optionsFilename, '/');
+                // Chop the string after it
+                *(lastSlash + 1) = '\0';
+                // And append the options extension
+                strcat(optionsFilename, ".");
+                strcat(optionsFilename, optionsFileExtension);
+                // Then, at the end of the loop, first we make sure the new filename is still inside
+                // the assets directory. We don't want to touch anything outside the input directory!
+                // Next, if that's true, we set hasOptions based on if the file exists and exit if so
+            } while (startsWith(optionsFilename, inDirName) && !(hasOptions = doesFileExist(optionsFilename)));
+        }
+    }
+
+    return hasOptions;
+}
+
+/**
+ * @brief Add a file to the list of jobs if it matches an extension mapping. This is called by ftw() for every file in
+ * the input directory, and only decides what to do. The jobs are run afterwards by runJobs()
+ *
+ * @param inFile The path to the file
+ * @param st Unused
+ * @param tflag The type of the path
+ * @return int 0 to keep walking the tree, or -1 to stop
+ */
+static int collectFile(const char* inFile, const struct stat* st __attribute__((unused)), int tflag)
 {
     if (FTW_F == tflag)
     {
-        char extBuf[16]           = {0};
-        char outFile[256]         = {0};
-        char optionsFilename[256] = {0};
+        char extBuf[16] = {0};
 
         for (size_t i = 0; i < loadedExtMappingCount; i++)
         {
-            const fileProcessorMap_t* extMap  = &loadedExtMappings[i];
-            const assetProcessor_t* processor = extMap->processor;
+            const fileProcessorMap_t* extMap = &loadedExtMappings[i];
 
             snprintf(extBuf, sizeof(extBuf), ".%s", extMap->inExt);
 
             if (endsWith(inFile, extBuf))
             {
                 // This is the matching processor!
-                // Calculate the outFile name (replace the extension) and
+                assetJob_t job = {.extMap = extMap, .nextSameOutput = SIZE_MAX};
+                snprintf(job.inFile, sizeof(job.inFile), "%s", inFile);
 
-                strcat(outFile, outDirName);
-                // strcat(outFile, "/");
-                strcat(outFile, get_filename(inFile));
+                // Calculate the outFile name (replace the extension)
+                snprintf(job.outFile, sizeof(job.outFile), "%s%s", outDirName, get_filename(inFile));
 
-                // Clip off the input file extension
-                outFile[strlen(outFile) - strlen(extMap->inExt)] = '\0';
+                // Clip off the input file extension and add the output file extension
+                job.outFile[strlen(job.outFile) - strlen(extMap->inExt)] = '\0';
+                strcat(job.outFile, extMap->outExt);
 
-                // Add the output file extension
-                strcat(outFile, extMap->outExt);
+                job.hasOptions = findOptionsFile(inFile, extMap->inExt, job.optionsFilename,
+                                                 sizeof(job.optionsFilename));
 
-                // Now, construct the options filename
-
-                // Add the whole input file path to the buffer
-                strncpy(optionsFilename, inFile, sizeof(optionsFilename));
-
-                // Clip off the input extension  again
-                optionsFilename[strlen(optionsFilename) - strlen(extMap->inExt)] = '\0';
-
-                // And append the options file extension
-                strcat(optionsFilename, optionsFileExtension);
-
-                // Now, check if the options filename exists
-                bool hasOptions = doesFileExist(optionsFilename);
-
-                if (!hasOptions)
+                if (jobCount == jobCapacity)
                 {
-                    // First, just remove the filename and replace it with the opts extension
-                    // This should be guaranteed to be inside the assets dir still...
-                    char* lastSlash  = strrchr(optionsFilename, '/');
-                    *(lastSlash + 1) = '\0';
-                    strcat(optionsFilename, ".");
-                    strcat(optionsFilename, optionsFileExtension);
-
-                    hasOptions = doesFileExist(optionsFilename);
-                    if (!hasOptions)
+                    size_t newCapacity  = jobCapacity ? jobCapacity * 2 : 256;
+                    assetJob_t* newJobs = realloc(jobs, newCapacity * sizeof(assetJob_t));
+                    if (NULL == newJobs)
                     {
-                        do
-                        {
-                            // Trim the first slash, of "/.opts"
-                            lastSlash  = strrchr(optionsFilename, '/');
-                            *lastSlash = '\0';
-                            // Find the next previous slash
-                            lastSlash = strrchr(optionsFilename, '/');
-                            // Chop the string after it
-                            *(lastSlash + 1) = '\0';
-                            // And append the options extension
-                            strcat(optionsFilename, ".");
-                            strcat(optionsFilename, optionsFileExtension);
-                            // Then, at the end of the loop, first we make sure the new filename is still inside
-                            // the assets directory. We don't want to touch anything outside the input directory!
-                            // Next, if that's true, we set hasOptions based on if the file exists and exit if so
-                        } while (startsWith(optionsFilename, inDirName)
-                                 && !(hasOptions = doesFileExist(optionsFilename)));
+                        return -1;
                     }
+                    jobs        = newJobs;
+                    jobCapacity = newCapacity;
                 }
 
-                // And if the options file has been modified since the output was generated,
-                // regenerate it the same as though the source file was modified
-                bool optionsModified = hasOptions && isSourceFileNewer(optionsFilename, outFile);
-                bool inFileModified  = isSourceFileNewer(inFile, outFile);
-
-                if (!inFileModified && !optionsModified)
+                // The output directory is flat, so files in different directories may have the same output file.
+                // Those jobs run one after another in the order they were found, like when every file was processed
+                // one at a time, so they don't write the same file at once
+                for (size_t j = 0; j < jobCount; j++)
                 {
-                    if (verbose)
+                    if (!jobs[j].chained && !strcmp(jobs[j].outFile, job.outFile))
                     {
-                        printf("[%s] SKIP %s -> %s\n", extMap->inExt, get_filename(inFile), get_filename(outFile));
+                        while (SIZE_MAX != jobs[j].nextSameOutput)
+                        {
+                            j = jobs[j].nextSameOutput;
+                        }
+                        jobs[j].nextSameOutput = jobCount;
+                        job.chained            = true;
+                        break;
                     }
-                    break;
                 }
-                else if (doesFileExist(outFile))
-                {
-                    printf("[assets-preprocessor] %s modified! Regenerating %s\n",
-                           (!inFileModified) ? (optionsFilename + strlen(inDirName)) : get_filename(inFile),
-                           get_filename(outFile));
-                }
-                filesUpdated++;
 
-                bool result    = false;
-                bool readError = false;
+                jobs[jobCount++] = job;
+                break;
+            }
+        }
+    }
+    else if (FTW_D != tflag)
+    {
+        return -1;
+    }
 
-                if (FUNCTION == processor->type)
-                {
-                    FILE* inHandle             = NULL;
-                    FILE* outHandle            = NULL;
-                    processorFileData_t inData = {0};
-                    processorFileData_t outData = {0};
+    return 0;
+}
 
-                    switch (processor->inFmt)
-                    {
-                        case FMT_FILE:
-                        case FMT_TEXT:
-                        case FMT_LINES:
-                        {
-                            inHandle = fopen(inFile, "r");
-                            break;
-                        }
+/**
+ * @brief Hash everything other than the input file which affects an output file: which processor makes it, how it is
+ * configured, and the options file
+ *
+ * @param job The job making the output file
+ * @param hash [out] Written with the hash
+ * @return true if the hash was calculated
+ * @return false if the options file could not be read
+ */
+static bool hashJobOptions(const assetJob_t* job, uint64_t* hash)
+{
+    const fileProcessorMap_t* extMap = job->extMap;
+
+    *hash = hashString(extMap->processor->name, ASSET_HASH_INIT);
+    *hash = hashString((EXEC == extMap->processor->type) ? extMap->processor->exec : NULL, *hash);
+    *hash = hashString(extMap->inExt, *hash);
+    *hash = hashString(extMap->outExt, *hash);
+    *hash = hashString(extMap->codec, *hash);
+    *hash = hashBytes(&job->hasOptions, sizeof(job->hasOptions), *hash);
+    return !job->hasOptions || hashFile(job->optionsFilename, hash);
+}
 
-                        case FMT_FILE_BIN:
-                        case FMT_DATA:
-                        case FMT_FILENAME:
-                        {
-                            inHandle = fopen(inFile, "rb");
-                            break;
-                        }
-                    }
+/**
+ * @brief Check whether one job's output is already up to date, and set job->cached if it is
+ *
+ * When there is a cache, the output is up to date if the cache says it was made from input and options with the same
+ * contents. Otherwise, the output is up to date if it is newer than the input and options files.
+ *
+ * @param job The job to check
+ */
+static void checkJob(assetJob_t* job)
+{
+    int64_t start = getTimeUs();
 
-                    if (!inHandle)
-                    {
-                        fprintf(stderr, "[%s] FAILED! Cannot open input file '%s'\n", extMap->inExt, inFile);
-                        break;
-                    }
+    bool inFileModified  = false;
+    bool optionsModified = false;
+    if (cacheEnabled)
+    {
+        job->inHash = ASSET_HASH_INIT;
+        if (!hashFile(job->inFile, &job->inHash) || !hashJobOptions(job, &job->optHash))
+        {
+            fprintf(stderr, "[assets-preprocessor] Error! Cannot read %s!\n", get_filename(job->inFile));
+            job->failed = true;
+            return;
+        }
 
-                    const char * outFileName = NULL;
+        const assetCacheEntry_t* entry = findAssetCacheEntry(&oldCache, job->inFile + strlen(inDirName));
+        inFileModified                 = (NULL == entry || entry->inHash != job->inHash);
+        optionsModified                = (NULL == entry || entry->optHash != job->optHash);
+        if (!doesFileExist(job->outFile))
+        {
+            inFileModified = true;
+        }
+    }
+    else
+    {
+        // And if the options file has been modified since the output was generated,
+        // regenerate it the same as though the source file was modified
+        optionsModified = job->hasOptions && isSourceFileNewer(job->optionsFilename, job->outFile);
+        inFileModified  = isSourceFileNewer(job->inFile, job->outFile);
+    }
 
-                    switch (processor->outFmt)
-                    {
-                        case FMT_FILE:
-                        case FMT_TEXT:
-                        case FMT_LINES:
-                        {
-                            outHandle = fopen(outFile, "w");
-                            outData = (processorFileData_t){ .file = outHandle };
-                            break;
-                        }
+    job->cached = !inFileModified && !optionsModified;
+    if (!job->cached && doesFileExist(job->outFile))
+    {
+        printf("[assets-preprocessor] %s modified! Regenerating %s\n",
+               (!inFileModified) ? (job->optionsFilename + strlen(inDirName)) : get_filename(job->inFile),
+               get_filename(job->outFile));
+    }
 
-                        case FMT_FILENAME:
-                        {
-                            outFileName = outFile;
-                            outData = (processorFileData_t){ .fileName = outFileName };
-                            break;
-                        }
+    job->elapsedUs = getTimeUs() - start;
+}
 
-                        case FMT_FILE_BIN:
-                        case FMT_DATA:
-                        {
-                            outHandle = fopen(outFile, "wb");
-                            outData = (processorFileData_t){ .file = outHandle };
-                            break;
-                        }
-                    }
+/**
+ * @brief Run one job which checkJob() found was out of date, or which has to run because another job with the same
+ * output file is out of date
+ *
+ * @param job The job to run
+ * @param force true to run the job even if its own output was up to date
+ */
+static void runJob(assetJob_t* job, bool force)
+{
+    const fileProcessorMap_t* extMap = job->extMap;
+    int64_t start                    = getTimeUs();
 
-                    if (!outHandle && !outFileName)
-                    {
-                        fprintf(stderr, "[%s] FAILED! Cannot open output file '%s'\n", extMap->inExt, outFile);
-                        break;
-                    }
+    if (job->failed)
+    {
+        return;
+    }
+    else if (job->cached && !force)
+    {
+        if (verbose)
+        {
+            printf("[%s] SKIP %s -> %s\n", extMap->inExt, get_filename(job->inFile), get_filename(job->outFile));
+        }
+        return;
+    }
 
-                    // Input and output files have been opened!
-                    // Now, handle any extra processing for the input:
-                    switch (processor->inFmt)
-                    {
-                        case FMT_FILE:
-                        case FMT_FILE_BIN:
-                        {
-                            inData.file = inHandle;
-                            break;
-                        }
+    job->cached = false;
+    if (!runProcessor(job))
+    {
+        fprintf(stderr, "[assets-preprocessor] Error! Failed to process %s!\n", get_filename(job->inFile));
+        job->failed = true;
+    }
 
-                        case FMT_FILENAME:
-                        {
-                            inData.fileName = inFile;
-                            break;
-                        }
+    job->elapsedUs += getTimeUs() - start;
+}
 
-                        case FMT_TEXT:
-                        case FMT_DATA:
-                        {
-                            // Open file, read text
-                            bool binFile = (processor->inFmt == FMT_DATA);
-                            fseek(inHandle, 0L, SEEK_END);
-                            long size = ftell(inHandle);
-                            fseek(inHandle, 0L, SEEK_SET);
+/**
+ * @brief Run jobs until there are none left. Each thread started by runJobs() runs this
+ *
+ * @param arg Unused
+ * @return void* NULL
+ */
+static void* jobThread(void* arg)
+{
+    size_t idx;
+    while ((idx = __atomic_fetch_add(&nextJob, 1, __ATOMIC_RELAXED)) < jobCount)
+    {
+        // Jobs with the same output file are run by whichever thread runs the first of them
+        if (jobs[idx].chained)
+        {
+            continue;
+        }
 
-                            char* data = malloc(size + (binFile ? 0 : 1));
+        // The last of them to run decides what the output file holds, so if any of them is out of date, they all run
+        // again in order. Otherwise an earlier job could overwrite the output of a later one which was skipped
+        bool stale = false;
+        for (size_t j = idx; SIZE_MAX != j; j = jobs[j].nextSameOutput)
+        {
+            checkJob(&jobs[j]);
+            stale = stale || !jobs[j].cached;
+        }
 
-                            if (!data)
-                            {
-                                readError = true;
-                                break;
-                            }
+        for (; SIZE_MAX != idx; idx = jobs[idx].nextSameOutput)
+        {
+            runJob(&jobs[idx], stale);
+        }
+    }
+    return NULL;
+}
 
-                            fread(data, size, 1, inHandle);
+/**
+ * @brief Run every job in the list, spread across numThreads threads
+ */
+static void runJobs(void)
+{
+    long threadCount = numThreads;
+    if (threadCount > (long)jobCount)
+    {
+        threadCount = jobCount;
+    }
+    if (threadCount < 1)
+    {
+        threadCount = 1;
+    }
+    pthread_t* threads = calloc(threadCount, sizeof(pthread_t));
 
-                            if (binFile)
-                            {
-                                inData.data   = (uint8_t*)data;
-                                inData.length = size;
-                            }
-                            else
-                            {
-                                data[size]      = '\0';
-                                inData.text     = data;
-                                inData.textSize = size + 1;
-                            }
-                            break;
-                        }
+    nextJob      = 0;
+    long started = 0;
+    for (; NULL != threads && started < threadCount - 1; started++)
+    {
+        if (0 != pthread_create(&threads[started], NULL, jobThread, NULL))
+        {
+            break;
+        }
+    }
 
-                        case FMT_LINES:
-                        {
-                            int lines = 0;
-                            int last  = 0;
-                            int ch    = 0;
-                            long size = 0;
-                            while (-1 != (ch = getc(inHandle)))
-                            {
-                                switch (ch)
-                                {
-                                    case '\n':
-                                    {
-                                        lines++;
-                                        break;
-                                    }
-
-                                    default:
-                                        break;
-                                }
-
-                                last = ch;
-                                size++;
-                            }
+    // This thread helps too, so everything still gets done even if no threads could be started
+    jobThread(NULL);
 
-                            // Handle when a file doesn't end with a newline
-                            if ('\n' != last)
-                            {
-                                lines++;
-                            }
+    for (long i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
 
-                            // Go back to the beginning for real reading
-                            fseek(inHandle, 0L, SEEK_SET);
+/**
+ * @brief Print how many files each processor handled, how many were already up to date, and how long they took
+ *
+ * @param wallUs The total time taken to run every job, in microseconds
+ */
+static void printStats(int64_t wallUs)
+{
+    processorStats_t* stats = calloc(loadedExtMappingCount + 1, sizeof(processorStats_t));
+    if (NULL == stats)
+    {
+        return;
+    }
 
-                            char* data = (char*)malloc(size + 1);
-                            if (!data)
-                            {
-                                readError = true;
-                                break;
-                            }
+    size_t statCount = 0;
+    int totalCached  = 0;
+    for (size_t i = 0; i < jobCount; i++)
+    {
+        const char* name = jobs[i].extMap->processor->name;
 
-                            char** lineList = malloc(lines * sizeof(char*));
-                            if (!lineList)
-                            {
-                                free(data);
-                                readError = true;
-                                break;
-                            }
-                            fread(data, size, 1, inHandle);
-                            fclose(inHandle);
-
-                            int outLine     = 0;
-                            char* cur       = data;
-                            const char* end = data + size;
-                            char* lineStart = cur;
-                            while (cur < end)
-                            {
-                                switch (*cur)
-                                {
-                                    case '\r':
-                                    {
-                                        if (cur + 1 < end && *(cur + 1) == '\n')
-                                        {
-                                            *cur = '\0';
-                                        }
-                                        break;
-                                    }
-
-                                    case '\n':
-                                    {
-                                        *cur                = '\0';
-                                        lineList[outLine++] = lineStart;
-                                        lineStart           = NULL;
-
-                                        break;
-                                    }
-
-                                    default:
-                                    {
-                                        if (!lineStart)
-                                        {
-                                            lineStart = cur;
-                                        }
-                                    }
-                                }
-                                cur++;
-                            }
-                            *cur = '\0';
+        // Exec processors are named by their whole command, so use the extension instead to keep it readable
+        if (EXEC == jobs[i].extMap->processor->type)
+        {
+            name = jobs[i].extMap->inExt;
+        }
 
-                            inData.lines     = lineList;
-                            inData.lineCount = lines;
-                            break;
-                        }
-                    }
+        size_t s = 0;
+        while (s < statCount && strcmp(stats[s].name, name))
+        {
+            s++;
+        }
+        if (s == statCount)
+        {
+            stats[statCount++].name = name;
+        }
 
-                    processorOptions_t options = {0};
-                    if (hasOptions)
-                    {
-                        if (getOptionsFromIniFile(&options, optionsFilename))
-                        {
-                            if (verbose)
-                            {
-                                printf("[%s] OPTS %s <- %s (%" PRIu32 ")\n", extMap->inExt, get_filename(inFile),
-                                       optionsFilename + strlen(inDirName), (uint32_t)options.optionCount);
-                            }
-                        }
-                        else
-                        {
-                            if (verbose)
-                            {
-                                fprintf(
-                                    stderr,
-                                    "[WRN] Options file %s exists but contains no options! Is it a valid INI file?\n",
-                                    optionsFilename);
-                            }
-                            hasOptions = false;
-                        }
-                    }
+        stats[s].files++;
+        stats[s].us += jobs[i].elapsedUs;
+        if (jobs[i].cached)
+        {
+            stats[s].cached++;
+            totalCached++;
+        }
+    }
+
+    printf("[assets-preprocessor] %-12s %6s %7s %9s\n", "Processor", "Files", "Cached", "Time");
+    for (size_t s = 0; s < statCount; s++)
+    {
+        printf("[assets-preprocessor] %-12.12s %6d %7d %8.3fs\n", stats[s].name, stats[s].files, stats[s].cached,
+               stats[s].us / 1000000.0);
+    }
+    printf("[assets-preprocessor] %d file%s, %d up to date (%.0f%%), in %.3fs with %ld thread%s\n", (int)jobCount,
+           (jobCount == 1) ? "" : "s", totalCached, jobCount ? (100.0 * totalCached / jobCount) : 100.0,
+           wallUs / 1000000.0, numThreads, (numThreads == 1) ? "" : "s");
+
+    free(stats);
+}
+
+/**
+ * @brief Process one input file into its output file with the job's processor
+ *
+ * @param job The job to run
+ * @return true if the file was processed
+ * @return false if there was an error
+ */
+static bool runProcessor(const assetJob_t* job)
+{
+    const fileProcessorMap_t* extMap  = job->extMap;
+    const assetProcessor_t* processor = extMap->processor;
+    const char* inFile                = job->inFile;
+    const char* outFile               = job->outFile;
+    const char* optionsFilename       = job->optionsFilename;
+    bool hasOptions                   = job->hasOptions;
+
+    bool result    = false;
+    bool readError = false;
+
+    if (FUNCTION == processor->type)
+    {
+        FILE* inHandle             = NULL;
+        FILE* outHandle            = NULL;
+        processorFileData_t inData = {0};
+        processorFileData_t outData = {0};
+
+        switch (processor->inFmt)
+        {
+            case FMT_FILE:
+            case FMT_TEXT:
+            case FMT_LINES:
+            {
+                inHandle = fopen(inFile, "r");
+                break;
+            }
+
+            case FMT_FILE_BIN:
+            case FMT_DATA:
+            case FMT_FILENAME:
+            {
+                inHandle = fopen(inFile, "rb");
+                break;
+            }
+        }
+
+        if (!inHandle)
+        {
+            fprintf(stderr, "[%s] FAILED! Cannot open input file '%s'\n", extMap->inExt, inFile);
+            return false;
+        }
+
+        const char * outFileName = NULL;
+
+        switch (processor->outFmt)
+        {
+            case FMT_FILE:
+            case FMT_TEXT:
+            case FMT_LINES:
+            {
+                outHandle = fopen(outFile, "w");
+                outData = (processorFileData_t){ .file = outHandle };
+                break;
+            }
+
+            case FMT_FILENAME:
+            {
+                outFileName = outFile;
+                outData = (processorFileData_t){ .fileName = outFileName };
+                break;
+            }
+
+            case FMT_FILE_BIN:
+            case FMT_DATA:
+            {
+                outHandle = fopen(outFile, "wb");
+                outData = (processorFileData_t){ .file = outHandle };
+                break;
+            }
+        }
+
+        if (!outHandle && !outFileName)
+        {
+            fprintf(stderr, "[%s] FAILED! Cannot open output file '%s'\n", extMap->inExt, outFile);
+            fclose(inHandle);
+            return false;
+        }
+
+        // Input and output files have been opened!
+        // Now, handle any extra processing for the input:
+        switch (processor->inFmt)
+        {
+            case FMT_FILE:
+            case FMT_FILE_BIN:
+            {
+                inData.file = inHandle;
+                break;
+            }
+
+            case FMT_FILENAME:
+            {
+                inData.fileName = inFile;
+                break;
+            }
+
+            case FMT_TEXT:
+            case FMT_DATA:
+            {
+                // Open file, read text
+                bool binFile = (processor->inFmt == FMT_DATA);
+                fseek(inHandle, 0L, SEEK_END);
+                long size = ftell(inHandle);
+                fseek(inHandle, 0L, SEEK_SET);
+
+                char* data = malloc(size + (binFile ? 0 : 1));
+
+                if (!data)
+                {
+                    readError = true;
+                    break;
+                }
 
-                    processorInput_t arg = {.in         = inData,
-                                            .out        = outData,
-                                            .inFilename = get_filename(inFile),
-                                            .options    = hasOptions ? &options : NULL};
+                fread(data, size, 1, inHandle);
 
-                    if (!readError)
+                if (binFile)
+                {
+                    inData.data   = (uint8_t*)data;
+                    inData.length = size;
+                }
+                else
+                {
+                    data[size]      = '\0';
+                    inData.text     = data;
+                    inData.textSize = size + 1;
+                }
+                break;
+            }
+
+            case FMT_LINES:
+            {
+                int lines = 0;
+                int last  = 0;
+                int ch    = 0;
+                long size = 0;
+                while (-1 != (ch = getc(inHandle)))
+                {
+                    switch (ch)
                     {
-                        result = processor->function(&arg);
-                        if (verbose)
+                        case '\n':
                         {
-                            printf("[%s] FUNC %s -> %s\n", extMap->inExt, arg.inFilename, get_filename(outFile));
+                            lines++;
+                            break;
                         }
+
+                        default:
+                            break;
                     }
 
-                    fclose(inHandle);
+                    last = ch;
+                    size++;
+                }
+
+                // Handle when a file doesn't end with a newline
+                if ('\n' != last)
+                {
+                    lines++;
+                }
 
-                    if (optionsModified)
-                    {
-                        deleteOptions(&options);
-                    }
+                // Go back to the beginning for real reading
+                fseek(inHandle, 0L, SEEK_SET);
 
-                    switch (processor->outFmt)
-                    {
-                        case FMT_FILE:
-                        case FMT_FILENAME:
-                        case FMT_FILE_BIN:
-                            // Nothing else necessary
-                            break;
+                char* data = (char*)malloc(size + 1);
+                if (!data)
+                {
+                    readError = true;
+                    break;
+                }
 
-                        case FMT_DATA:
-                        {
-                            fwrite(arg.out.data, arg.out.length, 1, outHandle);
+                char** lineList = malloc(lines * sizeof(char*));
+                if (!lineList)
+                {
+                    free(data);
+                    readError = true;
+                    break;
+                }
+                fread(data, size, 1, inHandle);
 
-                            if ((processor->inFmt != FMT_DATA || arg.out.data != arg.in.data)
-                                && (processor->inFmt != FMT_TEXT || (void*)arg.out.data != (void*)arg.in.text))
+                int outLine     = 0;
+                char* cur       = data;
+                const char* end = data + size;
+                char* lineStart = cur;
+                while (cur < end)
+                {
+                    switch (*cur)
+                    {
+                        case '\r':
+                        {
+                            if (cur + 1 < end && *(cur + 1) == '\n')
                             {
-                                free(arg.out.data);
+                                *cur = '\0';
                             }
                             break;
                         }
 
-                        case FMT_TEXT:
+                        case '\n':
                         {
-                            fwrite(arg.out.text, strlen(arg.out.text), 1, outHandle);
+                            *cur                = '\0';
+                            lineList[outLine++] = lineStart;
+                            lineStart           = NULL;
 
-                            if ((processor->inFmt != FMT_TEXT || arg.out.text != arg.in.text)
-                                && (processor->inFmt != FMT_DATA || (void*)arg.out.text != (void*)arg.in.data))
-                            {
-                                free(arg.out.text);
-                            }
                             break;
                         }
 
-                        case FMT_LINES:
+                        default:
                         {
-                            for (size_t n = 0; n < arg.out.lineCount; n++)
-                            {
-                                fwrite(arg.out.lines[n], strlen(arg.out.lines[n]), 1, outHandle);
-                                putc('\n', outHandle);
-                            }
-
-                            if (processor->inFmt != FMT_LINES || arg.out.lines != arg.in.lines)
+                            if (!lineStart)
                             {
-                                free(arg.out.lines[0]);
-                                free(arg.out.lines);
+                                lineStart = cur;
                             }
-                            break;
                         }
                     }
+                    cur++;
+                }
+                *cur = '\0';
 
-                    if (outHandle)
-                    {
-                        fclose(outHandle);
-                    }
+                inData.lines     = lineList;
+                inData.lineCount = lines;
+                break;
+            }
+        }
 
-                    // And clean up the input file however necessary
-                    switch (processor->inFmt)
-                    {
-                        case FMT_FILE:
-                        case FMT_FILE_BIN:
-                        case FMT_FILENAME:
-                        {
-                            break;
-                        }
+        processorOptions_t options = {0};
+        if (hasOptions)
+        {
+            if (getOptionsFromIniFile(&options, optionsFilename))
+            {
+                if (verbose)
+                {
+                    printf("[%s] OPTS %s <- %s (%" PRIu32 ")\n", extMap->inExt, get_filename(inFile),
+                           optionsFilename + strlen(inDirName), (uint32_t)options.optionCount);
+                }
+            }
+            else
+            {
+                if (verbose)
+                {
+                    fprintf(
+                        stderr,
+                        "[WRN] Options file %s exists but contains no options! Is it a valid INI file?\n",
+                        optionsFilename);
+                }
+                hasOptions = false;
+            }
+        }
 
-                        case FMT_DATA:
-                        {
-                            free(arg.in.data);
-                            break;
-                        }
+        processorInput_t arg = {.in         = inData,
+                                .out        = outData,
+                                .inFilename = get_filename(inFile),
+                                .options    = hasOptions ? &options : NULL,
+                                .codec      = extMap->codec};
 
-                        case FMT_TEXT:
-                        {
-                            free(arg.in.text);
-                            break;
-                        }
+        if (!readError)
+        {
+            result = processor->function(&arg);
+            if (verbose)
+            {
+                printf("[%s] FUNC %s -> %s\n", extMap->inExt, arg.inFilename, get_filename(outFile));
+            }
+        }
 
-                        case FMT_LINES:
-                        {
-                            free(arg.in.lines[0]);
-                            free(arg.in.lines);
-                            break;
-                        }
+        fclose(inHandle);
 
-                        default:
-                            break;
-                    }
+        if (hasOptions)
+        {
+            deleteOptions(&options);
+        }
 
-                    if (readError || !result)
-                    {
-                        if (!deleteFile(outFile))
-                        {
-                            fprintf(stderr,
-                                    "[WRN] Could not clean up invalid output file %s after failed proecessing\n",
-                                    outFile);
-                        }
-                    }
+        switch (processor->outFmt)
+        {
+            case FMT_FILE:
+            case FMT_FILENAME:
+            case FMT_FILE_BIN:
+                // Nothing else necessary
+                break;
+
+            case FMT_DATA:
+            {
+                fwrite(arg.out.data, arg.out.length, 1, outHandle);
+
+                if ((processor->inFmt != FMT_DATA || arg.out.data != arg.in.data)
+                    && (processor->inFmt != FMT_TEXT || (void*)arg.out.data != (void*)arg.in.text))
+                {
+                    free(arg.out.data);
                 }
-                else if (EXEC == processor->type)
+                break;
+            }
+
+            case FMT_TEXT:
+            {
+                fwrite(arg.out.text, strlen(arg.out.text), 1, outHandle);
+
+                if ((processor->inFmt != FMT_TEXT || arg.out.text != arg.in.text)
+                    && (processor->inFmt != FMT_DATA || (void*)arg.out.text != (void*)arg.in.data))
+                {
+                    free(arg.out.text);
+                }
+                break;
+            }
+
+            case FMT_LINES:
+            {
+                for (size_t n = 0; n < arg.out.lineCount; n++)
                 {
-                    // 2048 chars ought to be enough for anybody!!
-                    char buf[2048];
-                    char* out = buf;
+                    fwrite(arg.out.lines[n], strlen(arg.out.lines[n]), 1, outHandle);
+                    putc('\n', outHandle);
+                }
 
-                    const char* cur = processor->exec;
-                    while (*cur)
+                if (processor->inFmt != FMT_LINES || arg.out.lines != arg.in.lines)
+                {
+                    free(arg.out.lines[0]);
+                    free(arg.out.lines);
+                }
+                break;
+            }
+        }
+
+        if (outHandle)
+        {
+            fclose(outHandle);
+        }
+
+        // And clean up the input file however necessary
+        switch (processor->inFmt)
+        {
+            case FMT_FILE:
+            case FMT_FILE_BIN:
+            case FMT_FILENAME:
+            {
+                break;
+            }
+
+            case FMT_DATA:
+            {
+                free(arg.in.data);
+                break;
+            }
+
+            case FMT_TEXT:
+            {
+                free(arg.in.text);
+                break;
+            }
+
+            case FMT_LINES:
+            {
+                free(arg.in.lines[0]);
+                free(arg.in.lines);
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        if (readError || !result)
+        {
+            if (!deleteFile(outFile))
+            {
+                fprintf(stderr,
+                        "[WRN] Could not clean up invalid output file %s after failed proecessing\n",
+                        outFile);
+            }
+        }
+    }
+    else if (EXEC == processor->type)
+    {
+        // 2048 chars ought to be enough for anybody!!
+        char buf[2048];
+        char* out = buf;
+
+        const char* cur = processor->exec;
+        while (*cur)
+        {
+            switch (*cur)
+            {
+                case '%':
+                {
+                    const char* substStr = NULL;
+                    cur++;
+                    switch (*cur)
                     {
-                        switch (*cur)
+                        // %i -> input file path
+                        case 'i':
+                            substStr = inFile;
+                            break;
+                        // %f -> input file name
+                        case 'f':
+                            substStr = get_filename(inFile);
+                            break;
+                        // %o -> output file path
+                        case 'o':
+                            substStr = outFile;
+                            break;
+                        // %a -> input file extension
+                        case 'a':
+                            substStr = extMap->inExt;
+                            break;
+                        // %b -> output file extension
+                        case 'b':
+                            substStr = extMap->outExt;
+                            break;
+                        // %% -> % (escape)
+                        case '%':
                         {
-                            case '%':
-                            {
-                                const char* substStr = NULL;
-                                cur++;
-                                switch (*cur)
-                                {
-                                    // %i -> input file path
-                                    case 'i':
-                                        substStr = inFile;
-                                        break;
-                                    // %f -> input file name
-                                    case 'f':
-                                        substStr = get_filename(inFile);
-                                        break;
-                                    // %o -> output file path
-                                    case 'o':
-                                        substStr = outFile;
-                                        break;
-                                    // %a -> input file extension
-                                    case 'a':
-                                        substStr = extMap->inExt;
-                                        break;
-                                    // %b -> output file extension
-                                    case 'b':
-                                        substStr = extMap->outExt;
-                                        break;
-                                    // %% -> % (escape)
-                                    case '%':
-                                    {
-                                        *out++ = *cur;
-                                        break;
-                                    }
-                                    default:
-                                    {
-                                        *out++ = '%';
-                                        *out++ = *cur;
-                                        break;
-                                    }
-                                }
-                                if (substStr)
-                                {
-                                    out = strcpy(out, substStr) + strlen(substStr);
-                                }
-                                break;
-                            }
-
-                            default:
-                            {
-                                *out++ = *cur;
-                            }
+                            *out++ = *cur;
+                            break;
+                        }
+                        default:
+                        {
+                            *out++ = '%';
+                            *out++ = *cur;
                             break;
                         }
-                        cur++;
                     }
-                    *out = '\0';
-
-                    if (verbose)
+                    if (substStr)
                     {
-                        printf("[%s] EXEC %s -> %s\n", extMap->inExt, get_filename(inFile), outFile);
-                        printf(" >>> %s\n", buf);
-                    }
-
-                    result = (0 == system(buf));
-
-                    if (!result)
-                    {
-                        fprintf(stderr, "Command failed!!!\n");
+                        out = strcpy(out, substStr) + strlen(substStr);
                     }
+                    break;
                 }
 
-                if (!result)
+                default:
                 {
-                    fprintf(stderr, "[assets-preprocessor] Error! Failed to process %s!\n", get_filename(inFile));
-                    processingErrors++;
+                    *out++ = *cur;
                 }
-
                 break;
             }
+            cur++;
+        }
+        *out = '\0';
+
+        if (verbose)
+        {
+            printf("[%s] EXEC %s -> %s\n", extMap->inExt, get_filename(inFile), outFile);
+            printf(" >>> %s\n", buf);
+        }
+
+        result = (0 == system(buf));
+
+        if (!result)
+        {
+            fprintf(stderr, "Command failed!!!\n");
         }
-    }
-    else if (FTW_D != tflag)
-    {
-        return -1;
     }
 
-    return 0;
+    return result;
 }
 
 static const assetProcessor_t* findProcessor(const char* name)
@@ -860,6 +1210,11 @@ static void setupConfig(assetProcessor_t* execProcessors, size_t* procCount, fil
                 // If the processor
                 pendingMap.processor = findProcessor(opt->value);
             }
+            else if (!strcasecmp("codec", keyName))
+            {
+                // The codec for processors which compress their output
+                pendingMap.codec = opt->value;
+            }
             else if (!strcasecmp("exec", keyName))
             {
                 pendingProc.type = EXEC;
@@ -929,9 +1284,19 @@ int main(int argc, char** argv)
     int c;
     const char* configFile        = NULL;
     const char* timestampFileName = NULL;
+    const char* cacheFileName     = NULL;
+
+#if defined(WINDOWS) || defined(__WINDOWS__) || defined(_WINDOWS) || defined(WIN32) || defined(WIN64) \
+    || defined(_WIN32) || defined(_WIN64) || defined(__WIN32__) || defined(__TOS_WIN__) || defined(_MSC_VER)
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    numThreads = sysInfo.dwNumberOfProcessors;
+#else
+    numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
 
     opterr = 0;
-    while ((c = getopt(argc, argv, "i:o:t:vc:h")) != -1)
+    while ((c = getopt(argc, argv, "i:o:t:vc:m:j:h")) != -1)
     {
         switch (c)
         {
@@ -960,6 +1325,16 @@ int main(int argc, char** argv)
                 configFile = optarg;
                 break;
             }
+            case 'm':
+            {
+                cacheFileName = optarg;
+                break;
+            }
+            case 'j':
+            {
+                numThreads = strtol(optarg, NULL, 10);
+                break;
+            }
             case 'h':
             {
                 print_usage();
@@ -1017,7 +1392,7 @@ int main(int argc, char** argv)
     loadedExtMappings     = dynamicMappings;
     loadedExtMappingCount = mapCount;
 
-    if (ftw(inDirName, processFile, 99) == -1)
+    if (ftw(inDirName, collectFile, 99) == -1)
     {
         fprintf(stderr, "Failed to walk file tree\n");
         if (globalConfig)
@@ -1025,9 +1400,62 @@ int main(int argc, char** argv)
             deleteOptions(&configOptions);
             globalConfig = NULL;
         }
+        free(jobs);
         return -1;
     }
 
+    if (NULL != cacheFileName)
+    {
+        // Outputs made by a different build of the preprocessor might be different, so hash the preprocessor too
+        uint64_t toolHash = ASSET_HASH_INIT;
+        cacheEnabled      = hashFile(argv[0], &toolHash);
+        if (cacheEnabled)
+        {
+            loadAssetCache(&oldCache, cacheFileName, toolHash);
+        }
+        else
+        {
+            fprintf(stderr, "[WRN] Cannot read %s, so the cache is disabled\n", argv[0]);
+        }
+    }
+
+    // Process everything
+    int64_t start = getTimeUs();
+    runJobs();
+    int64_t wallUs = getTimeUs() - start;
+
+    assetCache_t newCache = {.toolHash = oldCache.toolHash};
+    for (size_t i = 0; i < jobCount; i++)
+    {
+        if (jobs[i].failed)
+        {
+            processingErrors++;
+        }
+        else if (cacheEnabled)
+        {
+            // Only remember files which were processed successfully, so failed ones are tried again next time
+            addAssetCacheEntry(&newCache, jobs[i].inFile + strlen(inDirName), jobs[i].inHash, jobs[i].optHash);
+        }
+
+        if (!jobs[i].cached)
+        {
+            filesUpdated++;
+        }
+    }
+
+    if (cacheEnabled && !saveAssetCache(&newCache, cacheFileName))
+    {
+        fprintf(stderr, "[WRN] Failed to write cache to '%s'\n", cacheFileName);
+    }
+    freeAssetCache(&newCache);
+    freeAssetCache(&oldCache);
+
+    if (verbose || filesUpdated > 0)
+    {
+        printStats(wallUs);
+    }
+    free(jobs);
+
     if (globalConfig)
     {
         deleteOptions(&configOptions);
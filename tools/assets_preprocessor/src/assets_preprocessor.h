@@ -62,6 +62,15 @@
  * If you are trying to debug an issue with an asset processor, adding `-v` to the command
  * will enable verbose logging which could be helpful.
  *
+ * Assets are processed in parallel, one per CPU, unless a different number is given with `-j`.
+ * Use `-j 1` when debugging a processor. When a cache file is given with `-m`, the hash of
+ * each asset's contents and options is saved there, and assets which haven't changed since
+ * they were last processed are skipped, no matter what their timestamps are. Rebuilding the
+ * asset preprocessor itself discards the cache. Without a cache file, assets are only
+ * processed if they are newer than their output files. After any assets are processed, the
+ * number of files each processor handled, how many were skipped, and how long they took
+ * are printed.
+ *
  * \subsection assetProc_config Config File
  *
  * The config file is what maps a file extension, such as `.png`, onto a specific asset
@@ -78,7 +87,10 @@
  * functions listed by passing the `-h` option (see \link assetProc_args Arguments \endlink
  * below), or a shell command. To use a shell command, use the `exec` option, like
  * `exec = python3 ./tools/custom_asset_proc.py %i %o`. To use a function, use the
- * `func` option, like `func = wsg` or `func = heatshrink`.
+ * `func` option, like `func = wsg` or `func = heatshrink`. Processors which compress their
+ * output use heatshrink, unless the section sets `codec = lz4`. LZ4 is much faster to
+ * decompress, and is often smaller for large files. `codec = none` stores the output
+ * without compression, which is larger but lets it be used from flash without RAM.
  *
  * Example config section
  * ```ini
@@ -156,10 +168,19 @@
  * <a href="https://github.com/AEFeinstein/Super-2024-Swadge-FW/blob/main/tools/font_maker/README.md">
  * font_maker</a> tool. The output file can be loaded with \ref loadFont().
  *
+ * Supports the option `outline`, which is false by default. If set to true, the
+ * font's outline is made ahead of time and stored with it, and both can be loaded
+ * with \ref loadFontFamily() instead of \ref loadFont() and \ref makeOutlineFont().
+ *
  * \paragraph assetProc_heatshrink heatshrink
  * Compresses the input file using <a href="https://github.com/atomicobject/heatshrink">
  * heatshrink</a> compression. Can be loaded with \ref readHeatshrinkFile().
  *
+ * Supports the option `codec`, which can be `heatshrink`, `lz4`, or `none`. This option is
+ * supported by every processor which compresses its output, and overrides the `codec` in
+ * the config file. LZ4 compressed and uncompressed files are also loaded with
+ * \ref readHeatshrinkFile().
+ *
  * \paragraph assetProc_json json
  * Validates the input JSON file and compresses it with heatshrink, by default.
  * The file can be loaded with \ref loadJson().
@@ -170,13 +191,15 @@
  *
  * \paragraph assetProc_text text
  * Removes any non-ASCII and unsupported characters in the input
- * file and writes it to the output.
+ * file and writes it to the output, followed by a null terminator. The file can be
+ * loaded with \ref loadTxt(), or used straight from flash with \ref loadTxtMapped().
  *
  * \paragraph assetProc_wsg wsg
  * Processes image files and converts them to the WSG (web-safe graphic) format.
  * These image files can be loaded with \ref loadWsg(). Any colors in the image
  * will be reduced to fit the web-safe color palette, along with one fully
- * transparent color, \ref paletteColor_t::cTransparent.
+ * transparent color, \ref paletteColor_t::cTransparent. Images stored with
+ * `codec = none` can also be used straight from flash with \ref loadWsgMapped().
  *
  * Supports the option `dither`, which is false by default. If set to true,
  * images will be dithered when reducing their colors to the web-safe palette,
@@ -262,6 +285,8 @@
  * | `-o` | Output directory where processed assets are written. Always required.    |
  * | `-c` | Configuration file. Optional, but it won't do much without it.           |
  * | `-t` | Timestamp file. File will be updated any time an asset changes. Optional |
+ * | `-m` | Cache file. Skips assets whose contents and options haven't changed.     |
+ * | `-j` | The number of assets to process at once. Defaults to the number of CPUs. |
  * | `-v` | Verbose mode. Outputs a lot more information during processing.          |
  * | `-h` | Display usage information, and list available processor function names.  |
  */
@@ -745,6 +770,9 @@ typedef struct
 
     /// @brief Holds a pointer to any configuration options in use for this file
     const processorOptions_t* options;
+
+    /// @brief The codec to compress this file with, from the config file, or NULL for the default
+    const char* codec;
 } processorInput_t;
 
 /**
@@ -797,6 +825,9 @@ typedef struct
 
     /// @brief Extra options passed to the processor for these files
     const processorOptions_t* options;
+
+    /// @brief The codec to compress these files with, or NULL for the default
+    const char* codec;
 } fileProcessorMap_t;
 
 /// @brief The path that is provided for input assets on the command line.
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "compress_util.h"
+#include "fileUtils.h"
+#include "heatshrink_util.h"
+#include "lz4_util.h"
+#include "stored_common.h"
+
+/**
+ * @brief Compress the given bytes with the codec chosen for this asset and write them to a file handle. The codec is
+ * the asset's option, i.e. `wsg.codec`, if it has one, or else the `codec` of its section in the config file, or
+ * else heatshrink. The codec `none` stores the bytes without compression. Either way, the file can be loaded with
+ * \ref readHeatshrinkFile()
+ *
+ * @param arg The processor input, with the options and the config file's codec
+ * @param optName The full name of the codec option, i.e. `"wsg.codec"`
+ * @param input The bytes to compress and write to a file
+ * @param len The length of the bytes to compress and write
+ * @param outFile An open file handle to write to
+ * @return true if the file was written
+ * @return false if there was an error
+ */
+bool writeCompressedFileHandle(const processorInput_t* arg, const char* optName, uint8_t* input, uint32_t len,
+                               FILE* outFile)
+{
+    const char* codec = getStrOption(arg->options, optName);
+    if (NULL == codec || !*codec)
+    {
+        codec = arg->codec;
+    }
+
+    if (NULL == codec || !*codec || !strcasecmp(codec, "heatshrink"))
+    {
+        return writeHeatshrinkFileHandle(input, len, outFile);
+    }
+    else if (!strcasecmp(codec, "lz4"))
+    {
+        return writeLz4FileHandle(input, len, outFile);
+    }
+    else if (!strcasecmp(codec, "none"))
+    {
+        return writeStoredFileHandle(input, len, outFile);
+    }
+
+    fprintf(stderr, "[WRN] Unknown %s '%s' for %s; using heatshrink\n", optName, codec, arg->inFilename);
+    return writeHeatshrinkFileHandle(input, len, outFile);
+}
+
+/**
+ * @brief Write the given bytes to a file handle without compressing them. Uncompressed assets are larger, but they
+ * can be used straight from flash, i.e. with loadWsgMapped(), so they don't take any RAM
+ *
+ * @param input The bytes to write to a file
+ * @param len The length of the bytes to write
+ * @param outFile An open file handle to write to
+ * @return true if the file was written
+ * @return false if the input was too large or there was an error
+ */
+bool writeStoredFileHandle(const uint8_t* input, uint32_t len, FILE* outFile)
+{
+    if (len > STORED_ASSET_MAX_SIZE)
+    {
+        fprintf(stderr, "[ERR] %u bytes is too large to store uncompressed\n", len);
+        return false;
+    }
+
+    /* The first byte is the tag, then the three bytes of size */
+    putc(STORED_ASSET_TAG, outFile);
+    putc(LO_BYTE(HI_WORD(len)), outFile);
+    putc(HI_BYTE(LO_WORD(len)), outFile);
+    putc(LO_BYTE(LO_WORD(len)), outFile);
+    /* Then dump the bytes */
+    return 0 == len || 1 == fwrite(input, len, 1, outFile);
+}
@@ -0,0 +1,14 @@
+#ifndef _COMPRESS_UTIL_H_
+#define _COMPRESS_UTIL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "assets_preprocessor.h"
+
+bool writeCompressedFileHandle(const processorInput_t* arg, const char* optName, uint8_t* input, uint32_t len,
+                               FILE* outFile);
+bool writeStoredFileHandle(const uint8_t* input, uint32_t len, FILE* outFile);
+
+#endif
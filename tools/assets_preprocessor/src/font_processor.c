@@ -7,6 +7,7 @@
 #include "assets_preprocessor.h"
 #include "font_processor.h"
 #include "fileUtils.h"
+#include "font_common.h"
 
 bool process_font(processorInput_t* arg);
 
@@ -19,7 +20,10 @@ const assetProcessor_t fontProcessor = {
 };
 
 uint32_t getPx(unsigned char* data, int w, int x, int y);
-void appendCharToFile(FILE* fp, unsigned char* data, int w, int h, int charStartX, int charEndX);
+static bool isCharPx(unsigned char* data, int w, int h, int charStartX, int charEndX, int x, int y);
+static void appendBitmapToFile(FILE* fp, unsigned char* data, int w, int h, int charStartX, int charEndX,
+                               bool outline);
+void appendCharToFile(FILE* fp, unsigned char* data, int w, int h, int charStartX, int charEndX, bool outline);
 
 /**
  * TODO
@@ -37,28 +41,57 @@ uint32_t getPx(unsigned char* data, int w, int x, int y)
 }
 
 /**
- * @brief TODO
+ * @brief Check if a pixel of a character is set. Pixels outside of the character are never set
  *
- * @param fp
- * @param data
- * @param w
- * @param h
- * @param charStartX
- * @param charEndX
+ * @param data The font image
+ * @param w The width of the font image
+ * @param h The height of the font image, including the spacing row
+ * @param charStartX The first column of the character
+ * @param charEndX The last column of the character
+ * @param x The column of the pixel
+ * @param y The row of the pixel
+ * @return true if the pixel is set, false if it is not
  */
-void appendCharToFile(FILE* fp, unsigned char* data, int w, int h, int charStartX, int charEndX)
+static bool isCharPx(unsigned char* data, int w, int h, int charStartX, int charEndX, int x, int y)
 {
-    /* Write the output width */
-    putc(charEndX - charStartX + 1, fp);
+    if (x < charStartX || x > charEndX || y < 0 || y >= h - 2)
+    {
+        return false;
+    }
+    return 0 == (0xFFFFFF & getPx(data, w, x, y));
+}
 
-    /* Write the output bitmap data */
+/**
+ * @brief Write one character's bitmap, or the bitmap of its outline. The outline is the same as makeOutlineFont()
+ * makes, every set pixel which is next to an unset pixel
+ *
+ * @param fp The file to write to
+ * @param data The font image
+ * @param w The width of the font image
+ * @param h The height of the font image, including the spacing row
+ * @param charStartX The first column of the character
+ * @param charEndX The last column of the character
+ * @param outline true to write the outline, false to write the character
+ */
+static void appendBitmapToFile(FILE* fp, unsigned char* data, int w, int h, int charStartX, int charEndX,
+                               bool outline)
+{
     unsigned char outByte = 0;
     uint8_t bitIdx        = 0;
     for (int chy = 0; chy < h - 2; chy++)
     {
         for (int chx = charStartX; chx <= charEndX; chx++)
         {
-            if (0 == (0xFFFFFF & getPx(data, w, chx, chy)))
+            bool isSet = isCharPx(data, w, h, charStartX, charEndX, chx, chy);
+            if (isSet && outline)
+            {
+                isSet = !isCharPx(data, w, h, charStartX, charEndX, chx - 1, chy)
+                        || !isCharPx(data, w, h, charStartX, charEndX, chx + 1, chy)
+                        || !isCharPx(data, w, h, charStartX, charEndX, chx, chy - 1)
+                        || !isCharPx(data, w, h, charStartX, charEndX, chx, chy + 1);
+            }
+
+            if (isSet)
             {
                 outByte |= (1 << bitIdx);
             }
@@ -77,8 +110,30 @@ void appendCharToFile(FILE* fp, unsigned char* data, int w, int h, int charStart
     if (0 != bitIdx)
     {
         putc(outByte, fp);
-        outByte = 0;
-        bitIdx  = 0;
+    }
+}
+
+/**
+ * @brief Write one character's width and bitmap, and its outline's bitmap if the font has one
+ *
+ * @param fp The file to write to
+ * @param data The font image
+ * @param w The width of the font image
+ * @param h The height of the font image, including the spacing row
+ * @param charStartX The first column of the character
+ * @param charEndX The last column of the character
+ * @param outline true to also write the outline's bitmap
+ */
+void appendCharToFile(FILE* fp, unsigned char* data, int w, int h, int charStartX, int charEndX, bool outline)
+{
+    /* Write the output width */
+    putc(charEndX - charStartX + 1, fp);
+
+    /* Write the output bitmap data */
+    appendBitmapToFile(fp, data, w, h, charStartX, charEndX, false);
+    if (outline)
+    {
+        appendBitmapToFile(fp, data, w, h, charStartX, charEndX, true);
     }
 }
 
@@ -98,6 +153,14 @@ bool process_font(processorInput_t* arg)
 
     int charsWritten = 0;
 
+    /* Fonts with an outline are written as a font family, which starts with a tag and the variants it has */
+    bool outline = getBoolOption(arg->options, "font.outline", false);
+    if (outline)
+    {
+        putc(FONT_FAMILY_TAG, fp);
+        putc(FONT_FAMILY_OUTLINE, fp);
+    }
+
     /* Write the output height, excluding spacing row */
     putc(h - 2, fp);
 
@@ -122,7 +185,7 @@ bool process_font(processorInput_t* arg)
                 /* white px (not black) */
                 if (isCountingChar)
                 {
-                    appendCharToFile(fp, data, w, h, charStartX, charEndX);
+                    appendCharToFile(fp, data, w, h, charStartX, charEndX, outline);
                     charsWritten++;
                     /* Increment the char (dbg) */
                     ch++;
@@ -138,7 +201,7 @@ bool process_font(processorInput_t* arg)
     /* Check for leftovers */
     if (charStartX != charEndX)
     {
-        appendCharToFile(fp, data, w, h, charStartX, charEndX);
+        appendCharToFile(fp, data, w, h, charStartX, charEndX, outline);
         charsWritten++;
     }
 
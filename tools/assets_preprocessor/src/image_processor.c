@@ -3,7 +3,8 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
+#include <strings.h>
 #include <unistd.h>
 
 #if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
@@ -28,240 +29,502 @@
 #include "image_processor.h"
 
 #include "heatshrink_encoder.h"
-#include "heatshrink_util.h"
+#include "compress_util.h"
 
 #include "fileUtils.h"
 
 #define CLAMP(x, l, u) ((x) < l ? l : ((x) > u ? u : (x)))
 
+/// The number of levels each color channel has in the palette
+#define CHANNEL_LEVELS 6
+
+/// The 8-bit value between two adjacent channel levels
+#define LEVEL_STEP (255 / (CHANNEL_LEVELS - 1))
+
+/// The palette index which means 'transparent'
+#define TRANSPARENT_IDX (CHANNEL_LEVELS * CHANNEL_LEVELS * CHANNEL_LEVELS)
+
+/// The seed used for random order dithering when none is given
+#define DEFAULT_DITHER_SEED 0x5A5A
+
+// Round an 8-bit channel value to the nearest of the six palette levels, 16 or 256 values at a time
+#define LEVEL(v)      (((v) * (CHANNEL_LEVELS - 1) + 127) / 255)
+#define LEVELS_16(v)                                                                                                \
+    LEVEL((v) + 0), LEVEL((v) + 1), LEVEL((v) + 2), LEVEL((v) + 3), LEVEL((v) + 4), LEVEL((v) + 5), LEVEL((v) + 6), \
+        LEVEL((v) + 7), LEVEL((v) + 8), LEVEL((v) + 9), LEVEL((v) + 10), LEVEL((v) + 11), LEVEL((v) + 12),          \
+        LEVEL((v) + 13), LEVEL((v) + 14), LEVEL((v) + 15)
+#define LEVELS_256                                                                                                   \
+    LEVELS_16(0), LEVELS_16(16), LEVELS_16(32), LEVELS_16(48), LEVELS_16(64), LEVELS_16(80), LEVELS_16(96),          \
+        LEVELS_16(112), LEVELS_16(128), LEVELS_16(144), LEVELS_16(160), LEVELS_16(176), LEVELS_16(192),              \
+        LEVELS_16(208), LEVELS_16(224), LEVELS_16(240)
+
+/**
+ * @brief The ways an image can be dithered
+ */
+typedef enum
+{
+    DITHER_NONE,            ///< Round every pixel to the nearest palette color
+    DITHER_RANDOM,          ///< Spread error to all undrawn neighbors, visiting pixels in a seeded random order
+    DITHER_FLOYD_STEINBERG, ///< Floyd-Steinberg error diffusion, alternating direction each row
+    DITHER_ORDERED,         ///< Offset each pixel by a 4x4 Bayer matrix, which spreads no error at all
+} ditherMode_t;
+
+/**
+ * @brief The error waiting to be added to one pixel by random order dithering
+ */
 typedef struct
 {
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    uint8_t a;
-    int eR;
-    int eG;
-    int eB;
-    bool isDrawn;
-} pixel_t;
-
-void shuffleArray(uint32_t* ar, uint32_t len);
-int isNeighborNotDrawn(pixel_t** img, int x, int y, int w, int h);
-void spreadError(pixel_t** img, int x, int y, int w, int h, int teR, int teG, int teB, float diagScalar);
+    int16_t eR;   ///< Red error, 8 bits per channel
+    int16_t eG;   ///< Green error, 8 bits per channel
+    int16_t eB;   ///< Blue error, 8 bits per channel
+    bool isDrawn; ///< true if this pixel was already quantized
+} pixelError_t;
+
+static uint32_t xorshift32(uint32_t* state);
+static void shuffleArray(uint32_t* ar, uint32_t len, uint32_t seed);
+static ditherMode_t getDitherMode(const processorInput_t* arg);
+static inline uint8_t quantizePixel(const uint8_t* src, int eR, int eG, int eB, int* qR, int* qG, int* qB);
+static void quantizeNearest(const uint8_t* src, uint8_t* dst, int w, int h);
+static void quantizeOrdered(const uint8_t* src, uint8_t* dst, int w, int h);
+static bool quantizeFloydSteinberg(const uint8_t* src, uint8_t* dst, int w, int h);
+static bool quantizeRandom(const uint8_t* src, uint8_t* dst, int w, int h, uint32_t seed);
 bool process_image(processorInput_t* arg);
 
 const assetProcessor_t imageProcessor
     = {.name = "wsg", .type = FUNCTION, .function = process_image, .inFmt = FMT_FILE_BIN, .outFmt = FMT_FILE_BIN};
 
+/// The nearest palette level for every 8-bit channel value
+static const uint8_t channelLevels[256] = {LEVELS_256};
+
+/// The offsets added by ordered dithering, out of 16 steps between two palette levels
+static const uint8_t bayer4x4[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5},
+};
+
+/**
+ * @brief Generate a pseudorandom number. This is used instead of rand() so dithering is the same on every platform and
+ * doesn't depend on the order images are processed in by multiple threads
+ *
+ * @param state [in,out] The generator's state, which must not be zero
+ * @return uint32_t The next pseudorandom number
+ */
+static uint32_t xorshift32(uint32_t* state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
 /**
  * @brief Randomizes the order of the given array of ints
  *
  * @param ar The array to randomize
  * @param len The number of items in the array
+ * @param seed The seed for the order, so the same seed always gives the same order
  */
-void shuffleArray(uint32_t* ar, uint32_t len)
+static void shuffleArray(uint32_t* ar, uint32_t len, uint32_t seed)
 {
-    srand(time(NULL));
-    for (int i = len - 1; i > 0; i--)
+    uint32_t state = seed ? seed : DEFAULT_DITHER_SEED;
+    for (uint32_t i = len - 1; i > 0 && i < len; i--)
     {
-        int index = rand() % (i + 1);
-        int a     = ar[index];
-        ar[index] = ar[i];
-        ar[i]     = a;
+        uint32_t index = xorshift32(&state) % (i + 1);
+        uint32_t a     = ar[index];
+        ar[index]      = ar[i];
+        ar[i]          = a;
     }
 }
 
-int isNeighborNotDrawn(pixel_t** img, int x, int y, int w, int h)
+/**
+ * @brief Read the dithering options for an image
+ *
+ * @param arg The processor input, with the options
+ * @return ditherMode_t The dithering to use
+ */
+static ditherMode_t getDitherMode(const processorInput_t* arg)
 {
-    if (0 <= x && x < w)
+    if (!getBoolOption(arg->options, "wsg.dither", false))
     {
-        if (0 <= y && y < h)
+        return DITHER_NONE;
+    }
+
+    const char* mode = getStrOption(arg->options, "wsg.ditherMode");
+    if (NULL == mode || !*mode || !strcasecmp(mode, "random"))
+    {
+        return DITHER_RANDOM;
+    }
+    else if (!strcasecmp(mode, "fs") || !strcasecmp(mode, "floyd-steinberg"))
+    {
+        return DITHER_FLOYD_STEINBERG;
+    }
+    else if (!strcasecmp(mode, "ordered"))
+    {
+        return DITHER_ORDERED;
+    }
+
+    fprintf(stderr, "[WRN] Unknown wsg.ditherMode '%s' for %s; using random\n", mode, arg->inFilename);
+    return DITHER_RANDOM;
+}
+
+/**
+ * @brief Quantize one pixel, after adding some error to it
+ *
+ * @param src The source pixel, RGBA with 8 bits per channel
+ * @param eR The error to add to red
+ * @param eG The error to add to green
+ * @param eB The error to add to blue
+ * @param qR [out] The red value after adding the error, clamped to 0-255
+ * @param qG [out] The green value after adding the error, clamped to 0-255
+ * @param qB [out] The blue value after adding the error, clamped to 0-255
+ * @return uint8_t The palette index, or ::TRANSPARENT_IDX
+ */
+static inline uint8_t quantizePixel(const uint8_t* src, int eR, int eG, int eB, int* qR, int* qG, int* qB)
+{
+    *qR = CLAMP(src[0] + eR, 0, 255);
+    *qG = CLAMP(src[1] + eG, 0, 255);
+    *qB = CLAMP(src[2] + eB, 0, 255);
+
+    if (src[3] < 128)
+    {
+        return TRANSPARENT_IDX;
+    }
+
+    /* Index math! The palette indices increase blue, then green, then red.
+     * Each has a value 0-5 (six levels)
+     */
+    return channelLevels[*qB] + (CHANNEL_LEVELS * channelLevels[*qG])
+           + (CHANNEL_LEVELS * CHANNEL_LEVELS * channelLevels[*qR]);
+}
+
+/**
+ * @brief Round every pixel to the nearest palette color
+ *
+ * @param src The source image, RGBA with 8 bits per channel
+ * @param dst [out] The palette indices, one byte per pixel
+ * @param w The image width
+ * @param h The image height
+ */
+static void quantizeNearest(const uint8_t* src, uint8_t* dst, int w, int h)
+{
+    const uint8_t* end = src + (size_t)w * h * 4;
+    for (; src < end; src += 4)
+    {
+        if (src[3] >= 128)
+        {
+            *dst++ = channelLevels[src[2]] + (CHANNEL_LEVELS * channelLevels[src[1]])
+                     + (CHANNEL_LEVELS * CHANNEL_LEVELS * channelLevels[src[0]]);
+        }
+        else
         {
-            return !(img[y][x].isDrawn) ? 1 : 0;
+            *dst++ = TRANSPARENT_IDX;
         }
     }
-    return 0;
 }
 
-void spreadError(pixel_t** img, int x, int y, int w, int h, int teR, int teG, int teB, float diagScalar)
+/**
+ * @brief Quantize with a 4x4 Bayer matrix. Each pixel is offset by up to half a palette step either way
+ *
+ * @param src The source image, RGBA with 8 bits per channel
+ * @param dst [out] The palette indices, one byte per pixel
+ * @param w The image width
+ * @param h The image height
+ */
+static void quantizeOrdered(const uint8_t* src, uint8_t* dst, int w, int h)
+{
+    // Scale the matrix from 0-15 to -LEVEL_STEP/2 to LEVEL_STEP/2
+    int offsets[4][4];
+    for (int y = 0; y < 4; y++)
+    {
+        for (int x = 0; x < 4; x++)
+        {
+            offsets[y][x] = ((2 * bayer4x4[y][x] - 15) * LEVEL_STEP) / 32;
+        }
+    }
+
+    int qR, qG, qB;
+    for (int y = 0; y < h; y++)
+    {
+        const int* row = offsets[y & 3];
+        for (int x = 0; x < w; x++)
+        {
+            int o  = row[x & 3];
+            *dst++ = quantizePixel(src, o, o, o, &qR, &qG, &qB);
+            src += 4;
+        }
+    }
+}
+
+/**
+ * @brief Quantize with Floyd-Steinberg error diffusion in integers. Rows alternate direction so the error doesn't
+ * drift to one side. Transparent pixels neither receive nor spread error
+ *
+ * @param src The source image, RGBA with 8 bits per channel
+ * @param dst [out] The palette indices, one byte per pixel
+ * @param w The image width
+ * @param h The image height
+ * @return true if the image was quantized
+ * @return false if memory could not be allocated
+ */
+static bool quantizeFloydSteinberg(const uint8_t* src, uint8_t* dst, int w, int h)
 {
-    if (0 <= x && x < w)
+    // The error for this row and the next, with a pixel of padding on either side so edges need no checks
+    int16_t* errBuf = calloc((size_t)(w + 2) * 3 * 2, sizeof(int16_t));
+    if (NULL == errBuf)
     {
-        if (0 <= y && y < h)
+        return false;
+    }
+    int16_t* curErr  = errBuf + 3;
+    int16_t* nextErr = errBuf + (w + 2) * 3 + 3;
+
+    for (int y = 0; y < h; y++)
+    {
+        bool reverse     = (y & 1);
+        int step         = reverse ? -1 : 1;
+        int x            = reverse ? w - 1 : 0;
+        const uint8_t* s = &src[((size_t)y * w + x) * 4];
+        uint8_t* d       = &dst[(size_t)y * w + x];
+
+        for (int i = 0; i < w; i++, x += step, s += step * 4, d += step)
         {
-            if (!img[y][x].isDrawn)
+            int16_t* e = &curErr[x * 3];
+            int qR, qG, qB;
+            *d = quantizePixel(s, e[0], e[1], e[2], &qR, &qG, &qB);
+            if (TRANSPARENT_IDX == *d)
             {
-                img[y][x].eR = (int)(teR * diagScalar + 0.5);
-                img[y][x].eG = (int)(teG * diagScalar + 0.5);
-                img[y][x].eB = (int)(teB * diagScalar + 0.5);
+                continue;
+            }
+
+            int te[3] = {
+                qR - channelLevels[qR] * LEVEL_STEP,
+                qG - channelLevels[qG] * LEVEL_STEP,
+                qB - channelLevels[qB] * LEVEL_STEP,
+            };
+
+            // 7/16 ahead, 3/16 behind below, 5/16 below, and whatever is left ahead below, so no error is lost
+            int16_t* ahead      = &curErr[(x + step) * 3];
+            int16_t* belowBack  = &nextErr[(x - step) * 3];
+            int16_t* below      = &nextErr[x * 3];
+            int16_t* belowAhead = &nextErr[(x + step) * 3];
+            for (int c = 0; c < 3; c++)
+            {
+                int e7 = (te[c] * 7) / 16;
+                int e3 = (te[c] * 3) / 16;
+                int e5 = (te[c] * 5) / 16;
+                ahead[c] += e7;
+                belowBack[c] += e3;
+                below[c] += e5;
+                belowAhead[c] += te[c] - e7 - e3 - e5;
             }
         }
+
+        // The next row becomes this row, and the row after it starts with no error
+        int16_t* tmp = curErr;
+        curErr       = nextErr;
+        nextErr      = tmp;
+        memset(nextErr - 3, 0, (size_t)(w + 2) * 3 * sizeof(int16_t));
     }
+
+    free(errBuf);
+    return true;
 }
 
-bool process_image(processorInput_t* arg)
+/**
+ * @brief Quantize pixels in a random order, spreading each pixel's error to all of its neighbors which haven't been
+ * drawn yet, with twice as much to the adjacent ones as the diagonal ones. This doesn't have the directional patterns
+ * of Floyd-Steinberg, but it's slower since it can't walk the image in order
+ *
+ * @param src The source image, RGBA with 8 bits per channel
+ * @param dst [out] The palette indices, one byte per pixel
+ * @param w The image width
+ * @param h The image height
+ * @param seed The seed for the pixel order
+ * @return true if the image was quantized
+ * @return false if memory could not be allocated
+ */
+static bool quantizeRandom(const uint8_t* src, uint8_t* dst, int w, int h, uint32_t seed)
 {
-    /* Load the source PNG */
-    int w, h, n;
-    unsigned char* data = stbi_load_from_file(arg->in.file, &w, &h, &n, 4);
+    // The error for every pixel, with a border which is already drawn so neighbors never need bounds checks
+    int stride           = w + 2;
+    uint32_t len         = (uint32_t)w * h;
+    uint32_t* indices    = malloc(len * sizeof(uint32_t));
+    pixelError_t* errBuf = calloc((size_t)stride * (h + 2), sizeof(pixelError_t));
+    if (NULL == indices || NULL == errBuf)
+    {
+        free(indices);
+        free(errBuf);
+        return false;
+    }
+    for (int x = 0; x < stride; x++)
+    {
+        errBuf[x].isDrawn                    = true;
+        errBuf[(h + 1) * stride + x].isDrawn = true;
+    }
+    for (int y = 1; y <= h; y++)
+    {
+        errBuf[y * stride].isDrawn         = true;
+        errBuf[y * stride + w + 1].isDrawn = true;
+    }
+    pixelError_t* errs = &errBuf[stride + 1];
 
-    bool dither = getBoolOption(arg->options, "wsg.dither", false);
+    // The offsets to the adjacent neighbors, then the diagonal ones
+    const int neighbors[8] = {-1, 1, -stride, stride, -stride - 1, -stride + 1, stride - 1, stride + 1};
 
-    if (NULL != data)
+    /* Create an array of pixel indicies, then shuffle it */
+    for (uint32_t i = 0; i < len; i++)
     {
-        /* Create an array for output */
-        pixel_t** image8b;
-        image8b = (pixel_t**)calloc(h, sizeof(pixel_t*));
-        for (int y = 0; y < h; y++)
+        indices[i] = i;
+    }
+    shuffleArray(indices, len, seed);
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint32_t idx     = indices[i];
+        pixelError_t* px = &errs[(idx / w) * stride + (idx % w)];
+
+        int qR, qG, qB;
+        dst[idx] = quantizePixel(&src[idx * 4], px->eR, px->eG, px->eB, &qR, &qG, &qB);
+
+        /* Mark the random pixel as drawn */
+        px->isDrawn = true;
+
+        /* Count all the neighbors that haven't been drawn yet */
+        int adjNeighbors  = 0;
+        int diagNeighbors = 0;
+        for (int n = 0; n < 4; n++)
         {
-            image8b[y] = (pixel_t*)calloc(w, sizeof(pixel_t));
+            adjNeighbors += !px[neighbors[n]].isDrawn;
+            diagNeighbors += !px[neighbors[n + 4]].isDrawn;
         }
 
-        /* Create an array of pixel indicies, then shuffle it */
-        uint32_t* indices = (uint32_t*)calloc(w * h, sizeof(uint32_t)); //[w * h];
-        for (int i = 0; i < w * h; i++)
+        int den = (2 * adjNeighbors) + diagNeighbors;
+        if (0 == den)
         {
-            indices[i] = i;
+            continue;
         }
-        shuffleArray(indices, w * h);
 
-        /* For all pixels */
-        for (int i = 0; i < w * h; i++)
+        /* Find the total error from the source pixel, 8 bits per channel */
+        int teR = src[idx * 4 + 0] - channelLevels[qR] * LEVEL_STEP;
+        int teG = src[idx * 4 + 1] - channelLevels[qG] * LEVEL_STEP;
+        int teB = src[idx * 4 + 2] - channelLevels[qB] * LEVEL_STEP;
+
+        /* Spread the error to all neighboring unquantized pixels, with twice as much error to the adjacent pixels as
+         * the diagonal ones. Round the same way as adding 0.5 and truncating
+         */
+        pixelError_t adjErr = {
+            .eR = (4 * teR + den) / (2 * den),
+            .eG = (4 * teG + den) / (2 * den),
+            .eB = (4 * teB + den) / (2 * den),
+        };
+        pixelError_t diagErr = {
+            .eR = (2 * teR + den) / (2 * den),
+            .eG = (2 * teG + den) / (2 * den),
+            .eB = (2 * teB + den) / (2 * den),
+        };
+        for (int n = 0; n < 8; n++)
         {
-            /* Get the x, y coordinates for the random pixel */
-            int x = indices[i] % w;
-            int y = indices[i] / w;
-
-            /* Get the source pixel, 8 bits per channel */
-            unsigned char sourceR = data[(y * (w * 4)) + (x * 4) + 0];
-            unsigned char sourceG = data[(y * (w * 4)) + (x * 4) + 1];
-            unsigned char sourceB = data[(y * (w * 4)) + (x * 4) + 2];
-            unsigned char sourceA = data[(y * (w * 4)) + (x * 4) + 3];
-
-            /* Find the bit-reduced value, use rounding, 5551 for RGBA */
-            image8b[y][x].r = CLAMP((127 + ((sourceR + image8b[y][x].eR) * 5)) / 255, 0, 5);
-            image8b[y][x].g = CLAMP((127 + ((sourceG + image8b[y][x].eG) * 5)) / 255, 0, 5);
-            image8b[y][x].b = CLAMP((127 + ((sourceB + image8b[y][x].eB) * 5)) / 255, 0, 5);
-            image8b[y][x].a = (sourceA >= 128) ? 0xFF : 0x00;
-
-            // Don't dither small sprites, it just doesn't look good
-            if (dither)
+            pixelError_t* neighbor = &px[neighbors[n]];
+            if (!neighbor->isDrawn)
             {
-                /* Find the total error, 8 bits per channel */
-                int teR = sourceR - ((image8b[y][x].r * 255) / 5);
-                int teG = sourceG - ((image8b[y][x].g * 255) / 5);
-                int teB = sourceB - ((image8b[y][x].b * 255) / 5);
-
-                /* Count all the neighbors that haven't been drawn yet */
-                int adjNeighbors = 0;
-                adjNeighbors += isNeighborNotDrawn(image8b, x + 0, y + 1, w, h);
-                adjNeighbors += isNeighborNotDrawn(image8b, x + 0, y - 1, w, h);
-                adjNeighbors += isNeighborNotDrawn(image8b, x + 1, y + 0, w, h);
-                adjNeighbors += isNeighborNotDrawn(image8b, x - 1, y + 0, w, h);
-                int diagNeighbors = 0;
-                diagNeighbors += isNeighborNotDrawn(image8b, x - 1, y - 1, w, h);
-                diagNeighbors += isNeighborNotDrawn(image8b, x + 1, y - 1, w, h);
-                diagNeighbors += isNeighborNotDrawn(image8b, x - 1, y + 1, w, h);
-                diagNeighbors += isNeighborNotDrawn(image8b, x + 1, y + 1, w, h);
-
-                /* Spread the error to all neighboring unquantized pixels, with
-                 * twice as much error to the adjacent pixels as the diagonal ones
-                 */
-                float diagScalar = 1 / (float)((2 * adjNeighbors) + diagNeighbors);
-                float adjScalar  = 2 * diagScalar;
-
-                /* Write the error */
-                spreadError(image8b, x - 1, y - 1, w, h, teR, teG, teB, diagScalar);
-                spreadError(image8b, x - 1, y + 1, w, h, teR, teG, teB, diagScalar);
-                spreadError(image8b, x + 1, y - 1, w, h, teR, teG, teB, diagScalar);
-                spreadError(image8b, x + 1, y + 1, w, h, teR, teG, teB, diagScalar);
-                spreadError(image8b, x - 1, y + 0, w, h, teR, teG, teB, adjScalar);
-                spreadError(image8b, x + 1, y + 0, w, h, teR, teG, teB, adjScalar);
-                spreadError(image8b, x + 0, y - 1, w, h, teR, teG, teB, adjScalar);
-                spreadError(image8b, x + 0, y + 1, w, h, teR, teG, teB, adjScalar);
+                *neighbor = (n < 4) ? adjErr : diagErr;
             }
-
-            /* Mark the random pixel as drawn */
-            image8b[y][x].isDrawn = true;
         }
+    }
 
-        free(indices);
+    free(indices);
+    free(errBuf);
+    return true;
+}
 
-        /* Free stbi memory */
+bool process_image(processorInput_t* arg)
+{
+    /* Load the source PNG */
+    int w, h, n;
+    unsigned char* data = stbi_load_from_file(arg->in.file, &w, &h, &n, 4);
+    if (NULL == data)
+    {
+        return false;
+    }
+
+    /* Create the output, a header followed by one palette index per pixel */
+    uint32_t hdrAndImgSz = sizeof(uint8_t) * (4 + (uint32_t)w * h);
+    uint8_t* hdrAndImg   = malloc(hdrAndImgSz);
+    if (NULL == hdrAndImg)
+    {
         stbi_image_free(data);
+        return false;
+    }
+    hdrAndImg[0]        = HI_BYTE(w);
+    hdrAndImg[1]        = LO_BYTE(w);
+    hdrAndImg[2]        = HI_BYTE(h);
+    hdrAndImg[3]        = LO_BYTE(h);
+    uint8_t* paletteBuf = &hdrAndImg[4];
+
+    // Don't dither small sprites, it just doesn't look good
+    bool ok = true;
+    switch (getDitherMode(arg))
+    {
+        case DITHER_NONE:
+        {
+            quantizeNearest(data, paletteBuf, w, h);
+            break;
+        }
+        case DITHER_RANDOM:
+        {
+            uint32_t seed = getIntOption(arg->options, "wsg.ditherSeed", DEFAULT_DITHER_SEED);
+            ok            = quantizeRandom(data, paletteBuf, w, h, seed);
+            break;
+        }
+        case DITHER_FLOYD_STEINBERG:
+        {
+            ok = quantizeFloydSteinberg(data, paletteBuf, w, h);
+            break;
+        }
+        case DITHER_ORDERED:
+        {
+            quantizeOrdered(data, paletteBuf, w, h);
+            break;
+        }
+    }
+
+    /* Free stbi memory */
+    stbi_image_free(data);
 
 // #define WRITE_DITHERED_PNG
 #ifdef WRITE_DITHERED_PNG
-        /* Convert to a pixel buffer */
+    if (ok)
+    {
+        /* Convert back to a pixel buffer */
         unsigned char* pixBuf = (unsigned char*)calloc(w * h * 4, sizeof(unsigned char)); //[w*h*4];
-        int pixBufIdx         = 0;
-        for (int y = 0; y < h; y++)
+        for (int i = 0; i < w * h; i++)
         {
-            for (int x = 0; x < w; x++)
+            uint8_t idx = paletteBuf[i];
+            if (TRANSPARENT_IDX != idx)
             {
-                pixBuf[pixBufIdx++] = (image8b[y][x].r * 255) / 5;
-                pixBuf[pixBufIdx++] = (image8b[y][x].g * 255) / 5;
-                pixBuf[pixBufIdx++] = (image8b[y][x].b * 255) / 5;
-                pixBuf[pixBufIdx++] = image8b[y][x].a;
+                pixBuf[i * 4 + 0] = (idx / (CHANNEL_LEVELS * CHANNEL_LEVELS)) * LEVEL_STEP;
+                pixBuf[i * 4 + 1] = ((idx / CHANNEL_LEVELS) % CHANNEL_LEVELS) * LEVEL_STEP;
+                pixBuf[i * 4 + 2] = (idx % CHANNEL_LEVELS) * LEVEL_STEP;
+                pixBuf[i * 4 + 3] = 0xFF;
             }
         }
-        /* Write a PNG */
-        char pngOutFilePath[strlen(outFilePath) + 4];
-        strcpy(pngOutFilePath, outFilePath);
-        strcat(pngOutFilePath, ".png");
+        /* Write a PNG to the working directory, not next to the input where it would be processed */
+        char pngOutFilePath[strlen(get_filename(arg->inFilename)) + sizeof(".dithered.png")];
+        strcpy(pngOutFilePath, get_filename(arg->inFilename));
+        strcat(pngOutFilePath, ".dithered.png");
         stbi_write_png(pngOutFilePath, w, h, 4, pixBuf, 4 * w);
         free(pixBuf);
+    }
 #endif
 
-        /* Convert to a palette buffer */
-        uint32_t paletteBufSize   = sizeof(unsigned char) * w * h;
-        unsigned char* paletteBuf = calloc(1, paletteBufSize);
-        int paletteBufIdx         = 0;
-        for (int y = 0; y < h; y++)
-        {
-            for (int x = 0; x < w; x++)
-            {
-                if (image8b[y][x].a)
-                {
-                    /* Index math! The palette indices increase blue, then green, then red.
-                     * Each has a value 0-5 (six levels)
-                     */
-                    paletteBuf[paletteBufIdx++]
-                        = (image8b[y][x].b) + (6 * (image8b[y][x].g)) + (36 * (image8b[y][x].r));
-                }
-                else
-                {
-                    /* This invalid value means 'transparent' */
-                    paletteBuf[paletteBufIdx++] = 6 * 6 * 6;
-                }
-            }
-        }
+    /* Write the compressed file */
+    bool result = ok && writeCompressedFileHandle(arg, "wsg.codec", hdrAndImg, hdrAndImgSz, arg->out.file);
 
-        /* Free dithering memory */
-        for (int y = 0; y < h; y++)
-        {
-            free(image8b[y]);
-        }
-        free(image8b);
-
-        /* Combine the header and image*/
-        uint32_t hdrAndImgSz = sizeof(uint8_t) * (4 + paletteBufSize);
-        uint8_t* hdrAndImg   = calloc(1, hdrAndImgSz);
-        hdrAndImg[0]         = HI_BYTE(w);
-        hdrAndImg[1]         = LO_BYTE(w);
-        hdrAndImg[2]         = HI_BYTE(h);
-        hdrAndImg[3]         = LO_BYTE(h);
-        memcpy(&hdrAndImg[4], paletteBuf, paletteBufSize);
-        /* Write the compressed file */
-
-        bool result = writeHeatshrinkFileHandle(hdrAndImg, hdrAndImgSz, arg->out.file);
-        /* Cleanup */
-        free(hdrAndImg);
-        free(paletteBuf);
-
-        return result;
-    }
+    /* Cleanup */
+    free(hdrAndImg);
 
-    return false;
+    return result;
 }
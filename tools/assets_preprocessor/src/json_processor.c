@@ -8,7 +8,7 @@
 #include "cJSON.h"
 #include "heatshrink_encoder.h"
 #include "fileUtils.h"
-#include "heatshrink_util.h"
+#include "compress_util.h"
 
 bool process_json(processorInput_t* arg);
 
@@ -51,7 +51,7 @@ bool process_json(processorInput_t* arg)
 
     if (compress)
     {
-        return writeHeatshrinkFileHandle((uint8_t*)jsonText, strlen(jsonText), arg->out.file);
+        return writeCompressedFileHandle(arg, "json.codec", (uint8_t*)jsonText, strlen(jsonText), arg->out.file);
     }
     else
     {
@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fileUtils.h"
+#include "lz4_common.h"
+#include "lz4_util.h"
+
+/// @brief The number of bits in a match finder hash
+#define LZ4_HASH_BITS 16
+
+/// @brief How many earlier positions with the same hash are checked for a match. Assets are compressed once and
+/// decompressed many times, so this is much deeper than a realtime compressor would go
+#define LZ4_MAX_CHAIN 1024
+
+/**
+ * @brief Finds matches by chaining together every earlier position with the same hash
+ */
+typedef struct
+{
+    const uint8_t* input; ///< The data being compressed
+    int32_t* head;        ///< The last position with each hash, or -1
+    int32_t* prev;        ///< The position before each one with the same hash, or -1
+    size_t nextInsert;    ///< The next position to add to the chains
+} lz4MatchFinder_t;
+
+static uint32_t hashPosition(const uint8_t* p);
+static void insertUpTo(lz4MatchFinder_t* mf, size_t pos);
+static size_t findMatch(lz4MatchFinder_t* mf, size_t pos, size_t maxLen, size_t* offset);
+static uint8_t* writeLength(uint8_t* op, size_t len);
+static uint8_t* writeSequence(uint8_t* op, const uint8_t* literals, size_t litLen, size_t offset, size_t matchLen);
+
+/**
+ * @brief Hash the four bytes at a position
+ *
+ * @param p The bytes to hash
+ * @return uint32_t A hash with ::LZ4_HASH_BITS bits
+ */
+static uint32_t hashPosition(const uint8_t* p)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    return (v * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+/**
+ * @brief Add every position before the given one to the hash chains
+ *
+ * @param mf The match finder
+ * @param pos The position to stop at, which is not added
+ */
+static void insertUpTo(lz4MatchFinder_t* mf, size_t pos)
+{
+    for (; mf->nextInsert < pos; mf->nextInsert++)
+    {
+        uint32_t h               = hashPosition(&mf->input[mf->nextInsert]);
+        mf->prev[mf->nextInsert] = mf->head[h];
+        mf->head[h]              = (int32_t)mf->nextInsert;
+    }
+}
+
+/**
+ * @brief Find the longest earlier match for the bytes at a position
+ *
+ * @param mf The match finder
+ * @param pos The position to match
+ * @param maxLen The longest match allowed
+ * @param offset [out] How far back the match is
+ * @return size_t The length of the match, or 0 if there is no match of at least ::LZ4_MIN_MATCH bytes
+ */
+static size_t findMatch(lz4MatchFinder_t* mf, size_t pos, size_t maxLen, size_t* offset)
+{
+    insertUpTo(mf, pos);
+
+    const uint8_t* cur = &mf->input[pos];
+    size_t bestLen     = LZ4_MIN_MATCH - 1;
+    int32_t cand       = mf->head[hashPosition(cur)];
+
+    for (int depth = 0; cand >= 0 && depth < LZ4_MAX_CHAIN && pos - cand <= LZ4_MAX_OFFSET; depth++)
+    {
+        const uint8_t* ref = &mf->input[cand];
+
+        // Only a match which is longer than the best so far is interesting, so check the byte which would make it so
+        if (ref[bestLen] == cur[bestLen])
+        {
+            size_t l = 0;
+            while (l < maxLen && ref[l] == cur[l])
+            {
+                l++;
+            }
+            if (l > bestLen)
+            {
+                bestLen = l;
+                *offset = pos - cand;
+                if (l == maxLen)
+                {
+                    break;
+                }
+            }
+        }
+        cand = mf->prev[cand];
+    }
+
+    return (bestLen >= LZ4_MIN_MATCH) ? bestLen : 0;
+}
+
+/**
+ * @brief Write the part of a length which didn't fit in the token, as a run of 255s and a smaller final byte
+ *
+ * @param op Where to write the length
+ * @param len The length, minus the ::LZ4_RUN_MASK which was in the token
+ * @return uint8_t* The position after the length
+ */
+static uint8_t* writeLength(uint8_t* op, size_t len)
+{
+    while (len >= 0xFF)
+    {
+        *op++ = 0xFF;
+        len -= 0xFF;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+/**
+ * @brief Write one LZ4 sequence, which is some literals followed by a match
+ *
+ * @param op Where to write the sequence
+ * @param literals The literals
+ * @param litLen The number of literals
+ * @param offset How far back the match is, or 0 for the last sequence which has no match
+ * @param matchLen The length of the match
+ * @return uint8_t* The position after the sequence
+ */
+static uint8_t* writeSequence(uint8_t* op, const uint8_t* literals, size_t litLen, size_t offset, size_t matchLen)
+{
+    size_t mlCode = offset ? matchLen - LZ4_MIN_MATCH : 0;
+
+    uint8_t* token = op++;
+    *token         = ((litLen < LZ4_RUN_MASK) ? litLen : LZ4_RUN_MASK) << 4;
+    if (litLen >= LZ4_RUN_MASK)
+    {
+        op = writeLength(op, litLen - LZ4_RUN_MASK);
+    }
+    memcpy(op, literals, litLen);
+    op += litLen;
+
+    if (offset)
+    {
+        *op++ = offset & 0xFF;
+        *op++ = (offset >> 8) & 0xFF;
+
+        *token |= (mlCode < LZ4_RUN_MASK) ? mlCode : LZ4_RUN_MASK;
+        if (mlCode >= LZ4_RUN_MASK)
+        {
+            op = writeLength(op, mlCode - LZ4_RUN_MASK);
+        }
+    }
+    return op;
+}
+
+/**
+ * @brief Compress bytes into one LZ4 block, using hash chains and lazy matching for a good ratio
+ *
+ * @param input The bytes to compress
+ * @param len The number of bytes to compress
+ * @param output Where to write the block. It must have space for ::LZ4_COMPRESS_BOUND(len) bytes
+ * @return size_t The size of the block, or 0 if memory could not be allocated
+ */
+size_t compressLz4Block(const uint8_t* input, size_t len, uint8_t* output)
+{
+    lz4MatchFinder_t mf = {
+        .input = input,
+        .head  = malloc(sizeof(int32_t) << LZ4_HASH_BITS),
+        .prev  = malloc(sizeof(int32_t) * (len ? len : 1)),
+    };
+    if (NULL == mf.head || NULL == mf.prev)
+    {
+        free(mf.head);
+        free(mf.prev);
+        return 0;
+    }
+    memset(mf.head, 0xFF, sizeof(int32_t) << LZ4_HASH_BITS);
+
+    uint8_t* op   = output;
+    size_t anchor = 0;
+    size_t pos    = 0;
+
+    // Matches may only start up to LZ4_MF_LIMIT bytes from the end, and the last LZ4_LAST_LITERALS are always literals
+    while (len > LZ4_MF_LIMIT && pos <= len - LZ4_MF_LIMIT)
+    {
+        size_t offset   = 0;
+        size_t matchLen = findMatch(&mf, pos, len - LZ4_LAST_LITERALS - pos, &offset);
+        if (0 == matchLen)
+        {
+            pos++;
+            continue;
+        }
+
+        // If the next position has a longer match, it's worth one more literal
+        while (pos + 1 <= len - LZ4_MF_LIMIT)
+        {
+            size_t nextOffset = 0;
+            size_t nextLen    = findMatch(&mf, pos + 1, len - LZ4_LAST_LITERALS - (pos + 1), &nextOffset);
+            if (nextLen <= matchLen)
+            {
+                break;
+            }
+            pos++;
+            matchLen = nextLen;
+            offset   = nextOffset;
+        }
+
+        op = writeSequence(op, &input[anchor], pos - anchor, offset, matchLen);
+        pos += matchLen;
+        anchor = pos;
+    }
+
+    // Finish with the remaining literals
+    op = writeSequence(op, &input[anchor], len - anchor, 0, 0);
+
+    free(mf.head);
+    free(mf.prev);
+    return op - output;
+}
+
+/**
+ * @brief Utility to compress the given bytes with LZ4 and write them to a file handle. LZ4 data is much faster to
+ * decompress than heatshrink data. It can reach much farther back for matches, so it is usually smaller for large
+ * files, but its literals cost more, so it is often a little larger for small files
+ *
+ * @param input The bytes to compress and write to a file
+ * @param len The length of the bytes to compress and write
+ * @param outFile An open file handle to write to
+ * @return true if the file was written
+ * @return false if the input was too large or there was an error
+ */
+bool writeLz4FileHandle(uint8_t* input, uint32_t len, FILE* outFile)
+{
+    if (len > LZ4_ASSET_MAX_SIZE)
+    {
+        fprintf(stderr, "[ERR] %u bytes is too large to compress with LZ4\n", len);
+        return false;
+    }
+
+    uint8_t* output = malloc(LZ4_COMPRESS_BOUND(len));
+    if (NULL == output)
+    {
+        fprintf(stderr, "Couldn't allocate output buffer\n");
+        return false;
+    }
+
+    size_t outputSize = compressLz4Block(input, len, output);
+    if (0 == outputSize)
+    {
+        fprintf(stderr, "Couldn't allocate LZ4 match finder\n");
+        free(output);
+        return false;
+    }
+
+    /* The first byte is the tag, then the three bytes of decompressed size */
+    putc(LZ4_ASSET_TAG, outFile);
+    putc(LO_BYTE(HI_WORD(len)), outFile);
+    putc(HI_BYTE(LO_WORD(len)), outFile);
+    putc(LO_BYTE(LO_WORD(len)), outFile);
+    /* Then dump the compressed bytes */
+    bool ok = (1 == fwrite(output, outputSize, 1, outFile));
+
+    free(output);
+    return ok;
+}
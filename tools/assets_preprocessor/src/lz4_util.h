@@ -0,0 +1,15 @@
+#ifndef _LZ4_UTIL_H_
+#define _LZ4_UTIL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/// @brief The most bytes an LZ4 block of the given size can compress to
+#define LZ4_COMPRESS_BOUND(len) ((len) + ((len) / 255) + 16)
+
+size_t compressLz4Block(const uint8_t* input, size_t len, uint8_t* output);
+bool writeLz4FileHandle(uint8_t* input, uint32_t len, FILE* outFile);
+
+#endif
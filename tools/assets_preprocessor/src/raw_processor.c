@@ -4,7 +4,7 @@
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
-#include "heatshrink_util.h"
+#include "compress_util.h"
 
 #include "raw_processor.h"
 
@@ -21,5 +21,5 @@ const assetProcessor_t heatshrinkProcessor = {
 bool process_heatshrink(processorInput_t* arg)
 {
     // Write the compressed bytes to a file
-    return writeHeatshrinkFileHandle(arg->in.data, arg->in.length, arg->out.file);
+    return writeCompressedFileHandle(arg, "heatshrink.codec", arg->in.data, arg->in.length, arg->out.file);
 }
\ No newline at end of file
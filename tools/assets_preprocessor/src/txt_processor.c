@@ -16,7 +16,7 @@ const assetProcessor_t textProcessor = {
     .type     = FUNCTION,
     .function = process_txt,
     .inFmt    = FMT_TEXT,
-    .outFmt   = FMT_TEXT,
+    .outFmt   = FMT_DATA,
 };
 
 /**
@@ -51,9 +51,11 @@ long remove_chars(char* str, long len, char c)
 bool process_txt(processorInput_t* arg)
 {
     /* Read input file */
-    long newSz        = remove_chars(arg->in.text, arg->in.textSize, '\r');
-    arg->out.text     = arg->in.text;
-    arg->out.textSize = newSz;
+    long newSz = remove_chars(arg->in.text, arg->in.textSize, '\r');
+
+    /* Keep the null terminator, so the text can be used straight from flash */
+    arg->out.data   = (uint8_t*)arg->in.text;
+    arg->out.length = newSz;
 
     return true;
 }
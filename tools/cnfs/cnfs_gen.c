@@ -1,16 +1,61 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
 #include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 int stringcmp(const void* a, const void* b);
 char* filenameToEnumName(const char* filename);
+uint32_t hashFilename(const char* filename, uint32_t hash);
+uint32_t hashData(const uint8_t* data, int len);
 
 #define MAX_FILES     8192
 #define CNFS_PATH_MAX 4096
 
+/// The magic number at the start of a binary CNFS image, "CNFS" when read as bytes
+#define CNFS_BIN_MAGIC 0x53464E43
+
+/// The version of the binary CNFS image format
+#define CNFS_BIN_VERSION 1
+
+/// The size of a binary CNFS image's header, before the file table
+#define CNFS_BIN_HDR_SIZE 24
+
+/// Every file starts on a multiple of this many bytes in cnfs_data[], so data like uncompressed WSGs and structs in bin
+/// files can be used in place instead of copied
+#define CNFS_ALIGN 4
+
+/// All the data required for an input file
+struct fileEntry
+{
+    char* filename;
+    uint8_t* data;
+    int offset;
+    int len;
+    int padLen;
+    uint32_t dataHash; ///< A hash of the file's data, to quickly find files with the same data
+    const char* group; ///< The asset directory this file came from, so files used together are stored together
+    bool isDuplicate;  ///< true if this file shares the data of an earlier file instead of storing its own
+};
+
+/// An asset source file name, and the directory it's in
+struct sourceFile
+{
+    char* stem;  ///< The file name up to its first '.', which is the same for the processed file
+    char* group; ///< The directory the file is in, relative to the source directory
+};
+
+int compareLayout(const void* a, const void* b);
+int compareSources(const void* a, const void* b);
+int findSourceFiles(const char* root, const char* relDir, struct sourceFile* sources, int numSources);
+const char* findGroup(const char* filename, const struct sourceFile* sources, int numSources);
+int writeImageBin(const char* path, uint32_t namesHash, const struct fileEntry* entries, int numFiles,
+                  struct fileEntry* const* layout, int dataSize);
+
 /**
  * @brief Wrapper for strcmp() to be used by qsort()
  *
@@ -75,21 +120,286 @@ char* filenameToEnumName(const char* filename)
     return enumName;
 }
 
+/**
+ * @brief Add a file name to a 32-bit FNV-1a hash of all file names in the image. The emulator compares this against
+ * the hash it was built with to make sure a binary image has the same ::cnfsFileIdx_t for every file
+ *
+ * @param filename The file name to add, including its NUL terminator so "ab" + "c" doesn't hash the same as "a" + "bc"
+ * @param hash The hash of the previous file names, or 0x811C9DC5 for the first one
+ * @return The updated hash
+ */
+uint32_t hashFilename(const char* filename, uint32_t hash)
+{
+    do
+    {
+        hash ^= (uint8_t)*filename;
+        hash *= 0x01000193;
+    } while (*filename++);
+    return hash;
+}
+
+/**
+ * @brief Hash a file's data with 32-bit FNV-1a
+ *
+ * @param data The data to hash
+ * @param len The length of the data
+ * @return The hash
+ */
+uint32_t hashData(const uint8_t* data, int len)
+{
+    uint32_t hash = 0x811C9DC5;
+    for (int i = 0; i < len; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+/**
+ * @brief Compare two files by where they should be stored in cnfs_data[], for qsort(). Files are grouped by the asset
+ * directory they came from, then sorted by name
+ *
+ * @param a A pointer to a pointer to a file
+ * @param b A pointer to a pointer to another file
+ * @return The order of the files
+ */
+int compareLayout(const void* a, const void* b)
+{
+    const struct fileEntry* fa = *(struct fileEntry* const*)a;
+    const struct fileEntry* fb = *(struct fileEntry* const*)b;
+
+    int groupCmp = strcmp(fa->group, fb->group);
+    return groupCmp ? groupCmp : strcmp(fa->filename, fb->filename);
+}
+
+/**
+ * @brief Compare two source files by directory then name, for qsort(), so the directory found for a file doesn't depend
+ * on the order readdir() returns files in
+ *
+ * @param a A source file
+ * @param b Another source file
+ * @return The order of the files
+ */
+int compareSources(const void* a, const void* b)
+{
+    const struct sourceFile* sa = a;
+    const struct sourceFile* sb = b;
+
+    int groupCmp = strcmp(sa->group, sb->group);
+    return groupCmp ? groupCmp : strcmp(sa->stem, sb->stem);
+}
+
+/**
+ * @brief Recursively find every asset source file, and note which directory it's in
+ *
+ * @param root The asset source directory
+ * @param relDir The directory to search, relative to root, or "" for root itself
+ * @param sources [out] Written with the source files
+ * @param numSources The number of source files found so far
+ * @return The number of source files found, including numSources
+ */
+int findSourceFiles(const char* root, const char* relDir, struct sourceFile* sources, int numSources)
+{
+    char path[CNFS_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", root, relDir);
+
+    DIR* dir = opendir(path);
+    if (!dir)
+    {
+        return numSources;
+    }
+
+    struct dirent* dp;
+    while ((dp = readdir(dir)) && numSources < MAX_FILES)
+    {
+        if ('.' == dp->d_name[0])
+        {
+            // Skip ".", "..", and hidden files like ".opts"
+            continue;
+        }
+
+        char relPath[CNFS_PATH_MAX];
+        snprintf(relPath, sizeof(relPath), "%s%s%s", relDir, *relDir ? "/" : "", dp->d_name);
+
+        struct stat st;
+        if (snprintf(path, sizeof(path), "%s/%s", root, relPath) >= (int)sizeof(path) || 0 != stat(path, &st))
+        {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode))
+        {
+            numSources = findSourceFiles(root, relPath, sources, numSources);
+        }
+        else
+        {
+            sources[numSources].stem                           = strdup(dp->d_name);
+            sources[numSources].stem[strcspn(dp->d_name, ".")] = '\0';
+            sources[numSources].group                          = strdup(relDir);
+            numSources++;
+        }
+    }
+    closedir(dir);
+    return numSources;
+}
+
+/**
+ * @brief Find the asset directory a processed file came from. The asset preprocessor replaces the extension, so a
+ * source file matches if the names are the same up to the first '.'
+ *
+ * @param filename The processed file's name
+ * @param sources The source files
+ * @param numSources The number of source files
+ * @return The directory, relative to the asset source directory, or "" if there is no matching source file
+ */
+const char* findGroup(const char* filename, const struct sourceFile* sources, int numSources)
+{
+    size_t stemLen = strcspn(filename, ".");
+    for (int i = 0; i < numSources; i++)
+    {
+        if (strlen(sources[i].stem) == stemLen && !strncmp(sources[i].stem, filename, stemLen))
+        {
+            return sources[i].group;
+        }
+    }
+    return "";
+}
+
+/**
+ * @brief Write a 32-bit value in little-endian order
+ *
+ * @param f The file to write to
+ * @param val The value to write
+ */
+static void writeU32(FILE* f, uint32_t val)
+{
+    uint8_t bytes[4] = {val & 0xFF, (val >> 8) & 0xFF, (val >> 16) & 0xFF, (val >> 24) & 0xFF};
+    fwrite(bytes, 1, sizeof(bytes), f);
+}
+
+/**
+ * @brief Write a binary CNFS image, which the emulator can map instead of the image compiled into it. All values are
+ * little-endian 32-bit integers:
+ *
+ * - ::CNFS_BIN_MAGIC, ::CNFS_BIN_VERSION, the number of files, the hash from hashFilenames(), the offset of the file
+ *   data from the start of the image, and the size of the file data
+ * - The file table, a length and an offset into the file data for each file, the same as \c cnfs_files[]
+ * - The file data, the same as \c cnfs_data[]. Files with the same data share one copy of it
+ *
+ * The image is written to a temporary file which is then renamed, so an emulator which has the old image mapped keeps
+ * seeing the old data instead of a half-written file
+ *
+ * @param path The file to write
+ * @param namesHash The hash of all file names
+ * @param entries The files, with their data and offsets, in ::cnfsFileIdx_t order
+ * @param numFiles The number of files
+ * @param layout The files in the order their data is stored
+ * @param dataSize The size of the file data, including padding
+ * @return 0 for success, a negative number for error
+ */
+int writeImageBin(const char* path, uint32_t namesHash, const struct fileEntry* entries, int numFiles,
+                  struct fileEntry* const* layout, int dataSize)
+{
+    char tmpPath[CNFS_PATH_MAX];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+    FILE* f = fopen(tmpPath, "wb");
+    if (!f)
+    {
+        fprintf(stderr, "Error: cannot open %s\n", tmpPath);
+        return -21;
+    }
+
+    uint32_t dataOffset = CNFS_BIN_HDR_SIZE + numFiles * 8;
+    writeU32(f, CNFS_BIN_MAGIC);
+    writeU32(f, CNFS_BIN_VERSION);
+    writeU32(f, numFiles);
+    writeU32(f, namesHash);
+    writeU32(f, dataOffset);
+    writeU32(f, dataSize);
+
+    for (int i = 0; i < numFiles; i++)
+    {
+        writeU32(f, entries[i].len);
+        writeU32(f, entries[i].offset);
+    }
+
+    static const uint8_t padding[CNFS_ALIGN] = {0};
+    for (int i = 0; i < numFiles; i++)
+    {
+        if (!layout[i]->isDuplicate)
+        {
+            fwrite(layout[i]->data, 1, layout[i]->len, f);
+            fwrite(padding, 1, layout[i]->padLen - layout[i]->len, f);
+        }
+    }
+
+    bool ok = !ferror(f);
+    if (0 != fclose(f) || !ok)
+    {
+        fprintf(stderr, "Error: cannot write %s\n", tmpPath);
+        remove(tmpPath);
+        return -22;
+    }
+
+#ifdef _WIN32
+    // rename() won't replace an existing file on Windows
+    remove(path);
+#endif
+    if (0 != rename(tmpPath, path))
+    {
+        fprintf(stderr, "Error: cannot rename %s to %s\n", tmpPath, path);
+        remove(tmpPath);
+        return -23;
+    }
+    return 0;
+}
+
 /**
  * @brief Main function for cnfs_gen. This converts a folder of files into a cnfs blob
  *
  * @param argc Argument count
- * @param argv Argument values: [program name, input folder, output C file, output H file]
+ * @param argv Argument values: [program name, optional "-s" and asset source folder, input folder, output C file,
+ * output H file, optional output binary image]. The C and H files are not written if they are "-". If the asset
+ * source folder is given, files which came from the same folder in it are stored next to each other
  * @return 0 for success, a negative number for error
  */
 int main(int argc, char** argv)
 {
+    const char* sourceDir = NULL;
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "s:")))
+    {
+        if ('s' == opt)
+        {
+            sourceDir = optarg;
+        }
+        else
+        {
+            fprintf(stderr, "Error: Usage: cnfs_gen [-s assets/] folder/ image.c|- image.h|- [image.bin]\n");
+            return -5;
+        }
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
+
     // Make sure enough arguments are supplied
-    if (argc != 4)
+    if (argc != 4 && argc != 5)
     {
-        fprintf(stderr, "Error: Usage: cnfs_gen folder/ image.c image.h\n");
+        fprintf(stderr, "Error: Usage: cnfs_gen [-s assets/] folder/ image.c|- image.h|- [image.bin]\n");
         return -5;
     }
+    bool writeSource = strcmp(argv[2], "-") && strcmp(argv[3], "-");
+
+    // Find which directory each asset came from
+    static struct sourceFile sources[MAX_FILES];
+    int numSources = 0;
+    if (NULL != sourceDir)
+    {
+        numSources = findSourceFiles(sourceDir, "", sources, 0);
+        qsort(sources, numSources, sizeof(struct sourceFile), compareSources);
+    }
 
     // Open the input directory
     struct dirent* dp;
@@ -117,21 +427,11 @@ int main(int argc, char** argv)
     qsort(filelist, numfiles_in, sizeof(char*), stringcmp);
 
     // A list of all the data required for an input file
-    struct fileEntry
-    {
-        char* filename;
-        uint8_t* data;
-        int offset;
-        int len;
-        int padLen;
-    } entries[MAX_FILES];
+    struct fileEntry entries[MAX_FILES];
 
     // A count of input files
     int nr_file = 0;
 
-    // The offset for the output file
-    int offset = 0;
-
     // For each input file
     for (int fno = 0; fno < numfiles_in; fno++)
     {
@@ -158,7 +458,7 @@ int main(int argc, char** argv)
         struct fileEntry* fe = &entries[nr_file];
         fe->data             = malloc(len);
         fe->len              = len;
-        fe->padLen           = ((len + 3) / 4) * 4;
+        fe->padLen           = ((len + CNFS_ALIGN - 1) / CNFS_ALIGN) * CNFS_ALIGN;
         int readLen          = fread(fe->data, 1, len, f);
         fe->filename         = fname_in;
         if (readLen != fe->len)
@@ -167,10 +467,9 @@ int main(int argc, char** argv)
         }
         else
         {
-            // Save the offset for this file
-            fe->offset = offset;
-            // Move the global offset
-            offset += fe->padLen;
+            fe->dataHash    = hashData(fe->data, fe->len);
+            fe->group       = findGroup(fname_in, sources, numSources);
+            fe->isDuplicate = false;
             // Increment the file IDX
             nr_file++;
         }
@@ -179,139 +478,214 @@ int main(int argc, char** argv)
         fclose(f);
     }
 
-    // Open the output file header
-    FILE* f = fopen(argv[3], "w");
-    if (!f)
-    {
-        fprintf(stderr, "Error: cannot open %s\n", argv[3]);
-        return -19;
-    }
-
-    // Write the output header file
-    fprintf(f, "#pragma once\n");
-    fprintf(f, "\n");
-    fprintf(f, "#include <stdint.h>\n");
-    fprintf(f, "\n");
-    fprintf(f, "typedef struct\n");
-    fprintf(f, "{\n");
-    fprintf(f, "    uint32_t len;    ///< The length of the file\n");
-    fprintf(f, "    uint32_t offset; ///< The offset of the file in cnfs_data[]\n");
-    fprintf(f, "} cnfsFileEntry;\n");
-    fprintf(f, "\n");
-    fprintf(f, "typedef enum\n");
-    fprintf(f, "{\n");
+    // Lay the data out so files from the same asset directory, which are usually loaded together, are next to each
+    // other. The file table stays in name order, so ::cnfsFileIdx_t doesn't change
+    struct fileEntry* layout[MAX_FILES];
     for (int i = 0; i < nr_file; i++)
     {
-        struct fileEntry* fe = &entries[i];
-        char* enumName       = filenameToEnumName(fe->filename);
-        fprintf(f, "    %s = %d, ///< %s\n", enumName, i, fe->filename);
-        free(enumName);
+        layout[i] = &entries[i];
     }
-    fprintf(f, "    %s = %d,\n", "CNFS_NUM_FILES", nr_file);
-    fprintf(f, "} cnfsFileIdx_t;\n");
-    fprintf(f, "\n");
-    fprintf(f, "const uint8_t* getCnfsImage(void);\n");
-    fprintf(f, "int32_t getCnfsSize(void);\n");
-    fprintf(f, "const cnfsFileEntry* getCnfsFiles(void);\n");
-    fclose(f);
+    qsort(layout, nr_file, sizeof(struct fileEntry*), compareLayout);
 
-    // Keep track of the output size, for debugging
-    int directorySize = 0;
+    // The offset for the output file
+    int offset = 0;
 
-    // Get the name of the header without the path
-    char* hdrNoPath = strrchr(argv[3], '/');
-    if (NULL == hdrNoPath)
-    {
-        // Slash not found, use name as-is
-        hdrNoPath = argv[3];
-    }
-    else
+    // Files with the same data, like sprites copied between modes, share one copy of it
+    int numDuplicates = 0;
+    int savedBytes    = 0;
+    for (int i = 0; i < nr_file; i++)
     {
-        // Advance past the slash
-        hdrNoPath++;
-    }
+        struct fileEntry* fe = layout[i];
+        for (int j = 0; j < i; j++)
+        {
+            const struct fileEntry* prev = layout[j];
+            if (!prev->isDuplicate && prev->dataHash == fe->dataHash && prev->len == fe->len
+                && !memcmp(prev->data, fe->data, fe->len))
+            {
+                fe->isDuplicate = true;
+                fe->offset      = prev->offset;
+                numDuplicates++;
+                savedBytes += fe->padLen;
+                break;
+            }
+        }
 
-    // Open the output C file
-    f = fopen(argv[2], "w");
-    if (!f)
-    {
-        fprintf(stderr, "Error: cannot open %s\n", argv[2]);
-        return -20;
+        if (!fe->isDuplicate)
+        {
+            // Save the offset for this file
+            fe->offset = offset;
+            // Move the global offset
+            offset += fe->padLen;
+        }
     }
 
-    // Write the cnfs_files[] array, which is a table of file names, lengths, and offsets
-    fprintf(f, "#include <stdint.h>\n");
-    fprintf(f, "#include \"%s\"\n", hdrNoPath);
-    fprintf(f, "\n");
-    fprintf(f, "/** An array of file lengths and offsets in ::cnfs_data */\n");
-    fprintf(f, "const cnfsFileEntry cnfs_files[CNFS_NUM_FILES] = {\n");
+    // Hash every file name, so the emulator can check that a binary image has the files it was built with
+    uint32_t namesHash = 0x811C9DC5;
     for (int i = 0; i < nr_file; i++)
     {
-        struct fileEntry* fe = entries + i;
-        fprintf(f, "    { .len = %d, .offset = %d },\n", fe->len, fe->offset);
-        directorySize += (((strlen(fe->filename) + 1) + 3) & (~3)) + 12;
+        namesHash = hashFilename(entries[i].filename, namesHash);
     }
-    fprintf(f, "};\n");
-    fprintf(f, "\n");
 
-    // Write the input file data to the output C file
-    fprintf(f, "/** A blob of all file data */\n");
-    fprintf(f, "const uint8_t cnfs_data[%d] = {\n\t", offset);
-    int ki = 0;
-    for (int i = 0; i < nr_file; i++)
+    // Keep track of the output size, for debugging
+    int directorySize = 0;
+
+    if (writeSource)
     {
-        struct fileEntry* fe = entries + i;
-        int k;
-        for (k = 0; k < fe->padLen; k++)
+        // Open the output file header
+        FILE* f = fopen(argv[3], "w");
+        if (!f)
+        {
+            fprintf(stderr, "Error: cannot open %s\n", argv[3]);
+            return -19;
+        }
+
+        // Write the output header file
+        fprintf(f, "#pragma once\n");
+        fprintf(f, "\n");
+        fprintf(f, "#include <stdint.h>\n");
+        fprintf(f, "\n");
+        fprintf(f, "typedef struct\n");
+        fprintf(f, "{\n");
+        fprintf(f, "    uint32_t len;    ///< The length of the file\n");
+        fprintf(f, "    uint32_t offset; ///< The offset of the file in cnfs_data[]\n");
+        fprintf(f, "} cnfsFileEntry;\n");
+        fprintf(f, "\n");
+        fprintf(f, "typedef enum\n");
+        fprintf(f, "{\n");
+        for (int i = 0; i < nr_file; i++)
+        {
+            struct fileEntry* fe = &entries[i];
+            char* enumName       = filenameToEnumName(fe->filename);
+            fprintf(f, "    %s = %d, ///< %s\n", enumName, i, fe->filename);
+            free(enumName);
+        }
+        fprintf(f, "    %s = %d,\n", "CNFS_NUM_FILES", nr_file);
+        fprintf(f, "} cnfsFileIdx_t;\n");
+        fprintf(f, "\n");
+        fprintf(f, "/// A hash of all file names. A binary CNFS image must match it to be used instead of this one\n");
+        fprintf(f, "#define CNFS_NAMES_HASH 0x%08XU\n", namesHash);
+        fprintf(f, "\n");
+        fprintf(f, "const uint8_t* getCnfsImage(void);\n");
+        fprintf(f, "int32_t getCnfsSize(void);\n");
+        fprintf(f, "const cnfsFileEntry* getCnfsFiles(void);\n");
+        fclose(f);
+
+        // Get the name of the header without the path
+        char* hdrNoPath = strrchr(argv[3], '/');
+        if (NULL == hdrNoPath)
+        {
+            // Slash not found, use name as-is
+            hdrNoPath = argv[3];
+        }
+        else
         {
-            uint8_t val = 0x00;
-            if (k < fe->len)
+            // Advance past the slash
+            hdrNoPath++;
+        }
+
+        // Open the output C file
+        f = fopen(argv[2], "w");
+        if (!f)
+        {
+            fprintf(stderr, "Error: cannot open %s\n", argv[2]);
+            return -20;
+        }
+
+        // Write the cnfs_files[] array, which is a table of file names, lengths, and offsets
+        fprintf(f, "#include <stdint.h>\n");
+        fprintf(f, "#include \"%s\"\n", hdrNoPath);
+        fprintf(f, "\n");
+        fprintf(f, "/** An array of file lengths and offsets in ::cnfs_data */\n");
+        fprintf(f, "const cnfsFileEntry cnfs_files[CNFS_NUM_FILES] = {\n");
+        for (int i = 0; i < nr_file; i++)
+        {
+            struct fileEntry* fe = entries + i;
+            fprintf(f, "    { .len = %d, .offset = %d },\n", fe->len, fe->offset);
+            directorySize += (((strlen(fe->filename) + 1) + 3) & (~3)) + 12;
+        }
+        fprintf(f, "};\n");
+        fprintf(f, "\n");
+
+        // Write the input file data to the output C file, aligned so files can be used in place
+        fprintf(f, "/** A blob of all file data */\n");
+        fprintf(f, "const uint8_t cnfs_data[%d] __attribute__((aligned(%d))) = {\n\t", offset, CNFS_ALIGN);
+        int ki = 0;
+        for (int i = 0; i < nr_file; i++)
+        {
+            struct fileEntry* fe = layout[i];
+            if (fe->isDuplicate)
             {
-                val = fe->data[k];
+                continue;
             }
-            fprintf(f, "0x%02X%s", val, (k == fe->padLen - 1 || ((ki & 0xf) == 0xf)) ? ",\n\t" : ", ");
-            ki++;
+            int k;
+            for (k = 0; k < fe->padLen; k++)
+            {
+                uint8_t val = 0x00;
+                if (k < fe->len)
+                {
+                    val = fe->data[k];
+                }
+                fprintf(f, "0x%02X%s", val, (k == fe->padLen - 1 || ((ki & 0xf) == 0xf)) ? ",\n\t" : ", ");
+                ki++;
+            }
+        }
+        fprintf(f, "\n};\n");
+        fprintf(f, "\n");
+
+        // Write some helper functions
+        fprintf(f, "/**\n");
+        fprintf(f, " * @brief Return the entire CNFS image\n");
+        fprintf(f, " * \n");
+        fprintf(f, " * @return The cnfs_data[] array\n");
+        fprintf(f, " */\n");
+        fprintf(f, "const uint8_t* getCnfsImage(void)\n");
+        fprintf(f, "{\n");
+        fprintf(f, "    return cnfs_data;\n");
+        fprintf(f, "}\n");
+        fprintf(f, "\n");
+        fprintf(f, "/**\n");
+        fprintf(f, " * @brief Get the size of the entire CNFS image\n");
+        fprintf(f, " * \n");
+        fprintf(f, " * @return The size of cnfs_data[]\n");
+        fprintf(f, " */\n");
+        fprintf(f, "int32_t getCnfsSize(void)\n");
+        fprintf(f, "{\n");
+        fprintf(f, "    return sizeof(cnfs_data);\n");
+        fprintf(f, "}\n");
+        fprintf(f, "\n");
+        fprintf(f, "/**\n");
+        fprintf(f, " * @brief Get the CNFS file data (length & offset)\n");
+        fprintf(f, " * \n");
+        fprintf(f, " * @return The cnfs_files[] array with file lengths and offsets, indexed by ::cnfsFileIdx_t\n");
+        fprintf(f, " */\n");
+        fprintf(f, "const cnfsFileEntry* getCnfsFiles(void)\n");
+        fprintf(f, "{\n");
+        fprintf(f, "    return cnfs_files;\n");
+        fprintf(f, "}\n");
+
+        fclose(f);
+    }
+
+    // Write the binary image, if requested
+    if (5 == argc)
+    {
+        int err = writeImageBin(argv[4], namesHash, entries, nr_file, layout, offset);
+        if (err)
+        {
+            return err;
         }
     }
-    fprintf(f, "\n};\n");
-    fprintf(f, "\n");
-
-    // Write some helper functions
-    fprintf(f, "/**\n");
-    fprintf(f, " * @brief Return the entire CNFS image\n");
-    fprintf(f, " * \n");
-    fprintf(f, " * @return The cnfs_data[] array\n");
-    fprintf(f, " */\n");
-    fprintf(f, "const uint8_t* getCnfsImage(void)\n");
-    fprintf(f, "{\n");
-    fprintf(f, "    return cnfs_data;\n");
-    fprintf(f, "}\n");
-    fprintf(f, "\n");
-    fprintf(f, "/**\n");
-    fprintf(f, " * @brief Get the size of the entire CNFS image\n");
-    fprintf(f, " * \n");
-    fprintf(f, " * @return The size of cnfs_data[]\n");
-    fprintf(f, " */\n");
-    fprintf(f, "int32_t getCnfsSize(void)\n");
-    fprintf(f, "{\n");
-    fprintf(f, "    return sizeof(cnfs_data);\n");
-    fprintf(f, "}\n");
-    fprintf(f, "\n");
-    fprintf(f, "/**\n");
-    fprintf(f, " * @brief Get the CNFS file data (length & offset)\n");
-    fprintf(f, " * \n");
-    fprintf(f, " * @return The cnfs_files[] array with file lengths and offsets, indexed by ::cnfsFileIdx_t\n");
-    fprintf(f, " */\n");
-    fprintf(f, "const cnfsFileEntry* getCnfsFiles(void)\n");
-    fprintf(f, "{\n");
-    fprintf(f, "    return cnfs_files;\n");
-    fprintf(f, "}\n");
-
-    fclose(f);
 
     // Debug print
     printf("Image size: %d bytes\n", offset);
-    printf("Directory size: %d bytes\n", directorySize);
+    if (numDuplicates)
+    {
+        printf("Duplicates: %d files share data with another file, saving %d bytes\n", numDuplicates, savedBytes);
+    }
+    if (writeSource)
+    {
+        printf("Directory size: %d bytes\n", directorySize);
+    }
 
     // Free everything
     for (int idx = 0; idx < numfiles_in; idx++)
@@ -319,6 +693,11 @@ int main(int argc, char** argv)
         free(entries[idx].data);
         free(filelist[idx]);
     }
+    for (int idx = 0; idx < numSources; idx++)
+    {
+        free(sources[idx].stem);
+        free(sources[idx].group);
+    }
 
     return 0;
 }
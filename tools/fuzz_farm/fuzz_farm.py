@@ -0,0 +1,553 @@
+#!/usr/bin/env python3
+"""
+Coverage-guided fuzz farm for Swadge modes.
+
+Runs many headless emulators in parallel against one mode. Each run either fuzzes from scratch with the emulator's
+fuzzer and records its inputs, or plays back a mutation of a recording which reached new code before. Coverage comes
+from the .gcda files written by an emulator built with `make ENABLE_GCOV=true`, one directory per run through
+GCOV_PREFIX. Recordings which reach new arcs are kept in the corpus, crashes are saved as replays along with whether
+they reproduce, and coverage over time is written to coverage.csv. See README.md for details.
+"""
+
+import argparse
+import csv
+import hashlib
+import os
+import random
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+from concurrent.futures import FIRST_COMPLETED, ThreadPoolExecutor, wait
+
+# ==============================================================================
+# Replay files, see emulator/src/extensions/replay/ext_replay.c
+# ==============================================================================
+
+BINARY_MAGIC = b"SWRP"
+BINARY_VERSION = 2
+INDEX_TAG = 0xFF
+
+# The entry types, in the same order as replayLogType_t
+BTN_DOWN, BTN_UP, TOUCH_PHI, TOUCH_R, TOUCH_I, ACCEL_X, ACCEL_Y, ACCEL_Z, FUZZ, QUIT, SCREENSHOT, SET_MODE, SEED, \
+    COMMAND = range(14)
+
+# Entries which are inputs, and so are mutated
+INPUT_TYPES = (BTN_DOWN, BTN_UP, TOUCH_PHI, TOUCH_R, TOUCH_I, ACCEL_X, ACCEL_Y, ACCEL_Z)
+
+# The buttons the emulator's fuzzer presses, i.e. everything but Select, which could leave the mode
+FUZZ_BUTTONS = [1 << bit for bit in range(7)]
+
+
+def readVarint(data: bytes, pos: int):
+    val = 0
+    shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        val |= (b & 0x7F) << shift
+        shift += 7
+        if not (b & 0x80):
+            return val, pos
+
+
+def readSigned(data: bytes, pos: int):
+    zigzag, pos = readVarint(data, pos)
+    return (zigzag >> 1) ^ -(zigzag & 1), pos
+
+
+def writeVarint(out: bytearray, val: int):
+    while True:
+        b = val & 0x7F
+        val >>= 7
+        out.append((b | 0x80) if val else b)
+        if not val:
+            return
+
+
+def writeSigned(out: bytearray, val: int):
+    writeVarint(out, (val << 1) ^ (val >> 63))
+
+
+def readReplay(path: str) -> list:
+    """
+    Read the entries of a binary recording as a list of (time, type, value) tuples. A recording cut short by a crash
+    is read up to its last whole entry
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != BINARY_MAGIC or len(data) < 5:
+        raise ValueError(f"{path} is not a binary recording, convert it with --convert-replay first")
+
+    entries = []
+    pos = 5
+    lastTime = 0
+    try:
+        while pos < len(data) and data[pos] != INDEX_TAG:
+            etype = data[pos]
+            delta, pos = readSigned(data, pos + 1)
+            lastTime += delta
+            if etype in (BTN_DOWN, BTN_UP, SEED):
+                val, pos = readVarint(data, pos)
+            elif etype in INPUT_TYPES:
+                val, pos = readSigned(data, pos)
+            elif etype in (SCREENSHOT, SET_MODE, COMMAND):
+                length, pos = readVarint(data, pos)
+                if pos + length > len(data):
+                    break
+                val = data[pos:pos + length].decode("utf-8", "replace")
+                pos += length
+            elif etype in (FUZZ, QUIT):
+                val = None
+            else:
+                break
+            entries.append((lastTime, etype, val))
+    except IndexError:
+        # The last entry was cut off
+        pass
+    return entries
+
+
+def writeReplay(path: str, entries: list):
+    """
+    Write (time, type, value) entries as a binary recording. It has no index, so seeking in it is slower, but it plays
+    back the same
+    """
+    out = bytearray(BINARY_MAGIC)
+    out.append(BINARY_VERSION)
+    lastTime = 0
+    for etime, etype, val in entries:
+        out.append(etype)
+        writeSigned(out, etime - lastTime)
+        lastTime = etime
+        if etype in (BTN_DOWN, BTN_UP, SEED):
+            writeVarint(out, val)
+        elif etype in INPUT_TYPES:
+            writeSigned(out, val)
+        elif etype in (SCREENSHOT, SET_MODE, COMMAND):
+            encoded = val.encode("utf-8")
+            writeVarint(out, len(encoded))
+            out += encoded
+    with open(path, "wb") as f:
+        f.write(out)
+
+
+class Input:
+    """
+    A replayable input, which is the seed the run was started with and the recorded input entries. Anything else in
+    a recording, like the mode it was started in, is given on the command line instead
+    """
+
+    def __init__(self, seed: int, entries: list):
+        self.seed = seed
+        self.entries = entries
+
+    @staticmethod
+    def fromReplay(path: str, seed: int = None):
+        entries = readReplay(path)
+        for _, etype, val in entries:
+            if seed is None and etype == SEED:
+                seed = val
+        return Input(seed if seed is not None else 0, [e for e in entries if e[1] in INPUT_TYPES])
+
+    def save(self, path: str):
+        writeReplay(path, [(0, SEED, self.seed)] + self.entries)
+
+    def length(self) -> int:
+        """The time of the last entry, in microseconds"""
+        return self.entries[-1][0] if self.entries else 0
+
+
+# ==============================================================================
+# Coverage, from the .gcda files written by -fprofile-arcs
+# ==============================================================================
+
+GCDA_MAGIC = 0x67636461
+TAG_FUNCTION = 0x01000000
+TAG_ARCS = 0x01A10000
+
+
+def readGcda(path: str, name: str, arcs: set):
+    """
+    Add every arc which was taken at least once to a set, as (name, function ident, counter index)
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < 12:
+        return
+    magic, version = struct.unpack_from("<II", data, 0)
+    if magic != GCDA_MAGIC:
+        return
+
+    # The version is like "B22*" for GCC 12.2. Starting with GCC 12, record lengths are in bytes instead of words,
+    # there's a checksum in the header, and counters which are all zero are written as a negative length without data
+    v = version.to_bytes(4, "big").decode("ascii", "replace")
+    major = int(v[0]) if v[0].isdigit() else (ord(v[0]) - ord("A")) * 10 + int(v[1])
+    byteLengths = major >= 12
+    pos = 16 if byteLengths else 12
+
+    ident = None
+    while pos + 8 <= len(data):
+        tag, length = struct.unpack_from("<Ii", data, pos)
+        pos += 8
+        if not byteLengths:
+            length *= 4
+
+        if tag == TAG_FUNCTION:
+            ident = struct.unpack_from("<I", data, pos)[0] if length >= 4 else None
+        elif tag == TAG_ARCS and ident is not None and length > 0:
+            counts = struct.unpack_from(f"<{length // 8}q", data, pos)
+            arcs.update((name, ident, i) for i, count in enumerate(counts) if count)
+
+        if length > 0:
+            pos += length
+
+
+def readCoverage(gcovDir: str) -> set:
+    """Read the arcs from every .gcda file written under a GCOV_PREFIX"""
+    arcs = set()
+    for root, _, files in os.walk(gcovDir):
+        for fname in files:
+            if fname.endswith(".gcda"):
+                path = os.path.join(root, fname)
+                readGcda(path, os.path.relpath(path, gcovDir), arcs)
+    return arcs
+
+
+# ==============================================================================
+# Mutation
+# ==============================================================================
+
+class Mutator:
+    """Makes new inputs from the corpus by changing, removing, repeating, and splicing input entries"""
+
+    def __init__(self, rng: random.Random, frameUs: int):
+        self.rng = rng
+        self.frameUs = frameUs
+        # The range of values seen for each input type, so new values are plausible
+        self.ranges = {TOUCH_PHI: (0, 359), TOUCH_R: (0, 1024), TOUCH_I: (0, (1 << 18) - 1)}
+
+    def learn(self, entries: list):
+        for _, etype, val in entries:
+            if etype in (ACCEL_X, ACCEL_Y, ACCEL_Z, TOUCH_PHI, TOUCH_R, TOUCH_I):
+                lo, hi = self.ranges.get(etype, (val, val))
+                self.ranges[etype] = (min(lo, val), max(hi, val))
+
+    def randomValue(self, etype: int) -> int:
+        if etype in (BTN_DOWN, BTN_UP):
+            return self.rng.choice(FUZZ_BUTTONS)
+        lo, hi = self.ranges.get(etype, (-256, 256))
+        return self.rng.randint(lo, hi)
+
+    def randomWindow(self, length: int):
+        start = self.rng.randrange(0, max(length, 1))
+        span = self.frameUs * self.rng.choice((1, 2, 4, 8, 16, 48, 120))
+        return start, span
+
+    def mutate(self, parent: Input, other: Input) -> Input:
+        entries = list(parent.entries)
+        seed = parent.seed
+
+        for _ in range(self.rng.randint(1, 4)):
+            length = max((e[0] for e in entries), default=0)
+            start, span = self.randomWindow(length)
+            op = self.rng.randrange(7)
+
+            if op == 0:
+                # Drop a window of input
+                entries = [e for e in entries if not (start <= e[0] < start + span)]
+            elif op == 1:
+                # Repeat a window of input, pushing everything after it later
+                window = [(t + span, ty, v) for t, ty, v in entries if start <= t < start + span]
+                entries = [(t + span if t >= start + span else t, ty, v) for t, ty, v in entries] + window
+            elif op == 2:
+                # Make everything after a point happen sooner, dropping what it overlaps
+                entries = [e for e in entries if not (start - span <= e[0] < start)]
+                entries = [(max(t - span, 0) if t >= start else t, ty, v) for t, ty, v in entries]
+            elif op == 3 and entries:
+                # Change the values of a few entries
+                for _ in range(self.rng.randint(1, 8)):
+                    i = self.rng.randrange(len(entries))
+                    t, ty, _ = entries[i]
+                    entries[i] = (t, ty, self.randomValue(ty))
+            elif op == 4:
+                # Press a few buttons
+                for _ in range(self.rng.randint(1, 6)):
+                    button = self.rng.choice(FUZZ_BUTTONS)
+                    t = self.rng.randrange(0, length + self.frameUs * 24)
+                    hold = self.frameUs * self.rng.randint(1, 48)
+                    entries += [(t, BTN_DOWN, button), (t + hold, BTN_UP, button)]
+            elif op == 5 and other.entries:
+                # Continue with another input from the same point
+                entries = [e for e in entries if e[0] < start] + [e for e in other.entries if e[0] >= start]
+            elif op == 6:
+                # Run with a different seed, so the mode's random numbers change
+                seed = self.rng.randrange(1, 1 << 31)
+
+        entries.sort(key=lambda e: e[0])
+        return Input(seed, entries)
+
+
+# ==============================================================================
+# Running the emulator
+# ==============================================================================
+
+class RunResult:
+    def __init__(self):
+        self.status = "ok"  # "ok", "crash", or "hang"
+        self.returncode = 0
+        self.arcs = set()
+        self.input = None
+        self.log = ""
+        self.crashDump = ""
+        self.reproduced = None
+        self.fresh = False
+        self.existing = None
+
+
+class Farm:
+    def __init__(self, args):
+        self.args = args
+        self.emulator = os.path.abspath(args.emulator if os.path.isfile(args.emulator) else shutil.which(args.emulator))
+        self.out = os.path.abspath(args.out)
+        self.corpusDir = os.path.join(self.out, "corpus")
+        self.crashDir = os.path.join(self.out, "crashes")
+        self.hangDir = os.path.join(self.out, "hangs")
+        self.workDir = os.path.join(self.out, "work")
+        for d in (self.corpusDir, self.crashDir, self.hangDir, self.workDir):
+            os.makedirs(d, exist_ok=True)
+
+        self.rng = random.Random(args.seed)
+        self.frameUs = int(1000000 / args.fps)
+        self.mutator = Mutator(self.rng, self.frameUs)
+
+        self.arcs = set()
+        self.corpus = []  # (Input, weight)
+        self.nextId = 1
+        self.crashSignatures = {}
+        self.runs = 0
+        self.crashes = 0
+        self.hangs = 0
+        self.warnedNoCoverage = False
+        self.startTime = time.monotonic()
+
+    def baseCommand(self, seed: int) -> list:
+        return [self.emulator, "--headless", "--max-speed", "--fake-fps", str(self.args.fps), "--lock",
+                "--mode", self.args.mode, "--seed", str(seed)]
+
+    def reproCommand(self, path: str, seed: int) -> str:
+        return (f'swadge_emulator --mode "{self.args.mode}" --lock --seed {seed} --fake-time --fake-fps {self.args.fps}'
+                f' --playback {path}')
+
+    def execute(self, cmd: list, runDir: str, result: RunResult):
+        """Run one emulator in its own directory, so each run starts with fresh NVS and writes its own coverage"""
+        gcovDir = os.path.join(runDir, "gcov")
+        env = dict(os.environ, GCOV_PREFIX=gcovDir)
+        logPath = os.path.join(runDir, "log.txt")
+        with open(logPath, "wb") as log:
+            try:
+                proc = subprocess.run(cmd, cwd=runDir, env=env, stdin=subprocess.DEVNULL, stdout=log,
+                                      stderr=subprocess.STDOUT, timeout=self.args.timeout)
+                result.returncode = proc.returncode
+                result.status = "ok" if 0 == proc.returncode else "crash"
+            except subprocess.TimeoutExpired:
+                result.status = "hang"
+        with open(logPath, "rb") as log:
+            result.log = log.read()[-8192:].decode("utf-8", "replace")
+        for fname in os.listdir(runDir):
+            if fname.startswith("crash-") and fname.endswith(".txt"):
+                with open(os.path.join(runDir, fname), "r", errors="replace") as f:
+                    result.crashDump += f.read()
+        result.arcs = readCoverage(gcovDir)
+
+    def run(self, inp: Input, seed: int, existing: str = None) -> RunResult:
+        """Fuzz from scratch with a seed if inp is None, or else play back inp. This is called from worker threads"""
+        result = RunResult()
+        result.existing = existing
+        runDir = tempfile.mkdtemp(dir=self.workDir)
+        try:
+            replayPath = os.path.join(runDir, "input.rpl")
+            if inp is None:
+                result.fresh = True
+                cmd = self.baseCommand(seed) + ["--fuzz", "--record", replayPath,
+                                                "--quit-after", str(self.args.run_time)]
+            else:
+                inp.save(replayPath)
+                seed = inp.seed
+                cmd = self.baseCommand(seed) + ["--playback", replayPath,
+                                                "--quit-after", str(inp.length() / 1000000 + 1)]
+
+            self.execute(cmd, runDir, result)
+
+            if os.path.exists(replayPath):
+                result.input = Input.fromReplay(replayPath, seed)
+            else:
+                result.input = Input(seed, [])
+
+            if "crash" == result.status:
+                # Check that the saved input reproduces the crash, since a recording may miss the last frame's input
+                verifyDir = tempfile.mkdtemp(dir=self.workDir)
+                try:
+                    verifyPath = os.path.join(verifyDir, "input.rpl")
+                    result.input.save(verifyPath)
+                    verify = RunResult()
+                    self.execute(self.baseCommand(seed) + ["--playback", verifyPath, "--quit-after",
+                                                           str(result.input.length() / 1000000 + 1)],
+                                 verifyDir, verify)
+                    result.reproduced = ("crash" == verify.status)
+                finally:
+                    shutil.rmtree(verifyDir, ignore_errors=True)
+        finally:
+            shutil.rmtree(runDir, ignore_errors=True)
+        return result
+
+    def nextInput(self):
+        """Pick what the next run does, as the input to play back, or None to fuzz from scratch, and a seed"""
+        if not self.corpus or self.rng.random() < self.args.fresh:
+            return None, self.rng.randrange(1, 1 << 31)
+        inputs = [c[0] for c in self.corpus]
+        weights = [c[1] for c in self.corpus]
+        parent, other = self.rng.choices(inputs, weights, k=2)
+        child = self.mutator.mutate(parent, other)
+        return child, child.seed
+
+    def crashSignature(self, result: RunResult) -> str:
+        """Identify a crash by its sanitizer report or backtrace, so each bug is only saved once"""
+        lines = [line for line in result.log.splitlines()
+                 if "ERROR: AddressSanitizer" in line or "runtime error:" in line or line.lstrip().startswith("#")]
+        lines += [line for line in result.crashDump.splitlines() if line.startswith(("Signal", "addr2line"))]
+        key = f"{result.returncode}\n" + "\n".join(lines[:8])
+        return hashlib.sha1(key.encode()).hexdigest()[:12]
+
+    def handle(self, result: RunResult):
+        """Merge one run's result into the farm. This is only called from the main thread"""
+        self.runs += 1
+        if result.input is not None:
+            self.mutator.learn(result.input.entries)
+
+        if "ok" == result.status and not result.arcs and not self.warnedNoCoverage:
+            self.warnedNoCoverage = True
+            print("WARNING: No coverage was written. Build the emulator with `make ENABLE_GCOV=true`", file=sys.stderr)
+
+        newArcs = result.arcs - self.arcs
+        self.arcs |= newArcs
+        if result.existing:
+            # Inputs already in the corpus stay there, even if earlier ones covered the same arcs
+            self.corpus.append((result.input, 1 + len(newArcs)))
+        elif newArcs and "hang" != result.status:
+            self.corpus.append((result.input, 1 + len(newArcs)))
+            path = os.path.join(self.corpusDir, f"cov-{self.nextId:06d}.rpl")
+            self.nextId += 1
+            result.input.save(path)
+            self.report(f"+{len(newArcs)} arcs from {'fuzzing' if result.fresh else 'mutation'}, saved {path}")
+
+        if "crash" == result.status:
+            self.crashes += 1
+            sig = self.crashSignature(result)
+            if sig not in self.crashSignatures:
+                base = os.path.join(self.crashDir, f"crash-{sig}")
+                self.crashSignatures[sig] = base + ".rpl"
+                result.input.save(base + ".rpl")
+                with open(base + ".txt", "w") as f:
+                    f.write(f"Exit code: {result.returncode}\n")
+                    f.write(f"Reproduces: {'yes' if result.reproduced else 'no'}\n")
+                    f.write(f"Replay: {self.reproCommand(base + '.rpl', result.input.seed)}\n\n")
+                    f.write(result.crashDump + "\n" + result.log)
+                self.report(f"new crash ({'reproduces' if result.reproduced else 'does not reproduce'}), "
+                            f"saved {base}.rpl")
+        elif "hang" == result.status:
+            self.hangs += 1
+            result.input.save(os.path.join(self.hangDir, f"hang-{self.hangs:04d}.rpl"))
+
+    def report(self, event: str = None):
+        elapsed = time.monotonic() - self.startTime
+        line = (f"[{elapsed:7.0f}s] runs {self.runs} ({self.runs / max(elapsed, 1):.2f}/s), arcs {len(self.arcs)}, "
+                f"corpus {len(self.corpus)}, crashes {self.crashes} ({len(self.crashSignatures)} unique), "
+                f"hangs {self.hangs}")
+        print(line + (f": {event}" if event else ""), flush=True)
+
+        statsPath = os.path.join(self.out, "coverage.csv")
+        newFile = not os.path.exists(statsPath)
+        with open(statsPath, "a", newline="") as f:
+            writer = csv.writer(f)
+            if newFile:
+                writer.writerow(["seconds", "runs", "arcs", "corpus", "crashes", "unique_crashes", "hangs"])
+            writer.writerow([round(elapsed, 1), self.runs, len(self.arcs), len(self.corpus), self.crashes,
+                             len(self.crashSignatures), self.hangs])
+
+    def loop(self):
+        # Start by replaying an existing corpus, so an interrupted farm picks up where it left off
+        pending = []
+        for fname in sorted(os.listdir(self.corpusDir)):
+            if fname.endswith(".rpl"):
+                path = os.path.join(self.corpusDir, fname)
+                pending.append((Input.fromReplay(path), path))
+                if fname.startswith("cov-") and fname[4:-4].isdigit():
+                    self.nextId = max(self.nextId, int(fname[4:-4]) + 1)
+        if pending:
+            print(f"Replaying {len(pending)} corpus inputs")
+
+        lastReport = time.monotonic()
+        with ThreadPoolExecutor(max_workers=self.args.jobs) as pool:
+            running = set()
+            try:
+                while True:
+                    timeUp = self.args.duration and time.monotonic() - self.startTime >= self.args.duration
+                    runsUp = self.args.runs and self.runs + len(running) >= self.args.runs
+                    while not timeUp and not runsUp and len(running) < self.args.jobs:
+                        if pending:
+                            inp, path = pending.pop(0)
+                            running.add(pool.submit(self.run, inp, inp.seed, path))
+                        else:
+                            running.add(pool.submit(self.run, *self.nextInput()))
+                        runsUp = self.args.runs and self.runs + len(running) >= self.args.runs
+                    if not running:
+                        break
+
+                    done, running = wait(running, timeout=1, return_when=FIRST_COMPLETED)
+                    for future in done:
+                        self.handle(future.result())
+
+                    if time.monotonic() - lastReport >= self.args.report:
+                        lastReport = time.monotonic()
+                        self.report()
+            except KeyboardInterrupt:
+                print("Stopping, waiting for running emulators to exit")
+                for future in running:
+                    future.cancel()
+
+        self.report("done")
+        for sig, path in self.crashSignatures.items():
+            print(f"Crash {sig}: {path}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Coverage-guided fuzz farm for Swadge modes")
+    parser.add_argument("--mode", required=True, help="The name of the mode to fuzz, see --modes-list")
+    parser.add_argument("--emulator", default="swadge_emulator",
+                        help="The emulator to run, built with `make ENABLE_GCOV=true`")
+    parser.add_argument("--out", default="fuzz_out", help="Where to write the corpus, crashes, and coverage.csv")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="How many emulators to run at once")
+    parser.add_argument("--duration", type=float, default=0, help="How many seconds to fuzz for, or 0 for no limit")
+    parser.add_argument("--runs", type=int, default=0, help="How many runs to do, or 0 for no limit")
+    parser.add_argument("--run-time", type=float, default=30,
+                        help="How many seconds of emulated time each fuzzing run lasts")
+    parser.add_argument("--timeout", type=float, default=120,
+                        help="How many real seconds a run may take before it counts as a hang")
+    parser.add_argument("--fps", type=float, default=24, help="The fake frame rate to run at")
+    parser.add_argument("--fresh", type=float, default=0.2,
+                        help="The fraction of runs which fuzz from scratch instead of mutating the corpus")
+    parser.add_argument("--report", type=float, default=10, help="How often to print and log coverage, in seconds")
+    parser.add_argument("--seed", type=int, default=None, help="Seed the farm's choices, for a repeatable farm")
+    args = parser.parse_args()
+
+    if not os.path.isfile(args.emulator) and not shutil.which(args.emulator):
+        parser.error(f"Can't find the emulator '{args.emulator}'")
+
+    Farm(args).loop()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,701 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <ftw.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <esp_heap_caps.h>
+
+#include "midiPlayer.h"
+#include "midiFileParser.h"
+#include "heatshrink_helper.h"
+#include "hdw-dac.h"
+#include "macros.h"
+#include "cnfs.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The longest song which will be rendered, in seconds, unless changed with -t
+#define DEFAULT_MAX_SECONDS 600
+
+/// The size of a canonical WAV header, in bytes
+#define WAV_HEADER_SIZE 44
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief The outcome of rendering one song. This is written by worker processes and read back through a pipe, so it
+ * must not contain pointers
+ */
+typedef struct
+{
+    bool loaded;             ///< true if the file was a MIDI file and was rendered
+    bool truncated;          ///< true if the song was cut off at the maximum length
+    uint64_t samples;        ///< The number of samples rendered
+    int64_t renderUs;        ///< The time spent in midiPlayerFillBuffer(), in microseconds
+    int64_t maxBlockUs;      ///< The longest time spent rendering one DAC buffer, in microseconds
+    uint32_t clipped;        ///< The number of samples which were clipped
+    uint8_t peakPoolVoices;  ///< The most pooled voices sounding at once
+    uint8_t peakPercVoices;  ///< The most percussion voices sounding at once
+    uint32_t stolenNotes;    ///< The number of notes cut off to make room for new notes
+    bool goldenChecked;      ///< true if the output was compared to a golden WAV
+    uint64_t goldenMismatch; ///< The number of samples which differ from the golden WAV, including missing ones
+    uint8_t goldenMaxDiff;   ///< The largest difference from any golden sample
+} renderResult_t;
+
+//==============================================================================
+// Function declarations
+//==============================================================================
+
+int64_t esp_timer_get_time(void);
+static void printUsage(void);
+static bool isMidiFile(const char* path);
+static int collectFile(const char* path, const struct stat* st, int tflag);
+static int compareStrings(const void* a, const void* b);
+static uint8_t* readFile(const char* path, size_t* size);
+static uint8_t* readWav(const char* path, uint32_t* numSamples);
+static bool writeWav(const char* path, const uint8_t* samples, uint32_t numSamples);
+static void makeOutputPath(char* out, size_t outLen, const char* dir, const char* midiPath);
+static void countVoices(const midiPlayer_t* player, renderResult_t* result);
+static void renderSong(const char* path, renderResult_t* result);
+static void renderAll(void);
+static void printResult(const char* path, const renderResult_t* result);
+
+//==============================================================================
+// Variables
+//==============================================================================
+
+/// The MIDI files to render, in the order they were found
+static char** songPaths = NULL;
+static size_t numSongs  = 0;
+
+/// The directory to write WAV files to, or NULL to not write them
+static const char* outDirName = NULL;
+
+/// The directory to read golden WAV files from, or NULL to not compare
+static const char* goldenDirName = NULL;
+
+/// The number of songs rendered at once
+static long numJobs = 1;
+
+/// The longest song which will be rendered, in samples
+static uint64_t maxSamples = (uint64_t)DEFAULT_MAX_SECONDS * DAC_SAMPLE_RATE_HZ;
+
+/// The number of pooled voices songs are rendered with
+static uint8_t voiceBudget = POOL_VOICE_COUNT;
+
+/// The results of every song, indexed like songPaths
+static renderResult_t* results = NULL;
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief The firmware's MIDI player measures its own load with this, so provide a real clock for it
+ *
+ * @return The time since an arbitrary point, in microseconds
+ */
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Print how to use this program
+ */
+static void printUsage(void)
+{
+    printf("Usage:\n  midi_render\n    [-j JOBS]\n    [-o OUTPUT_DIRECTORY]\n    [-g GOLDEN_DIRECTORY]\n"
+           "    [-t MAX_SECONDS]\n    [-v VOICES]\n    [FILE_OR_DIRECTORY ...]\n");
+    printf("\nRenders each .mid file with the Swadge's MIDI player as fast as possible. Directories are searched\n"
+           "recursively, and ./assets is used if nothing is given. JOBS songs are rendered at once, and defaults to\n"
+           "the number of CPUs. If OUTPUT_DIRECTORY is given, each song is written there as an 8-bit WAV file. If\n"
+           "GOLDEN_DIRECTORY is given, each song is compared to the WAV file of the same name there, and the exit\n"
+           "status is nonzero if any differ. If VOICES is given, songs are rendered with only that many pooled\n"
+           "voices, to see how voice stealing copes with dense songs.\n\n");
+}
+
+/**
+ * @brief Check if a path has a MIDI file extension
+ *
+ * @param path The path to check
+ * @return true if the path ends in .mid or .midi
+ */
+static bool isMidiFile(const char* path)
+{
+    const char* ext = strrchr(path, '.');
+    return (NULL != ext) && (0 == strcasecmp(ext, ".mid") || 0 == strcasecmp(ext, ".midi"));
+}
+
+/**
+ * @brief Add a file to songPaths if it's a MIDI file. Called by ftw() for each file in a directory
+ *
+ * @param path The path to the file
+ * @param st Unused
+ * @param tflag The type of the file
+ * @return 0 to continue the search
+ */
+static int collectFile(const char* path, const struct stat* st __attribute__((unused)), int tflag)
+{
+    if (FTW_F == tflag && isMidiFile(path))
+    {
+        songPaths             = realloc(songPaths, sizeof(char*) * (numSongs + 1));
+        songPaths[numSongs++] = strdup(path);
+    }
+    return 0;
+}
+
+/**
+ * @brief Compare two strings for qsort()
+ *
+ * @param a A pointer to the first string pointer
+ * @param b A pointer to the second string pointer
+ * @return The result of strcmp()
+ */
+static int compareStrings(const void* a, const void* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * @brief Read an entire file into memory allocated with heap_caps_malloc()
+ *
+ * @param path The file to read
+ * @param size [out] The size of the file
+ * @return The file's contents, or NULL if it couldn't be read
+ */
+static uint8_t* readFile(const char* path, size_t* size)
+{
+    FILE* fp = fopen(path, "rb");
+    if (NULL == fp)
+    {
+        return NULL;
+    }
+
+    fseek(fp, 0L, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0L, SEEK_SET);
+
+    uint8_t* data = (len > 0) ? heap_caps_malloc(len, MALLOC_CAP_8BIT) : NULL;
+    if (NULL != data && 1 != fread(data, len, 1, fp))
+    {
+        heap_caps_free(data);
+        data = NULL;
+    }
+    fclose(fp);
+
+    *size = len;
+    return data;
+}
+
+/**
+ * @brief Read the samples from a WAV file written by writeWav()
+ *
+ * @param path The file to read
+ * @param numSamples [out] The number of samples read
+ * @return The samples, or NULL if the file couldn't be read. Free this with free()
+ */
+static uint8_t* readWav(const char* path, uint32_t* numSamples)
+{
+    FILE* fp = fopen(path, "rb");
+    if (NULL == fp)
+    {
+        return NULL;
+    }
+
+    // Skip the RIFF header, then look for the data chunk
+    uint8_t* data = NULL;
+    uint8_t chunk[8];
+    fseek(fp, 12L, SEEK_SET);
+    while (NULL == data && 1 == fread(chunk, sizeof(chunk), 1, fp))
+    {
+        uint32_t chunkLen = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+        if (0 == memcmp(chunk, "data", 4))
+        {
+            // Golden files are much larger than anything the Swadge's heap allows, so don't use it
+            data        = malloc(MAX(chunkLen, 1));
+            *numSamples = fread(data, 1, chunkLen, fp);
+        }
+        else
+        {
+            fseek(fp, chunkLen + (chunkLen & 1), SEEK_CUR);
+        }
+    }
+
+    fclose(fp);
+    return data;
+}
+
+/**
+ * @brief Write samples to an unsigned 8-bit mono WAV file at the DAC's sample rate
+ *
+ * @param path The file to write
+ * @param samples The samples to write
+ * @param numSamples The number of samples to write
+ * @return true if the file was written
+ */
+static bool writeWav(const char* path, const uint8_t* samples, uint32_t numSamples)
+{
+    FILE* fp = fopen(path, "wb");
+    if (NULL == fp)
+    {
+        return false;
+    }
+
+    // The sizes and rates in the header, in the order they are written
+    const uint32_t fields[] = {
+        WAV_HEADER_SIZE - 8 + numSamples, // RIFF chunk size
+        16,                               // fmt chunk size
+        1 | (1 << 16),                    // PCM format, one channel
+        DAC_SAMPLE_RATE_HZ,               // Sample rate
+        DAC_SAMPLE_RATE_HZ,               // Byte rate
+        1 | (8 << 16),                    // Block alignment, bits per sample
+        numSamples,                       // data chunk size
+    };
+    const char* tags[] = {"RIFF", "WAVEfmt ", NULL, NULL, NULL, NULL, "data"};
+
+    uint8_t header[WAV_HEADER_SIZE];
+    size_t pos = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(fields); i++)
+    {
+        if (NULL != tags[i])
+        {
+            memcpy(&header[pos], tags[i], strlen(tags[i]));
+            pos += strlen(tags[i]);
+        }
+        for (int b = 0; b < 4; b++)
+        {
+            header[pos++] = (fields[i] >> (8 * b)) & 0xFF;
+        }
+    }
+
+    bool ok = (1 == fwrite(header, sizeof(header), 1, fp)) && (numSamples == fwrite(samples, 1, numSamples, fp));
+    fclose(fp);
+    return ok;
+}
+
+/**
+ * @brief Build the path of a WAV file in a directory, named after a MIDI file
+ *
+ * @param out [out] The path is written here
+ * @param outLen The size of out
+ * @param dir The directory the WAV file is in
+ * @param midiPath The path to the MIDI file
+ */
+static void makeOutputPath(char* out, size_t outLen, const char* dir, const char* midiPath)
+{
+    const char* name = strrchr(midiPath, '/');
+    name             = (NULL != name) ? name + 1 : midiPath;
+
+    const char* ext = strrchr(name, '.');
+    snprintf(out, outLen, "%s/%.*s.wav", dir, (int)(ext - name), name);
+}
+
+/**
+ * @brief Update the peak voice counts with the voices which are currently sounding
+ *
+ * @param player The player to count voices in
+ * @param result [out] The peak counts are updated here
+ */
+static void countVoices(const midiPlayer_t* player, renderResult_t* result)
+{
+    // These are the same voices that midiPlayerStep() steps
+    const voiceStates_t* pool = &player->poolVoiceStates;
+    const voiceStates_t* perc = &player->percVoiceStates;
+    uint8_t poolVoices        = __builtin_popcount(pool->on | pool->held | pool->sustenuto | pool->release);
+    uint8_t percVoices        = __builtin_popcount(perc->on | perc->held | perc->sustenuto | perc->release);
+
+    result->peakPoolVoices = MAX(result->peakPoolVoices, poolVoices);
+    result->peakPercVoices = MAX(result->peakPercVoices, percVoices);
+}
+
+/**
+ * @brief Render one song, then write it to outDirName and compare it to goldenDirName if they are set
+ *
+ * @param path The MIDI file to render
+ * @param result [out] The outcome of rendering the song
+ */
+static void renderSong(const char* path, renderResult_t* result)
+{
+    memset(result, 0, sizeof(renderResult_t));
+
+    size_t size   = 0;
+    uint8_t* data = readFile(path, &size);
+    if (NULL == data)
+    {
+        return;
+    }
+
+    // Processed assets are heatshrink-compressed, so accept those too
+    uint32_t rawSize = 0;
+    if ((size < 4 || memcmp(data, "MThd", 4)) && heatshrinkDecompress(NULL, &rawSize, data, size))
+    {
+        uint8_t* raw = heap_caps_malloc(rawSize, MALLOC_CAP_8BIT);
+        if (NULL != raw && heatshrinkDecompress(raw, &rawSize, data, size))
+        {
+            heap_caps_free(data);
+            data = raw;
+            size = rawSize;
+        }
+        else
+        {
+            heap_caps_free(raw);
+        }
+    }
+
+    midiFile_t file = {0};
+    if (!loadMidiData(data, size, &file))
+    {
+        heap_caps_free(data);
+        return;
+    }
+
+    midiPlayer_t* player = heap_caps_malloc(sizeof(midiPlayer_t), MALLOC_CAP_8BIT);
+    midiPlayerInit(player);
+
+    // Always use a fixed number of voices, so the output doesn't depend on how fast this machine is
+    midiSetVoiceBudget(player, voiceBudget, false);
+    player->loop = false;
+    midiSetFile(player, &file);
+    midiPause(player, false);
+
+    // Render one DAC buffer at a time, like the firmware does, until the song finishes and pauses itself
+    size_t capacity  = DAC_SAMPLE_RATE_HZ * 60;
+    uint8_t* samples = malloc(capacity);
+    while (!player->paused)
+    {
+        if (result->samples + DAC_BUF_SIZE > maxSamples)
+        {
+            result->truncated = true;
+            break;
+        }
+
+        if (result->samples + DAC_BUF_SIZE > capacity)
+        {
+            capacity *= 2;
+            samples = realloc(samples, capacity);
+        }
+
+        int64_t start = esp_timer_get_time();
+        midiPlayerFillBuffer(player, &samples[result->samples], DAC_BUF_SIZE);
+        int64_t blockUs = esp_timer_get_time() - start;
+        result->renderUs += blockUs;
+        result->maxBlockUs = MAX(result->maxBlockUs, blockUs);
+        result->samples += DAC_BUF_SIZE;
+
+        countVoices(player, result);
+    }
+    result->clipped     = player->clipped;
+    result->stolenNotes = player->stolenNotes;
+    result->loaded      = true;
+
+    char wavPath[1024];
+    if (NULL != outDirName)
+    {
+        makeOutputPath(wavPath, sizeof(wavPath), outDirName, path);
+        if (!writeWav(wavPath, samples, result->samples))
+        {
+            fprintf(stderr, "Cannot write '%s'\n", wavPath);
+        }
+    }
+
+    if (NULL != goldenDirName)
+    {
+        makeOutputPath(wavPath, sizeof(wavPath), goldenDirName, path);
+        uint32_t goldenLen = 0;
+        uint8_t* golden    = readWav(wavPath, &goldenLen);
+        if (NULL == golden)
+        {
+            fprintf(stderr, "Cannot read golden file '%s'\n", wavPath);
+        }
+        else
+        {
+            // Any samples missing from either file count as mismatches
+            uint32_t common        = MIN(goldenLen, result->samples);
+            result->goldenChecked  = true;
+            result->goldenMismatch = MAX(goldenLen, result->samples) - common;
+            for (uint32_t i = 0; i < common; i++)
+            {
+                if (golden[i] != samples[i])
+                {
+                    result->goldenMismatch++;
+                    result->goldenMaxDiff = MAX(result->goldenMaxDiff, abs(golden[i] - samples[i]));
+                }
+            }
+            free(golden);
+        }
+    }
+
+    free(samples);
+    deinitMidiParser(&player->reader);
+    heap_caps_free(player);
+    unloadMidiFile(&file);
+}
+
+/**
+ * @brief Render every song in songPaths, numJobs at a time, and store the outcomes in results
+ *
+ * Each song is rendered in its own process, because the synthesizer keeps some state in static variables, and
+ * sharing that between songs would make the output depend on which songs happened to render at the same time.
+ */
+static void renderAll(void)
+{
+    if (numJobs <= 1)
+    {
+        // Render in this process, which is easier to debug and profile
+        for (size_t i = 0; i < numSongs; i++)
+        {
+            renderSong(songPaths[i], &results[i]);
+        }
+        return;
+    }
+
+    pid_t* pids  = calloc(numSongs, sizeof(pid_t));
+    int* pipes   = calloc(numSongs, sizeof(int));
+    size_t next  = 0;
+    long running = 0;
+    size_t done  = 0;
+    while (done < numSongs)
+    {
+        // Start songs until every job is busy
+        while (running < numJobs && next < numSongs)
+        {
+            int fds[2];
+            if (0 != pipe(fds))
+            {
+                perror("pipe");
+                exit(EXIT_FAILURE);
+            }
+
+            pid_t pid = fork();
+            if (0 == pid)
+            {
+                close(fds[0]);
+                renderResult_t result;
+                renderSong(songPaths[next], &result);
+                ssize_t written = write(fds[1], &result, sizeof(result));
+                _exit((sizeof(result) == written) ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            else if (pid < 0)
+            {
+                perror("fork");
+                exit(EXIT_FAILURE);
+            }
+
+            close(fds[1]);
+            pids[next]  = pid;
+            pipes[next] = fds[0];
+            next++;
+            running++;
+        }
+
+        // Wait for any song to finish, then collect its result
+        int status = 0;
+        pid_t pid  = wait(&status);
+        if (pid < 0)
+        {
+            perror("wait");
+            exit(EXIT_FAILURE);
+        }
+
+        for (size_t i = 0; i < next; i++)
+        {
+            if (pids[i] == pid)
+            {
+                if (sizeof(renderResult_t) != read(pipes[i], &results[i], sizeof(renderResult_t)))
+                {
+                    // The worker crashed, so the song counts as not rendered
+                    memset(&results[i], 0, sizeof(renderResult_t));
+                }
+                close(pipes[i]);
+                break;
+            }
+        }
+        running--;
+        done++;
+    }
+
+    free(pids);
+    free(pipes);
+}
+
+/**
+ * @brief Print one line describing the outcome of rendering a song
+ *
+ * @param path The MIDI file which was rendered
+ * @param result The outcome of rendering it
+ */
+static void printResult(const char* path, const renderResult_t* result)
+{
+    if (!result->loaded)
+    {
+        printf("%-40s FAILED to load\n", path);
+        return;
+    }
+
+    double seconds = (double)result->samples / DAC_SAMPLE_RATE_HZ;
+    double speed   = (result->renderUs > 0) ? seconds * 1000000 / result->renderUs : 0;
+    double blockUs = (result->samples > 0) ? (double)result->renderUs * DAC_BUF_SIZE / result->samples : 0;
+    printf("%-40s %7.1fs %8.1fx %8" PRIu32 " %3" PRIu8 "/%-3" PRIu8 " %3" PRIu8 "/%-3d %7" PRIu32 " %6.0f/%-6" PRId64,
+           path, seconds, speed, result->clipped, result->peakPoolVoices, voiceBudget, result->peakPercVoices,
+           PERCUSSION_VOICES, result->stolenNotes, blockUs, result->maxBlockUs);
+
+    if (result->truncated)
+    {
+        printf(" truncated");
+    }
+    if (result->goldenChecked)
+    {
+        if (0 == result->goldenMismatch)
+        {
+            printf(" golden OK");
+        }
+        else
+        {
+            printf(" golden MISMATCH %" PRIu64 " samples, max diff %" PRIu8, result->goldenMismatch,
+                   result->goldenMaxDiff);
+        }
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Render MIDI files with the Swadge's MIDI player and report how it went
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ * @return 0 if every song rendered and matched its golden file, 1 otherwise
+ */
+int main(int argc, char** argv)
+{
+    numJobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    int c;
+    while (-1 != (c = getopt(argc, argv, "hj:o:g:t:v:")))
+    {
+        switch (c)
+        {
+            case 'j':
+            {
+                numJobs = strtol(optarg, NULL, 10);
+                break;
+            }
+            case 'o':
+            {
+                outDirName = optarg;
+                mkdir(outDirName, 0755);
+                break;
+            }
+            case 'g':
+            {
+                goldenDirName = optarg;
+                break;
+            }
+            case 't':
+            {
+                maxSamples = strtoull(optarg, NULL, 10) * DAC_SAMPLE_RATE_HZ;
+                break;
+            }
+            case 'v':
+            {
+                voiceBudget = CLAMP(strtol(optarg, NULL, 10), 1, POOL_VOICE_COUNT);
+                break;
+            }
+            case 'h':
+            default:
+            {
+                printUsage();
+                return (c == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (optind >= argc)
+    {
+        ftw("./assets", collectFile, 16);
+    }
+    for (int i = optind; i < argc; i++)
+    {
+        ftw(argv[i], collectFile, 16);
+    }
+    qsort(songPaths, numSongs, sizeof(char*), compareStrings);
+
+    if (0 == numSongs)
+    {
+        fprintf(stderr, "No MIDI files found\n");
+        return EXIT_FAILURE;
+    }
+
+    // The drum samples are in the asset image
+    initCnfs();
+
+    results = calloc(numSongs, sizeof(renderResult_t));
+
+    int64_t start = esp_timer_get_time();
+    renderAll();
+    int64_t wallUs = esp_timer_get_time() - start;
+
+    printf("%-40s %8s %9s %8s %7s %7s %7s %13s\n", "Song", "Length", "Speed", "Clipped", "Voices", "Drums", "Stolen",
+           "Block us");
+
+    uint64_t totalSamples = 0;
+    int64_t totalRenderUs = 0;
+    int64_t maxBlockUs    = 0;
+    uint64_t totalStolen  = 0;
+    int failures          = 0;
+    for (size_t i = 0; i < numSongs; i++)
+    {
+        printResult(songPaths[i], &results[i]);
+        totalSamples += results[i].samples;
+        totalRenderUs += results[i].renderUs;
+        maxBlockUs = MAX(maxBlockUs, results[i].maxBlockUs);
+        totalStolen += results[i].stolenNotes;
+        if (!results[i].loaded || (results[i].goldenChecked && results[i].goldenMismatch)
+            || (NULL != goldenDirName && !results[i].goldenChecked))
+        {
+            failures++;
+        }
+        free(songPaths[i]);
+    }
+
+    double seconds = (double)totalSamples / DAC_SAMPLE_RATE_HZ;
+    printf("\n%zu songs, %.1fs of audio rendered in %.2fs with %ld jobs\n", numSongs, seconds,
+           (double)wallUs / 1000000, numJobs);
+    if (totalRenderUs > 0 && wallUs > 0)
+    {
+        printf("Single core speed %.1fx realtime, overall %.1fx realtime\n", seconds * 1000000 / totalRenderUs,
+               seconds * 1000000 / wallUs);
+        printf("%" PRIu64 " notes stolen, %.0fus mean and %" PRId64 "us longest block render, with a %" PRId64
+               "us deadline\n",
+               totalStolen, (double)totalRenderUs * DAC_BUF_SIZE / totalSamples, maxBlockUs,
+               (int64_t)SAMPLES_TO_US(DAC_BUF_SIZE));
+    }
+    if (0 != failures)
+    {
+        printf("%d songs failed\n", failures);
+    }
+
+    free(songPaths);
+    free(results);
+    return (0 == failures) ? EXIT_SUCCESS : EXIT_FAILURE;
+}